@@ -0,0 +1,269 @@
+/*
+ * ColumnDB C microbenchmarks
+ * Times ingest, wide-table lookup, scan, save and load; prints JSON.
+ *
+ * Usage: bench_columndb [--rows N] [--output FILE]
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L  /* clock_gettime */
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "../include/column_db.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define DEFAULT_ROWS 1000000
+#define BATCH_ROWS 65536
+#define WIDE_COLUMNS 256
+#define WIDE_ROWS 2000
+#define BENCH_FILE "bench_columndb.cdb"
+
+/* One JSON result line is written per benchmark */
+static FILE* out;
+static int num_results = 0;
+
+/* Monotonic time in seconds */
+static double now_seconds(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+/* Record a result; bytes may be 0 when throughput in MB/s is meaningless */
+static void report(const char* name, double seconds, size_t rows, size_t bytes) {
+    fprintf(out, "%s\n    {\"name\": \"%s\", \"seconds\": %.6f, \"rows\": %zu, \"rows_per_sec\": %.1f",
+            num_results ? "," : "", name, seconds, rows, seconds > 0 ? rows / seconds : 0.0);
+    if (bytes > 0) {
+        fprintf(out, ", \"bytes\": %zu, \"mb_per_sec\": %.1f", bytes,
+                seconds > 0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0);
+    }
+    fprintf(out, "}");
+    num_results++;
+}
+
+static void fail(const char* what) {
+    fprintf(stderr, "benchmark failed: %s: %s\n", what, cdb_get_error());
+    exit(1);
+}
+
+static cdb_database_t* create_table(const char* name, cdb_data_type_t type) {
+    cdb_database_t* db = cdb_create_database();
+    if (!db || cdb_add_column(db, name, type) < 0) fail("create table");
+    return db;
+}
+
+/* Per-row ingest by name and by handle */
+static void bench_row_ingest(size_t rows) {
+    cdb_database_t* db = create_table("v", CDB_TYPE_INT64);
+    double start = now_seconds();
+    for (size_t i = 0; i < rows; i++) {
+        if (cdb_insert_int64(db, "v", (int64_t)i) < 0) fail("insert_int64");
+    }
+    report("ingest_row_int64", now_seconds() - start, rows, rows * sizeof(int64_t));
+    cdb_free_database(db);
+
+    db = create_table("v", CDB_TYPE_INT64);
+    size_t col = (size_t)cdb_get_column_index(db, "v");
+    start = now_seconds();
+    for (size_t i = 0; i < rows; i++) {
+        if (cdb_insert_int64_h(db, col, (int64_t)i) < 0) fail("insert_int64_h");
+    }
+    report("ingest_row_int64_handle", now_seconds() - start, rows, rows * sizeof(int64_t));
+    cdb_free_database(db);
+
+    db = create_table("v", CDB_TYPE_INT64);
+    start = now_seconds();
+    if (cdb_reserve(db, "v", rows) < 0) fail("reserve");
+    for (size_t i = 0; i < rows; i++) {
+        if (cdb_insert_int64_h(db, col, (int64_t)i) < 0) fail("insert_int64_h");
+    }
+    report("ingest_row_int64_reserved", now_seconds() - start, rows, rows * sizeof(int64_t));
+    cdb_free_database(db);
+}
+
+/* Bulk ingest in batches */
+static void bench_bulk_ingest(size_t rows) {
+    int64_t* batch = (int64_t*)malloc(BATCH_ROWS * sizeof(int64_t));
+    if (!batch) fail("allocate batch");
+    for (size_t i = 0; i < BATCH_ROWS; i++) batch[i] = (int64_t)i;
+
+    cdb_database_t* db = create_table("v", CDB_TYPE_INT64);
+    double start = now_seconds();
+    for (size_t done = 0; done < rows; done += BATCH_ROWS) {
+        size_t n = rows - done < BATCH_ROWS ? rows - done : BATCH_ROWS;
+        if (cdb_append_int64_array(db, "v", batch, n, NULL) < 0) fail("append_int64_array");
+    }
+    report("ingest_bulk_int64", now_seconds() - start, rows, rows * sizeof(int64_t));
+    cdb_free_database(db);
+    free(batch);
+}
+
+/* String ingest, per row and bulk */
+static void bench_string_ingest(size_t rows) {
+    char buf[32];
+    size_t bytes = 0;
+
+    cdb_database_t* db = create_table("s", CDB_TYPE_STRING);
+    double start = now_seconds();
+    for (size_t i = 0; i < rows; i++) {
+        snprintf(buf, sizeof(buf), "user-%zu", i);
+        bytes += strlen(buf);
+        if (cdb_insert_string(db, "s", buf) < 0) fail("insert_string");
+    }
+    report("ingest_row_string", now_seconds() - start, rows, bytes);
+    cdb_free_database(db);
+
+    static const char* statuses[] = {"active", "pending", "closed", "archived"};
+    const char** values = (const char**)malloc(BATCH_ROWS * sizeof(char*));
+    if (!values) fail("allocate batch");
+    for (size_t i = 0; i < BATCH_ROWS; i++) values[i] = statuses[i % 4];
+
+    cdb_data_type_t types[] = {CDB_TYPE_STRING, CDB_TYPE_DICT_STRING};
+    const char* names[] = {"ingest_bulk_string_lowcard", "ingest_bulk_dict_string"};
+    for (int t = 0; t < 2; t++) {
+        db = create_table("s", types[t]);
+        start = now_seconds();
+        for (size_t done = 0; done < rows; done += BATCH_ROWS) {
+            size_t n = rows - done < BATCH_ROWS ? rows - done : BATCH_ROWS;
+            if (cdb_append_string_array(db, "s", values, n, NULL) < 0) fail("append_string_array");
+        }
+        report(names[t], now_seconds() - start, rows, 0);
+        cdb_free_database(db);
+    }
+    free(values);
+}
+
+/* Insert by name into a wide table, where name resolution dominates */
+static void bench_wide_table(void) {
+    char names[WIDE_COLUMNS][16];
+    cdb_database_t* db = cdb_create_database();
+    if (!db) fail("create table");
+    for (int c = 0; c < WIDE_COLUMNS; c++) {
+        snprintf(names[c], sizeof(names[c]), "col_%03d", c);
+        if (cdb_add_column(db, names[c], CDB_TYPE_INT32) < 0) fail("add_column");
+    }
+
+    double start = now_seconds();
+    for (int r = 0; r < WIDE_ROWS; r++) {
+        for (int c = 0; c < WIDE_COLUMNS; c++) {
+            if (cdb_insert_int32(db, names[c], r) < 0) fail("insert_int32");
+        }
+    }
+    report("ingest_wide_table_by_name", now_seconds() - start,
+           (size_t)WIDE_ROWS * WIDE_COLUMNS, 0);
+    cdb_free_database(db);
+}
+
+/* Build the mixed table used by the scan, save and load benchmarks */
+static cdb_database_t* build_mixed_table(size_t rows, size_t* bytes) {
+    cdb_database_t* db = cdb_create_database();
+    if (!db || cdb_add_column(db, "id", CDB_TYPE_INT64) < 0 ||
+        cdb_add_column(db, "score", CDB_TYPE_FLOAT64) < 0 ||
+        cdb_add_column(db, "name", CDB_TYPE_STRING) < 0) {
+        fail("create table");
+    }
+
+    char buf[32];
+    *bytes = rows * (sizeof(int64_t) + sizeof(double));
+    for (size_t i = 0; i < rows; i++) {
+        snprintf(buf, sizeof(buf), "name-%zu", i % 10000);
+        *bytes += strlen(buf);
+        if (cdb_insert_int64(db, "id", (int64_t)i) < 0 ||
+            cdb_insert_float64(db, "score", (double)i * 0.5) < 0 ||
+            cdb_insert_string(db, "name", buf) < 0) {
+            fail("insert");
+        }
+    }
+    return db;
+}
+
+/* Aggregate scan over a float64 column */
+static void bench_scan(cdb_database_t* db, size_t rows) {
+    cdb_agg_result_t result;
+    cdb_column_t* col = cdb_get_column(db, "score");
+    double start = now_seconds();
+    if (!col || cdb_aggregate(col, CDB_AGG_SUM, &result) < 0) fail("aggregate");
+    report("scan_sum_float64", now_seconds() - start, rows, rows * sizeof(double));
+}
+
+/* Save, full load and mmap open of the mixed table */
+static void bench_save_load(cdb_database_t* db, size_t rows, size_t bytes) {
+    double start = now_seconds();
+    if (cdb_save_to(db, BENCH_FILE) < 0) fail("save");
+    report("save", now_seconds() - start, rows, bytes);
+
+    cdb_database_t* loaded = cdb_create_database();
+    start = now_seconds();
+    if (!loaded || cdb_load_from(loaded, BENCH_FILE) < 0) fail("load");
+    report("load", now_seconds() - start, rows, bytes);
+    cdb_free_database(loaded);
+
+    const char* projection[] = {"score"};
+    loaded = cdb_create_database();
+    start = now_seconds();
+    if (!loaded || cdb_load_columns(loaded, BENCH_FILE, projection, 1) < 0) fail("load_columns");
+    report("load_one_column", now_seconds() - start, rows, rows * sizeof(double));
+    cdb_free_database(loaded);
+
+    loaded = cdb_create_database();
+    start = now_seconds();
+    if (!loaded || cdb_open_mmap(loaded, BENCH_FILE) < 0) fail("open_mmap");
+    report("open_mmap", now_seconds() - start, rows, 0);
+    cdb_free_database(loaded);
+
+    remove(BENCH_FILE);
+}
+
+int main(int argc, char** argv) {
+    size_t rows = DEFAULT_ROWS;
+    const char* output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rows") == 0 && i + 1 < argc) {
+            rows = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--rows N] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot open %s\n", output);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"suite\": \"columndb-c\",\n  \"rows\": %zu,\n  \"timestamp\": %lld,\n  \"results\": [",
+            rows, (long long)time(NULL));
+
+    bench_row_ingest(rows);
+    bench_bulk_ingest(rows);
+    bench_string_ingest(rows);
+    bench_wide_table();
+
+    size_t bytes;
+    cdb_database_t* db = build_mixed_table(rows, &bytes);
+    bench_scan(db, rows);
+    bench_save_load(db, rows, bytes);
+    cdb_free_database(db);
+
+    fprintf(out, "\n  ]\n}\n");
+    if (output) fclose(out);
+    return 0;
+}
@@ -0,0 +1,204 @@
+"""
+ColumnDB Python benchmarks
+
+Times the Python API paths (ingest, export, save/load, aggregates) and
+writes the results as JSON, in the same shape as bench_columndb.c.
+
+Usage:
+    python bench/bench_columndb.py [--rows N] [--repeat R] [--output FILE]
+"""
+
+import argparse
+import array
+import json
+import os
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+
+from columndb import BatchWriter, ColumnDB, DataType
+
+
+def best_of(repeat, func):
+    """Run func() repeat times and return the fastest wall time in seconds."""
+    best = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        func()
+        elapsed = time.perf_counter() - start
+        if best is None or elapsed < best:
+            best = elapsed
+    return best
+
+
+def result(name, seconds, rows, nbytes=0):
+    entry = {
+        "name": name,
+        "seconds": round(seconds, 6),
+        "rows": rows,
+        "rows_per_sec": round(rows / seconds, 1) if seconds > 0 else 0.0,
+    }
+    if nbytes:
+        entry["bytes"] = nbytes
+        entry["mb_per_sec"] = round(nbytes / seconds / (1024 * 1024), 1) if seconds > 0 else 0.0
+    return entry
+
+
+def make_table(rows):
+    db = ColumnDB()
+    db.add_column("id", DataType.INT64)
+    db.add_column("score", DataType.FLOAT64)
+    db.add_column("name", DataType.STRING)
+    db.add_column("status", DataType.DICT_STRING)
+    db.append_array("id", array.array('q', range(rows)))
+    db.append_array("score", array.array('d', (i * 0.5 for i in range(rows))))
+    db.append_array("name", [f"name-{i % 10000}" for i in range(rows)])
+    db.append_array("status", [("active", "pending", "closed")[i % 3] for i in range(rows)])
+    return db
+
+
+def run(rows, repeat):
+    results = []
+    ids = array.array('q', range(rows))
+    names = [f"user-{i}" for i in range(rows)]
+
+    def ingest_rows():
+        db = ColumnDB()
+        db.add_column("v", DataType.INT64)
+        for i in range(rows):
+            db.insert("v", i)
+
+    def ingest_bulk():
+        db = ColumnDB()
+        db.add_column("v", DataType.INT64)
+        db.append_array("v", ids)
+
+    def ingest_strings():
+        db = ColumnDB()
+        db.add_column("s", DataType.STRING)
+        db.append_array("s", names)
+
+    row_tuples = [(i, i * 0.5, names[i]) for i in range(rows)]
+
+    def ingest_row_batch():
+        db = ColumnDB()
+        db.add_column("id", DataType.INT64)
+        db.add_column("score", DataType.FLOAT64)
+        db.add_column("name", DataType.STRING)
+        db.insert_rows(row_tuples)
+
+    results.append(result("ingest_row_int64", best_of(repeat, ingest_rows), rows, rows * 8))
+    results.append(result("ingest_row_batch_mixed", best_of(repeat, ingest_row_batch), rows))
+    results.append(result("ingest_bulk_int64", best_of(repeat, ingest_bulk), rows, rows * 8))
+    results.append(result("ingest_bulk_string", best_of(repeat, ingest_strings), rows,
+                          sum(len(s) for s in names)))
+
+    db = make_table(rows)
+    results.append(result("get_column_data_int64",
+                          best_of(repeat, lambda: db.get_column_data("id")), rows, rows * 8))
+    results.append(result("get_column_data_string",
+                          best_of(repeat, lambda: db.get_column_data("name")), rows))
+    results.append(result("get_column_buffer_float64",
+                          best_of(repeat, lambda: db.get_column_buffer("score")), rows, rows * 8))
+    results.append(result("sum_float64", best_of(repeat, lambda: db.sum("score")), rows, rows * 8))
+    db.set_sorted("id")
+    results.append(result("range_sorted_int64",
+                          best_of(repeat, lambda: db.range("id", rows // 4, rows // 2)), rows))
+    results.append(result("group_by_dict_sum",
+                          best_of(repeat, lambda: db.group_by("status", [("sum", "score")])),
+                          rows))
+    results.append(result("filter_float64",
+                          best_of(repeat, lambda: db.filter(("score", ">", 50.0), ["id"])),
+                          rows, rows * 8))
+    db.create_index("status", "bitmap")
+    results.append(result("filter_bitmap_index",
+                          best_of(repeat, lambda: db.filter(("status", "==", "closed"), ["id"])),
+                          rows))
+    db.drop_index("status")
+
+    fd, path = tempfile.mkstemp(suffix=".cdb")
+    os.close(fd)
+    try:
+        seconds = best_of(repeat, lambda: db.save(path))
+        nbytes = os.path.getsize(path)
+        results.append(result("save", seconds, rows, nbytes))
+        results.append(result("load", best_of(repeat, lambda: ColumnDB.load(path)), rows, nbytes))
+        results.append(result("load_mmap",
+                              best_of(repeat, lambda: ColumnDB.load(path, mmap=True)), rows))
+        results.append(result("load_one_column",
+                              best_of(repeat, lambda: ColumnDB.load(path, columns=["score"])),
+                              rows, rows * 8))
+        results.append(result("iter_batches_sum",
+                              best_of(repeat, lambda: sum(b.sum("score")
+                                                          for b in ColumnDB.iter_batches(path, ["score"]))),
+                              rows, rows * 8))
+        seconds = best_of(repeat, lambda: db.save(path, compression="zlib"))
+        nbytes = os.path.getsize(path)
+        results.append(result("save_zlib", seconds, rows, nbytes))
+        results.append(result("load_zlib", best_of(repeat, lambda: ColumnDB.load(path)), rows, nbytes))
+
+        # make_table is deterministic, so the grown table extends the file's rows
+        delta = max(rows // 100, 1)
+        grown = make_table(rows + delta)
+        seconds = None
+        for _ in range(repeat):
+            db.save(path)
+            start = time.perf_counter()
+            grown.save(path, append=True)
+            elapsed = time.perf_counter() - start
+            seconds = elapsed if seconds is None else min(seconds, elapsed)
+        results.append(result("save_append", seconds, delta))
+
+        batches = [db.filter([("id", ">=", start), ("id", "<", start + 65536)])
+                   for start in range(0, rows, 65536)]
+
+        def write_batches():
+            with BatchWriter(path, db, flush_rows=max(rows // 4, 1)) as writer:
+                for batch in batches:
+                    writer.write(batch)
+
+        results.append(result("batch_writer", best_of(repeat, write_batches), rows))
+    finally:
+        os.remove(path)
+
+    results.append(result("arrow_export", best_of(repeat, lambda: db.__arrow_c_stream__()), rows))
+    results.append(result("from_arrow", best_of(repeat, lambda: ColumnDB.from_arrow(db)), rows))
+
+    try:
+        import pandas  # noqa: F401
+    except ImportError:
+        pass
+    else:
+        results.append(result("to_pandas", best_of(repeat, db.to_pandas), rows))
+
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ColumnDB Python benchmarks")
+    parser.add_argument("--rows", type=int, default=200000)
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--output", help="Write JSON here instead of stdout")
+    args = parser.parse_args()
+
+    report = {
+        "suite": "columndb-python",
+        "rows": args.rows,
+        "repeat": args.repeat,
+        "timestamp": int(time.time()),
+        "python": sys.version.split()[0],
+        "results": run(args.rows, args.repeat),
+    }
+
+    text = json.dumps(report, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -20,6 +20,11 @@ class DataType:
     FLOAT64 = 3
     STRING = 4
     BOOL = 5
+    DICT_STRING = 6  # Dictionary-encoded string, for low-cardinality data
+
+
+# Block compression codecs accepted by ColumnDB.save(compression=...)
+COMPRESSION_CODECS = {"zlib": 1, "zstd": 2, "lz4": 3}
 
 
 class ColumnDB:
@@ -45,6 +50,15 @@ class ColumnDB:
         >>> print(data)  # ['Alice']
     """
     
+    _GROUP_OPS = {
+        "sum": _columndb.AGG_SUM, "min": _columndb.AGG_MIN, "max": _columndb.AGG_MAX,
+        "count": _columndb.AGG_COUNT, "mean": _columndb.AGG_MEAN,
+    }
+    
+    _INDEX_KINDS = {
+        "hash": _columndb.INDEX_HASH, "bitmap": _columndb.INDEX_BITMAP, "auto": _columndb.INDEX_AUTO,
+    }
+    
     def __init__(self, filename: Optional[str] = None):
         """
         Initialize a new database.
@@ -80,7 +94,7 @@ class ColumnDB:
         if name in self._columns:
             raise ValueError(f"Column '{name}' already exists")
         
-        if data_type < DataType.INT32 or data_type > DataType.BOOL:
+        if data_type < DataType.INT32 or data_type > DataType.DICT_STRING:
             raise ValueError(f"Invalid data type: {data_type}")
         
         try:
@@ -116,13 +130,146 @@ class ColumnDB:
             self._db.insert_float32(column_name, float(value))
         elif data_type == DataType.FLOAT64:
             self._db.insert_float64(column_name, float(value))
-        elif data_type == DataType.STRING:
+        elif data_type in (DataType.STRING, DataType.DICT_STRING):
             self._db.insert_string(column_name, str(value))
         elif data_type == DataType.BOOL:
             self._db.insert_bool(column_name, bool(value))
         else:
             raise ValueError(f"Unknown data type: {data_type}")
     
+    def append_array(self, column_name: str, values: Any,
+                     null_bitmap: Optional[Any] = None) -> None:
+        """
+        Append many values to a column in a single call.
+        
+        Numeric and bool columns accept any C-contiguous buffer-protocol
+        object (numpy array, array.array, memoryview) whose item type
+        matches the column; the data is copied with one memcpy. String
+        and dictionary columns accept a sequence of str/None.
+        
+        Args:
+            column_name: Name of the column
+            values: Buffer or sequence of values to append
+            null_bitmap: Optional bytes-like bitmap, bit i set marks row i NULL
+            
+        Raises:
+            ValueError: If column doesn't exist, null_bitmap is too short,
+                or a string contains a NUL character
+            TypeError: If the buffer format doesn't match the column type
+        """
+        self._db.append_array(column_name, values, null_bitmap)
+    
+    def insert_rows(self, rows: Any) -> None:
+        """
+        Insert a batch of rows in a single call.
+        
+        Each row is a tuple (or other sequence) with one value per column,
+        in column order; None inserts NULL. Values are converted in C one
+        column at a time, which is much faster than calling insert() for
+        every value. Either all rows are inserted or none is.
+        
+        Args:
+            rows: Sequence of rows
+            
+        Raises:
+            ValueError: If a row has the wrong number of values or a
+                string contains a NUL character
+            TypeError: If a value doesn't match its column's type
+            OverflowError: If an integer doesn't fit its column
+            RuntimeError: If the columns have different row counts
+        """
+        self._db.insert_rows(rows)
+    
+    def filter(self, where: Any, columns: Optional[List[str]] = None) -> 'ColumnDB':
+        """
+        Copy the rows matching a filter into a new database.
+        
+        The filter is evaluated in C a column at a time, with vectorized
+        comparisons into selection bitmaps; only the matching rows of the
+        projected columns are copied.
+        
+        Args:
+            where: A comparison ``(column, op, value)`` with op one of
+                ``==``, ``!=``, ``<``, ``<=``, ``>``, ``>=``, or
+                ``(column, "is null")`` / ``(column, "is not null")``;
+                ``("and", term, term, ...)`` / ``("or", term, ...)`` combine
+                terms, and a list of terms means all of them.
+            columns: Columns to copy (default: all)
+            
+        Returns:
+            New ColumnDB with the matching rows
+            
+        Raises:
+            ValueError: If a column doesn't exist or a term is malformed
+            TypeError: If a value doesn't match its column's type
+            
+        Example:
+            >>> db.filter([("price", ">", 100), ("status", "==", "open")])
+        """
+        if isinstance(where, list):
+            where = ("and", *where)
+        
+        instance = ColumnDB.__new__(ColumnDB)
+        instance._db = self._db.filter(where, columns)
+        instance._filename = None
+        names = set(instance._db.get_column_names())
+        instance._columns = {name: t for name, t in self._columns.items() if name in names}
+        return instance
+    
+    def group_by(self, key: str, aggregates: Optional[List[tuple]] = None) -> 'ColumnDB':
+        """
+        Group rows by a key column and aggregate each group, in C.
+        
+        Rows are hashed into groups a thread's share of the rows at a time
+        (see set_num_threads()), then the partial groups are merged. Groups
+        come out in order of first appearance; NULL keys form one group.
+        
+        Args:
+            key: Key column; int32, int64, bool or dictionary-encoded string
+            aggregates: ``(op, column)`` or ``(op, column, name)`` tuples with
+                op one of ``sum``, ``min``, ``max``, ``count``, ``mean``;
+                ``("count", None)`` counts rows. Result columns are named
+                ``<op>_<column>`` (or ``count``) unless a name is given.
+                Default: ``[("count", None)]``.
+                
+        Returns:
+            New ColumnDB with the key column, then one column per aggregate
+            (INT64, or FLOAT64 for float columns and mean; None for groups
+            without values)
+            
+        Raises:
+            ValueError: If a column doesn't exist, the key type can't be
+                grouped or an aggregate is invalid
+                
+        Example:
+            >>> db.group_by("city", [("sum", "sales"), ("mean", "age", "avg_age")])
+        """
+        if aggregates is None:
+            aggregates = [("count", None)]
+        
+        specs = []
+        for aggregate in aggregates:
+            if not isinstance(aggregate, tuple) or len(aggregate) not in (2, 3):
+                raise ValueError("Aggregates must be (op, column) or (op, column, name) tuples")
+            op = self._GROUP_OPS.get(aggregate[0])
+            if op is None:
+                raise ValueError(f"Unknown aggregate: {aggregate[0]!r}")
+            specs.append((op,) + tuple(aggregate[1:]))
+        
+        instance = ColumnDB.__new__(ColumnDB)
+        instance._db = self._db.group_by(key, specs)
+        instance._filename = None
+        instance._columns = {}
+        names = instance._db.get_column_names()
+        if key in self._columns:
+            instance._columns[key] = self._columns[key]
+        for name, aggregate in zip(names[1:], aggregates):
+            floats = (DataType.FLOAT32, DataType.FLOAT64)
+            is_float = aggregate[0] == "mean" or (
+                aggregate[0] != "count" and self._columns.get(aggregate[1]) in floats)
+            instance._columns[name] = DataType.FLOAT64 if is_float else DataType.INT64
+        return instance
+    
     def get_column_data(self, column_name: str) -> List[Any]:
         """
         Retrieve all data from a column as a list.
@@ -143,6 +290,109 @@ class ColumnDB:
         except RuntimeError as e:
             raise ValueError(f"Column '{column_name}' does not exist: {e}")
     
+    def get_column_buffer(self, column_name: str) -> memoryview:
+        """
+        Get a zero-copy, read-only view of a numeric or bool column.
+        
+        For DICT_STRING columns the view holds the uint32 dictionary codes
+        (format "I"); see get_dictionary().
+        
+        The memoryview (and anything built on it, e.g. numpy.asarray)
+        points straight at the C column storage and keeps the database
+        alive. While any such view exists, inserts into the database raise
+        BufferError, since growing a column may move its memory.
+        
+        Args:
+            column_name: Name of the column
+            
+        Returns:
+            memoryview with a struct format matching the column type
+            
+        Raises:
+            ValueError: If column doesn't exist
+            TypeError: If the column is a string column
+        """
+        return self._db.get_column_buffer(column_name)
+    
+    def get_dictionary(self, column_name: str) -> List[str]:
+        """
+        Get the distinct values of a DICT_STRING column.
+        
+        Entry i is the value of code i, so an equality filter can be
+        computed on the codes from get_column_buffer() instead of on
+        strings.
+        
+        Args:
+            column_name: Name of the column
+            
+        Returns:
+            List of distinct values in first-seen order
+            
+        Raises:
+            ValueError: If column doesn't exist
+            TypeError: If the column is not dictionary-encoded
+        """
+        return self._db.get_dictionary(column_name)
+    
+    def get_null_bitmap(self, column_name: str) -> memoryview:
+        """
+        Get a zero-copy, read-only view of a column's null bitmap.
+        
+        Bit i (LSB first within each byte) is set when row i is NULL.
+        
+        Args:
+            column_name: Name of the column
+            
+        Returns:
+            memoryview of (num_rows + 7) // 8 bytes
+            
+        Raises:
+            ValueError: If column doesn't exist
+        """
+        return self._db.get_null_bitmap(column_name)
+    
+    def sum(self, column_name: str) -> Optional[Union[int, float]]:
+        """
+        Sum of a numeric or bool column's non-NULL values, computed in C.
+        
+        Integer columns give an int (int64 arithmetic), float columns a
+        float and bool columns the number of True values. Returns None when
+        the column has no non-NULL values.
+        
+        Raises:
+            ValueError: If column doesn't exist
+            TypeError: If the column is a string column
+        """
+        return self._db.aggregate(column_name, _columndb.AGG_SUM)
+    
+    def min(self, column_name: str) -> Optional[Union[int, float]]:
+        """Smallest non-NULL value (NaN is skipped), or None. See sum()."""
+        return self._db.aggregate(column_name, _columndb.AGG_MIN)
+    
+    def max(self, column_name: str) -> Optional[Union[int, float]]:
+        """Largest non-NULL value (NaN is skipped), or None. See sum()."""
+        return self._db.aggregate(column_name, _columndb.AGG_MAX)
+    
+    def count(self, column_name: str) -> int:
+        """Number of non-NULL values; works on every column type."""
+        return self._db.aggregate(column_name, _columndb.AGG_COUNT)
+    
+    def mean(self, column_name: str) -> Optional[float]:
+        """Mean of the non-NULL values as a float, or None. See sum()."""
+        return self._db.aggregate(column_name, _columndb.AGG_MEAN)
+    
+    def get_null_count(self, column_name: str) -> int:
+        """
+        Get the number of NULL values in a column.
+        
+        The count is tracked on every insert and stored in the .cdb file,
+        so this is O(1).
+        
+        Raises:
+            ValueError: If column doesn't exist
+        """
+        return self._db.get_null_count(column_name)
+    
     def get_num_rows(self) -> int:
         """Get the number of rows in the database."""
         return self._db.get_num_rows()
@@ -165,6 +415,7 @@ class ColumnDB:
             DataType.FLOAT64: "float64",
             DataType.STRING: "string",
             DataType.BOOL: "bool",
+            DataType.DICT_STRING: "dict_string",
         }
         
         # Use _columns dict if it's populated (database created in this session)
@@ -179,29 +430,343 @@ class ColumnDB:
         
         return {}
     
-    def save(self, filename: str) -> None:
+    def save(self, filename: str, compression: Optional[str] = None,
+             level: Optional[int] = None, append: bool = False) -> None:
         """
         Save database to a .cdb file.
         
         Args:
             filename: Path to save to (e.g., "data.cdb")
+            compression: Compress each column's data and null bitmap as
+                independent blocks with "zlib", "zstd" or "lz4". Blocks
+                that would not shrink are stored as is. Loading
+                decompresses columns in parallel; with mmap=True they are
+                decompressed on first access.
+            level: Codec compression level (zlib 1-9, zstd 1-22); the
+                codec's default when omitted. lz4 has no levels.
+            append: Only write the rows added since the file was saved,
+                as a new segment at the end of the file; the rest of the
+                file is not rewritten. The database must have the file's
+                columns and start with its rows (e.g. it was loaded from
+                it). Missing files and files from older versions are
+                written in full. See compact().
             
         Raises:
-            RuntimeError: If save fails
+            ValueError: If the codec is unknown, not built in, or the
+                level is out of range
+            IOError: If the file cannot be written, or append is set and
+                the database does not extend it
         """
+        codec = self._codec(compression)
         self._filename = filename
         try:
-            self._db.save(filename)
+            self._db.save(filename, codec, level or 0, append)
         except RuntimeError as e:
             raise RuntimeError(f"Failed to save database: {e}")
     
+    @staticmethod
+    def _codec(compression: Optional[str]) -> int:
+        if compression is None:
+            return 0
+        if compression not in COMPRESSION_CODECS:
+            raise ValueError(f"Unknown compression codec: {compression!r}")
+        return COMPRESSION_CODECS[compression]
+    
+    @staticmethod
+    def compact(filename: str, compression: Optional[str] = None,
+                level: Optional[int] = None) -> None:
+        """
+        Merge the segments appended by save(append=True) into one.
+        
+        The file is read whole and written again, so later loads read one
+        section per column (and mmap=True can use every column in place).
+        Runs without holding the GIL, so it can run in a background thread.
+        
+        Args:
+            filename: Path of a .cdb file
+            compression, level: As for save()
+        
+        Raises:
+            ValueError: If the codec is unknown or not built in
+            IOError: If the file cannot be read or written
+        """
+        _columndb.compact(filename, ColumnDB._codec(compression), level or 0)
+    
+    @staticmethod
+    def compression_available(compression: str) -> bool:
+        """Whether a compression codec ("zlib", "zstd", "lz4") was built in."""
+        codec = COMPRESSION_CODECS.get(compression)
+        return codec is not None and _columndb.compression_available(codec)
+    
+    @staticmethod
+    def enable_stats(enabled: bool = True) -> None:
+        """
+        Turn the C core's statistics counters on or off.
+        
+        Counting is off by default and is shared by every database in the
+        process. While off, each hook costs one relaxed load of a flag.
+        
+        Raises:
+            RuntimeError: If the library was built with COLUMNDB_NO_STATS
+        """
+        _columndb.set_stats_enabled(enabled)
+    
+    @staticmethod
+    def stats(reset: bool = False) -> Dict[str, int]:
+        """
+        Counters gathered since statistics were enabled or last reset.
+        
+        Keys are bytes_read, bytes_written, allocations (new column
+        buffers), reallocs and realloc_bytes (buffers grown, and the bytes
+        they held before), rows_scanned (rows visited by filters,
+        aggregates, group_by and scan_between), saves and loads, and the
+        nanoseconds spent in each phase: save_ns, load_ns, read_ns,
+        write_ns, sync_ns, encode_ns (encoding and compression) and
+        decode_ns. Every value is 0 while counting is off.
+        
+        Args:
+            reset: Zero the counters after taking the snapshot
+        """
+        stats = _columndb.get_stats()
+        if reset:
+            _columndb.reset_stats()
+        return stats
+    
+    def set_row_group_size(self, rows: int) -> None:
+        """
+        Set the number of rows per row group in files saved from now on.
+        
+        Each row group of a numeric or bool column is stored with a zone
+        map (min, max, NULL count) that scan_between() uses to skip it.
+        The default is 65536 rows.
+        
+        Raises:
+            ValueError: If rows is not a positive multiple of 64
+        """
+        self._db.set_row_group_size(rows)
+    
+    def set_column_encoding(self, enabled: bool) -> None:
+        """
+        Enable or disable lightweight column encodings in later saves.
+        
+        When enabled (the default), each integer, float and bool column is
+        saved with whichever of RLE, delta + bit-packing or
+        frame-of-reference makes it smallest, provided that saves at least
+        1/8 of its size. Encoded columns are decoded when loaded, so
+        ColumnDB.load(..., mmap=True) reads them on first access instead of
+        using the file in place; disable encoding to keep numeric columns
+        zero-copy under mmap.
+        """
+        self._db.set_column_encoding(enabled)
+    
+    def set_num_threads(self, threads: int) -> None:
+        """
+        Set how many threads save() and load() use from now on.
+        
+        Columns are encoded, compressed and written (or read and
+        decompressed) concurrently, one column per task, using positional
+        file I/O. 0, the default, starts one thread per CPU; 1 does all the
+        work on the calling thread. The output file does not depend on the
+        thread count.
+        
+        Raises:
+            ValueError: If threads is negative
+        """
+        self._db.set_num_threads(threads)
+    
+    def reserve(self, rows: int, column_name: Optional[str] = None) -> None:
+        """
+        Make room for rows rows in total so inserts up to that many never
+        reallocate.
+        
+        Columns otherwise grow by the growth factor whenever they fill up,
+        copying their data each time. Loading a file reserves its row count
+        automatically.
+        
+        Args:
+            rows: Total number of rows to make room for
+            column_name: Column to reserve in (default: every column)
+            
+        Raises:
+            ValueError: If rows is negative or the column doesn't exist
+            MemoryError: If the memory cannot be allocated
+            BufferError: If column buffers are currently exported
+        """
+        self._db.reserve(rows, column_name)
+    
+    def set_growth_factor(self, factor: float) -> None:
+        """
+        Set the factor by which a full column grows (default 2.0).
+        
+        Smaller factors waste less memory on ingest; larger ones copy the
+        data less often.
+        
+        Raises:
+            ValueError: If factor is not greater than 1 and at most 8
+        """
+        self._db.set_growth_factor(factor)
+    
+    def set_sorted(self, column_name: str, sorted: bool = True) -> None:
+        """
+        Declare a column sorted, or clear the flag.
+        
+        A sorted column has its NULLs first, then values that never
+        decrease (and no NaN). The rows are checked when declaring; appends
+        that break the order clear the flag. Saving detects sorted columns
+        on its own and records it in the file, so loading keeps it.
+        Filters and range() on a sorted column binary-search it instead of
+        scanning every row.
+        
+        Raises:
+            ValueError: If the column doesn't exist, is not numeric or
+                bool, or is not in order
+        """
+        self._db.set_sorted(column_name, sorted)
+    
+    def is_sorted(self, column_name: str) -> bool:
+        """Whether a column is known to be sorted (see set_sorted())."""
+        return self._db.is_sorted(column_name)
+    
+    def range(self, column_name: str, low: Any = None, high: Any = None) -> tuple:
+        """
+        Find the rows of a sorted column with low <= value <= high.
+        
+        Binary search: with a memory-mapped file only the pages probed are
+        read. None leaves that side of the range open.
+        
+        Returns:
+            (start, end): the matching rows are start to end - 1
+            
+        Raises:
+            ValueError: If the column doesn't exist or is not sorted
+            
+        Example:
+            >>> start, end = db.range("timestamp", t0, t1)
+            >>> db.get_column_buffer("value")[start:end]
+        """
+        return self._db.range(column_name, low, high)
+    
+    def create_index(self, column_name: str, kind: str = "auto") -> None:
+        """
+        Build a secondary index on a column.
+        
+        "hash" keeps the row numbers of every distinct value, "bitmap" keeps
+        them as compressed row bitmaps (smaller for few distinct values),
+        "auto" picks bitmap for low-cardinality columns and hash otherwise.
+        filter() answers == and != on an indexed column from the index.
+        Appends leave the index stale until the next filter() or save(),
+        which rebuild it. Saved files keep their indexes.
+        
+        Raises:
+            ValueError: If the column doesn't exist, the kind is unknown, or
+                the column is a float column
+        """
+        code = self._INDEX_KINDS.get(kind)
+        if code is None:
+            raise ValueError(f"Unknown index kind: {kind!r}")
+        self._db.create_index(column_name, code)
+    
+    def drop_index(self, column_name: str) -> None:
+        """Remove a column's index, if it has one."""
+        self._db.drop_index(column_name)
+    
+    def get_index(self, column_name: str) -> Optional[str]:
+        """The index kind declared on a column ("hash", "bitmap", "auto"), or None."""
+        code = self._db.get_index(column_name)
+        for name, value in self._INDEX_KINDS.items():
+            if value == code:
+                return name
+        return None
+    
+    @staticmethod
+    def scan_between(filename: str, column_name: str,
+                     low: Union[int, float], high: Union[int, float],
+                     with_stats: bool = False):
+        """
+        Find the rows of a saved column with low <= value <= high.
+        
+        Only the zone maps are read up front; row groups whose min/max
+        cannot match are never read from disk, and groups that match
+        entirely are not read either. NULL and NaN values never match.
+        
+        Args:
+            filename: Path of a .cdb file
+            column_name: Numeric or bool column to scan
+            low, high: Inclusive bounds
+            with_stats: Also return (groups_read, groups_total)
+        
+        Returns:
+            Ascending list of matching row indices, or
+            (rows, groups_read, groups_total) when with_stats is set
+        
+        Raises:
+            IOError: If the file or column is missing or not numeric
+        """
+        rows, groups_read, groups_total = _columndb.scan_between(
+            filename, column_name, low, high)
+        if with_stats:
+            return rows, groups_read, groups_total
+        return rows
+
+    @staticmethod
+    def iter_batches(filename: str, columns: Optional[List[str]] = None,
+                     batch_size: int = 65536):
+        """
+        Read a saved file a batch of rows at a time.
+
+        Only the rows of the current batch are read and decoded, so memory
+        stays bounded by the batch size however large the file is; the
+        next batch is read in the background while the caller works on
+        this one. Batches don't span appended segments, so one can be
+        short at the end of each segment. Column checksums are not
+        verified, as no batch reads a whole column.
+
+        Args:
+            filename: Path of a .cdb file
+            columns: Only read these columns (default: all)
+            batch_size: Rows per batch
+
+        Yields:
+            ColumnDB with the next rows of the selected columns
+
+        Raises:
+            IOError: If the file can't be read or a column doesn't exist
+            ValueError: If batch_size is not positive
+
+        Example:
+            >>> for batch in ColumnDB.iter_batches("data.cdb", ["price"]):
+            ...     total += batch.sum("price") or 0
+        """
+        reader = _columndb.open_reader(filename, columns)
+        try:
+            while True:
+                batch = reader.next_batch(batch_size)
+                if batch is None:
+                    return
+                instance = ColumnDB.__new__(ColumnDB)
+                instance._db = batch
+                instance._filename = None
+                instance._columns = {}
+                yield instance
+        finally:
+            reader.close()
+    
     @classmethod
-    def load(cls, filename: str) -> 'ColumnDB':
+    def load(cls, filename: str, mmap: bool = False,
+             columns: Optional[List[str]] = None,
+             threads: Optional[int] = None) -> 'ColumnDB':
         """
         Load database from a .cdb file.
 
         Args:
             filename: Path to load from (e.g., "data.cdb")
+            mmap: Memory-map the file instead of reading it. Opening is then
+                O(metadata): numeric columns are used in place and other
+                columns are read on first access.
+            columns: Only load these columns; the others are skipped
+                without reading or allocating anything for them.
+            threads: Threads reading the columns (see set_num_threads());
+                None uses one per CPU. The database keeps this setting.
             
         Returns:
             ColumnDB instance loaded from file
@@ -217,7 +782,12 @@ class ColumnDB:
         # Create C extension object and call load on it
         try:
             db_ext = _columndb.ColumnDB()
-            db_ext.load(filename)
+            if threads is not None:
+                db_ext.set_num_threads(threads)
+            if mmap:
+                db_ext.open_mmap(filename, columns)
+            else:
+                db_ext.load(filename, columns)
             instance._db = db_ext
             
             # Rebuild the _columns tracking dict
@@ -256,10 +826,67 @@ class ColumnDB:
         
         return result
     
+    def __arrow_c_array__(self, requested_schema: Any = None) -> tuple:
+        """
+        Export the database as an Arrow struct array (Arrow PyCapsule interface).
+
+        Values, string offsets and bytes are shared with the consumer
+        rather than copied; only validity bitmaps and BOOL columns are.
+        Like get_column_buffer(), the database can't be modified while
+        the exported data is alive.
+
+        Returns:
+            (schema capsule, array capsule)
+
+        Raises:
+            ValueError: If the columns have different numbers of rows
+        """
+        return self._db.__arrow_c_array__(requested_schema)
+
+    def __arrow_c_stream__(self, requested_schema: Any = None) -> Any:
+        """
+        Export the database as an Arrow array stream of one struct array
+        (Arrow PyCapsule interface), e.g. for pyarrow.table(db) or
+        polars.DataFrame(db). See __arrow_c_array__().
+        """
+        return self._db.__arrow_c_stream__(requested_schema)
+
+    @classmethod
+    def from_arrow(cls, data: Any) -> 'ColumnDB':
+        """
+        Create a database from Arrow data: any object with
+        __arrow_c_stream__ or __arrow_c_array__, such as a pyarrow Table
+        or RecordBatch, a polars DataFrame or another ColumnDB.
+
+        Rows are copied a whole buffer at a time. Integer, float, bool and
+        string columns (utf8 and large_utf8) are supported, and
+        dictionary-encoded strings become DICT_STRING columns.
+
+        Raises:
+            TypeError: If data doesn't implement the Arrow PyCapsule interface
+            ValueError: If a column has an unsupported type
+        """
+        if hasattr(data, "__arrow_c_stream__"):
+            db_ext = _columndb.import_arrow_stream(data.__arrow_c_stream__())
+        elif hasattr(data, "__arrow_c_array__"):
+            schema, array = data.__arrow_c_array__()
+            db_ext = _columndb.import_arrow(schema, array)
+        else:
+            raise TypeError("from_arrow() needs an object with __arrow_c_stream__ or __arrow_c_array__")
+        instance = cls.__new__(cls)
+        instance._db = db_ext
+        instance._filename = None
+        instance._columns = {}
+        return instance
+    
     def to_pandas(self):
         """
         Convert the database to a pandas DataFrame.
         
+        With pyarrow 14 or later installed the columns are handed over
+        through the Arrow C stream interface (see __arrow_c_stream__()),
+        strings and NULLs included, with no pass over the rows in Python.
+        
         Returns:
             pandas.DataFrame with all data
             
@@ -271,7 +898,46 @@ class ColumnDB:
         except ImportError:
             raise ImportError("pandas is required for to_pandas()")
         
-        return pd.DataFrame(self.to_dict())
+        try:
+            import pyarrow as pa
+        except ImportError:
+            pa = None
+        if pa is not None and hasattr(pa.RecordBatchReader, "from_stream"):
+            # Hand the columns over through the Arrow C stream interface
+            return pa.RecordBatchReader.from_stream(self).read_all().to_pandas()
+        
+        import numpy as np
+        
+        data = {}
+        for col_name in self._db.get_column_names():
+            try:
+                categories = self._db.get_dictionary(col_name)
+            except TypeError:
+                categories = None
+            
+            if categories is not None:
+                # Dictionary columns map straight onto a Categorical
+                codes = np.asarray(self._db.get_column_buffer(col_name)).astype(np.int64)
+                bitmap = np.frombuffer(self._db.get_null_bitmap(col_name), dtype=np.uint8)
+                nulls = np.unpackbits(bitmap, bitorder="little")[:len(codes)].astype(bool)
+                codes[nulls] = -1
+                data[col_name] = pd.Categorical.from_codes(codes, categories)
+                continue
+            
+            try:
+                values = np.asarray(self._db.get_column_buffer(col_name))
+            except TypeError:
+                # String columns have no fixed-width buffer
+                data[col_name] = self.get_column_data(col_name)
+                continue
+            
+            if self._db.get_null_count(col_name) > 0:
+                # Columns with NULLs need per-row None handling
+                data[col_name] = self.get_column_data(col_name)
+            else:
+                data[col_name] = values
+        
+        return pd.DataFrame(data, copy=False)
     
     def __repr__(self) -> str:
         """String representation of the database."""
@@ -280,7 +946,87 @@ class ColumnDB:
         return f"ColumnDB(rows={num_rows}, columns={num_cols})"
 
 
+class BatchWriter:
+    """
+    Write a .cdb file from batches of rows in bounded memory.
+    
+    Rows are buffered until flush_rows of them are in, then written: the
+    first ones as the file, later ones as segments appended to it (as with
+    save(append=True)). Each write is committed on its own, so the file
+    can be read at any time and keeps the written rows if the process
+    dies. Closing writes the rest. See ColumnDB.compact() to merge the
+    segments.
+    
+    Example:
+        >>> schema = ColumnDB()
+        >>> schema.add_column("ts", DataType.INT64)
+        >>> with BatchWriter("events.cdb", schema) as writer:
+        ...     for batch in batches:  # ColumnDBs with schema's columns
+        ...         writer.write(batch)
+    """
+    
+    def __init__(self, filename: str, schema: ColumnDB, flush_rows: Optional[int] = None,
+                 compression: Optional[str] = None, level: Optional[int] = None):
+        """
+        Start writing a file; nothing is written before the first flush.
+        
+        Args:
+            filename: Path of the .cdb file; an existing file is replaced
+                by the first write
+            schema: ColumnDB whose columns (in order) every batch has; its
+                row group size, encoding and thread settings are used
+            flush_rows: Rows buffered before a write (default 1048576)
+            compression, level: As for ColumnDB.save()
+        
+        Raises:
+            ValueError: If flush_rows is not positive or the codec is
+                unknown, not built in, or the level is out of range
+        """
+        if flush_rows is not None and flush_rows <= 0:
+            raise ValueError("flush_rows must be positive")
+        self._writer = _columndb.open_writer(filename, schema._db, flush_rows or 0,
+                                             ColumnDB._codec(compression), level or 0)
+    
+    def write(self, batch: ColumnDB) -> None:
+        """
+        Buffer the rows of a batch, writing them out once enough are in.
+        
+        Raises:
+            IOError: If the batch's columns differ from the schema's (the
+                batch is then not added) or the file can't be written
+                (the rows stay buffered for the next flush)
+        """
+        self._writer.write(batch._db)
+    
+    def flush(self) -> None:
+        """Write the buffered rows now."""
+        self._writer.flush()
+    
+    @property
+    def rows_written(self) -> int:
+        """Rows written to the file so far, not counting buffered ones."""
+        return self._writer.rows_written()
+    
+    def close(self) -> None:
+        """Write the buffered rows and close the file (an empty file if none)."""
+        self._writer.close()
+    
+    def abort(self) -> None:
+        """Close the file without writing the buffered rows."""
+        self._writer.abort()
+    
+    def __enter__(self) -> 'BatchWriter':
+        return self
+    
+    def __exit__(self, exc_type, exc, tb) -> None:
+        if exc_type is None:
+            self.close()
+        else:
+            self.abort()
+
+
 __all__ = [
+    "BatchWriter",
     "ColumnDB",
     "DataType",
     "HAS_C_EXTENSION",
@@ -15,10 +15,40 @@ typedef enum {
     CDB_TYPE_FLOAT32 = 2,
     CDB_TYPE_FLOAT64 = 3,
     CDB_TYPE_STRING = 4,
-    CDB_TYPE_BOOL = 5
+    CDB_TYPE_BOOL = 5,
+    CDB_TYPE_DICT_STRING = 6  /* Dictionary-encoded string (low cardinality) */
 } cdb_data_type_t;
 
-/* Column structure */
+/* Where a column's data and null bitmap live */
+typedef enum {
+    CDB_STORAGE_HEAP = 0,     /* Owned heap buffers */
+    CDB_STORAGE_MAPPED = 1,   /* Read-only pointers into the database's file mapping */
+    CDB_STORAGE_UNLOADED = 2  /* Not read yet; materialized on first access */
+} cdb_storage_t;
+
+/* General-purpose block compression of saved columns */
+typedef enum {
+    CDB_COMPRESSION_NONE = 0,
+    CDB_COMPRESSION_ZLIB = 1,  /* Always available */
+    CDB_COMPRESSION_ZSTD = 2,  /* Only when built with libzstd */
+    CDB_COMPRESSION_LZ4 = 3    /* Only when built with liblz4 */
+} cdb_compression_t;
+
+/* Secondary index of a column (see cdb_create_index) */
+typedef enum {
+    CDB_INDEX_NONE = 0,
+    CDB_INDEX_HASH = 1,    /* Row numbers of each distinct value */
+    CDB_INDEX_BITMAP = 2,  /* Compressed row bitmap of each distinct value */
+    CDB_INDEX_AUTO = 3     /* BITMAP for low-cardinality columns, else HASH */
+} cdb_index_kind_t;
+
+/* Column structure.
+ * STRING columns use an Arrow-style layout: data holds num_rows + 1
+ * uint64_t offsets into string_data, and row i is the byte range
+ * [offsets[i], offsets[i + 1]). NULL rows are empty ranges.
+ * DICT_STRING columns hold one uint32_t code per row in data; code c is
+ * the dictionary value [dict_offsets[c], dict_offsets[c + 1]) of
+ * string_data. */
 typedef struct cdb_column {
     char* name;
     cdb_data_type_t data_type;
@@ -26,30 +56,124 @@ typedef struct cdb_column {
     size_t capacity;      /* Allocated capacity */
     size_t num_rows;      /* Number of rows in this column */
     uint8_t* null_bitmap; /* Null bitmap for handling NULL values */
+    size_t null_count;    /* Rows with the null bit set; 0 lets scans skip the bitmap */
+    int sorted;           /* NULL rows first, then non-decreasing values (see cdb_set_sorted) */
+    uint8_t index_kind;        /* Declared cdb_index_kind_t, kept across saves */
+    struct cdb_index* index;   /* Built index; stale once num_rows grows past it */
+    char* string_data;           /* STRING: contiguous UTF-8 bytes of all rows */
+    size_t string_data_size;     /* STRING: bytes in use */
+    size_t string_data_capacity; /* STRING: bytes allocated */
+    uint64_t* dict_offsets;      /* DICT_STRING: dict_size + 1 offsets into string_data */
+    size_t dict_size;            /* DICT_STRING: number of distinct values */
+    size_t dict_capacity;        /* DICT_STRING: entries allocated */
+    uint32_t* dict_index;        /* DICT_STRING: value -> code hash, built on first use */
+    size_t dict_index_capacity;  /* DICT_STRING: power of two, kept at most half full */
+    cdb_storage_t storage;
+    uint8_t file_encoding;   /* On-disk encoding of the section (mapped/unloaded only) */
+    uint64_t file_offset;    /* Data offset in the mapped file (mapped/unloaded only) */
+    uint64_t file_data_size; /* Data size in the mapped file (mapped/unloaded only) */
+    size_t file_group_rows;  /* Rows per encoded chunk in the mapped file (unloaded only) */
+    uint8_t file_compression;     /* Codec of the mapped blocks (unloaded only) */
+    uint64_t file_stored_size;    /* Data block size as stored, compressed or not */
+    uint64_t file_stored_bitmap;  /* Null bitmap block size as stored */
+    uint32_t file_checksum;       /* CRC32C of the stored blocks (mapped/unloaded only) */
+    uint8_t file_unverified;      /* file_checksum is still to be checked on first access */
+    uint8_t file_pending;         /* Verification or materialization still to do (mapped only) */
 } cdb_column_t;
 
+/* Slot of the column name hash index */
+typedef struct cdb_name_slot {
+    uint32_t hash;
+    int32_t index;        /* Column index, -1 for an empty slot */
+} cdb_name_slot_t;
+
 /* Database structure */
 typedef struct cdb_database {
     char* filename;
     cdb_column_t* columns;
     size_t num_columns;
     size_t capacity;      /* Column capacity */
+    void* mapping;        /* File mapping from cdb_open_mmap (NULL if none) */
+    size_t mapping_size;
+    cdb_name_slot_t* name_index;  /* Open-addressing hash of column names */
+    size_t name_index_capacity;   /* Power of two, kept at most half full */
+    size_t row_group_rows;        /* Rows per zone-mapped row group in saved files */
+    int encode_columns;           /* Let saves pick RLE/delta/frame-of-reference encodings */
+    cdb_compression_t compression; /* Block codec of saved columns */
+    int compression_level;        /* 0 = the codec's default */
+    size_t num_threads;           /* Threads of saves, loads and group-bys; 0 = one per CPU */
+    double growth_factor;         /* Capacity multiplier when a column is full */
+    struct cdb_rwlock* lock;      /* Readers share it, modifying calls hold it alone */
+    struct cdb_rwlock* load_lock; /* Serializes lazy materialization of columns */
 } cdb_database_t;
 
+/* Default rows per row group; each group of a saved numeric column gets a
+ * zone map (min, max, null count) that scans use to skip it */
+#define CDB_DEFAULT_ROW_GROUP_ROWS 65536
+
+/* Columns that run out of room grow their capacity by this factor */
+#define CDB_DEFAULT_GROWTH_FACTOR 2.0
+#define CDB_MAX_GROWTH_FACTOR 8.0
+
 /* Memory management */
 cdb_database_t* cdb_create_database(void);
 void cdb_free_database(cdb_database_t* db);
 
+/* Concurrency: any number of threads may read a database at once while
+ * they hold its read lock; column pointers, data and lengths obtained under
+ * it stay valid until it is released. Functions that modify the database
+ * (add_column, insert, append, load/open, cdb_set_*, and saving a mapped
+ * database over its own file) take the write lock themselves, so they wait
+ * for readers and for each other. The write lock is re-entrant: a thread
+ * holding it may call modifying functions and take the read lock, e.g. to
+ * make several inserts atomic. Never call a modifying function while
+ * holding only the read lock, and never take the read lock twice: a
+ * waiting writer holds back new readers so it is not starved. Errors
+ * (cdb_get_error) are per thread. */
+void cdb_read_lock(cdb_database_t* db);
+void cdb_read_unlock(cdb_database_t* db);
+void cdb_write_lock(cdb_database_t* db);
+void cdb_write_unlock(cdb_database_t* db);
+int cdb_try_read_lock(cdb_database_t* db);   /* 1 if acquired without waiting */
+int cdb_try_write_lock(cdb_database_t* db);
+
 /* File I/O */
 int cdb_open(const char* filename, cdb_database_t* db);
 int cdb_save(const char* filename, cdb_database_t* db);
 int cdb_save_to(cdb_database_t* db, const char* filename);  /* Save to specific file */
 int cdb_load_from(cdb_database_t* db, const char* filename); /* Load from specific file */
+int cdb_open_mmap(cdb_database_t* db, const char* filename); /* Map file, load columns lazily */
+
+/* Incremental saves: append the rows added since the file was written as
+ * a new segment at its end, leaving the bytes already there untouched (a
+ * missing or pre-v11 file is written in full). The database must have the
+ * file's columns, in order, and start with the file's rows. A crash before
+ * the append completes leaves the file as it was. Loads read every segment;
+ * cdb_compact rewrites a file as one segment. */
+int cdb_save_append(cdb_database_t* db, const char* filename);
+int cdb_compact(const char* filename, cdb_compression_t codec, int level);
+
+/* Projection pushdown: read only the named columns; others cost no I/O */
+int cdb_load_columns(cdb_database_t* db, const char* filename,
+                     const char* const* names, size_t num_names);
+int cdb_open_mmap_columns(cdb_database_t* db, const char* filename,
+                          const char* const* names, size_t num_names);
 
 /* Schema management */
 int cdb_add_column(cdb_database_t* db, const char* name, cdb_data_type_t type);
 int cdb_get_column_index(cdb_database_t* db, const char* name);
 cdb_column_t* cdb_get_column(cdb_database_t* db, const char* name);
+cdb_column_t* cdb_get_column_by_index(cdb_database_t* db, size_t col_index);
+
+/* Capacity: make room for num_rows rows in total so inserts up to that many
+ * never reallocate (string bytes still grow as needed). Loading a file
+ * reserves its row count up front. Large columns start on huge page
+ * boundaries and are advised as transparent huge pages where supported. */
+int cdb_reserve(cdb_database_t* db, const char* column_name, size_t num_rows);
+int cdb_reserve_all(cdb_database_t* db, size_t num_rows);
+/* Factor by which a full column grows (default 2.0, up to CDB_MAX_GROWTH_FACTOR);
+ * smaller factors waste less memory, larger ones copy less often */
+int cdb_set_growth_factor(cdb_database_t* db, double factor);
 
 /* Data insertion */
 int cdb_insert_int32(cdb_database_t* db, const char* column_name, int32_t value);
@@ -60,15 +184,327 @@ int cdb_insert_string(cdb_database_t* db, const char* column_name, const char* v
 int cdb_insert_bool(cdb_database_t* db, const char* column_name, uint8_t value);
 int cdb_insert_null(cdb_database_t* db, const char* column_name);
 
+/* Handle-based insertion: resolve the column index once with
+ * cdb_get_column_index() and skip the name lookup in hot loops */
+int cdb_insert_int32_h(cdb_database_t* db, size_t col_index, int32_t value);
+int cdb_insert_int64_h(cdb_database_t* db, size_t col_index, int64_t value);
+int cdb_insert_float32_h(cdb_database_t* db, size_t col_index, float value);
+int cdb_insert_float64_h(cdb_database_t* db, size_t col_index, double value);
+int cdb_insert_string_h(cdb_database_t* db, size_t col_index, const char* value);
+int cdb_insert_bool_h(cdb_database_t* db, size_t col_index, uint8_t value);
+int cdb_insert_null_h(cdb_database_t* db, size_t col_index);
+
+/* Bulk insertion: append n values in one call.
+ * null_bitmap is optional (NULL = no nulls); bit i set marks row i as NULL. */
+int cdb_append_array(cdb_database_t* db, const char* column_name,
+                     const void* values, size_t n, const uint8_t* null_bitmap);
+int cdb_append_int32_array(cdb_database_t* db, const char* column_name,
+                           const int32_t* values, size_t n, const uint8_t* null_bitmap);
+int cdb_append_int64_array(cdb_database_t* db, const char* column_name,
+                           const int64_t* values, size_t n, const uint8_t* null_bitmap);
+int cdb_append_float32_array(cdb_database_t* db, const char* column_name,
+                             const float* values, size_t n, const uint8_t* null_bitmap);
+int cdb_append_float64_array(cdb_database_t* db, const char* column_name,
+                             const double* values, size_t n, const uint8_t* null_bitmap);
+int cdb_append_string_array(cdb_database_t* db, const char* column_name,
+                            const char* const* values, size_t n, const uint8_t* null_bitmap);
+int cdb_append_bool_array(cdb_database_t* db, const char* column_name,
+                          const uint8_t* values, size_t n, const uint8_t* null_bitmap);
+
+/* Row-wise insertion: one value per column, in column order. The member
+ * read is the one matching the column's type. */
+typedef struct cdb_value {
+    union {
+        int32_t i32;
+        int64_t i64;
+        float f32;
+        double f64;
+        const char* str;  /* STRING/DICT_STRING, NUL-terminated; NULL is a NULL value */
+        uint8_t b;
+    } as;
+    int is_null;
+} cdb_value_t;
+
+/* Append whole rows so every column grows together; all columns must have
+ * the same number of rows. Either every row is appended or none is.
+ * cdb_append_rows takes num_rows rows back to back (row-major). */
+int cdb_append_row(cdb_database_t* db, const cdb_value_t* values);
+int cdb_append_rows(cdb_database_t* db, const cdb_value_t* values, size_t num_rows);
+
 /* Data retrieval */
 int32_t cdb_get_int32(cdb_column_t* col, size_t row_index);
 int64_t cdb_get_int64(cdb_column_t* col, size_t row_index);
 float cdb_get_float32(cdb_column_t* col, size_t row_index);
 double cdb_get_float64(cdb_column_t* col, size_t row_index);
-char* cdb_get_string(cdb_column_t* col, size_t row_index);
+const char* cdb_get_string(cdb_column_t* col, size_t row_index, size_t* length); /* Not NUL-terminated */
 uint8_t cdb_get_bool(cdb_column_t* col, size_t row_index);
 int cdb_is_null(cdb_column_t* col, size_t row_index);
 
+/* Dictionary-encoded columns: filters and group-bys can work on the codes.
+ * STRING insert/append functions also accept DICT_STRING columns. */
+uint32_t cdb_get_dict_code(cdb_column_t* col, size_t row_index);
+int64_t cdb_dict_lookup(cdb_column_t* col, const char* value); /* Code, or -1 if absent */
+const char* cdb_dict_value(cdb_column_t* col, uint32_t code, size_t* length); /* Not NUL-terminated */
+
+/* Aggregation over a column's non-NULL values */
+typedef enum {
+    CDB_AGG_SUM = 0,
+    CDB_AGG_MIN = 1,
+    CDB_AGG_MAX = 2,
+    CDB_AGG_COUNT = 3,   /* Works on every column type */
+    CDB_AGG_MEAN = 4
+} cdb_agg_op_t;
+
+typedef struct cdb_agg_result {
+    size_t count;         /* Non-NULL rows aggregated */
+    int is_null;          /* No non-NULL rows: SUM/MIN/MAX/MEAN are NULL */
+    int is_float;         /* Value is in f (float columns, MEAN) rather than i */
+    int64_t i;
+    double f;
+} cdb_agg_result_t;
+
+int cdb_aggregate(cdb_column_t* col, cdb_agg_op_t op, cdb_agg_result_t* result);
+
+/* Filtering: predicates are evaluated a column at a time into selection
+ * bitmaps. SQL semantics: NULL rows only match IS NULL; NaN only matches != */
+typedef enum {
+    CDB_CMP_EQ = 0,
+    CDB_CMP_NE = 1,
+    CDB_CMP_LT = 2,
+    CDB_CMP_LE = 3,
+    CDB_CMP_GT = 4,
+    CDB_CMP_GE = 5,
+    CDB_CMP_IS_NULL = 6,      /* The value is not used */
+    CDB_CMP_IS_NOT_NULL = 7
+} cdb_cmp_op_t;
+
+/* Bit i of words[i / 64] selects row i; bits past num_rows are 0 */
+typedef struct cdb_selection {
+    uint64_t* words;
+    size_t num_rows;
+} cdb_selection_t;
+
+/* Compare every row of a column with a value of the column's type (strings
+ * compare bytewise) into a new selection; free it with cdb_selection_free */
+int cdb_select(const cdb_column_t* col, cdb_cmp_op_t op, const cdb_value_t* value, cdb_selection_t* out);
+int cdb_selection_and(cdb_selection_t* sel, const cdb_selection_t* other);  /* In place */
+int cdb_selection_or(cdb_selection_t* sel, const cdb_selection_t* other);
+size_t cdb_selection_count(const cdb_selection_t* sel);
+void cdb_selection_free(cdb_selection_t* sel);
+
+/* A compiled filter: terms in postfix order. COMPARE pushes the selection
+ * of one comparison; AND and OR replace the top two with their combination. */
+typedef enum {
+    CDB_PRED_COMPARE = 0,
+    CDB_PRED_AND = 1,
+    CDB_PRED_OR = 2
+} cdb_pred_kind_t;
+
+typedef struct cdb_predicate {
+    cdb_pred_kind_t kind;
+    const char* column;   /* COMPARE only */
+    cdb_cmp_op_t op;
+    cdb_value_t value;
+} cdb_predicate_t;
+
+/* Evaluate a compiled filter over a database's rows. Like cdb_get_column,
+ * these read the database: hold its read lock if other threads modify it. */
+int cdb_where(cdb_database_t* db, const cdb_predicate_t* terms, size_t num_terms, cdb_selection_t* out);
+
+/* Copy the selected rows of the named columns (every column if names is
+ * NULL) into dst as new columns; dst must be another database */
+int cdb_filter(cdb_database_t* db, const cdb_selection_t* sel,
+               const char* const* names, size_t num_names, cdb_database_t* dst);
+
+/* Sorted columns: a numeric or bool column whose NULL rows come first and
+ * whose values never decrease (no NaN) can be declared sorted. Declaring
+ * checks the rows; appends that break the order clear the flag. Saves
+ * detect sorted columns and record it in the file, so loads keep the flag.
+ * Filters and cdb_range binary-search sorted columns instead of scanning. */
+int cdb_set_sorted(cdb_database_t* db, const char* column_name, int sorted);
+
+/* Rows [*start, *end) of a sorted column hold exactly the values with
+ * lo <= value <= hi; a NULL bound pointer leaves that side open. Mapped
+ * columns only touch the pages the search probes. */
+int cdb_range(const cdb_column_t* col, const cdb_value_t* lo, const cdb_value_t* hi,
+              size_t* start, size_t* end);
+
+/* Secondary indexes on INT32, INT64, BOOL, STRING and DICT_STRING columns.
+ * Filters answer = and != on a column from its index instead of scanning.
+ * Appends leave an index stale until cdb_refresh_indexes (or a save, which
+ * writes every declared index to the file; loads read them back). */
+int cdb_create_index(cdb_database_t* db, const char* column_name, cdb_index_kind_t kind);
+int cdb_drop_index(cdb_database_t* db, const char* column_name);
+cdb_index_kind_t cdb_get_index_kind(const cdb_column_t* col);  /* NONE if missing or stale */
+int cdb_has_stale_indexes(const cdb_database_t* db);
+int cdb_refresh_indexes(cdb_database_t* db);
+
+/* Hash group-by: one output row per distinct key, in order of first
+ * appearance, with all NULL keys in one group. Keys are INT32, INT64, BOOL
+ * or DICT_STRING (grouped by code). dst gets the key column, then one
+ * column per aggregate: INT64, or FLOAT64 for float inputs and MEAN;
+ * groups without values get NULL. Rows are split across db's threads. */
+typedef struct cdb_group_agg {
+    cdb_agg_op_t op;
+    const char* column;   /* NULL counts every row (COUNT only) */
+    const char* output;   /* Result column; NULL = "<op>_<column>", or "count" */
+} cdb_group_agg_t;
+
+int cdb_group_by(cdb_database_t* db, const char* key_column,
+                 const cdb_group_agg_t* aggs, size_t num_aggs, cdb_database_t* dst);
+
+/* Zone-map scans over a saved file: rows of a numeric column with
+ * lo <= value <= hi (NULL and NaN never match). Only row groups whose
+ * zone map overlaps the range are read from disk. */
+typedef struct cdb_scan_result {
+    uint64_t* rows;       /* Matching row indices, ascending */
+    size_t num_rows;
+    size_t groups_total;
+    size_t groups_read;   /* Groups whose values had to be read */
+} cdb_scan_result_t;
+
+int cdb_set_row_group_size(cdb_database_t* db, size_t rows); /* Positive multiple of 64 */
+int cdb_set_column_encoding(cdb_database_t* db, int enabled);  /* On by default */
+int cdb_set_compression(cdb_database_t* db, cdb_compression_t codec, int level); /* Level 0 = default */
+int cdb_compression_available(cdb_compression_t codec);
+int cdb_set_num_threads(cdb_database_t* db, size_t num_threads); /* 0 = one per CPU */
+int cdb_scan_between_int64(const char* filename, const char* column_name,
+                           int64_t lo, int64_t hi, cdb_scan_result_t* result);
+int cdb_scan_between_float64(const char* filename, const char* column_name,
+                             double lo, double hi, cdb_scan_result_t* result);
+void cdb_free_scan_result(cdb_scan_result_t* result);
+
+/* Streaming reads of a saved file, batch_rows rows at a time (fewer at the
+ * end of the base and of each appended segment). Only the rows of the
+ * current batch are read and decoded, into buffers reused from batch to
+ * batch, and the next batch is read in the background meanwhile.
+ * next_batch returns 1 with a batch, 0 at the end, -1 on error; the batch
+ * belongs to the reader and stays valid until the next call, unless
+ * take_batch hands it over (free it with cdb_free_database). A reader is
+ * used by one thread at a time. */
+typedef struct cdb_reader cdb_reader_t;
+
+cdb_reader_t* cdb_reader_open(const char* filename, const char* const* names, size_t num_names); /* NULL names = all */
+int cdb_reader_next_batch(cdb_reader_t* reader, size_t batch_rows, cdb_database_t** out_batch);
+cdb_database_t* cdb_reader_take_batch(cdb_reader_t* reader);
+void cdb_reader_close(cdb_reader_t* reader);
+
+/* Streaming writes: a file built from batches of rows (databases with the
+ * writer's columns) without holding them all. Rows are buffered until
+ * flush_rows are in (0 = CDB_DEFAULT_FLUSH_ROWS), then written: the first
+ * ones as the base of the file, later ones as appended segments, each
+ * committed on its own so the file is always readable. close writes the
+ * rest and frees the writer even if that fails; abort drops it. */
+typedef struct cdb_writer cdb_writer_t;
+
+#define CDB_DEFAULT_FLUSH_ROWS ((size_t)1 << 20)
+
+cdb_writer_t* cdb_writer_open(const char* filename, cdb_database_t* schema, size_t flush_rows); /* schema's columns and save settings */
+int cdb_writer_write(cdb_writer_t* writer, cdb_database_t* batch);
+int cdb_writer_flush(cdb_writer_t* writer);
+uint64_t cdb_writer_rows_written(const cdb_writer_t* writer);
+int cdb_writer_close(cdb_writer_t* writer);
+void cdb_writer_abort(cdb_writer_t* writer);
+
+/* Arrow C data interface (https://arrow.apache.org/docs/format/CDataInterface.html).
+ * The structs are the standard ones, so headers that define them too can
+ * be included alongside. */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif /* ARROW_C_DATA_INTERFACE */
+
+#ifndef ARROW_C_STREAM_INTERFACE
+#define ARROW_C_STREAM_INTERFACE
+
+struct ArrowArrayStream {
+    int (*get_schema)(struct ArrowArrayStream*, struct ArrowSchema* out);
+    int (*get_next)(struct ArrowArrayStream*, struct ArrowArray* out);
+    const char* (*get_last_error)(struct ArrowArrayStream*);
+    void (*release)(struct ArrowArrayStream*);
+    void* private_data;
+};
+
+#endif /* ARROW_C_STREAM_INTERFACE */
+
+/* Export a database as one struct array ("+s") with a child per column:
+ * INT32/INT64/FLOAT32/FLOAT64 as i/l/f/g, STRING as large_utf8 (U),
+ * DICT_STRING as int32 codes over a large_utf8 dictionary and BOOL as b.
+ * Values, offsets and string bytes are shared, not copied: the database
+ * must stay alive and unmodified until every exported array is released.
+ * Only validity bitmaps (Arrow's bits are set for valid rows, ours for
+ * NULL ones) and BOOL values (Arrow packs them into bits) are copied, and
+ * columns without NULLs need no validity bitmap. All columns must have
+ * the same number of rows. The stream yields that one array; its callbacks
+ * take the database's read lock and fail if columns were added since. */
+int cdb_export_arrow(cdb_database_t* db, struct ArrowSchema* out_schema, struct ArrowArray* out_array);
+int cdb_export_arrow_stream(cdb_database_t* db, struct ArrowArrayStream* out_stream);
+
+/* Import a struct array (or every array of a stream) into a new database,
+ * one column per child: i/l/f/g/b, utf8 and large_utf8 strings, and
+ * dictionaries of strings (as DICT_STRING). The rows are copied, a
+ * buffer at a time. The inputs are released either way. */
+cdb_database_t* cdb_import_arrow(struct ArrowSchema* schema, struct ArrowArray* array);
+cdb_database_t* cdb_import_arrow_stream(struct ArrowArrayStream* stream);
+
+/* Statistics: process-wide counters that show where the time of loads,
+ * saves and scans goes. Counting is off until cdb_set_stats_enabled turns
+ * it on, and costs one branch per counted event while off; building with
+ * CDB_NO_STATS leaves it out altogether. Times are in nanoseconds; those
+ * of reads, writes, encoding and decoding are summed over threads, so
+ * they can add up to more than the wall time of the saves and loads. */
+typedef struct cdb_stats {
+    uint64_t bytes_read;       /* Read from files (pages of mapped files not included) */
+    uint64_t bytes_written;
+    uint64_t allocations;      /* Column buffers allocated */
+    uint64_t reallocs;         /* Column buffers grown */
+    uint64_t realloc_bytes;    /* Bytes those growths copied, at most */
+    uint64_t rows_scanned;     /* Rows compared by filters, aggregated or grouped */
+    uint64_t saves;            /* Saves, appended segments included */
+    uint64_t save_ns;
+    uint64_t loads;            /* Loads and mapped opens */
+    uint64_t load_ns;
+    uint64_t read_ns;          /* In file reads */
+    uint64_t write_ns;         /* In file writes */
+    uint64_t sync_ns;          /* Syncing saved files to storage */
+    uint64_t encode_ns;        /* Encoding and compressing columns */
+    uint64_t decode_ns;        /* Decoding and decompressing columns */
+} cdb_stats_t;
+
+int cdb_set_stats_enabled(int enabled);  /* -1 when built with CDB_NO_STATS */
+int cdb_stats_enabled(void);
+void cdb_get_stats(cdb_stats_t* out);
+void cdb_reset_stats(void);
+
 /* Statistics and metadata */
 size_t cdb_get_num_rows(cdb_database_t* db);
 size_t cdb_get_num_columns(cdb_database_t* db);
@@ -69,6 +69,41 @@ Thanks to the C backend, ColumnDB offers:
 - Low memory overhead for analytics workloads
 """
 
+
+def find_codec(header, function, library):
+    """Whether an optional compression library can be compiled and linked"""
+    import tempfile
+    from distutils.ccompiler import new_compiler
+    from distutils.errors import CompileError, LinkError
+    compiler = new_compiler()
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, 'probe.c')
+        with open(source, 'w') as f:
+            f.write('#include <%s>\nint main(void) { (void)&%s; return 0; }\n' % (header, function))
+        try:
+            objects = compiler.compile([source], output_dir=tmp)
+            compiler.link_executable(objects, 'probe', output_dir=tmp, libraries=[library])
+        except (CompileError, LinkError):
+            return False
+    return True
+
+
+# zlib is required; zstd and lz4 are compiled in when present
+# (set COLUMNDB_NO_ZSTD / COLUMNDB_NO_LZ4 to leave them out)
+define_macros = []
+libraries = ['zlib' if sys.platform == 'win32' else 'z']
+if not os.environ.get('COLUMNDB_NO_ZSTD') and find_codec('zstd.h', 'ZSTD_compress', 'zstd'):
+    define_macros.append(('CDB_HAVE_ZSTD', '1'))
+    libraries.append('zstd')
+if not os.environ.get('COLUMNDB_NO_LZ4') and find_codec('lz4.h', 'LZ4_compress_default', 'lz4'):
+    define_macros.append(('CDB_HAVE_LZ4', '1'))
+    libraries.append('lz4')
+
+# Statistics counters (ColumnDB.stats()) are compiled in but off until
+# enabled; set COLUMNDB_NO_STATS to leave them out altogether
+if os.environ.get('COLUMNDB_NO_STATS'):
+    define_macros.append(('CDB_NO_STATS', '1'))
+
 # Define the C extension module
 columndb_extension = Extension(
     'columndb.columndb',
@@ -76,12 +111,27 @@ columndb_extension = Extension(
         'src/columndb_extension.c',
         'src/column_db.c',
         'src/column_db_fileio.c',
+        'src/column_db_aggregate.c',
+        'src/column_db_encoding.c',
+        'src/column_db_compress.c',
+        'src/column_db_thread.c',
+        'src/column_db_memory.c',
+        'src/column_db_filter.c',
+        'src/column_db_group.c',
+        'src/column_db_index.c',
+        'src/column_db_checksum.c',
+        'src/column_db_arrow.c',
+        'src/column_db_stats.c',
     ],
     include_dirs=['include'],
+    define_macros=define_macros,
+    libraries=libraries,
     extra_compile_args=[
         '-std=c99',
         '-Wall',
+        '-pthread',
     ] if sys.platform != 'win32' else ['/D_CRT_SECURE_NO_WARNINGS'],
+    extra_link_args=['-pthread'] if sys.platform != 'win32' else [],
 )
 
 setup(
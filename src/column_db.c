@@ -1,14 +1,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include "../include/column_db.h"
+#include <math.h>
+#include "column_db_internal.h"
 
 #define INITIAL_CAPACITY 10
 #define INITIAL_COLUMNS 5
 #define STRING_MAX_LEN 1024
+#define NAME_INDEX_MIN_CAPACITY 16  /* Power of two */
+#define STRING_ARENA_INITIAL_SIZE 256
+#define DICT_INITIAL_CAPACITY 16
+#define DICT_INDEX_MIN_CAPACITY 32  /* Power of two */
+#define DICT_EMPTY_SLOT UINT32_MAX  /* Also caps the number of distinct values */
 
-/* Error message storage (simple thread-safe alternative) */
-static char error_message[256] = {0};
+/* Error message of the last failed call, per thread */
+static CDB_THREAD_LOCAL char error_message[256];
 
 /* Helper function to set error message */
 void set_error(const char* msg) {
@@ -19,6 +25,71 @@ void set_error(const char* msg) {
     }
 }
 
+/* Number of set bits */
+static unsigned popcount64(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (unsigned)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Count NULL rows a word (64 rows) at a time */
+size_t cdb_count_nulls(const uint8_t* null_bitmap, size_t num_rows) {
+    size_t nulls = 0;
+    for (size_t base = 0; base < num_rows; base += 64) {
+        /* Rows past the end read as NULL; count only real ones */
+        uint64_t word = cdb_null_word(null_bitmap, base, num_rows);
+        if (num_rows - base < 64) word &= ((uint64_t)1 << (num_rows - base)) - 1;
+        nulls += popcount64(word);
+    }
+    return nulls;
+}
+
+#define CDB_NEVER_NAN(v) 0
+#define CDB_ORDER_LOOP(T, IS_NAN)                                                \
+    do {                                                                         \
+        const T* values = (const T*)col->data;                                   \
+        for (size_t r = from; r < col->num_rows; r++) {                          \
+            if (IS_NAN(values[r])) return 0;                                     \
+            if (r > first_value && !(values[r - 1] <= values[r])) return 0;      \
+        }                                                                        \
+    } while (0)
+
+/* Whether rows from first_row on keep a column sorted, given the rows before
+ * it are: NULLs first, then non-decreasing values without NaN */
+int cdb_rows_in_order(const cdb_column_t* col, size_t first_row) {
+    /* NULLs are a prefix exactly when no row past null_count is NULL */
+    size_t first_value = col->null_count;
+    size_t from = first_row > first_value ? first_row : first_value;
+    if (col->null_count) {
+        for (size_t r = from; r < col->num_rows; r++) {
+            if ((col->null_bitmap[r / 8] >> (r % 8)) & 1) return 0;
+        }
+    }
+    
+    switch (col->data_type) {
+        case CDB_TYPE_INT32: CDB_ORDER_LOOP(int32_t, CDB_NEVER_NAN); break;
+        case CDB_TYPE_INT64: CDB_ORDER_LOOP(int64_t, CDB_NEVER_NAN); break;
+        case CDB_TYPE_FLOAT32: CDB_ORDER_LOOP(float, isnan); break;
+        case CDB_TYPE_FLOAT64: CDB_ORDER_LOOP(double, isnan); break;
+        case CDB_TYPE_BOOL: CDB_ORDER_LOOP(uint8_t, CDB_NEVER_NAN); break;
+        default: return 0;
+    }
+    return 1;
+}
+
+#undef CDB_ORDER_LOOP
+#undef CDB_NEVER_NAN
+
+/* A sorted column stays flagged only while appended rows keep it in order */
+static void check_appended_order(cdb_column_t* col, size_t first_row) {
+    if (col->sorted && !cdb_rows_in_order(col, first_row)) col->sorted = 0;
+}
+
 /* Create a new database */
 cdb_database_t* cdb_create_database(void) {
     cdb_database_t* db = (cdb_database_t*)malloc(sizeof(cdb_database_t));
@@ -28,8 +99,13 @@ cdb_database_t* cdb_create_database(void) {
     }
     
     db->columns = (cdb_column_t*)malloc(INITIAL_COLUMNS * sizeof(cdb_column_t));
-    if (!db->columns) {
+    db->lock = cdb_rwlock_create();
+    db->load_lock = cdb_rwlock_create();
+    if (!db->columns || !db->lock || !db->load_lock) {
         set_error("Failed to allocate columns array");
+        free(db->columns);
+        cdb_rwlock_destroy(db->lock);
+        cdb_rwlock_destroy(db->load_lock);
         free(db);
         return NULL;
     }
@@ -37,6 +113,16 @@ cdb_database_t* cdb_create_database(void) {
     db->num_columns = 0;
     db->capacity = INITIAL_COLUMNS;
     db->filename = NULL;
+    db->mapping = NULL;
+    db->mapping_size = 0;
+    db->name_index = NULL;
+    db->name_index_capacity = 0;
+    db->row_group_rows = CDB_DEFAULT_ROW_GROUP_ROWS;
+    db->encode_columns = 1;
+    db->compression = CDB_COMPRESSION_NONE;
+    db->compression_level = 0;
+    db->num_threads = 0;
+    db->growth_factor = CDB_DEFAULT_GROWTH_FACTOR;
     
     return db;
 }
@@ -47,103 +133,215 @@ void cdb_free_database(cdb_database_t* db) {
     
     for (size_t i = 0; i < db->num_columns; i++) {
         free(db->columns[i].name);
-        if (db->columns[i].data_type == CDB_TYPE_STRING) {
-            for (size_t j = 0; j < db->columns[i].num_rows; j++) {
-                char** strings = (char**)db->columns[i].data;
-                if (strings[j]) free(strings[j]);
-            }
-        }
-        free(db->columns[i].data);
+        free(db->columns[i].dict_index);
+        cdb_index_free(db->columns[i].index);
+        if (db->columns[i].storage != CDB_STORAGE_HEAP) continue;
+        cdb_data_free(db->columns[i].data);
         free(db->columns[i].null_bitmap);
+        free(db->columns[i].string_data);
+        free(db->columns[i].dict_offsets);
     }
     
+    cdb_unmap_file(db);
     free(db->columns);
+    free(db->name_index);
     if (db->filename) free(db->filename);
+    cdb_rwlock_destroy(db->lock);
+    cdb_rwlock_destroy(db->load_lock);
     free(db);
 }
 
-/* Add a column to the database */
-int cdb_add_column(cdb_database_t* db, const char* name, cdb_data_type_t type) {
+/* Database locks (see column_db.h); a NULL database is left to the call that follows */
+void cdb_read_lock(cdb_database_t* db) {
+    if (db) cdb_rwlock_read(db->lock);
+}
+
+void cdb_read_unlock(cdb_database_t* db) {
+    if (db) cdb_rwlock_read_unlock(db->lock);
+}
+
+void cdb_write_lock(cdb_database_t* db) {
+    if (db) cdb_rwlock_write(db->lock);
+}
+
+void cdb_write_unlock(cdb_database_t* db) {
+    if (db) cdb_rwlock_write_unlock(db->lock);
+}
+
+int cdb_try_read_lock(cdb_database_t* db) {
+    return db ? cdb_rwlock_try_read(db->lock) : 1;
+}
+
+int cdb_try_write_lock(cdb_database_t* db) {
+    return db ? cdb_rwlock_try_write(db->lock) : 1;
+}
+
+/* FNV-1a hash of a column name */
+static uint32_t hash_name(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* FNV-1a hash of a byte range */
+static uint32_t hash_bytes(const char* data, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Look up a column index in the name hash (-1 if absent) */
+static int name_index_find(const cdb_database_t* db, const char* name, uint32_t hash) {
+    if (!db->name_index) return -1;
+    
+    size_t mask = db->name_index_capacity - 1;
+    for (size_t slot = hash & mask; db->name_index[slot].index >= 0; slot = (slot + 1) & mask) {
+        const cdb_name_slot_t* entry = &db->name_index[slot];
+        if (entry->hash == hash && strcmp(db->columns[entry->index].name, name) == 0) {
+            return entry->index;
+        }
+    }
+    return -1;
+}
+
+/* Rebuild the name hash for the current columns, kept at most half full */
+static int rebuild_name_index(cdb_database_t* db, size_t min_columns) {
+    size_t capacity = NAME_INDEX_MIN_CAPACITY;
+    while (capacity < min_columns * 2) capacity *= 2;
+    
+    cdb_name_slot_t* table = (cdb_name_slot_t*)malloc(capacity * sizeof(cdb_name_slot_t));
+    if (!table) {
+        set_error("Failed to allocate column name index");
+        return -1;
+    }
+    for (size_t slot = 0; slot < capacity; slot++) {
+        table[slot].index = -1;
+    }
+    
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < db->num_columns; i++) {
+        uint32_t hash = hash_name(db->columns[i].name);
+        size_t slot = hash & mask;
+        while (table[slot].index >= 0) slot = (slot + 1) & mask;
+        table[slot].hash = hash;
+        table[slot].index = (int32_t)i;
+    }
+    
+    free(db->name_index);
+    db->name_index = table;
+    db->name_index_capacity = capacity;
+    return 0;
+}
+
+/* Add a column slot with no storage allocated yet */
+cdb_column_t* cdb_add_column_deferred(cdb_database_t* db, const char* name, cdb_data_type_t type) {
     if (!db || !name) {
         set_error("Invalid database or column name");
-        return -1;
+        return NULL;
+    }
+    
+    if (cdb_type_size(type) == 0) {
+        set_error("Unknown data type");
+        return NULL;
     }
     
     /* Check if column name already exists */
-    for (size_t i = 0; i < db->num_columns; i++) {
-        if (strcmp(db->columns[i].name, name) == 0) {
-            set_error("Column already exists");
-            return -1;
-        }
+    uint32_t hash = hash_name(name);
+    if (name_index_find(db, name, hash) >= 0) {
+        set_error("Column already exists");
+        return NULL;
+    }
+    
+    /* Grow the name index before it passes half full */
+    if ((db->num_columns + 1) * 2 > db->name_index_capacity &&
+        rebuild_name_index(db, db->num_columns + 1) < 0) {
+        return NULL;
     }
     
     /* Resize columns array if needed */
     if (db->num_columns >= db->capacity) {
-        db->capacity *= 2;
-        cdb_column_t* new_columns = (cdb_column_t*)realloc(db->columns, db->capacity * sizeof(cdb_column_t));
+        size_t new_capacity = db->capacity * 2;
+        cdb_column_t* new_columns = (cdb_column_t*)realloc(db->columns, new_capacity * sizeof(cdb_column_t));
         if (!new_columns) {
             set_error("Failed to expand columns array");
-            return -1;
+            return NULL;
         }
         db->columns = new_columns;
+        db->capacity = new_capacity;
     }
     
     cdb_column_t* col = &db->columns[db->num_columns];
     col->name = (char*)malloc(strlen(name) + 1);
     if (!col->name) {
         set_error("Failed to allocate column name");
-        return -1;
+        return NULL;
     }
     strcpy_s(col->name, strlen(name) + 1, name);
     
     col->data_type = type;
-    col->capacity = INITIAL_CAPACITY;
+    col->data = NULL;
+    col->capacity = 0;
     col->num_rows = 0;
+    col->null_bitmap = NULL;
+    col->null_count = 0;
+    col->string_data = NULL;
+    col->string_data_size = 0;
+    col->string_data_capacity = 0;
+    col->dict_offsets = NULL;
+    col->dict_size = 0;
+    col->dict_capacity = 0;
+    col->dict_index = NULL;
+    col->dict_index_capacity = 0;
+    col->storage = CDB_STORAGE_HEAP;
+    col->file_encoding = CDB_FILE_ENCODING_PLAIN;
+    col->file_offset = 0;
+    col->file_data_size = 0;
+    col->file_group_rows = 0;
+    col->file_compression = CDB_COMPRESSION_NONE;
+    col->file_stored_size = 0;
+    col->file_stored_bitmap = 0;
+    col->file_checksum = 0;
+    col->file_unverified = 0;
+    col->file_pending = 0;
+    col->sorted = 0;
+    col->index_kind = CDB_INDEX_NONE;
+    col->index = NULL;
     
-    /* Allocate data array based on type */
-    size_t element_size = 0;
-    switch (type) {
-        case CDB_TYPE_INT32:
-            element_size = sizeof(int32_t);
-            break;
-        case CDB_TYPE_INT64:
-            element_size = sizeof(int64_t);
-            break;
-        case CDB_TYPE_FLOAT32:
-            element_size = sizeof(float);
-            break;
-        case CDB_TYPE_FLOAT64:
-            element_size = sizeof(double);
-            break;
-        case CDB_TYPE_STRING:
-            element_size = sizeof(char*);
-            break;
-        case CDB_TYPE_BOOL:
-            element_size = sizeof(uint8_t);
-            break;
-        default:
-            set_error("Unknown data type");
-            return -1;
-    }
+    /* Index the new column */
+    size_t mask = db->name_index_capacity - 1;
+    size_t slot = hash & mask;
+    while (db->name_index[slot].index >= 0) slot = (slot + 1) & mask;
+    db->name_index[slot].hash = hash;
+    db->name_index[slot].index = (int32_t)db->num_columns;
     
-    col->data = (void*)malloc(col->capacity * element_size);
-    if (!col->data) {
-        set_error("Failed to allocate column data");
-        free(col->name);
-        return -1;
-    }
+    db->num_columns++;
+    return col;
+}
+
+/* Add a column to the database */
+int cdb_add_column(cdb_database_t* db, const char* name, cdb_data_type_t type) {
+    cdb_write_lock(db);
+    cdb_column_t* col = cdb_add_column_deferred(db, name, type);
+    int status = col ? 0 : -1;
     
-    /* Allocate null bitmap (1 byte per 8 values) */
-    col->null_bitmap = (uint8_t*)calloc((col->capacity + 7) / 8, sizeof(uint8_t));
-    if (!col->null_bitmap) {
-        set_error("Failed to allocate null bitmap");
-        free(col->data);
+    /* Allocate data array and null bitmap (1 byte per 8 values) */
+    if (col && cdb_column_reserve(col, INITIAL_CAPACITY) < 0) {
+        cdb_data_free(col->data);
+        free(col->null_bitmap);
         free(col->name);
-        return -1;
+        db->num_columns--;
+        rebuild_name_index(db, db->num_columns);
+        status = -1;
     }
     
-    db->num_columns++;
-    return 0;
+    cdb_write_unlock(db);
+    return status;
 }
 
 /* Get column index by name */
@@ -153,185 +351,1039 @@ int cdb_get_column_index(cdb_database_t* db, const char* name) {
         return -1;
     }
     
-    for (size_t i = 0; i < db->num_columns; i++) {
-        if (strcmp(db->columns[i].name, name) == 0) {
-            return (int)i;
-        }
+    int idx = name_index_find(db, name, hash_name(name));
+    if (idx < 0) {
+        set_error("Column not found");
     }
-    
-    set_error("Column not found");
-    return -1;
+    return idx;
 }
 
-/* Get column by name */
+/* Get column by index (materializes lazily opened columns) */
+cdb_column_t* cdb_get_column_by_index(cdb_database_t* db, size_t col_index) {
+    if (!db || col_index >= db->num_columns) {
+        set_error("Column not found");
+        return NULL;
+    }
+    if (cdb_column_ensure_loaded(db, &db->columns[col_index]) < 0) return NULL;
+    return &db->columns[col_index];
+}
+
+/* Get column by name (materializes lazily opened columns) */
 cdb_column_t* cdb_get_column(cdb_database_t* db, const char* name) {
     int idx = cdb_get_column_index(db, name);
     if (idx < 0) return NULL;
-    return &db->columns[idx];
+    return cdb_get_column_by_index(db, (size_t)idx);
+}
+
+/* Size in bytes of one element of the given type */
+size_t cdb_type_size(cdb_data_type_t type) {
+    switch (type) {
+        case CDB_TYPE_INT32: return sizeof(int32_t);
+        case CDB_TYPE_INT64: return sizeof(int64_t);
+        case CDB_TYPE_FLOAT32: return sizeof(float);
+        case CDB_TYPE_FLOAT64: return sizeof(double);
+        case CDB_TYPE_STRING: return sizeof(uint64_t);  /* One offset per row */
+        case CDB_TYPE_BOOL: return sizeof(uint8_t);
+        case CDB_TYPE_DICT_STRING: return sizeof(uint32_t);  /* One code per row */
+        default: return 0;
+    }
+}
+
+/* Number of elements in a column's data array for the given row capacity */
+static size_t data_slots(const cdb_column_t* col, size_t rows) {
+    /* String columns keep a trailing end offset */
+    return col->data_type == CDB_TYPE_STRING ? rows + 1 : rows;
+}
+
+/* Copy a mapped column into heap buffers so it can be modified */
+int cdb_column_unmap(cdb_column_t* col) {
+    if (col->storage != CDB_STORAGE_MAPPED) return 0;
+    
+    size_t data_size = data_slots(col, col->num_rows) * cdb_type_size(col->data_type);
+    size_t bitmap_size = (col->num_rows + 7) / 8;
+    size_t dict_offsets_size = 0;
+    if (col->data_type == CDB_TYPE_DICT_STRING) {
+        dict_offsets_size = (col->dict_size + 1) * sizeof(uint64_t);
+    }
+    
+    void* data = cdb_data_resize(NULL, 0, cdb_data_alloc_size(data_size));
+    uint8_t* bitmap = (uint8_t*)malloc(bitmap_size);
+    char* string_data = col->string_data_size > 0 ? (char*)malloc(col->string_data_size) : NULL;
+    uint64_t* dict_offsets = dict_offsets_size > 0 ? (uint64_t*)malloc(dict_offsets_size) : NULL;
+    if (!data || !bitmap || (col->string_data_size > 0 && !string_data) ||
+        (dict_offsets_size > 0 && !dict_offsets)) {
+        cdb_data_free(data);
+        free(bitmap);
+        free(string_data);
+        free(dict_offsets);
+        set_error("Failed to copy mapped column");
+        return -1;
+    }
+    
+    memcpy(data, col->data, data_size);
+    memcpy(bitmap, col->null_bitmap, bitmap_size);
+    if (string_data) {
+        memcpy(string_data, col->string_data, col->string_data_size);
+    }
+    if (dict_offsets) {
+        memcpy(dict_offsets, col->dict_offsets, dict_offsets_size);
+    }
+    col->data = data;
+    col->null_bitmap = bitmap;
+    col->string_data = string_data;
+    col->string_data_capacity = col->string_data_size;
+    col->dict_offsets = dict_offsets;
+    col->dict_capacity = col->dict_size;
+    col->capacity = col->num_rows;
+    col->storage = CDB_STORAGE_HEAP;
+    return 0;
+}
+
+/* Grow column data and null bitmap to hold at least min_capacity rows */
+int cdb_column_reserve(cdb_column_t* col, size_t min_capacity) {
+    if (!col) {
+        set_error("Invalid column");
+        return -1;
+    }
+    if (min_capacity <= col->capacity) return 0;
+    
+    /* Mapped memory is read-only: move it to the heap before growing */
+    if (cdb_column_unmap(col) < 0) return -1;
+    
+    size_t element_size = cdb_type_size(col->data_type);
+    if (element_size == 0) {
+        set_error("Unknown data type");
+        return -1;
+    }
+    
+    /* The byte size, rounded up to huge pages, and the bitmap size must fit size_t */
+    if (min_capacity > (SIZE_MAX - CDB_HUGE_PAGE_SIZE) / element_size - 1) {
+        set_error("Failed to expand column data");
+        return -1;
+    }
+    
+    /* Large arrays are rounded up to whole huge pages; use all of them */
+    size_t old_size = col->capacity ? cdb_data_alloc_size(data_slots(col, col->capacity) * element_size) : 0;
+    size_t new_size = cdb_data_alloc_size(data_slots(col, min_capacity) * element_size);
+    min_capacity = new_size / element_size - data_slots(col, 0);
+    
+    void* new_data = cdb_data_resize(col->data, old_size, new_size);
+    if (!new_data) {
+        set_error("Failed to expand column data");
+        return -1;
+    }
+    if (col->data_type == CDB_TYPE_STRING && col->capacity == 0) {
+        ((uint64_t*)new_data)[0] = 0;
+    }
+    col->data = new_data;
+    
+    /* New bitmap bytes must start out as "not null" */
+    size_t old_bitmap_size = (col->capacity + 7) / 8;
+    size_t new_bitmap_size = (min_capacity + 7) / 8;
+    cdb_stat_growth(old_bitmap_size);
+    uint8_t* new_bitmap = realloc(col->null_bitmap, new_bitmap_size);
+    if (!new_bitmap) {
+        set_error("Failed to expand null bitmap");
+        return -1;
+    }
+    memset(new_bitmap + old_bitmap_size, 0, new_bitmap_size - old_bitmap_size);
+    col->null_bitmap = new_bitmap;
+    
+    col->capacity = min_capacity;
+    return 0;
+}
+
+/* Capacity of a column grown by the database's growth factor to hold at least required rows */
+static size_t grown_capacity(const cdb_database_t* db, const cdb_column_t* col, size_t required) {
+    if (col->capacity == 0) return required > INITIAL_CAPACITY ? required : INITIAL_CAPACITY;
+    
+    double target = (double)col->capacity * db->growth_factor;
+    size_t grown = target < (double)SIZE_MAX ? (size_t)target : SIZE_MAX;
+    if (grown <= col->capacity) grown = col->capacity + 1;
+    return grown > required ? grown : required;
 }
 
 /* Helper to expand column data if needed */
-static int expand_column_if_needed(cdb_column_t* col) {
+static int expand_column_if_needed(cdb_database_t* db, cdb_column_t* col) {
     if (col->num_rows >= col->capacity) {
-        col->capacity *= 2;
-        
-        size_t element_size = 0;
-        switch (col->data_type) {
-            case CDB_TYPE_INT32: element_size = sizeof(int32_t); break;
-            case CDB_TYPE_INT64: element_size = sizeof(int64_t); break;
-            case CDB_TYPE_FLOAT32: element_size = sizeof(float); break;
-            case CDB_TYPE_FLOAT64: element_size = sizeof(double); break;
-            case CDB_TYPE_STRING: element_size = sizeof(char*); break;
-            case CDB_TYPE_BOOL: element_size = sizeof(uint8_t); break;
-            default: return -1;
-        }
-        
-        void* new_data = realloc(col->data, col->capacity * element_size);
-        if (!new_data) {
-            set_error("Failed to expand column data");
-            return -1;
-        }
-        col->data = new_data;
-        
-        uint8_t* new_bitmap = realloc(col->null_bitmap, (col->capacity + 7) / 8);
-        if (!new_bitmap) {
-            set_error("Failed to expand null bitmap");
-            return -1;
-        }
-        col->null_bitmap = new_bitmap;
+        return cdb_column_reserve(col, grown_capacity(db, col, col->num_rows + 1));
     }
     return 0;
 }
 
-/* Insert int32 */
-int cdb_insert_int32(cdb_database_t* db, const char* column_name, int32_t value) {
+/* Reserve room for num_rows rows in every materialized column from first_column on */
+int cdb_reserve_columns(cdb_database_t* db, size_t first_column, size_t num_rows) {
+    for (size_t c = first_column; c < db->num_columns; c++) {
+        if (db->columns[c].storage == CDB_STORAGE_UNLOADED) continue;
+        if (cdb_column_reserve(&db->columns[c], num_rows) < 0) return -1;
+    }
+    return 0;
+}
+
+/* Reserve room for num_rows rows in total in one column */
+int cdb_reserve(cdb_database_t* db, const char* column_name, size_t num_rows) {
+    cdb_write_lock(db);
     cdb_column_t* col = cdb_get_column(db, column_name);
-    if (!col || col->data_type != CDB_TYPE_INT32) {
-        set_error("Column not found or type mismatch");
+    int status = col ? cdb_column_reserve(col, num_rows) : -1;
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Reserve room for num_rows rows in total in every column */
+int cdb_reserve_all(cdb_database_t* db, size_t num_rows) {
+    if (!db) {
+        set_error("Invalid database");
         return -1;
     }
     
-    if (expand_column_if_needed(col) < 0) return -1;
+    cdb_write_lock(db);
+    int status = 0;
+    for (size_t c = 0; status == 0 && c < db->num_columns; c++) {
+        status = cdb_column_ensure_loaded(db, &db->columns[c]);
+    }
+    if (status == 0) status = cdb_reserve_columns(db, 0, num_rows);
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Set the factor by which full columns grow */
+int cdb_set_growth_factor(cdb_database_t* db, double factor) {
+    if (!db) {
+        set_error("Invalid database");
+        return -1;
+    }
+    if (!(factor > 1.0 && factor <= CDB_MAX_GROWTH_FACTOR)) {
+        set_error("Growth factor must be greater than 1 and at most 8");
+        return -1;
+    }
+    
+    cdb_write_lock(db);
+    db->growth_factor = factor;
+    cdb_write_unlock(db);
+    return 0;
+}
+
+/* Declare a column sorted (checked against its rows) or clear the flag */
+int cdb_set_sorted(cdb_database_t* db, const char* column_name, int sorted) {
+    cdb_write_lock(db);
+    cdb_column_t* col = cdb_get_column(db, column_name);
+    int status = col ? 0 : -1;
+    if (col && sorted && !cdb_rows_in_order(col, 0)) {
+        set_error(col->data_type == CDB_TYPE_STRING || col->data_type == CDB_TYPE_DICT_STRING
+                  ? "Only numeric and bool columns can be sorted"
+                  : "Column is not in ascending order");
+        status = -1;
+    }
+    if (status == 0) col->sorted = sorted ? 1 : 0;
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Grow a string column's byte buffer to hold at least min_bytes */
+int cdb_string_reserve(cdb_column_t* col, size_t min_bytes) {
+    if (min_bytes <= col->string_data_capacity) return 0;
+    
+    size_t capacity = col->string_data_capacity ? col->string_data_capacity * 2 : STRING_ARENA_INITIAL_SIZE;
+    if (capacity < min_bytes) capacity = min_bytes;
+    
+    cdb_stat_growth(col->string_data_capacity);
+    char* new_data = (char*)realloc(col->string_data, capacity);
+    if (!new_data) {
+        set_error("Failed to expand string storage");
+        return -1;
+    }
+    col->string_data = new_data;
+    col->string_data_capacity = capacity;
+    return 0;
+}
+
+/* Grow a dictionary's offsets array to hold at least min_entries values */
+int cdb_dict_reserve(cdb_column_t* col, size_t min_entries) {
+    if (min_entries <= col->dict_capacity) return 0;
+    
+    /* Mapped dictionaries are read-only */
+    if (cdb_column_unmap(col) < 0) return -1;
+    
+    size_t capacity = col->dict_capacity ? col->dict_capacity * 2 : DICT_INITIAL_CAPACITY;
+    if (capacity < min_entries) capacity = min_entries;
+    
+    cdb_stat_growth(col->dict_offsets ? (col->dict_capacity + 1) * sizeof(uint64_t) : 0);
+    uint64_t* new_offsets = (uint64_t*)realloc(col->dict_offsets, (capacity + 1) * sizeof(uint64_t));
+    if (!new_offsets) {
+        set_error("Failed to expand dictionary");
+        return -1;
+    }
+    if (!col->dict_offsets) {
+        new_offsets[0] = 0;
+    }
+    col->dict_offsets = new_offsets;
+    col->dict_capacity = capacity;
+    return 0;
+}
+
+/* Rebuild the value -> code hash for the current dictionary, kept at most half full */
+static int rebuild_dict_index(cdb_column_t* col, size_t min_entries) {
+    size_t capacity = DICT_INDEX_MIN_CAPACITY;
+    while (capacity < min_entries * 2) capacity *= 2;
+    
+    uint32_t* table = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    if (!table) {
+        set_error("Failed to allocate dictionary index");
+        return -1;
+    }
+    for (size_t slot = 0; slot < capacity; slot++) {
+        table[slot] = DICT_EMPTY_SLOT;
+    }
+    
+    size_t mask = capacity - 1;
+    for (size_t code = 0; code < col->dict_size; code++) {
+        uint64_t start = col->dict_offsets[code];
+        size_t slot = hash_bytes(col->string_data + start, (size_t)(col->dict_offsets[code + 1] - start)) & mask;
+        while (table[slot] != DICT_EMPTY_SLOT) slot = (slot + 1) & mask;
+        table[slot] = (uint32_t)code;
+    }
+    
+    free(col->dict_index);
+    col->dict_index = table;
+    col->dict_index_capacity = capacity;
+    return 0;
+}
+
+/* Find a value's dictionary code through the hash (-1 if absent) */
+static int64_t dict_find(const cdb_column_t* col, const char* value, size_t len, uint32_t hash) {
+    size_t mask = col->dict_index_capacity - 1;
+    for (size_t slot = hash & mask; col->dict_index[slot] != DICT_EMPTY_SLOT; slot = (slot + 1) & mask) {
+        uint32_t code = col->dict_index[slot];
+        uint64_t start = col->dict_offsets[code];
+        if (col->dict_offsets[code + 1] - start == len &&
+            (len == 0 || memcmp(col->string_data + start, value, len) == 0)) {
+            return code;
+        }
+    }
+    return -1;
+}
+
+/* Get the code for a value, adding it to the dictionary if it is new */
+static int dict_intern(cdb_column_t* col, const char* value, size_t len, uint32_t* code) {
+    if (!col->dict_index && rebuild_dict_index(col, col->dict_size) < 0) return -1;
+    
+    uint32_t hash = hash_bytes(value, len);
+    int64_t found = dict_find(col, value, len, hash);
+    if (found >= 0) {
+        *code = (uint32_t)found;
+        return 0;
+    }
+    
+    if (col->dict_size >= DICT_EMPTY_SLOT) {
+        set_error("Too many distinct values for a dictionary column");
+        return -1;
+    }
+    if ((col->dict_size + 1) * 2 > col->dict_index_capacity &&
+        rebuild_dict_index(col, col->dict_size + 1) < 0) {
+        return -1;
+    }
+    if (cdb_dict_reserve(col, col->dict_size + 1) < 0 ||
+        cdb_string_reserve(col, col->string_data_size + len) < 0) {
+        return -1;
+    }
+    
+    if (len > 0) {
+        memcpy(col->string_data + col->string_data_size, value, len);
+    }
+    col->string_data_size += len;
+    col->dict_offsets[col->dict_size + 1] = col->string_data_size;
+    
+    size_t mask = col->dict_index_capacity - 1;
+    size_t slot = hash & mask;
+    while (col->dict_index[slot] != DICT_EMPTY_SLOT) slot = (slot + 1) & mask;
+    col->dict_index[slot] = (uint32_t)col->dict_size;
+    
+    *code = (uint32_t)col->dict_size;
+    col->dict_size++;
+    return 0;
+}
+
+/* Append raw bytes as the next string row */
+static void push_string(cdb_column_t* col, const char* value, size_t len) {
+    uint64_t* offsets = (uint64_t*)col->data;
+    if (len > 0) {
+        memcpy(col->string_data + col->string_data_size, value, len);
+    }
+    col->string_data_size += len;
+    offsets[col->num_rows + 1] = col->string_data_size;
+    col->num_rows++;
+}
+
+/* Resolve a column handle for appending one value of the given type */
+static cdb_column_t* column_for_insert(cdb_database_t* db, size_t col_index, cdb_data_type_t type) {
+    if (!db || col_index >= db->num_columns || db->columns[col_index].data_type != type) {
+        set_error("Column not found or type mismatch");
+        return NULL;
+    }
+    
+    cdb_column_t* col = &db->columns[col_index];
+    if (cdb_column_ensure_loaded(db, col) < 0) return NULL;
+    if (expand_column_if_needed(db, col) < 0) return NULL;
+    
+    return col;
+}
+
+/* Insert int32 by column handle; the caller holds the write lock */
+static int insert_int32(cdb_database_t* db, size_t col_index, int32_t value) {
+    cdb_column_t* col = column_for_insert(db, col_index, CDB_TYPE_INT32);
+    if (!col) return -1;
     
     int32_t* data = (int32_t*)col->data;
     data[col->num_rows] = value;
     col->num_rows++;
+    check_appended_order(col, col->num_rows - 1);
     
     return 0;
 }
 
+/* Insert int32 by column handle */
+int cdb_insert_int32_h(cdb_database_t* db, size_t col_index, int32_t value) {
+    cdb_write_lock(db);
+    int status = insert_int32(db, col_index, value);
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Insert int32 */
+int cdb_insert_int32(cdb_database_t* db, const char* column_name, int32_t value) {
+    cdb_write_lock(db);
+    int status = -1;
+    int idx = cdb_get_column_index(db, column_name);
+    if (idx < 0) {
+        set_error("Column not found or type mismatch");
+    } else {
+        status = insert_int32(db, (size_t)idx, value);
+    }
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Insert int64 by column handle; the caller holds the write lock */
+static int insert_int64(cdb_database_t* db, size_t col_index, int64_t value) {
+    cdb_column_t* col = column_for_insert(db, col_index, CDB_TYPE_INT64);
+    if (!col) return -1;
+    
+    int64_t* data = (int64_t*)col->data;
+    data[col->num_rows] = value;
+    col->num_rows++;
+    check_appended_order(col, col->num_rows - 1);
+    
+    return 0;
+}
+
+/* Insert int64 by column handle */
+int cdb_insert_int64_h(cdb_database_t* db, size_t col_index, int64_t value) {
+    cdb_write_lock(db);
+    int status = insert_int64(db, col_index, value);
+    cdb_write_unlock(db);
+    return status;
+}
+
 /* Insert int64 */
 int cdb_insert_int64(cdb_database_t* db, const char* column_name, int64_t value) {
-    cdb_column_t* col = cdb_get_column(db, column_name);
-    if (!col || col->data_type != CDB_TYPE_INT64) {
+    cdb_write_lock(db);
+    int status = -1;
+    int idx = cdb_get_column_index(db, column_name);
+    if (idx < 0) {
         set_error("Column not found or type mismatch");
-        return -1;
+    } else {
+        status = insert_int64(db, (size_t)idx, value);
     }
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Insert float32 by column handle; the caller holds the write lock */
+static int insert_float32(cdb_database_t* db, size_t col_index, float value) {
+    cdb_column_t* col = column_for_insert(db, col_index, CDB_TYPE_FLOAT32);
+    if (!col) return -1;
     
-    if (expand_column_if_needed(col) < 0) return -1;
-    
-    int64_t* data = (int64_t*)col->data;
+    float* data = (float*)col->data;
     data[col->num_rows] = value;
     col->num_rows++;
+    check_appended_order(col, col->num_rows - 1);
     
     return 0;
 }
 
+/* Insert float32 by column handle */
+int cdb_insert_float32_h(cdb_database_t* db, size_t col_index, float value) {
+    cdb_write_lock(db);
+    int status = insert_float32(db, col_index, value);
+    cdb_write_unlock(db);
+    return status;
+}
+
 /* Insert float32 */
 int cdb_insert_float32(cdb_database_t* db, const char* column_name, float value) {
-    cdb_column_t* col = cdb_get_column(db, column_name);
-    if (!col || col->data_type != CDB_TYPE_FLOAT32) {
+    cdb_write_lock(db);
+    int status = -1;
+    int idx = cdb_get_column_index(db, column_name);
+    if (idx < 0) {
         set_error("Column not found or type mismatch");
-        return -1;
+    } else {
+        status = insert_float32(db, (size_t)idx, value);
     }
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Insert float64 by column handle; the caller holds the write lock */
+static int insert_float64(cdb_database_t* db, size_t col_index, double value) {
+    cdb_column_t* col = column_for_insert(db, col_index, CDB_TYPE_FLOAT64);
+    if (!col) return -1;
     
-    if (expand_column_if_needed(col) < 0) return -1;
-    
-    float* data = (float*)col->data;
+    double* data = (double*)col->data;
     data[col->num_rows] = value;
     col->num_rows++;
+    check_appended_order(col, col->num_rows - 1);
     
     return 0;
 }
 
+/* Insert float64 by column handle */
+int cdb_insert_float64_h(cdb_database_t* db, size_t col_index, double value) {
+    cdb_write_lock(db);
+    int status = insert_float64(db, col_index, value);
+    cdb_write_unlock(db);
+    return status;
+}
+
 /* Insert float64 */
 int cdb_insert_float64(cdb_database_t* db, const char* column_name, double value) {
-    cdb_column_t* col = cdb_get_column(db, column_name);
-    if (!col || col->data_type != CDB_TYPE_FLOAT64) {
+    cdb_write_lock(db);
+    int status = -1;
+    int idx = cdb_get_column_index(db, column_name);
+    if (idx < 0) {
         set_error("Column not found or type mismatch");
+    } else {
+        status = insert_float64(db, (size_t)idx, value);
+    }
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Insert string by column handle; the caller holds the write lock */
+static int insert_string(cdb_database_t* db, size_t col_index, const char* value) {
+    if (!value) {
+        set_error("Invalid string value");
         return -1;
     }
     
-    if (expand_column_if_needed(col) < 0) return -1;
+    /* Dictionary columns take the same string values */
+    cdb_data_type_t type = CDB_TYPE_STRING;
+    if (db && col_index < db->num_columns && db->columns[col_index].data_type == CDB_TYPE_DICT_STRING) {
+        type = CDB_TYPE_DICT_STRING;
+    }
     
-    double* data = (double*)col->data;
-    data[col->num_rows] = value;
-    col->num_rows++;
+    cdb_column_t* col = column_for_insert(db, col_index, type);
+    if (!col) return -1;
     
+    size_t len = strlen(value);
+    if (type == CDB_TYPE_DICT_STRING) {
+        uint32_t code;
+        if (dict_intern(col, value, len, &code) < 0) return -1;
+        ((uint32_t*)col->data)[col->num_rows] = code;
+        col->num_rows++;
+        return 0;
+    }
+    
+    if (cdb_string_reserve(col, col->string_data_size + len) < 0) return -1;
+    
+    push_string(col, value, len);
     return 0;
 }
 
+/* Insert string by column handle */
+int cdb_insert_string_h(cdb_database_t* db, size_t col_index, const char* value) {
+    cdb_write_lock(db);
+    int status = insert_string(db, col_index, value);
+    cdb_write_unlock(db);
+    return status;
+}
+
 /* Insert string */
 int cdb_insert_string(cdb_database_t* db, const char* column_name, const char* value) {
-    cdb_column_t* col = cdb_get_column(db, column_name);
-    if (!col || col->data_type != CDB_TYPE_STRING) {
+    cdb_write_lock(db);
+    int status = -1;
+    int idx = cdb_get_column_index(db, column_name);
+    if (idx < 0) {
         set_error("Column not found or type mismatch");
-        return -1;
-    }
-    
-    if (expand_column_if_needed(col) < 0) return -1;
-    
-    char** strings = (char**)col->data;
-    char* str_copy = (char*)malloc(strlen(value) + 1);
-    if (!str_copy) {
-        set_error("Failed to allocate string memory");
-        return -1;
+    } else {
+        status = insert_string(db, (size_t)idx, value);
     }
-    strcpy_s(str_copy, strlen(value) + 1, value);
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Insert bool by column handle; the caller holds the write lock */
+static int insert_bool(cdb_database_t* db, size_t col_index, uint8_t value) {
+    cdb_column_t* col = column_for_insert(db, col_index, CDB_TYPE_BOOL);
+    if (!col) return -1;
     
-    strings[col->num_rows] = str_copy;
+    uint8_t* data = (uint8_t*)col->data;
+    data[col->num_rows] = value ? 1 : 0;
     col->num_rows++;
+    check_appended_order(col, col->num_rows - 1);
     
     return 0;
 }
 
+/* Insert bool by column handle */
+int cdb_insert_bool_h(cdb_database_t* db, size_t col_index, uint8_t value) {
+    cdb_write_lock(db);
+    int status = insert_bool(db, col_index, value);
+    cdb_write_unlock(db);
+    return status;
+}
+
 /* Insert bool */
 int cdb_insert_bool(cdb_database_t* db, const char* column_name, uint8_t value) {
-    cdb_column_t* col = cdb_get_column(db, column_name);
-    if (!col || col->data_type != CDB_TYPE_BOOL) {
+    cdb_write_lock(db);
+    int status = -1;
+    int idx = cdb_get_column_index(db, column_name);
+    if (idx < 0) {
         set_error("Column not found or type mismatch");
-        return -1;
+    } else {
+        status = insert_bool(db, (size_t)idx, value);
     }
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Insert NULL by column handle; the caller holds the write lock */
+static int insert_null(cdb_database_t* db, size_t col_index) {
+    cdb_column_t* col = cdb_get_column_by_index(db, col_index);
+    if (!col) return -1;
     
-    if (expand_column_if_needed(col) < 0) return -1;
+    if (expand_column_if_needed(db, col) < 0) return -1;
+    
+    /* NULL strings are empty ranges in the byte buffer */
+    if (col->data_type == CDB_TYPE_STRING) {
+        uint64_t* offsets = (uint64_t*)col->data;
+        offsets[col->num_rows + 1] = offsets[col->num_rows];
+    } else if (col->data_type == CDB_TYPE_DICT_STRING) {
+        ((uint32_t*)col->data)[col->num_rows] = 0;
+    }
+    
+    /* Set null bit */
+    size_t byte_idx = col->num_rows / 8;
+    size_t bit_idx = col->num_rows % 8;
+    col->null_bitmap[byte_idx] |= (1 << bit_idx);
+    col->null_count++;
     
-    uint8_t* data = (uint8_t*)col->data;
-    data[col->num_rows] = value ? 1 : 0;
     col->num_rows++;
+    check_appended_order(col, col->num_rows - 1);
     
     return 0;
 }
 
+/* Insert NULL by column handle */
+int cdb_insert_null_h(cdb_database_t* db, size_t col_index) {
+    cdb_write_lock(db);
+    int status = insert_null(db, col_index);
+    cdb_write_unlock(db);
+    return status;
+}
+
 /* Insert NULL */
 int cdb_insert_null(cdb_database_t* db, const char* column_name) {
+    cdb_write_lock(db);
+    int idx = cdb_get_column_index(db, column_name);
+    int status = idx < 0 ? -1 : insert_null(db, (size_t)idx);
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Grow capacity once for a batch of n rows, keeping growth amortized */
+static int reserve_for_append(cdb_database_t* db, cdb_column_t* col, size_t n) {
+    size_t required = col->num_rows + n;
+    if (required <= col->capacity) return 0;
+    return cdb_column_reserve(col, grown_capacity(db, col, required));
+}
+
+/* Copy n null bits from null_bitmap into the column starting at num_rows */
+static void append_null_bits(cdb_column_t* col, const uint8_t* null_bitmap, size_t n) {
+    size_t start = col->num_rows;
+    
+    if (start % 8 == 0) {
+        /* Byte aligned: copy whole bytes, mask off bits past the batch */
+        size_t full_bytes = n / 8;
+        memcpy(col->null_bitmap + start / 8, null_bitmap, full_bytes);
+        if (n % 8) {
+            col->null_bitmap[start / 8 + full_bytes] =
+                null_bitmap[full_bytes] & (uint8_t)((1u << (n % 8)) - 1);
+        }
+        return;
+    }
+    
+    for (size_t i = 0; i < n; i++) {
+        if ((null_bitmap[i / 8] >> (i % 8)) & 1) {
+            size_t row = start + i;
+            col->null_bitmap[row / 8] |= (uint8_t)(1u << (row % 8));
+        }
+    }
+}
+
+/* Append n fixed-width values with a single copy into the column; the caller holds the write lock */
+static int append_fixed(cdb_database_t* db, const char* column_name,
+                        const void* values, size_t n, const uint8_t* null_bitmap) {
     cdb_column_t* col = cdb_get_column(db, column_name);
     if (!col) {
         set_error("Column not found");
         return -1;
     }
+    if (col->data_type == CDB_TYPE_STRING || col->data_type == CDB_TYPE_DICT_STRING) {
+        set_error("Use cdb_append_string_array for string columns");
+        return -1;
+    }
+    if (n == 0) return 0;
+    if (!values) {
+        set_error("Invalid values array");
+        return -1;
+    }
     
-    if (expand_column_if_needed(col) < 0) return -1;
+    if (reserve_for_append(db, col, n) < 0) return -1;
     
-    /* Set null bit */
-    size_t byte_idx = col->num_rows / 8;
-    size_t bit_idx = col->num_rows % 8;
-    col->null_bitmap[byte_idx] |= (1 << bit_idx);
+    size_t element_size = cdb_type_size(col->data_type);
+    uint8_t* dest = (uint8_t*)col->data + col->num_rows * element_size;
     
-    col->num_rows++;
+    if (col->data_type == CDB_TYPE_BOOL) {
+        /* Normalize to 0/1 like cdb_insert_bool */
+        const uint8_t* src = (const uint8_t*)values;
+        for (size_t i = 0; i < n; i++) {
+            dest[i] = src[i] ? 1 : 0;
+        }
+    } else {
+        memcpy(dest, values, n * element_size);
+    }
+    
+    if (null_bitmap) {
+        append_null_bits(col, null_bitmap, n);
+        col->null_count += cdb_count_nulls(null_bitmap, n);
+    }
+    
+    col->num_rows += n;
+    check_appended_order(col, col->num_rows - n);
+    return 0;
+}
+
+/* Append n fixed-width values */
+int cdb_append_array(cdb_database_t* db, const char* column_name,
+                     const void* values, size_t n, const uint8_t* null_bitmap) {
+    cdb_write_lock(db);
+    int status = append_fixed(db, column_name, values, n, null_bitmap);
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Type-checked wrapper around cdb_append_array */
+static int append_typed_array(cdb_database_t* db, const char* column_name, cdb_data_type_t type,
+                              const void* values, size_t n, const uint8_t* null_bitmap) {
+    cdb_write_lock(db);
+    int status = -1;
+    cdb_column_t* col = cdb_get_column(db, column_name);
+    if (!col || col->data_type != type) {
+        set_error("Column not found or type mismatch");
+    } else {
+        status = append_fixed(db, column_name, values, n, null_bitmap);
+    }
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Append int32 array */
+int cdb_append_int32_array(cdb_database_t* db, const char* column_name,
+                           const int32_t* values, size_t n, const uint8_t* null_bitmap) {
+    return append_typed_array(db, column_name, CDB_TYPE_INT32, values, n, null_bitmap);
+}
+
+/* Append int64 array */
+int cdb_append_int64_array(cdb_database_t* db, const char* column_name,
+                           const int64_t* values, size_t n, const uint8_t* null_bitmap) {
+    return append_typed_array(db, column_name, CDB_TYPE_INT64, values, n, null_bitmap);
+}
+
+/* Append float32 array */
+int cdb_append_float32_array(cdb_database_t* db, const char* column_name,
+                             const float* values, size_t n, const uint8_t* null_bitmap) {
+    return append_typed_array(db, column_name, CDB_TYPE_FLOAT32, values, n, null_bitmap);
+}
+
+/* Append float64 array */
+int cdb_append_float64_array(cdb_database_t* db, const char* column_name,
+                             const double* values, size_t n, const uint8_t* null_bitmap) {
+    return append_typed_array(db, column_name, CDB_TYPE_FLOAT64, values, n, null_bitmap);
+}
+
+/* Append bool array */
+int cdb_append_bool_array(cdb_database_t* db, const char* column_name,
+                          const uint8_t* values, size_t n, const uint8_t* null_bitmap) {
+    return append_typed_array(db, column_name, CDB_TYPE_BOOL, values, n, null_bitmap);
+}
+
+/* Append string array (NULL entries are stored as NULL values); the caller holds the write lock */
+static int append_strings(cdb_database_t* db, const char* column_name,
+                          const char* const* values, size_t n, const uint8_t* null_bitmap) {
+    cdb_column_t* col = cdb_get_column(db, column_name);
+    if (!col || (col->data_type != CDB_TYPE_STRING && col->data_type != CDB_TYPE_DICT_STRING)) {
+        set_error("Column not found or type mismatch");
+        return -1;
+    }
+    if (n == 0) return 0;
+    if (!values) {
+        set_error("Invalid values array");
+        return -1;
+    }
+    
+    if (reserve_for_append(db, col, n) < 0) return -1;
+    
+    if (col->data_type == CDB_TYPE_DICT_STRING) {
+        /* Encode the whole batch before committing any row */
+        uint32_t* codes = (uint32_t*)col->data + col->num_rows;
+        for (size_t i = 0; i < n; i++) {
+            int is_null = !values[i] || (null_bitmap && ((null_bitmap[i / 8] >> (i % 8)) & 1));
+            codes[i] = 0;
+            if (!is_null && dict_intern(col, values[i], strlen(values[i]), &codes[i]) < 0) return -1;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (!values[i] || (null_bitmap && ((null_bitmap[i / 8] >> (i % 8)) & 1))) {
+                size_t row = col->num_rows + i;
+                col->null_bitmap[row / 8] |= (uint8_t)(1u << (row % 8));
+                col->null_count++;
+            }
+        }
+        col->num_rows += n;
+        return 0;
+    }
+    
+    /* Size the byte buffer once for the whole batch */
+    size_t total_bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (values[i]) total_bytes += strlen(values[i]);
+    }
+    if (cdb_string_reserve(col, col->string_data_size + total_bytes) < 0) return -1;
+    
+    for (size_t i = 0; i < n; i++) {
+        int is_null = !values[i] || (null_bitmap && ((null_bitmap[i / 8] >> (i % 8)) & 1));
+        if (is_null) {
+            size_t row = col->num_rows;
+            col->null_bitmap[row / 8] |= (uint8_t)(1u << (row % 8));
+            col->null_count++;
+            push_string(col, NULL, 0);
+        } else {
+            push_string(col, values[i], strlen(values[i]));
+        }
+    }
     
     return 0;
 }
 
+/* Append string array */
+int cdb_append_string_array(cdb_database_t* db, const char* column_name,
+                            const char* const* values, size_t n, const uint8_t* null_bitmap) {
+    cdb_write_lock(db);
+    int status = append_strings(db, column_name, values, n, null_bitmap);
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Append every row of src, a loaded column of the same type in another
+ * database; dictionary codes are translated through the values */
+int cdb_append_column(cdb_database_t* db, size_t col_index, const cdb_column_t* src) {
+    if (!db || col_index >= db->num_columns || db->columns[col_index].data_type != src->data_type) {
+        set_error("Column not found or type mismatch");
+        return -1;
+    }
+    cdb_column_t* col = &db->columns[col_index];
+    size_t n = src->num_rows;
+    if (n == 0) return 0;
+    if (cdb_column_ensure_loaded(db, col) < 0 || reserve_for_append(db, col, n) < 0) return -1;
+    
+    size_t first = col->num_rows;
+    if (col->data_type == CDB_TYPE_STRING) {
+        const uint64_t* src_offsets = (const uint64_t*)src->data;
+        size_t bytes = (size_t)(src_offsets[n] - src_offsets[0]);
+        if (cdb_string_reserve(col, col->string_data_size + bytes) < 0) return -1;
+        if (bytes > 0) {
+            memcpy(col->string_data + col->string_data_size, src->string_data + src_offsets[0], bytes);
+        }
+        uint64_t* offsets = (uint64_t*)col->data;
+        for (size_t i = 0; i < n; i++) {
+            offsets[first + i + 1] = col->string_data_size + (src_offsets[i + 1] - src_offsets[0]);
+        }
+        col->string_data_size += bytes;
+    } else if (col->data_type == CDB_TYPE_DICT_STRING) {
+        uint32_t* code_map = (uint32_t*)malloc((src->dict_size ? src->dict_size : 1) * sizeof(uint32_t));
+        if (!code_map) {
+            set_error("Failed to allocate dictionary map");
+            return -1;
+        }
+        for (size_t c = 0; c < src->dict_size; c++) {
+            uint64_t start = src->dict_offsets[c];
+            if (dict_intern(col, src->string_data + start, (size_t)(src->dict_offsets[c + 1] - start), &code_map[c]) < 0) {
+                free(code_map);
+                return -1;
+            }
+        }
+        const uint32_t* src_codes = (const uint32_t*)src->data;
+        uint32_t* codes = (uint32_t*)col->data + first;
+        for (size_t i = 0; i < n; i++) {
+            codes[i] = src_codes[i] < src->dict_size ? code_map[src_codes[i]] : 0;
+        }
+        free(code_map);
+    } else {
+        size_t element_size = cdb_type_size(col->data_type);
+        memcpy((uint8_t*)col->data + first * element_size, src->data, n * element_size);
+    }
+    
+    if (src->null_count) {
+        append_null_bits(col, src->null_bitmap, n);
+        col->null_count += src->null_count;
+    }
+    col->num_rows += n;
+    check_appended_order(col, first);
+    return 0;
+}
+
+/* Whether a row value is NULL for its column */
+static int row_value_is_null(const cdb_column_t* col, const cdb_value_t* value) {
+    if (value->is_null) return 1;
+    return (col->data_type == CDB_TYPE_STRING || col->data_type == CDB_TYPE_DICT_STRING) && !value->as.str;
+}
+
+/* Make room for a batch of rows in one column; DICT_STRING codes are
+ * interned here, so nothing after this step can fail */
+static int prepare_row_column(cdb_database_t* db, cdb_column_t* col,
+                              const cdb_value_t* values, size_t stride, size_t n) {
+    if (reserve_for_append(db, col, n) < 0) return -1;
+    
+    if (col->data_type == CDB_TYPE_STRING) {
+        size_t total_bytes = 0;
+        for (size_t r = 0; r < n; r++) {
+            const cdb_value_t* value = &values[r * stride];
+            if (!row_value_is_null(col, value)) total_bytes += strlen(value->as.str);
+        }
+        return cdb_string_reserve(col, col->string_data_size + total_bytes);
+    }
+    
+    if (col->data_type == CDB_TYPE_DICT_STRING) {
+        uint32_t* codes = (uint32_t*)col->data + col->num_rows;
+        for (size_t r = 0; r < n; r++) {
+            const cdb_value_t* value = &values[r * stride];
+            codes[r] = 0;
+            if (!row_value_is_null(col, value) &&
+                dict_intern(col, value->as.str, strlen(value->as.str), &codes[r]) < 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+#define CDB_ROW_LOOP(T, MEMBER)                                              \
+    do {                                                                     \
+        T* dest = (T*)col->data + col->num_rows;                             \
+        for (size_t r = 0; r < n; r++) {                                     \
+            const cdb_value_t* value = &values[r * stride];                  \
+            dest[r] = value->is_null ? (T)0 : (T)value->as.MEMBER;           \
+        }                                                                    \
+    } while (0)
+
+/* Write a prepared batch into one column, dispatching on its type once */
+static void write_row_column(cdb_column_t* col, const cdb_value_t* values, size_t stride, size_t n) {
+    size_t start = col->num_rows;
+    switch (col->data_type) {
+        case CDB_TYPE_INT32: CDB_ROW_LOOP(int32_t, i32); break;
+        case CDB_TYPE_INT64: CDB_ROW_LOOP(int64_t, i64); break;
+        case CDB_TYPE_FLOAT32: CDB_ROW_LOOP(float, f32); break;
+        case CDB_TYPE_FLOAT64: CDB_ROW_LOOP(double, f64); break;
+        case CDB_TYPE_BOOL: {
+            uint8_t* dest = (uint8_t*)col->data + start;
+            for (size_t r = 0; r < n; r++) {
+                const cdb_value_t* value = &values[r * stride];
+                dest[r] = !value->is_null && value->as.b ? 1 : 0;
+            }
+            break;
+        }
+        case CDB_TYPE_STRING:
+            /* push_string advances num_rows itself */
+            for (size_t r = 0; r < n; r++) {
+                const cdb_value_t* value = &values[r * stride];
+                if (row_value_is_null(col, value)) {
+                    push_string(col, NULL, 0);
+                } else {
+                    push_string(col, value->as.str, strlen(value->as.str));
+                }
+            }
+            col->num_rows = start;
+            break;
+        default:
+            break;  /* DICT_STRING codes were written by prepare_row_column */
+    }
+    
+    for (size_t r = 0; r < n; r++) {
+        if (row_value_is_null(col, &values[r * stride])) {
+            size_t row = start + r;
+            col->null_bitmap[row / 8] |= (uint8_t)(1u << (row % 8));
+            col->null_count++;
+        }
+    }
+    col->num_rows = start + n;
+    check_appended_order(col, start);
+}
+
+#undef CDB_ROW_LOOP
+
+/* Append num_rows rows; the caller holds the write lock */
+static int append_rows(cdb_database_t* db, const cdb_value_t* values, size_t num_rows) {
+    if (!db || (!values && num_rows > 0)) {
+        set_error("Invalid database or values");
+        return -1;
+    }
+    if (db->num_columns == 0) {
+        set_error("Database has no columns");
+        return -1;
+    }
+    
+    for (size_t c = 0; c < db->num_columns; c++) {
+        if (cdb_column_ensure_loaded(db, &db->columns[c]) < 0) return -1;
+        if (db->columns[c].num_rows != db->columns[0].num_rows) {
+            set_error("Columns have different row counts");
+            return -1;
+        }
+    }
+    if (num_rows == 0) return 0;
+    
+    /* Reserve everything first so a failure appends no row at all */
+    size_t stride = db->num_columns;
+    for (size_t c = 0; c < db->num_columns; c++) {
+        if (prepare_row_column(db, &db->columns[c], values + c, stride, num_rows) < 0) return -1;
+    }
+    for (size_t c = 0; c < db->num_columns; c++) {
+        write_row_column(&db->columns[c], values + c, stride, num_rows);
+    }
+    return 0;
+}
+
+/* Append one row */
+int cdb_append_row(cdb_database_t* db, const cdb_value_t* values) {
+    return cdb_append_rows(db, values, 1);
+}
+
+/* Append rows stored back to back */
+int cdb_append_rows(cdb_database_t* db, const cdb_value_t* values, size_t num_rows) {
+    cdb_write_lock(db);
+    int status = append_rows(db, values, num_rows);
+    cdb_write_unlock(db);
+    return status;
+}
+
 /* Get int32 */
 int32_t cdb_get_int32(cdb_column_t* col, size_t row_index) {
     if (!col || col->data_type != CDB_TYPE_INT32 || row_index >= col->num_rows) {
@@ -368,13 +1420,23 @@ double cdb_get_float64(cdb_column_t* col, size_t row_index) {
     return data[row_index];
 }
 
-/* Get string */
-char* cdb_get_string(cdb_column_t* col, size_t row_index) {
+/* Get string (not NUL-terminated; length returned through *length) */
+const char* cdb_get_string(cdb_column_t* col, size_t row_index, size_t* length) {
+    if (length) *length = 0;
+    if (col && col->data_type == CDB_TYPE_DICT_STRING && row_index < col->num_rows) {
+        return cdb_dict_value(col, ((const uint32_t*)col->data)[row_index], length);
+    }
     if (!col || col->data_type != CDB_TYPE_STRING || row_index >= col->num_rows) {
         return NULL;
     }
-    char** strings = (char**)col->data;
-    return strings[row_index];
+    const uint64_t* offsets = (const uint64_t*)col->data;
+    uint64_t start = offsets[row_index];
+    uint64_t end = offsets[row_index + 1];
+    if (end < start || end > col->string_data_size) {
+        return NULL;
+    }
+    if (length) *length = (size_t)(end - start);
+    return col->string_data ? col->string_data + start : "";
 }
 
 /* Get bool */
@@ -386,11 +1448,50 @@ uint8_t cdb_get_bool(cdb_column_t* col, size_t row_index) {
     return data[row_index];
 }
 
+/* Get the dictionary code of a row */
+uint32_t cdb_get_dict_code(cdb_column_t* col, size_t row_index) {
+    if (!col || col->data_type != CDB_TYPE_DICT_STRING || row_index >= col->num_rows) {
+        return 0;
+    }
+    const uint32_t* codes = (const uint32_t*)col->data;
+    return codes[row_index];
+}
+
+/* Find the code of a value in a column's dictionary */
+int64_t cdb_dict_lookup(cdb_column_t* col, const char* value) {
+    if (!col || col->data_type != CDB_TYPE_DICT_STRING || !value) {
+        return -1;
+    }
+    if (!col->dict_index && rebuild_dict_index(col, col->dict_size) < 0) {
+        return -1;
+    }
+    size_t len = strlen(value);
+    return dict_find(col, value, len, hash_bytes(value, len));
+}
+
+/* Get a dictionary value by code (not NUL-terminated) */
+const char* cdb_dict_value(cdb_column_t* col, uint32_t code, size_t* length) {
+    if (length) *length = 0;
+    if (!col || col->data_type != CDB_TYPE_DICT_STRING || code >= col->dict_size) {
+        return NULL;
+    }
+    uint64_t start = col->dict_offsets[code];
+    uint64_t end = col->dict_offsets[code + 1];
+    if (end < start || end > col->string_data_size) {
+        return NULL;
+    }
+    if (length) *length = (size_t)(end - start);
+    return col->string_data ? col->string_data + start : "";
+}
+
 /* Check if value is NULL */
 int cdb_is_null(cdb_column_t* col, size_t row_index) {
     if (!col || row_index >= col->num_rows) {
         return -1;
     }
+    if (col->null_count == 0) {
+        return 0;
+    }
     
     size_t byte_idx = row_index / 8;
     size_t bit_idx = row_index % 8;
@@ -0,0 +1,153 @@
+/*
+ * ColumnDB Aggregate Implementation
+ * Null-aware SUM/MIN/MAX/COUNT/MEAN over column data
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "column_db_internal.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define CDB_AGG_LANES 8  /* Independent accumulators per kernel */
+
+/* x86 builds with GCC/Clang get an AVX2 copy of the kernels, picked at runtime.
+ * Other targets use the baseline copy (SSE2 on x86-64, NEON on AArch64). */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CDB_AGG_AVX2_DISPATCH 1
+#endif
+
+/* Binary operations the kernels reduce with */
+#define CDB_STEP_SUM(acc, v) ((acc) + (v))
+#define CDB_STEP_MIN(acc, v) ((v) < (acc) ? (v) : (acc))  /* Skips NaN values */
+#define CDB_STEP_MAX(acc, v) ((v) > (acc) ? (v) : (acc))
+
+/* Index of the lowest set bit (x must be non-zero) */
+static unsigned count_trailing_zeros(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (unsigned)index;
+#else
+    unsigned index = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+/* Null bits of a 64-row block; a NULL bitmap means the column has no NULLs */
+static uint64_t block_nulls(const uint8_t* null_bitmap, size_t base, size_t n) {
+    if (null_bitmap) return cdb_null_word(null_bitmap, base, n);
+    return n - base >= 64 ? 0 : ~(uint64_t)0 << (n - base);
+}
+
+#define CDB_KERNEL_SUFFIX _base
+#define CDB_KERNEL_TARGET
+#include "column_db_kernels.h"
+#undef CDB_KERNEL_SUFFIX
+#undef CDB_KERNEL_TARGET
+
+#ifdef CDB_AGG_AVX2_DISPATCH
+#define CDB_KERNEL_SUFFIX _avx2
+#define CDB_KERNEL_TARGET __attribute__((target("avx2")))
+#include "column_db_kernels.h"
+#undef CDB_KERNEL_SUFFIX
+#undef CDB_KERNEL_TARGET
+#endif
+
+typedef void (*cdb_reduce_fn)(const cdb_column_t* col, cdb_agg_op_t op, cdb_agg_result_t* result);
+
+/* Pick the widest kernel set the CPU supports (once) */
+static cdb_reduce_fn select_reduce(void) {
+    static cdb_reduce_fn reduce = NULL;
+    if (!reduce) {
+#ifdef CDB_AGG_AVX2_DISPATCH
+        __builtin_cpu_init();
+        reduce = __builtin_cpu_supports("avx2") ? reduce_avx2 : reduce_base;
+#else
+        reduce = reduce_base;
+#endif
+    }
+    return reduce;
+}
+
+/* Whether a float column has a non-NULL value that is not NaN. MIN/MAX
+ * skip NaN, so a result still at its +/-inf identity is either a real
+ * infinity or a column of nothing but NaN; only then is this scan run. */
+static int has_number(const cdb_column_t* col) {
+    for (size_t row = 0; row < col->num_rows; row++) {
+        if (col->null_count && ((col->null_bitmap[row / 8] >> (row % 8)) & 1)) continue;
+        double v = col->data_type == CDB_TYPE_FLOAT32 ? ((const float*)col->data)[row]
+                                                      : ((const double*)col->data)[row];
+        if (!isnan(v)) return 1;
+    }
+    return 0;
+}
+
+/* Aggregate a column's non-NULL values */
+int cdb_aggregate(cdb_column_t* col, cdb_agg_op_t op, cdb_agg_result_t* result) {
+    if (!col || !result) {
+        set_error("Invalid column or result");
+        return -1;
+    }
+    if (op < CDB_AGG_SUM || op > CDB_AGG_MEAN) {
+        set_error("Unknown aggregate operation");
+        return -1;
+    }
+    if (col->storage == CDB_STORAGE_UNLOADED) {
+        set_error("Column is not loaded");
+        return -1;
+    }
+    
+    memset(result, 0, sizeof(*result));
+    result->count = col->num_rows - col->null_count;
+    if (op == CDB_AGG_COUNT) {
+        result->i = (int64_t)result->count;
+        return 0;
+    }
+    
+    switch (col->data_type) {
+        case CDB_TYPE_INT32:
+        case CDB_TYPE_INT64:
+        case CDB_TYPE_BOOL:
+            break;
+        case CDB_TYPE_FLOAT32:
+        case CDB_TYPE_FLOAT64:
+            result->is_float = 1;
+            break;
+        default:
+            set_error("Aggregate requires a numeric or bool column");
+            return -1;
+    }
+    
+    /* SQL semantics: aggregates over no values are NULL */
+    if (result->count == 0) {
+        result->is_null = 1;
+        result->is_float |= (op == CDB_AGG_MEAN);
+        return 0;
+    }
+    
+    select_reduce()(col, op, result);
+    if ((op == CDB_AGG_MIN || op == CDB_AGG_MAX) && result->is_float &&
+        result->f == (op == CDB_AGG_MIN ? HUGE_VAL : -HUGE_VAL) && !has_number(col)) {
+        result->is_null = 1;
+        result->f = 0.0;
+    }
+    cdb_stat_add(CDB_STAT_ROWS_SCANNED, col->num_rows);
+    
+    if (op == CDB_AGG_MEAN) {
+        double sum = result->is_float ? result->f : (double)result->i;
+        result->f = sum / (double)result->count;
+        result->i = 0;
+        result->is_float = 1;
+    }
+    return 0;
+}
@@ -0,0 +1,725 @@
+/*
+ * ColumnDB Arrow Interop
+ * Export to and import from the Arrow C data interface. Exports share the
+ * columns' values, offsets and string bytes with the consumer and keep
+ * one reference per array until the last is released; imports copy each
+ * Arrow buffer into the new database's columns in one go.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include "column_db_internal.h"
+
+/* Stand-in for buffers the database has not allocated; Arrow wants
+ * offsets buffers to hold at least one entry */
+static const uint64_t empty_buffer[1] = {0};
+
+/* Shared by the arrays and stream of one export */
+typedef struct {
+    cdb_rwlock_t* lock;       /* Consumers may release arrays from any thread */
+    size_t refs;
+    void (*on_release)(void* ctx);
+    void* ctx;
+} cdb_arrow_owner_t;
+
+typedef struct {
+    cdb_arrow_owner_t* owner;
+    const void* buffers[3];
+    struct ArrowArray* dictionary;
+    uint8_t* validity;        /* Inverted copy of the null bitmap */
+    uint8_t* bits;            /* BOOL values packed into bits */
+} cdb_arrow_array_private_t;
+
+typedef struct {
+    char* name;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+} cdb_arrow_schema_private_t;
+
+typedef struct {
+    cdb_database_t* db;
+    cdb_arrow_owner_t* owner;
+    size_t num_columns;       /* Columns when the stream was created */
+    int done;
+    char error[256];
+} cdb_arrow_stream_private_t;
+
+/* Owner with one reference; on failure on_release runs right away */
+static cdb_arrow_owner_t* owner_create(void (*on_release)(void*), void* ctx) {
+    cdb_arrow_owner_t* owner = (cdb_arrow_owner_t*)malloc(sizeof(cdb_arrow_owner_t));
+    cdb_rwlock_t* lock = owner ? cdb_rwlock_create() : NULL;
+    if (!lock) {
+        free(owner);
+        if (on_release) on_release(ctx);
+        set_error("Failed to allocate Arrow export");
+        return NULL;
+    }
+    owner->lock = lock;
+    owner->refs = 1;
+    owner->on_release = on_release;
+    owner->ctx = ctx;
+    return owner;
+}
+
+static void owner_retain(cdb_arrow_owner_t* owner) {
+    cdb_rwlock_write(owner->lock);
+    owner->refs++;
+    cdb_rwlock_write_unlock(owner->lock);
+}
+
+static void owner_release(cdb_arrow_owner_t* owner) {
+    cdb_rwlock_write(owner->lock);
+    int last = --owner->refs == 0;
+    cdb_rwlock_write_unlock(owner->lock);
+    if (!last) return;
+    
+    if (owner->on_release) owner->on_release(owner->ctx);
+    cdb_rwlock_destroy(owner->lock);
+    free(owner);
+}
+
+static void release_array(struct ArrowArray* array) {
+    cdb_arrow_array_private_t* priv = (cdb_arrow_array_private_t*)array->private_data;
+    
+    /* Children the consumer moved out have a NULL release */
+    for (int64_t i = 0; i < array->n_children; i++) {
+        struct ArrowArray* child = array->children[i];
+        if (child->release) child->release(child);
+        free(child);
+    }
+    free(array->children);
+    if (priv->dictionary) {
+        if (priv->dictionary->release) priv->dictionary->release(priv->dictionary);
+        free(priv->dictionary);
+    }
+    free(priv->validity);
+    free(priv->bits);
+    owner_release(priv->owner);
+    free(priv);
+    array->release = NULL;
+}
+
+static void release_schema(struct ArrowSchema* schema) {
+    cdb_arrow_schema_private_t* priv = (cdb_arrow_schema_private_t*)schema->private_data;
+    
+    for (int64_t i = 0; i < schema->n_children; i++) {
+        struct ArrowSchema* child = priv->children[i];
+        if (child->release) child->release(child);
+        free(child);
+    }
+    free(priv->children);
+    if (priv->dictionary) {
+        if (priv->dictionary->release) priv->dictionary->release(priv->dictionary);
+        free(priv->dictionary);
+    }
+    free(priv->name);
+    free(priv);
+    schema->release = NULL;
+}
+
+/* Fill in an array with no buffers set yet; it holds a reference to owner */
+static cdb_arrow_array_private_t* init_array(struct ArrowArray* out, cdb_arrow_owner_t* owner,
+                                             size_t length, size_t null_count,
+                                             int64_t n_buffers, size_t n_children) {
+    cdb_arrow_array_private_t* priv = (cdb_arrow_array_private_t*)calloc(1, sizeof(cdb_arrow_array_private_t));
+    struct ArrowArray** children = n_children ? (struct ArrowArray**)calloc(n_children, sizeof(struct ArrowArray*)) : NULL;
+    if (!priv || (n_children && !children)) {
+        free(priv);
+        free(children);
+        set_error("Failed to allocate Arrow array");
+        return NULL;
+    }
+    owner_retain(owner);
+    priv->owner = owner;
+    
+    memset(out, 0, sizeof(*out));
+    out->length = (int64_t)length;
+    out->null_count = (int64_t)null_count;
+    out->n_buffers = n_buffers;
+    out->buffers = priv->buffers;
+    out->children = children;
+    out->release = release_array;
+    out->private_data = priv;
+    return priv;
+}
+
+/* Add the next child of a struct array (children are filled in order) */
+static struct ArrowArray* add_child_array(struct ArrowArray* parent) {
+    struct ArrowArray* child = (struct ArrowArray*)calloc(1, sizeof(struct ArrowArray));
+    if (!child) {
+        set_error("Failed to allocate Arrow array");
+        return NULL;
+    }
+    parent->children[parent->n_children++] = child;
+    return child;
+}
+
+static cdb_arrow_schema_private_t* init_schema(struct ArrowSchema* out, const char* format,
+                                               const char* name, int64_t flags, size_t n_children) {
+    cdb_arrow_schema_private_t* priv = (cdb_arrow_schema_private_t*)calloc(1, sizeof(cdb_arrow_schema_private_t));
+    size_t name_len = strlen(name);
+    char* name_copy = priv ? (char*)malloc(name_len + 1) : NULL;
+    struct ArrowSchema** children = n_children ? (struct ArrowSchema**)calloc(n_children, sizeof(struct ArrowSchema*)) : NULL;
+    if (!name_copy || (n_children && !children)) {
+        free(priv);
+        free(name_copy);
+        free(children);
+        set_error("Failed to allocate Arrow schema");
+        return NULL;
+    }
+    memcpy(name_copy, name, name_len + 1);
+    priv->name = name_copy;
+    priv->children = children;
+    
+    memset(out, 0, sizeof(*out));
+    out->format = format;
+    out->name = name_copy;
+    out->flags = flags;
+    out->children = children;
+    out->release = release_schema;
+    out->private_data = priv;
+    return priv;
+}
+
+/* Arrow format of a column's values (the indices, for DICT_STRING) */
+static const char* column_format(const cdb_column_t* col) {
+    switch (col->data_type) {
+        case CDB_TYPE_INT32: return "i";
+        case CDB_TYPE_INT64: return "l";
+        case CDB_TYPE_FLOAT32: return "f";
+        case CDB_TYPE_FLOAT64: return "g";
+        case CDB_TYPE_STRING: return "U";
+        case CDB_TYPE_BOOL: return "b";
+        case CDB_TYPE_DICT_STRING: return col->dict_size <= INT32_MAX ? "i" : "I";
+        default: return NULL;
+    }
+}
+
+/* Every column loaded and of the same length, as one struct array needs */
+static int prepare_export(cdb_database_t* db) {
+    for (size_t c = 0; c < db->num_columns; c++) {
+        cdb_column_t* col = &db->columns[c];
+        if (col->num_rows != db->columns[0].num_rows) {
+            set_error("Arrow export needs columns with the same number of rows");
+            return -1;
+        }
+        if (cdb_column_ensure_loaded(db, col) < 0) return -1;
+    }
+    return 0;
+}
+
+static int export_schema(const cdb_database_t* db, struct ArrowSchema* out) {
+    cdb_arrow_schema_private_t* root = init_schema(out, "+s", "", 0, db->num_columns);
+    if (!root) return -1;
+    
+    for (size_t c = 0; c < db->num_columns; c++) {
+        const cdb_column_t* col = &db->columns[c];
+        struct ArrowSchema* child = (struct ArrowSchema*)calloc(1, sizeof(struct ArrowSchema));
+        if (!child) {
+            set_error("Failed to allocate Arrow schema");
+            release_schema(out);
+            return -1;
+        }
+        root->children[out->n_children++] = child;
+        cdb_arrow_schema_private_t* priv = init_schema(child, column_format(col), col->name, ARROW_FLAG_NULLABLE, 0);
+        if (!priv) {
+            release_schema(out);
+            return -1;
+        }
+        
+        if (col->data_type == CDB_TYPE_DICT_STRING) {
+            priv->dictionary = (struct ArrowSchema*)calloc(1, sizeof(struct ArrowSchema));
+            if (!priv->dictionary || !init_schema(priv->dictionary, "U", "", 0, 0)) {
+                set_error("Failed to allocate Arrow schema");
+                release_schema(out);
+                return -1;
+            }
+            child->dictionary = priv->dictionary;
+        }
+    }
+    return 0;
+}
+
+/* Arrow validity bits (set = valid) of a null bitmap */
+static uint8_t* validity_bits(const uint8_t* null_bitmap, size_t num_rows) {
+    size_t bytes = (num_rows + 7) / 8;
+    uint8_t* bits = (uint8_t*)malloc(bytes ? bytes : 1);
+    if (!bits) return NULL;
+    for (size_t i = 0; i < bytes; i++) {
+        bits[i] = (uint8_t)~null_bitmap[i];
+    }
+    return bits;
+}
+
+/* BOOL values, one byte each, as bits */
+static uint8_t* pack_bools(const uint8_t* values, size_t num_rows) {
+    size_t bytes = (num_rows + 7) / 8;
+    uint8_t* bits = (uint8_t*)calloc(bytes ? bytes : 1, 1);
+    if (!bits) return NULL;
+    for (size_t i = 0; i < num_rows; i++) {
+        if (values[i]) bits[i / 8] |= (uint8_t)(1u << (i % 8));
+    }
+    return bits;
+}
+
+static int export_column(const cdb_column_t* col, cdb_arrow_owner_t* owner, struct ArrowArray* out) {
+    int64_t n_buffers = col->data_type == CDB_TYPE_STRING ? 3 : 2;
+    cdb_arrow_array_private_t* priv = init_array(out, owner, col->num_rows, col->null_count, n_buffers, 0);
+    if (!priv) return -1;
+    
+    if (col->null_count > 0) {
+        priv->validity = validity_bits(col->null_bitmap, col->num_rows);
+        if (!priv->validity) goto oom;
+        priv->buffers[0] = priv->validity;
+    }
+    const void* data = col->data ? col->data : (const void*)empty_buffer;
+    const void* bytes = col->string_data ? (const void*)col->string_data : (const void*)empty_buffer;
+    
+    if (col->data_type == CDB_TYPE_BOOL) {
+        priv->bits = pack_bools((const uint8_t*)data, col->num_rows);
+        if (!priv->bits) goto oom;
+        priv->buffers[1] = priv->bits;
+    } else if (col->data_type == CDB_TYPE_STRING) {
+        priv->buffers[1] = data;
+        priv->buffers[2] = bytes;
+    } else if (col->data_type == CDB_TYPE_DICT_STRING) {
+        /* NULL rows hold code 0, which Arrow leaves undefined */
+        priv->buffers[1] = data;
+        priv->dictionary = (struct ArrowArray*)calloc(1, sizeof(struct ArrowArray));
+        if (!priv->dictionary) goto oom;
+        cdb_arrow_array_private_t* dict = init_array(priv->dictionary, owner, col->dict_size, 0, 3, 0);
+        if (!dict) {
+            release_array(out);
+            return -1;
+        }
+        dict->buffers[1] = col->dict_offsets ? (const void*)col->dict_offsets : (const void*)empty_buffer;
+        dict->buffers[2] = bytes;
+        out->dictionary = priv->dictionary;
+    } else {
+        priv->buffers[1] = data;
+    }
+    return 0;
+
+oom:
+    set_error("Failed to allocate Arrow buffers");
+    release_array(out);
+    return -1;
+}
+
+static int export_array(const cdb_database_t* db, cdb_arrow_owner_t* owner, struct ArrowArray* out) {
+    size_t num_rows = db->num_columns ? db->columns[0].num_rows : 0;
+    if (!init_array(out, owner, num_rows, 0, 1, db->num_columns)) return -1;
+    
+    for (size_t c = 0; c < db->num_columns; c++) {
+        struct ArrowArray* child = add_child_array(out);
+        if (!child || export_column(&db->columns[c], owner, child) < 0) {
+            release_array(out);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Export with a hook that runs once everything exported is released */
+int cdb_export_arrow_hooked(cdb_database_t* db, struct ArrowSchema* out_schema, struct ArrowArray* out_array,
+                            void (*on_release)(void* ctx), void* ctx) {
+    if (!db || !out_schema || !out_array) {
+        if (on_release) on_release(ctx);
+        set_error("Invalid database or Arrow structs");
+        return -1;
+    }
+    
+    cdb_arrow_owner_t* owner = owner_create(on_release, ctx);
+    if (!owner) return -1;
+    
+    int status = prepare_export(db);
+    if (status == 0) status = export_schema(db, out_schema);
+    if (status == 0 && export_array(db, owner, out_array) < 0) {
+        release_schema(out_schema);
+        status = -1;
+    }
+    owner_release(owner);
+    return status;
+}
+
+int cdb_export_arrow(cdb_database_t* db, struct ArrowSchema* out_schema, struct ArrowArray* out_array) {
+    return cdb_export_arrow_hooked(db, out_schema, out_array, NULL, NULL);
+}
+
+/* The database may have changed since the stream was created: callbacks run
+ * under its read lock and check again that it can still be exported whole */
+static int stream_check(cdb_arrow_stream_private_t* priv) {
+    if (priv->db->num_columns != priv->num_columns) {
+        set_error("Database columns changed during Arrow export");
+        return EINVAL;
+    }
+    return prepare_export(priv->db) < 0 ? EINVAL : 0;
+}
+
+static int stream_get_schema(struct ArrowArrayStream* stream, struct ArrowSchema* out) {
+    cdb_arrow_stream_private_t* priv = (cdb_arrow_stream_private_t*)stream->private_data;
+    cdb_read_lock(priv->db);
+    int status = stream_check(priv);
+    if (status == 0 && export_schema(priv->db, out) < 0) status = ENOMEM;
+    cdb_read_unlock(priv->db);
+    if (status != 0) snprintf(priv->error, sizeof(priv->error), "%s", cdb_get_error());
+    return status;
+}
+
+static int stream_get_next(struct ArrowArrayStream* stream, struct ArrowArray* out) {
+    cdb_arrow_stream_private_t* priv = (cdb_arrow_stream_private_t*)stream->private_data;
+    if (priv->done) {
+        /* End of stream */
+        memset(out, 0, sizeof(*out));
+        return 0;
+    }
+    cdb_read_lock(priv->db);
+    int status = stream_check(priv);
+    if (status == 0 && export_array(priv->db, priv->owner, out) < 0) status = ENOMEM;
+    cdb_read_unlock(priv->db);
+    if (status != 0) {
+        snprintf(priv->error, sizeof(priv->error), "%s", cdb_get_error());
+        return status;
+    }
+    priv->done = 1;
+    return 0;
+}
+
+static const char* stream_get_last_error(struct ArrowArrayStream* stream) {
+    cdb_arrow_stream_private_t* priv = (cdb_arrow_stream_private_t*)stream->private_data;
+    return priv->error[0] ? priv->error : NULL;
+}
+
+static void stream_release(struct ArrowArrayStream* stream) {
+    cdb_arrow_stream_private_t* priv = (cdb_arrow_stream_private_t*)stream->private_data;
+    owner_release(priv->owner);
+    free(priv);
+    stream->release = NULL;
+}
+
+int cdb_export_arrow_stream_hooked(cdb_database_t* db, struct ArrowArrayStream* out_stream,
+                                   void (*on_release)(void* ctx), void* ctx) {
+    if (!db || !out_stream) {
+        if (on_release) on_release(ctx);
+        set_error("Invalid database or Arrow stream");
+        return -1;
+    }
+    
+    cdb_arrow_owner_t* owner = owner_create(on_release, ctx);
+    if (!owner) return -1;
+    
+    cdb_arrow_stream_private_t* priv = (cdb_arrow_stream_private_t*)calloc(1, sizeof(cdb_arrow_stream_private_t));
+    if (!priv || prepare_export(db) < 0) {
+        if (!priv) set_error("Failed to allocate Arrow stream");
+        free(priv);
+        owner_release(owner);
+        return -1;
+    }
+    
+    /* The stream keeps the owner's first reference */
+    priv->db = db;
+    priv->owner = owner;
+    priv->num_columns = db->num_columns;
+    out_stream->get_schema = stream_get_schema;
+    out_stream->get_next = stream_get_next;
+    out_stream->get_last_error = stream_get_last_error;
+    out_stream->release = stream_release;
+    out_stream->private_data = priv;
+    return 0;
+}
+
+int cdb_export_arrow_stream(cdb_database_t* db, struct ArrowArrayStream* out_stream) {
+    return cdb_export_arrow_stream_hooked(db, out_stream, NULL, NULL);
+}
+
+/* Whether a format is one of Arrow's integer types (dictionary indices) */
+static int is_index_format(const char* format) {
+    return format[0] != '\0' && format[1] == '\0' && strchr("cCsSiIlL", format[0]) != NULL;
+}
+
+/* Column type for an Arrow field, -1 with the error set if there is none */
+static int import_type(const struct ArrowSchema* field, cdb_data_type_t* type) {
+    const char* format = field->format;
+    
+    if (field->dictionary) {
+        const char* values = field->dictionary->format;
+        if (is_index_format(format) && (strcmp(values, "u") == 0 || strcmp(values, "U") == 0)) {
+            *type = CDB_TYPE_DICT_STRING;
+            return 0;
+        }
+    } else if (strcmp(format, "i") == 0) {
+        *type = CDB_TYPE_INT32;
+        return 0;
+    } else if (strcmp(format, "l") == 0) {
+        *type = CDB_TYPE_INT64;
+        return 0;
+    } else if (strcmp(format, "f") == 0) {
+        *type = CDB_TYPE_FLOAT32;
+        return 0;
+    } else if (strcmp(format, "g") == 0) {
+        *type = CDB_TYPE_FLOAT64;
+        return 0;
+    } else if (strcmp(format, "b") == 0) {
+        *type = CDB_TYPE_BOOL;
+        return 0;
+    } else if (strcmp(format, "u") == 0 || strcmp(format, "U") == 0) {
+        *type = CDB_TYPE_STRING;
+        return 0;
+    }
+    
+    char message[256];
+    snprintf(message, sizeof(message), "Unsupported Arrow type '%s' of column '%s'",
+             format, field->name ? field->name : "");
+    set_error(message);
+    return -1;
+}
+
+/* Add a column per field of a struct schema */
+static int import_columns(cdb_database_t* db, const struct ArrowSchema* schema) {
+    if (!schema->format || strcmp(schema->format, "+s") != 0) {
+        set_error("Arrow import needs a struct array (a record batch)");
+        return -1;
+    }
+    for (int64_t i = 0; i < schema->n_children; i++) {
+        const struct ArrowSchema* field = schema->children[i];
+        cdb_data_type_t type;
+        if (!field->name) {
+            set_error("Arrow column without a name");
+            return -1;
+        }
+        if (import_type(field, &type) < 0 || cdb_add_column(db, field->name, type) < 0) return -1;
+    }
+    return 0;
+}
+
+static int bit_is_set(const uint8_t* bits, int64_t i) {
+    return (bits[i / 8] >> (i % 8)) & 1;
+}
+
+/* Mark rows whose Arrow validity bit (from bit start on) is clear as NULL */
+static void add_null_bits(uint8_t* nulls, const uint8_t* validity, int64_t start, size_t n) {
+    if (start % 8 == 0) {
+        const uint8_t* src = validity + start / 8;
+        for (size_t k = 0; k < (n + 7) / 8; k++) {
+            nulls[k] |= (uint8_t)~src[k];
+        }
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!bit_is_set(validity, start + (int64_t)i)) nulls[i / 8] |= (uint8_t)(1u << (i % 8));
+    }
+}
+
+/* Dictionary index of row i, widened from any integer format */
+static int64_t index_value(const char* format, const void* indices, int64_t i) {
+    switch (format[0]) {
+        case 'c': return ((const int8_t*)indices)[i];
+        case 'C': return ((const uint8_t*)indices)[i];
+        case 's': return ((const int16_t*)indices)[i];
+        case 'S': return ((const uint16_t*)indices)[i];
+        case 'i': return ((const int32_t*)indices)[i];
+        case 'I': return ((const uint32_t*)indices)[i];
+        case 'l': return ((const int64_t*)indices)[i];
+        default: {
+            uint64_t value = ((const uint64_t*)indices)[i];
+            return value > INT64_MAX ? -1 : (int64_t)value;
+        }
+    }
+}
+
+/* Offsets of n strings from entry start on, as uint64 (utf8 ones are widened into *copy) */
+static const uint64_t* string_offsets(const char* format, const void* offsets, int64_t start, size_t n,
+                                      uint64_t** copy) {
+    if (strcmp(format, "U") == 0) return (const uint64_t*)offsets + start;
+    
+    *copy = (uint64_t*)malloc((n + 1) * sizeof(uint64_t));
+    if (!*copy) return NULL;
+    const int32_t* narrow = (const int32_t*)offsets + start;
+    for (size_t i = 0; i <= n; i++) {
+        (*copy)[i] = (uint64_t)(uint32_t)narrow[i];
+    }
+    return *copy;
+}
+
+/* Append rows [start, start + n) of one Arrow field to column col_index, through
+ * a column that views the Arrow buffers; parent_validity marks struct rows that are NULL */
+static int import_field(cdb_database_t* db, size_t col_index, const struct ArrowSchema* field,
+                        const struct ArrowArray* array, int64_t start, size_t n,
+                        const uint8_t* parent_validity, int64_t parent_start) {
+    cdb_column_t* col = &db->columns[col_index];
+    cdb_column_t src;
+    memset(&src, 0, sizeof(src));
+    src.data_type = col->data_type;
+    src.num_rows = n;
+    if (n == 0) return 0;
+    
+    int status = -1;
+    uint8_t* nulls = NULL;
+    uint8_t* bools = NULL;
+    uint64_t* offsets = NULL;
+    uint64_t* dict_offsets = NULL;
+    uint32_t* codes = NULL;
+    
+    if ((array->null_count != 0 && array->buffers[0]) || parent_validity) {
+        nulls = (uint8_t*)calloc((n + 7) / 8, 1);
+        if (!nulls) goto oom;
+        if (array->null_count != 0 && array->buffers[0]) {
+            add_null_bits(nulls, (const uint8_t*)array->buffers[0], start, n);
+        }
+        if (parent_validity) add_null_bits(nulls, parent_validity, parent_start, n);
+        src.null_bitmap = nulls;
+        src.null_count = cdb_count_nulls(nulls, n);
+    }
+    
+    switch (col->data_type) {
+        case CDB_TYPE_BOOL:
+            bools = (uint8_t*)malloc(n);
+            if (!bools) goto oom;
+            for (size_t i = 0; i < n; i++) {
+                bools[i] = (uint8_t)bit_is_set((const uint8_t*)array->buffers[1], start + (int64_t)i);
+            }
+            src.data = bools;
+            break;
+        case CDB_TYPE_STRING:
+            src.data = (void*)string_offsets(field->format, array->buffers[1], start, n, &offsets);
+            if (!src.data) goto oom;
+            src.string_data = (char*)array->buffers[2];
+            break;
+        case CDB_TYPE_DICT_STRING: {
+            const struct ArrowArray* dict = array->dictionary;
+            if (!dict) {
+                set_error("Arrow dictionary column without a dictionary");
+                goto done;
+            }
+            if (dict->null_count != 0 && dict->buffers[0]) {
+                set_error("Arrow dictionaries with NULL values are not supported");
+                goto done;
+            }
+            src.dict_size = (size_t)dict->length;
+            src.dict_offsets = (uint64_t*)string_offsets(field->dictionary->format, dict->buffers[1],
+                                                         dict->offset, src.dict_size, &dict_offsets);
+            codes = (uint32_t*)malloc(n * sizeof(uint32_t));
+            if (!src.dict_offsets || !codes) goto oom;
+            src.string_data = (char*)dict->buffers[2];
+            for (size_t i = 0; i < n; i++) {
+                int64_t code = index_value(field->format, array->buffers[1], start + (int64_t)i);
+                int is_null = nulls && bit_is_set(nulls, (int64_t)i);
+                if (!is_null && (code < 0 || code >= dict->length)) {
+                    set_error("Arrow dictionary index out of range");
+                    goto done;
+                }
+                codes[i] = is_null ? 0 : (uint32_t)code;
+            }
+            src.data = codes;
+            break;
+        }
+        default:
+            src.data = (uint8_t*)array->buffers[1] + (size_t)start * cdb_type_size(col->data_type);
+            break;
+    }
+    
+    status = cdb_append_column(db, col_index, &src);
+    goto done;
+
+oom:
+    set_error("Failed to allocate Arrow import buffers");
+done:
+    free(nulls);
+    free(bools);
+    free(offsets);
+    free(dict_offsets);
+    free(codes);
+    return status;
+}
+
+/* Append the rows of a struct array to the columns import_columns added */
+static int import_rows(cdb_database_t* db, const struct ArrowSchema* schema, const struct ArrowArray* array) {
+    if (array->n_children != schema->n_children || (size_t)array->n_children != db->num_columns) {
+        set_error("Arrow array does not match its schema");
+        return -1;
+    }
+    const uint8_t* parent_validity = array->null_count != 0 ? (const uint8_t*)array->buffers[0] : NULL;
+    
+    for (int64_t i = 0; i < array->n_children; i++) {
+        const struct ArrowArray* child = array->children[i];
+        if (child->length < array->offset + array->length) {
+            set_error("Arrow column is shorter than its struct array");
+            return -1;
+        }
+        if (import_field(db, (size_t)i, schema->children[i], child, child->offset + array->offset,
+                         (size_t)array->length, parent_validity, array->offset) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+cdb_database_t* cdb_import_arrow(struct ArrowSchema* schema, struct ArrowArray* array) {
+    if (!schema || !array || !schema->release || !array->release) {
+        if (schema && schema->release) schema->release(schema);
+        if (array && array->release) array->release(array);
+        set_error("Invalid Arrow schema or array");
+        return NULL;
+    }
+    
+    cdb_database_t* db = cdb_create_database();
+    if (db && (import_columns(db, schema) < 0 || import_rows(db, schema, array) < 0)) {
+        cdb_free_database(db);
+        db = NULL;
+    }
+    array->release(array);
+    schema->release(schema);
+    return db;
+}
+
+/* Error of a failed stream callback */
+static void stream_error(struct ArrowArrayStream* stream, const char* what) {
+    const char* detail = stream->get_last_error ? stream->get_last_error(stream) : NULL;
+    char message[256];
+    snprintf(message, sizeof(message), "Arrow stream failed to %s%s%s", what,
+             detail ? ": " : "", detail ? detail : "");
+    set_error(message);
+}
+
+cdb_database_t* cdb_import_arrow_stream(struct ArrowArrayStream* stream) {
+    if (!stream || !stream->release) {
+        set_error("Invalid Arrow stream");
+        return NULL;
+    }
+    
+    struct ArrowSchema schema;
+    cdb_database_t* db = cdb_create_database();
+    if (!db) {
+        stream->release(stream);
+        return NULL;
+    }
+    if (stream->get_schema(stream, &schema) != 0) {
+        stream_error(stream, "get the schema");
+        stream->release(stream);
+        cdb_free_database(db);
+        return NULL;
+    }
+    
+    int status = import_columns(db, &schema);
+    while (status == 0) {
+        struct ArrowArray array;
+        if (stream->get_next(stream, &array) != 0) {
+            stream_error(stream, "get the next array");
+            status = -1;
+            break;
+        }
+        if (!array.release) break;
+        status = import_rows(db, &schema, &array);
+        array.release(&array);
+    }
+    
+    schema.release(&schema);
+    stream->release(stream);
+    if (status < 0) {
+        cdb_free_database(db);
+        return NULL;
+    }
+    return db;
+}
@@ -0,0 +1,231 @@
+/*
+ * ColumnDB checksums
+ * CRC32C (Castagnoli) of the blocks in a .cdb file. x86 CPUs with SSE4.2
+ * and ARMv8 builds with the CRC extension use the crc32c instructions;
+ * everything else uses a slicing-by-8 table. The tables are built and the
+ * instructions picked once, by whichever thread checksums first.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "column_db_internal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* x86 builds with GCC/Clang get an SSE4.2 copy, picked at runtime */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CDB_CRC_SSE42_DISPATCH 1
+#include <nmmintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define CDB_CRC_SSE42_DISPATCH 1
+#include <intrin.h>
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define CDB_CRC_ARM 1
+#include <arm_acle.h>
+#endif
+
+#define CDB_CRC32C_POLY 0x82f63b78u  /* Reflected Castagnoli polynomial */
+
+/* table[k][b]: CRC of byte b followed by k zero bytes */
+static uint32_t crc32c_table[8][256];
+
+static void compute_crc32c_table(void) {
+    for (unsigned int n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        for (unsigned int k = 0; k < 8; k++) {
+            crc = (crc & 1) ? CDB_CRC32C_POLY ^ (crc >> 1) : crc >> 1;
+        }
+        crc32c_table[0][n] = crc;
+    }
+    for (unsigned int n = 0; n < 256; n++) {
+        for (unsigned int k = 1; k < 8; k++) {
+            uint32_t prev = crc32c_table[k - 1][n];
+            crc32c_table[k][n] = crc32c_table[0][prev & 0xff] ^ (prev >> 8);
+        }
+    }
+}
+
+/* Eight bytes at a time through the tables (words are read little-endian) */
+static uint32_t crc32c_table_update(uint32_t crc, const uint8_t* p, size_t size) {
+    for (; size >= 8; p += 8, size -= 8) {
+        uint32_t lo = crc ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+        crc = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff] ^
+              crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][p[4]] ^ crc32c_table[2][p[5]] ^
+              crc32c_table[1][p[6]] ^ crc32c_table[0][p[7]];
+    }
+    for (; size > 0; p++, size--) {
+        crc = crc32c_table[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CDB_CRC_SSE42_DISPATCH
+#if defined(__GNUC__)
+#define CDB_SSE42_TARGET __attribute__((target("sse4.2")))
+#else
+#define CDB_SSE42_TARGET
+#endif
+
+/* One instruction stream, 8 bytes per instruction */
+CDB_SSE42_TARGET
+static uint32_t crc32c_sse42_stream(uint32_t crc, const uint8_t* p, size_t size) {
+#if defined(__x86_64__) || defined(_M_X64)
+    uint64_t crc64 = crc;
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+#endif
+    for (; size >= 4; p += 4, size -= 4) {
+        uint32_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+    }
+    for (; size > 0; p++, size--) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+/* The instruction has a latency of 3 cycles but issues every cycle, so
+ * large buffers run three lanes of CDB_CRC_LANE bytes side by side and
+ * combine them: appending n zero bytes is linear in the CRC, so shifting
+ * a lane's CRC past the lanes after it is a table lookup per byte. */
+#define CDB_CRC_LANE 8192
+
+static uint32_t crc32c_shift_table[4][256];  /* CRC of byte b << 8k followed by a lane of zeros */
+
+CDB_SSE42_TARGET
+static void compute_crc32c_shift_table(void) {
+    static const uint8_t zeros[CDB_CRC_LANE] = {0};
+    uint32_t bits[32];
+    for (unsigned int i = 0; i < 32; i++) {
+        bits[i] = crc32c_sse42_stream((uint32_t)1 << i, zeros, CDB_CRC_LANE);
+    }
+    for (unsigned int k = 0; k < 4; k++) {
+        for (unsigned int b = 0; b < 256; b++) {
+            uint32_t shifted = 0;
+            for (unsigned int i = 0; i < 8; i++) {
+                if (b & (1u << i)) shifted ^= bits[8 * k + i];
+            }
+            crc32c_shift_table[k][b] = shifted;
+        }
+    }
+}
+
+static uint32_t crc32c_shift(uint32_t crc) {
+    return crc32c_shift_table[0][crc & 0xff] ^ crc32c_shift_table[1][(crc >> 8) & 0xff] ^
+           crc32c_shift_table[2][(crc >> 16) & 0xff] ^ crc32c_shift_table[3][crc >> 24];
+}
+#endif
+
+CDB_SSE42_TARGET
+static uint32_t crc32c_sse42_update(uint32_t crc, const uint8_t* p, size_t size) {
+#if defined(__x86_64__) || defined(_M_X64)
+    if (size >= 3 * CDB_CRC_LANE) {
+        for (; size >= 3 * CDB_CRC_LANE; p += 3 * CDB_CRC_LANE, size -= 3 * CDB_CRC_LANE) {
+            uint64_t a = crc, b = 0, c = 0;
+            for (size_t i = 0; i < CDB_CRC_LANE; i += 8) {
+                uint64_t wa, wb, wc;
+                memcpy(&wa, p + i, sizeof(wa));
+                memcpy(&wb, p + CDB_CRC_LANE + i, sizeof(wb));
+                memcpy(&wc, p + 2 * CDB_CRC_LANE + i, sizeof(wc));
+                a = _mm_crc32_u64(a, wa);
+                b = _mm_crc32_u64(b, wb);
+                c = _mm_crc32_u64(c, wc);
+            }
+            crc = crc32c_shift(crc32c_shift((uint32_t)a) ^ (uint32_t)b) ^ (uint32_t)c;
+        }
+    }
+#endif
+    return crc32c_sse42_stream(crc, p, size);
+}
+
+static int cpu_has_sse42(void) {
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#else
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] >> 20) & 1;
+#endif
+}
+#endif
+
+#ifdef CDB_CRC_ARM
+static uint32_t crc32c_arm_update(uint32_t crc, const uint8_t* p, size_t size) {
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    for (; size > 0; p++, size--) {
+        crc = __crc32cb(crc, *p);
+    }
+    return crc;
+}
+#endif
+
+typedef uint32_t (*cdb_crc_fn)(uint32_t crc, const uint8_t* p, size_t size);
+
+static cdb_crc_fn crc_update;  /* Set by init_crc */
+
+/* Pick the instructions the CPU supports and build the tables they use */
+static void init_crc(void) {
+#if defined(CDB_CRC_SSE42_DISPATCH)
+    if (cpu_has_sse42()) {
+#if defined(__x86_64__) || defined(_M_X64)
+        compute_crc32c_shift_table();
+#endif
+        crc_update = crc32c_sse42_update;
+        return;
+    }
+    compute_crc32c_table();
+    crc_update = crc32c_table_update;
+#elif defined(CDB_CRC_ARM)
+    crc_update = crc32c_arm_update;
+#else
+    compute_crc32c_table();
+    crc_update = crc32c_table_update;
+#endif
+}
+
+#ifdef _WIN32
+static INIT_ONCE crc_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK init_crc_once(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once;
+    (void)param;
+    (void)context;
+    init_crc();
+    return TRUE;
+}
+#else
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+#endif
+
+/* The update function, set up by the first caller; the others wait for it */
+static cdb_crc_fn select_crc(void) {
+#ifdef _WIN32
+    InitOnceExecuteOnce(&crc_once, init_crc_once, NULL, NULL);
+#else
+    pthread_once(&crc_once, init_crc);
+#endif
+    return crc_update;
+}
+
+/* CRC32C of size bytes, continuing from crc (0 to start) */
+uint32_t cdb_crc32c(uint32_t crc, const void* data, size_t size) {
+    if (size == 0) return crc;
+    return ~select_crc()(~crc, (const uint8_t*)data, size);
+}
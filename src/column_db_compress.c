@@ -0,0 +1,177 @@
+/*
+ * ColumnDB block compression
+ * Whole-block compress/decompress for the general-purpose codecs a .cdb
+ * column may be stored with. zlib is always built in; zstd and lz4 are
+ * compiled in when setup.py finds them (CDB_HAVE_ZSTD / CDB_HAVE_LZ4).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <zlib.h>
+#include "column_db_internal.h"
+
+#ifdef CDB_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef CDB_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+/* Whether a codec was built into this library */
+int cdb_compression_available(cdb_compression_t codec) {
+    switch (codec) {
+        case CDB_COMPRESSION_NONE:
+        case CDB_COMPRESSION_ZLIB:
+            return 1;
+#ifdef CDB_HAVE_ZSTD
+        case CDB_COMPRESSION_ZSTD:
+            return 1;
+#endif
+#ifdef CDB_HAVE_LZ4
+        case CDB_COMPRESSION_LZ4:
+            return 1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+/* Highest level accepted for a codec (0 always selects the codec's default) */
+int cdb_compression_max_level(cdb_compression_t codec) {
+    switch (codec) {
+        case CDB_COMPRESSION_ZLIB:
+            return Z_BEST_COMPRESSION;
+#ifdef CDB_HAVE_ZSTD
+        case CDB_COMPRESSION_ZSTD:
+            return ZSTD_maxCLevel();
+#endif
+        default:
+            return 0;  /* lz4 has a single level */
+    }
+}
+
+/* Compress size bytes into a malloc'd block */
+static int compress_block(cdb_compression_t codec, int level, const void* src, uint64_t size,
+                          uint8_t** out, uint64_t* out_size) {
+    uint8_t* dst = NULL;
+    *out = NULL;
+    *out_size = 0;
+    
+    switch (codec) {
+        case CDB_COMPRESSION_ZLIB: {
+            uLong bound = compressBound((uLong)size);
+            if ((uint64_t)(uLong)size != size || bound < size) break;
+            dst = (uint8_t*)malloc(bound ? bound : 1);
+            if (!dst) goto no_memory;
+            uLongf written = bound;
+            if (compress2(dst, &written, (const Bytef*)src, (uLong)size,
+                          level ? level : Z_DEFAULT_COMPRESSION) != Z_OK) {
+                free(dst);
+                set_error("zlib compression failed");
+                return -1;
+            }
+            *out = dst;
+            *out_size = written;
+            return 0;
+        }
+#ifdef CDB_HAVE_ZSTD
+        case CDB_COMPRESSION_ZSTD: {
+            size_t bound = ZSTD_compressBound((size_t)size);
+            if ((uint64_t)(size_t)size != size || ZSTD_isError(bound)) break;
+            dst = (uint8_t*)malloc(bound);
+            if (!dst) goto no_memory;
+            size_t written = ZSTD_compress(dst, bound, src, (size_t)size,
+                                           level ? level : ZSTD_CLEVEL_DEFAULT);
+            if (ZSTD_isError(written)) {
+                free(dst);
+                set_error("zstd compression failed");
+                return -1;
+            }
+            *out = dst;
+            *out_size = written;
+            return 0;
+        }
+#endif
+#ifdef CDB_HAVE_LZ4
+        case CDB_COMPRESSION_LZ4: {
+            if (size > LZ4_MAX_INPUT_SIZE) break;
+            int bound = LZ4_compressBound((int)size);
+            dst = (uint8_t*)malloc(bound ? (size_t)bound : 1);
+            if (!dst) goto no_memory;
+            int written = LZ4_compress_default((const char*)src, (char*)dst, (int)size, bound);
+            if (size > 0 && written <= 0) {
+                free(dst);
+                set_error("lz4 compression failed");
+                return -1;
+            }
+            *out = dst;
+            *out_size = (uint64_t)written;
+            return 0;
+        }
+#endif
+        default:
+            set_error("Compression codec not available");
+            return -1;
+    }
+    
+    set_error("Block too large to compress");
+    return -1;
+
+no_memory:
+    set_error("Failed to allocate compression buffer");
+    return -1;
+}
+
+int cdb_compress_block(cdb_compression_t codec, int level, const void* src, uint64_t size,
+                       uint8_t** out, uint64_t* out_size) {
+    uint64_t start = cdb_stat_start();
+    int status = compress_block(codec, level, src, size, out, out_size);
+    cdb_stat_time(CDB_STAT_ENCODE_NS, start);
+    return status;
+}
+
+/* Decompress a block that must expand to exactly size bytes */
+static int decompress_block(cdb_compression_t codec, const void* src, uint64_t src_size,
+                            void* dst, uint64_t size) {
+    switch (codec) {
+        case CDB_COMPRESSION_ZLIB: {
+            uLongf written = (uLongf)size;
+            if ((uint64_t)written != size || (uint64_t)(uLong)src_size != src_size ||
+                uncompress((Bytef*)dst, &written, (const Bytef*)src, (uLong)src_size) != Z_OK ||
+                written != size) {
+                break;
+            }
+            return 0;
+        }
+#ifdef CDB_HAVE_ZSTD
+        case CDB_COMPRESSION_ZSTD: {
+            size_t written = ZSTD_decompress(dst, (size_t)size, src, (size_t)src_size);
+            if (ZSTD_isError(written) || written != size) break;
+            return 0;
+        }
+#endif
+#ifdef CDB_HAVE_LZ4
+        case CDB_COMPRESSION_LZ4: {
+            if (size > INT_MAX || src_size > INT_MAX) break;
+            int written = LZ4_decompress_safe((const char*)src, (char*)dst, (int)src_size, (int)size);
+            if (written < 0 || (uint64_t)written != size) break;
+            return 0;
+        }
+#endif
+        default:
+            set_error("Column is compressed with a codec not built into this library");
+            return -1;
+    }
+    
+    set_error("Corrupt compressed column data");
+    return -1;
+}
+
+int cdb_decompress_block(cdb_compression_t codec, const void* src, uint64_t src_size,
+                         void* dst, uint64_t size) {
+    uint64_t start = cdb_stat_start();
+    int status = decompress_block(codec, src, src_size, dst, size);
+    cdb_stat_time(CDB_STAT_DECODE_NS, start);
+    return status;
+}
@@ -0,0 +1,447 @@
+/*
+ * ColumnDB Lightweight Column Encodings
+ * RLE, delta + bit-packing and frame-of-reference for fixed-width columns.
+ *
+ * An encoded section is a table of num_groups + 1 uint64 chunk offsets
+ * (relative to the section, the last one is the section size) followed by
+ * one independently decodable, 8-byte aligned chunk per row group.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "column_db_internal.h"
+
+#define RLE_HEADER_SIZE 8     /* uint64 run count */
+#define FOR_HEADER_SIZE 16    /* int64 reference, uint64 bit width */
+#define DELTA_HEADER_SIZE 24  /* int64 first value, int64 minimum delta, uint64 bit width */
+
+/* Encoded sizes of one chunk under each encoding */
+typedef struct {
+    uint64_t rle;
+    uint64_t delta;
+    uint64_t frame;
+} chunk_sizes_t;
+
+static uint64_t pad8(uint64_t size) {
+    return (size + 7) & ~(uint64_t)7;
+}
+
+/* Bits needed to hold every value in [0, range] */
+static unsigned bit_width(uint64_t range) {
+    unsigned width = 0;
+    while (range) {
+        width++;
+        range >>= 1;
+    }
+    return width;
+}
+
+/* Words of a packed array of count values, plus one padding word so
+ * unpacking may always read the word after the one holding a value */
+static uint64_t packed_words(uint64_t count, unsigned width) {
+    return (count * width + 63) / 64 + 1;
+}
+
+static uint64_t value_mask(unsigned width) {
+    return width >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+}
+
+/* Pack count values of width bits each, LSB first */
+static void pack_bits(const uint64_t* values, size_t count, unsigned width, uint64_t* words) {
+    memset(words, 0, (size_t)packed_words(count, width) * sizeof(uint64_t));
+    if (width == 0) return;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t bit = (uint64_t)i * width;
+        size_t index = (size_t)(bit >> 6);
+        unsigned shift = (unsigned)(bit & 63);
+        words[index] |= values[i] << shift;
+        if (shift + width > 64) words[index + 1] |= values[i] >> (64 - shift);
+    }
+}
+
+/* Value i of a packed array (width > 0); branch-free across word boundaries */
+static inline uint64_t unpack_one(const uint64_t* words, uint64_t bit, uint64_t mask) {
+    size_t index = (size_t)(bit >> 6);
+    unsigned shift = (unsigned)(bit & 63);
+    return ((words[index] >> shift) | ((words[index + 1] << 1) << (63 - shift))) & mask;
+}
+
+/* Load rows [start, start + n) as 64-bit patterns (integers sign-extended).
+ * NULL rows repeat the previous value so they do not widen ranges or break runs. */
+static void load_chunk(const cdb_column_t* col, size_t start, size_t n, uint64_t* values) {
+    size_t elem_size = cdb_type_size(col->data_type);
+    const uint8_t* data = (const uint8_t*)col->data + start * elem_size;
+    
+    /* One type switch per chunk, not per value */
+    switch (col->data_type) {
+        case CDB_TYPE_INT32:
+            for (size_t i = 0; i < n; i++) values[i] = (uint64_t)(int64_t)((const int32_t*)data)[i];
+            break;
+        case CDB_TYPE_FLOAT32:
+            for (size_t i = 0; i < n; i++) values[i] = ((const uint32_t*)data)[i];
+            break;
+        case CDB_TYPE_BOOL:
+            for (size_t i = 0; i < n; i++) values[i] = data[i];
+            break;
+        default:
+            memcpy(values, data, n * sizeof(uint64_t));
+            break;
+    }
+    
+    if (col->null_count == 0) return;
+    
+    /* Leading NULL rows take the first valid value */
+    uint64_t fill = 0;
+    size_t end = start + n;
+    for (size_t i = 0; i < n; i++) {
+        if (!cdb_is_null((cdb_column_t*)col, start + i)) {
+            fill = values[i];
+            break;
+        }
+    }
+    for (size_t base = 0; base < n; base += 64) {
+        uint64_t nulls = cdb_null_word(col->null_bitmap, start + base, end);
+        size_t count = n - base < 64 ? n - base : 64;
+        for (size_t k = 0; k < count; k++) {
+            if ((nulls >> k) & 1) values[base + k] = fill;
+            else fill = values[base + k];
+        }
+    }
+}
+
+/* Size of one chunk under each encoding (UINT64_MAX where it does not apply) */
+static void chunk_sizes(cdb_data_type_t type, const uint64_t* values, size_t n, chunk_sizes_t* sizes) {
+    size_t elem_size = cdb_type_size(type);
+    int64_t min = (int64_t)values[0], max = (int64_t)values[0];
+    int64_t dmin = 0, dmax = 0;
+    uint64_t runs = 1;
+    
+    for (size_t i = 1; i < n; i++) {
+        int64_t v = (int64_t)values[i];
+        int64_t d = (int64_t)(values[i] - values[i - 1]);
+        if (v < min) min = v;
+        if (v > max) max = v;
+        if (i == 1 || d < dmin) dmin = d;
+        if (i == 1 || d > dmax) dmax = d;
+        runs += values[i] != values[i - 1];
+    }
+    
+    sizes->rle = RLE_HEADER_SIZE + pad8(runs * elem_size) + pad8(runs * sizeof(uint32_t));
+    sizes->delta = UINT64_MAX;
+    sizes->frame = UINT64_MAX;
+    if (type == CDB_TYPE_FLOAT32 || type == CDB_TYPE_FLOAT64) return;
+    
+    sizes->frame = FOR_HEADER_SIZE +
+        packed_words(n, bit_width((uint64_t)max - (uint64_t)min)) * sizeof(uint64_t);
+    if (type != CDB_TYPE_BOOL) {
+        sizes->delta = DELTA_HEADER_SIZE +
+            packed_words(n - 1, bit_width((uint64_t)dmax - (uint64_t)dmin)) * sizeof(uint64_t);
+    }
+}
+
+/* Encode one chunk; values is used as scratch. Returns the bytes written. */
+static uint64_t encode_chunk(cdb_file_encoding_t encoding, cdb_data_type_t type,
+                             uint64_t* values, size_t n, uint8_t* out) {
+    size_t elem_size = cdb_type_size(type);
+    
+    if (encoding == CDB_FILE_ENCODING_RLE) {
+        /* Run values (element width), then uint32 run lengths */
+        uint64_t runs = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (i == 0 || values[i] != values[i - 1]) runs++;
+        }
+        uint8_t* run_values = out + RLE_HEADER_SIZE;
+        uint8_t* run_lengths = run_values + pad8(runs * elem_size);
+        memset(out, 0, (size_t)(RLE_HEADER_SIZE + pad8(runs * elem_size) + pad8(runs * sizeof(uint32_t))));
+        memcpy(out, &runs, sizeof(uint64_t));
+        
+        size_t run = 0;
+        for (size_t i = 0; i < n; run++) {
+            size_t j = i + 1;
+            while (j < n && values[j] == values[i]) j++;
+            uint32_t length = (uint32_t)(j - i);
+            memcpy(run_values + run * elem_size, &values[i], elem_size);  /* Little-endian low bytes */
+            memcpy(run_lengths + run * sizeof(uint32_t), &length, sizeof(uint32_t));
+            i = j;
+        }
+        return RLE_HEADER_SIZE + pad8(runs * elem_size) + pad8(runs * sizeof(uint32_t));
+    }
+    
+    if (encoding == CDB_FILE_ENCODING_DELTA) {
+        /* First value, then deltas relative to the smallest delta */
+        int64_t first = (int64_t)values[0];
+        int64_t dmin = 0;
+        for (size_t i = n - 1; i > 0; i--) {
+            values[i] -= values[i - 1];
+            if (i == n - 1 || (int64_t)values[i] < dmin) dmin = (int64_t)values[i];
+        }
+        uint64_t range = 0;
+        for (size_t i = 1; i < n; i++) {
+            values[i] -= (uint64_t)dmin;
+            if (values[i] > range) range = values[i];
+        }
+        uint64_t width = bit_width(range);
+        memcpy(out, &first, sizeof(int64_t));
+        memcpy(out + 8, &dmin, sizeof(int64_t));
+        memcpy(out + 16, &width, sizeof(uint64_t));
+        pack_bits(values + 1, n - 1, (unsigned)width, (uint64_t*)(out + DELTA_HEADER_SIZE));
+        return DELTA_HEADER_SIZE + packed_words(n - 1, (unsigned)width) * sizeof(uint64_t);
+    }
+    
+    /* Frame of reference: minimum, then offsets from it */
+    int64_t min = (int64_t)values[0];
+    for (size_t i = 1; i < n; i++) {
+        if ((int64_t)values[i] < min) min = (int64_t)values[i];
+    }
+    uint64_t range = 0;
+    for (size_t i = 0; i < n; i++) {
+        values[i] -= (uint64_t)min;
+        if (values[i] > range) range = values[i];
+    }
+    uint64_t width = bit_width(range);
+    memcpy(out, &min, sizeof(int64_t));
+    memcpy(out + 8, &width, sizeof(uint64_t));
+    pack_bits(values, n, (unsigned)width, (uint64_t*)(out + FOR_HEADER_SIZE));
+    return FOR_HEADER_SIZE + packed_words(n, (unsigned)width) * sizeof(uint64_t);
+}
+
+/* Encode a fixed-width column, or leave it plain when that is about as small */
+static int encode_column(const cdb_column_t* col, size_t group_rows, cdb_file_encoding_t* encoding,
+                         uint8_t** section, uint64_t* size) {
+    *encoding = CDB_FILE_ENCODING_PLAIN;
+    *section = NULL;
+    *size = 0;
+    
+    size_t elem_size = cdb_type_size(col->data_type);
+    if (col->num_rows == 0 || elem_size == 0 ||
+        col->data_type == CDB_TYPE_STRING || col->data_type == CDB_TYPE_DICT_STRING) {
+        return 0;
+    }
+    
+    size_t num_groups = (col->num_rows + group_rows - 1) / group_rows;
+    size_t max_rows = col->num_rows < group_rows ? col->num_rows : group_rows;
+    uint64_t* values = (uint64_t*)malloc(max_rows * sizeof(uint64_t));
+    if (!values) {
+        set_error("Failed to allocate encoding buffer");
+        return -1;
+    }
+    
+    /* First pass: total size under each encoding */
+    uint64_t table_size = ((uint64_t)num_groups + 1) * sizeof(uint64_t);
+    chunk_sizes_t total = {table_size, table_size, table_size};
+    for (size_t start = 0; start < col->num_rows; start += group_rows) {
+        size_t n = col->num_rows - start < group_rows ? col->num_rows - start : group_rows;
+        chunk_sizes_t sizes;
+        load_chunk(col, start, n, values);
+        chunk_sizes(col->data_type, values, n, &sizes);
+        total.rle = sizes.rle == UINT64_MAX || total.rle == UINT64_MAX ? UINT64_MAX : total.rle + sizes.rle;
+        total.delta = sizes.delta == UINT64_MAX || total.delta == UINT64_MAX ? UINT64_MAX : total.delta + sizes.delta;
+        total.frame = sizes.frame == UINT64_MAX || total.frame == UINT64_MAX ? UINT64_MAX : total.frame + sizes.frame;
+    }
+    
+    /* Plain data maps in place; only give that up for a real saving */
+    uint64_t plain = (uint64_t)col->num_rows * elem_size;
+    uint64_t best = plain - plain / 8;
+    if (total.rle < best) {
+        best = total.rle;
+        *encoding = CDB_FILE_ENCODING_RLE;
+    }
+    if (total.delta < best) {
+        best = total.delta;
+        *encoding = CDB_FILE_ENCODING_DELTA;
+    }
+    if (total.frame < best) {
+        best = total.frame;
+        *encoding = CDB_FILE_ENCODING_FOR;
+    }
+    if (*encoding == CDB_FILE_ENCODING_PLAIN) {
+        free(values);
+        return 0;
+    }
+    
+    /* Second pass: write the chunks after the offset table */
+    uint8_t* out = (uint8_t*)malloc((size_t)best);
+    if (!out) {
+        free(values);
+        set_error("Failed to allocate encoding buffer");
+        *encoding = CDB_FILE_ENCODING_PLAIN;
+        return -1;
+    }
+    uint64_t offset = table_size;
+    size_t group = 0;
+    for (size_t start = 0; start < col->num_rows; start += group_rows, group++) {
+        size_t n = col->num_rows - start < group_rows ? col->num_rows - start : group_rows;
+        memcpy(out + group * sizeof(uint64_t), &offset, sizeof(uint64_t));
+        load_chunk(col, start, n, values);
+        offset += encode_chunk(*encoding, col->data_type, values, n, out + offset);
+    }
+    memcpy(out + num_groups * sizeof(uint64_t), &offset, sizeof(uint64_t));
+    
+    free(values);
+    *section = out;
+    *size = offset;
+    return 0;
+}
+
+int cdb_encode_column(const cdb_column_t* col, size_t group_rows, cdb_file_encoding_t* encoding,
+                      uint8_t** section, uint64_t* size) {
+    uint64_t start = cdb_stat_start();
+    int status = encode_column(col, group_rows, encoding, section, size);
+    cdb_stat_time(CDB_STAT_ENCODE_NS, start);
+    return status;
+}
+
+/* Store decoded 64-bit patterns as the column's element type */
+#define CDB_DECODE_LOOP(EXPR)                                                       \
+    do {                                                                            \
+        switch (elem_size) {                                                        \
+            case 1: for (size_t i = 0; i < n; i++) ((uint8_t*)out)[i] = (uint8_t)(EXPR); break;    \
+            case 4: for (size_t i = 0; i < n; i++) ((uint32_t*)out)[i] = (uint32_t)(EXPR); break;  \
+            default: for (size_t i = 0; i < n; i++) ((uint64_t*)out)[i] = (EXPR); break;           \
+        }                                                                           \
+    } while (0)
+
+/* Decode one chunk of n rows into out */
+static int decode_chunk(cdb_file_encoding_t encoding, cdb_data_type_t type,
+                        const uint8_t* chunk, uint64_t chunk_size, size_t n, void* out) {
+    size_t elem_size = cdb_type_size(type);
+    
+    if (encoding == CDB_FILE_ENCODING_RLE) {
+        uint64_t runs;
+        if (chunk_size < RLE_HEADER_SIZE) goto corrupt;
+        memcpy(&runs, chunk, sizeof(uint64_t));
+        if (runs > n || RLE_HEADER_SIZE + pad8(runs * elem_size) + pad8(runs * sizeof(uint32_t)) > chunk_size) {
+            goto corrupt;
+        }
+        const uint8_t* run_values = chunk + RLE_HEADER_SIZE;
+        const uint8_t* run_lengths = run_values + pad8(runs * elem_size);
+        size_t row = 0;
+        for (uint64_t r = 0; r < runs; r++) {
+            uint32_t length;
+            memcpy(&length, run_lengths + r * sizeof(uint32_t), sizeof(uint32_t));
+            if (length > n - row) goto corrupt;
+            const uint8_t* value = run_values + r * elem_size;
+            if (elem_size == 1) {
+                memset((uint8_t*)out + row, *value, length);
+            } else if (elem_size == 4) {
+                uint32_t v;
+                memcpy(&v, value, sizeof(v));
+                for (uint32_t k = 0; k < length; k++) ((uint32_t*)out)[row + k] = v;
+            } else {
+                uint64_t v;
+                memcpy(&v, value, sizeof(v));
+                for (uint32_t k = 0; k < length; k++) ((uint64_t*)out)[row + k] = v;
+            }
+            row += length;
+        }
+        if (row != n) goto corrupt;
+        return 0;
+    }
+    
+    if (encoding == CDB_FILE_ENCODING_DELTA) {
+        int64_t first, dmin;
+        uint64_t width;
+        if (type == CDB_TYPE_BOOL || chunk_size < DELTA_HEADER_SIZE || n == 0) goto corrupt;
+        memcpy(&first, chunk, sizeof(int64_t));
+        memcpy(&dmin, chunk + 8, sizeof(int64_t));
+        memcpy(&width, chunk + 16, sizeof(uint64_t));
+        if (width > 64 || DELTA_HEADER_SIZE + packed_words(n - 1, (unsigned)width) * sizeof(uint64_t) > chunk_size) {
+            goto corrupt;
+        }
+        const uint64_t* words = (const uint64_t*)(chunk + DELTA_HEADER_SIZE);
+        uint64_t mask = value_mask((unsigned)width);
+        uint64_t acc = (uint64_t)first - (uint64_t)dmin;  /* Row 0 adds dmin back with a zero delta */
+        if (width == 0) {
+            CDB_DECODE_LOOP(acc += (uint64_t)dmin);
+        } else {
+            /* Delta i - 1 leads to row i; row 0 has none */
+            CDB_DECODE_LOOP(acc += (uint64_t)dmin + (i ? unpack_one(words, (uint64_t)(i - 1) * width, mask) : 0));
+        }
+        return 0;
+    }
+    
+    if (encoding == CDB_FILE_ENCODING_FOR) {
+        int64_t min;
+        uint64_t width;
+        if (type == CDB_TYPE_FLOAT32 || type == CDB_TYPE_FLOAT64 || chunk_size < FOR_HEADER_SIZE) goto corrupt;
+        memcpy(&min, chunk, sizeof(int64_t));
+        memcpy(&width, chunk + 8, sizeof(uint64_t));
+        if (width > 64 || FOR_HEADER_SIZE + packed_words(n, (unsigned)width) * sizeof(uint64_t) > chunk_size) {
+            goto corrupt;
+        }
+        const uint64_t* words = (const uint64_t*)(chunk + FOR_HEADER_SIZE);
+        uint64_t mask = value_mask((unsigned)width);
+        uint64_t ref = (uint64_t)min;
+        if (width == 0) {
+            CDB_DECODE_LOOP(ref);
+        } else {
+            CDB_DECODE_LOOP(ref + unpack_one(words, (uint64_t)i * width, mask));
+        }
+        return 0;
+    }
+
+corrupt:
+    set_error("Corrupt encoded column data");
+    return -1;
+}
+
+#undef CDB_DECODE_LOOP
+
+int cdb_decode_chunk(cdb_file_encoding_t encoding, cdb_data_type_t type,
+                     const uint8_t* chunk, uint64_t chunk_size, size_t n, void* out) {
+    uint64_t start = cdb_stat_start();
+    int status = decode_chunk(encoding, type, chunk, chunk_size, n, out);
+    cdb_stat_time(CDB_STAT_DECODE_NS, start);
+    return status;
+}
+
+/* Check a section's chunk offset table and return chunk g's bounds */
+int cdb_encoded_chunk(const uint8_t* section, uint64_t size, size_t num_groups, size_t g,
+                      uint64_t* offset, uint64_t* chunk_size) {
+    uint64_t begin, end;
+    uint64_t table_size = ((uint64_t)num_groups + 1) * sizeof(uint64_t);
+    if (size < table_size) goto corrupt;
+    memcpy(&begin, section + g * sizeof(uint64_t), sizeof(uint64_t));
+    memcpy(&end, section + (g + 1) * sizeof(uint64_t), sizeof(uint64_t));
+    if (begin < table_size || end < begin || end > size ||
+        (uintptr_t)(section + begin) % sizeof(uint64_t) != 0) {
+        goto corrupt;
+    }
+    *offset = begin;
+    *chunk_size = end - begin;
+    return 0;
+
+corrupt:
+    set_error("Corrupt encoded column data");
+    return -1;
+}
+
+/* Decode a whole encoded section into out; NULL rows read back as 0 */
+int cdb_decode_column(cdb_file_encoding_t encoding, cdb_data_type_t type,
+                      const uint8_t* section, uint64_t size, size_t num_rows, size_t group_rows,
+                      const uint8_t* null_bitmap, void* out) {
+    size_t elem_size = cdb_type_size(type);
+    size_t num_groups = (num_rows + group_rows - 1) / group_rows;
+    
+    for (size_t g = 0; g < num_groups; g++) {
+        size_t start = g * group_rows;
+        size_t n = num_rows - start < group_rows ? num_rows - start : group_rows;
+        uint64_t offset, chunk_size;
+        if (cdb_encoded_chunk(section, size, num_groups, g, &offset, &chunk_size) < 0 ||
+            cdb_decode_chunk(encoding, type, section + offset, chunk_size, n,
+                             (uint8_t*)out + start * elem_size) < 0) {
+            return -1;
+        }
+    }
+    
+    if (null_bitmap) {
+        for (size_t base = 0; base < num_rows; base += 64) {
+            uint64_t nulls = cdb_null_word(null_bitmap, base, num_rows);
+            size_t count = num_rows - base < 64 ? num_rows - base : 64;
+            for (size_t k = 0; k < count; k++) {
+                if ((nulls >> k) & 1) memset((uint8_t*)out + (base + k) * elem_size, 0, elem_size);
+            }
+        }
+    }
+    return 0;
+}
@@ -3,311 +3,3262 @@
  * Binary format: .cdb files
  */
 
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L  /* fseeko, fileno, mmap, pread */
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
-#include "../include/column_db.h"
+#include <math.h>
+#include <errno.h>
+#include "column_db_internal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #define CDB_MAGIC_HEADER 0x43444201  /* "CDB\x01" */
 #define CDB_MAGIC_FOOTER 0x43444245  /* "CDBE" */
-#define CDB_VERSION 1
-
-/* Simple CRC32 implementation */
-static uint32_t crc32_table[256];
-static int crc32_table_computed = 0;
-
-static void compute_crc32_table(void) {
-    if (crc32_table_computed) return;
-    
-    for (unsigned int n = 0; n < 256; n++) {
-        uint32_t crc = n;
-        for (unsigned int k = 0; k < 8; k++) {
-            if (crc & 1) {
-                crc = 0xedb88320L ^ (crc >> 1);
-            } else {
-                crc = crc >> 1;
-            }
-        }
-        crc32_table[n] = crc;
+#define CDB_MAGIC_SEGMENT 0x43444253 /* "CDBS": directory of an appended segment */
+#define CDB_VERSION 12
+#define CDB_MIN_VERSION 1            /* v1 files carry unusable data offsets */
+#define CDB_STRING_OFFSETS_VERSION 3 /* First version storing strings as offsets + bytes */
+#define CDB_DICT_STRING_VERSION 4    /* First version with dictionary-encoded columns */
+#define CDB_NULL_COUNT_VERSION 5     /* First version storing per-column null counts */
+#define CDB_NULL_COUNT_UNKNOWN UINT64_MAX
+#define CDB_ZONE_MAP_VERSION 6       /* First version with row groups and zone maps */
+#define CDB_ENCODING_VERSION 7       /* First version with encoded columns */
+#define CDB_COMPRESSION_VERSION 8    /* First version with block-compressed columns */
+#define CDB_COLUMN_FLAGS_VERSION 9   /* First version with per-column flags */
+#define CDB_COLUMN_SORTED 0x1        /* Column flag: NULLs first, then non-decreasing values */
+#define CDB_INDEX_VERSION 10         /* First version with saved column indexes */
+#define CDB_SEGMENT_VERSION 11       /* First version with appended segments */
+#define CDB_CHECKSUM_VERSION 12      /* First version with CRC32C directory and column checksums */
+#define CDB_FLAG_ENCODED_COLUMNS 0x1 /* Header flag: some column is RLE/delta/FOR encoded */
+#define CDB_FLAG_COMPRESSED_COLUMNS 0x2 /* Header flag: some column is block compressed */
+#define CDB_KNOWN_FLAGS (CDB_FLAG_ENCODED_COLUMNS | CDB_FLAG_COMPRESSED_COLUMNS)
+#define CDB_HEADER_SIZE 32
+#define CDB_SEGMENT_LINK_SIZE 16     /* Follows the header from v11: segment link and size/first row */
+#define CDB_FOOTER_SIZE 16
+#define CDB_DATA_ALIGNMENT 64        /* Column data starts on a cache line */
+
+#ifdef _WIN32
+#define cdb_fseek(f, off) _fseeki64((f), (__int64)(off), SEEK_SET)
+#define cdb_ftell(f) ((uint64_t)_ftelli64(f))
+#define cdb_fileno(f) _fileno(f)
+#else
+#define cdb_fseek(f, off) fseeko((f), (off_t)(off), SEEK_SET)
+#define cdb_ftell(f) ((uint64_t)ftello(f))
+#define cdb_fileno(f) fileno(f)
+#endif
+
+/* One column entry of the on-disk metadata */
+typedef struct {
+    char* name;
+    cdb_data_type_t data_type;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint64_t null_bitmap_size;
+    uint64_t null_count;      /* CDB_NULL_COUNT_UNKNOWN before format v5 */
+    uint64_t row_group_rows;  /* 0 before format v6 */
+    uint64_t zone_map_offset; /* 0 when the column has no zone maps */
+    cdb_file_encoding_t encoding;
+    cdb_compression_t compression;
+    uint64_t stored_data_size;   /* Data block size on disk; data_size unless compressed */
+    uint64_t stored_bitmap_size; /* Null bitmap block size on disk */
+    int sorted;
+    cdb_index_kind_t index_kind;  /* Declared index; NONE before format v10 */
+    uint64_t index_offset;
+    uint64_t index_size;
+    int has_checksum;             /* From format v12 */
+    uint32_t checksum;            /* CRC32C of the stored data block and null bitmap */
+} cdb_file_column_t;
+
+/* Header and column metadata of a .cdb file */
+typedef struct {
+    uint32_t version;
+    uint32_t num_columns;
+    uint32_t num_rows;
+    uint64_t timestamp;
+    uint32_t flags;
+    uint64_t segment_link;    /* v11+: base: newest segment's directory; segment: the previous one (0 = none) */
+    uint64_t committed_size;  /* Base, v11+: bytes in use; appends start at the next boundary */
+    uint64_t first_row;       /* Segment: file row of its first row */
+    cdb_file_column_t* columns;
+} cdb_file_directory_t;
+
+/* Dictionary stored after the codes of a DICT_STRING section */
+typedef struct {
+    uint64_t size;
+    const uint64_t* offsets;  /* size + 1 offsets into bytes */
+    const char* bytes;
+    uint64_t byte_size;
+} cdb_file_dictionary_t;
+
+/* Bound of a zone map: int64 for integer and bool columns, double for float columns */
+typedef union {
+    int64_t i;
+    double f;
+} cdb_zone_value_t;
+
+/* Zone map of one row group, as stored in the file */
+typedef struct {
+    cdb_zone_value_t min;
+    cdb_zone_value_t max;
+    uint64_t null_count;
+} cdb_zone_map_t;
+
+/* Read exactly size bytes or fail */
+static int read_exact(FILE* f, void* buf, size_t size) {
+    uint64_t start = cdb_stat_start();
+    int status = fread(buf, 1, size, f) == size ? 0 : -1;
+    cdb_stat_time(CDB_STAT_READ_NS, start);
+    if (status == 0) cdb_stat_add(CDB_STAT_BYTES_READ, size);
+    return status;
+}
+
+/* Positional I/O: several threads may read or write one file at once */
+#ifdef _WIN32
+#define CDB_MAX_IO_CHUNK (1u << 30)
+
+static int transfer_at(int fd, void* buf, size_t size, uint64_t offset, int writing) {
+    HANDLE handle = (HANDLE)_get_osfhandle(fd);
+    uint8_t* p = (uint8_t*)buf;
+    while (size > 0) {
+        DWORD chunk = size > CDB_MAX_IO_CHUNK ? CDB_MAX_IO_CHUNK : (DWORD)size;
+        DWORD done = 0;
+        OVERLAPPED at = {0};
+        at.Offset = (DWORD)offset;
+        at.OffsetHigh = (DWORD)(offset >> 32);
+        BOOL ok = writing ? WriteFile(handle, p, chunk, &done, &at) : ReadFile(handle, p, chunk, &done, &at);
+        if (!ok || done == 0) return -1;
+        p += done;
+        size -= done;
+        offset += done;
+    }
+    return 0;
+}
+
+static int pread_all(int fd, void* buf, size_t size, uint64_t offset) {
+    return transfer_at(fd, buf, size, offset, 0);
+}
+
+static int pwrite_all(int fd, const void* buf, size_t size, uint64_t offset) {
+    return transfer_at(fd, (void*)buf, size, offset, 1);
+}
+#else
+static int pread_all(int fd, void* buf, size_t size, uint64_t offset) {
+    uint8_t* p = (uint8_t*)buf;
+    while (size > 0) {
+        ssize_t done = pread(fd, p, size, (off_t)offset);
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return -1;
+        p += done;
+        size -= (size_t)done;
+        offset += (uint64_t)done;
+    }
+    return 0;
+}
+
+static int pwrite_all(int fd, const void* buf, size_t size, uint64_t offset) {
+    const uint8_t* p = (const uint8_t*)buf;
+    while (size > 0) {
+        ssize_t done = pwrite(fd, p, size, (off_t)offset);
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return -1;
+        p += done;
+        size -= (size_t)done;
+        offset += (uint64_t)done;
+    }
+    return 0;
+}
+#endif
+
+/* Positional reads and writes as counted in the statistics */
+static int read_at(int fd, void* buf, size_t size, uint64_t offset) {
+    uint64_t start = cdb_stat_start();
+    int status = pread_all(fd, buf, size, offset);
+    cdb_stat_time(CDB_STAT_READ_NS, start);
+    if (status == 0) cdb_stat_add(CDB_STAT_BYTES_READ, size);
+    return status;
+}
+
+static int write_at(int fd, const void* buf, size_t size, uint64_t offset) {
+    uint64_t start = cdb_stat_start();
+    int status = pwrite_all(fd, buf, size, offset);
+    cdb_stat_time(CDB_STAT_WRITE_NS, start);
+    if (status == 0) cdb_stat_add(CDB_STAT_BYTES_WRITTEN, size);
+    return status;
+}
+
+/* Bytes the codes of a DICT_STRING section take, padded so the dictionary is 8-byte aligned */
+static uint64_t dict_codes_size(uint64_t num_rows) {
+    return (num_rows * sizeof(uint32_t) + 7) & ~(uint64_t)7;
+}
+
+/* Whether the type's values are compared as doubles */
+static int is_float_type(cdb_data_type_t type) {
+    return type == CDB_TYPE_FLOAT32 || type == CDB_TYPE_FLOAT64;
+}
+
+/* Whether the type gets zone maps (numeric and bool columns) */
+static int has_zone_maps(cdb_data_type_t type) {
+    return type != CDB_TYPE_STRING && type != CDB_TYPE_DICT_STRING;
+}
+
+/* Number of row groups covering num_rows */
+static uint64_t row_group_count(uint64_t num_rows, uint64_t row_group_rows) {
+    return (num_rows + row_group_rows - 1) / row_group_rows;
+}
+
+/* Fold the non-NULL values of rows [start, end) into a zone map (NaN is never a bound) */
+#define CDB_ZONE_LOOP(T, FIELD)                                                     \
+    do {                                                                            \
+        const T* values = (const T*)col->data;                                      \
+        for (size_t base = start; base < end; base += 64) {                         \
+            uint64_t nulls = col->null_count ? cdb_null_word(col->null_bitmap, base, end) : 0; \
+            size_t count = end - base < 64 ? end - base : 64;                       \
+            for (size_t k = 0; k < count; k++) {                                    \
+                if ((nulls >> k) & 1) {                                             \
+                    zone->null_count++;                                             \
+                    continue;                                                       \
+                }                                                                   \
+                T v = values[base + k];                                             \
+                if (v < zone->min.FIELD) zone->min.FIELD = v;                       \
+                if (v > zone->max.FIELD) zone->max.FIELD = v;                       \
+            }                                                                       \
+        }                                                                           \
+    } while (0)
+
+/* Compute the zone map of rows [start, end) of a fixed-width column */
+static void compute_zone_map(const cdb_column_t* col, size_t start, size_t end, cdb_zone_map_t* zone) {
+    if (is_float_type(col->data_type)) {
+        zone->min.f = HUGE_VAL;
+        zone->max.f = -HUGE_VAL;
+    } else {
+        zone->min.i = INT64_MAX;
+        zone->max.i = INT64_MIN;
+    }
+    zone->null_count = 0;
+    
+    switch (col->data_type) {
+        case CDB_TYPE_INT32: CDB_ZONE_LOOP(int32_t, i); break;
+        case CDB_TYPE_INT64: CDB_ZONE_LOOP(int64_t, i); break;
+        case CDB_TYPE_FLOAT32: CDB_ZONE_LOOP(float, f); break;
+        case CDB_TYPE_FLOAT64: CDB_ZONE_LOOP(double, f); break;
+        case CDB_TYPE_BOOL: CDB_ZONE_LOOP(uint8_t, i); break;
+        default: break;
+    }
+}
+
+#undef CDB_ZONE_LOOP
+
+/* Bytes a column's values occupy in the file */
+static uint64_t column_data_size(const cdb_column_t* col) {
+    if (col->data_type == CDB_TYPE_STRING) {
+        /* Strings: num_rows + 1 offsets followed by the bytes */
+        return ((uint64_t)col->num_rows + 1) * sizeof(uint64_t) + col->string_data_size;
+    }
+    if (col->data_type == CDB_TYPE_DICT_STRING) {
+        /* Codes, then the dictionary: count, count + 1 offsets, bytes */
+        return dict_codes_size(col->num_rows) + sizeof(uint64_t) +
+               ((uint64_t)col->dict_size + 1) * sizeof(uint64_t) + col->string_data_size;
+    }
+    return (uint64_t)col->num_rows * cdb_type_size(col->data_type);
+}
+
+/* Check that string offsets start at 0, never decrease and end at byte_size */
+static int validate_offsets(const uint64_t* offsets, size_t num_rows, uint64_t byte_size) {
+    if (offsets[0] != 0 || offsets[num_rows] != byte_size) goto corrupt;
+    for (size_t j = 0; j < num_rows; j++) {
+        if (offsets[j + 1] < offsets[j]) goto corrupt;
     }
-    crc32_table_computed = 1;
+    return 0;
+
+corrupt:
+    set_error("Corrupt string column offsets");
+    return -1;
 }
 
-static uint32_t crc32(const uint8_t* data, size_t length) {
-    compute_crc32_table();
+/* Decode length-prefixed strings (format v1/v2) into the column's offsets and bytes */
+static int decode_length_prefixed(cdb_column_t* col, const uint8_t* bytes, uint64_t size, size_t num_rows) {
+    if (size < (uint64_t)num_rows * sizeof(uint32_t)) goto corrupt;
+    if (cdb_string_reserve(col, (size_t)(size - (uint64_t)num_rows * sizeof(uint32_t))) < 0) return -1;
     
-    uint32_t crc = 0xffffffff;
-    for (size_t i = 0; i < length; i++) {
-        crc = crc32_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    uint64_t* offsets = (uint64_t*)col->data;
+    uint64_t pos = 0;
+    uint64_t used = 0;
+    offsets[0] = 0;
+    for (size_t j = 0; j < num_rows; j++) {
+        uint32_t str_len;
+        if (size - pos < sizeof(uint32_t)) goto corrupt;
+        memcpy(&str_len, bytes + pos, sizeof(uint32_t));
+        pos += sizeof(uint32_t);
+        if (size - pos < str_len) goto corrupt;
+        
+        memcpy(col->string_data + used, bytes + pos, str_len);
+        pos += str_len;
+        used += str_len;
+        offsets[j + 1] = used;
     }
-    return crc ^ 0xffffffff;
+    col->string_data_size = (size_t)used;
+    return 0;
+
+corrupt:
+    set_error("Corrupt string column data");
+    return -1;
 }
 
-/* Save database to file */
-int cdb_save_to(cdb_database_t* db, const char* filename) {
-    if (!db || !filename) {
-        set_error("Invalid database or filename");
+/* Locate the dictionary in the (8-byte aligned) tail of a DICT_STRING section */
+static int parse_dictionary(const uint8_t* tail, uint64_t tail_size, cdb_file_dictionary_t* dict) {
+    uint64_t count;
+    if (tail_size < sizeof(uint64_t)) goto corrupt;
+    memcpy(&count, tail, sizeof(uint64_t));
+    if (count >= (tail_size - sizeof(uint64_t)) / sizeof(uint64_t)) goto corrupt;
+    
+    dict->size = count;
+    dict->offsets = (const uint64_t*)(tail + sizeof(uint64_t));
+    dict->bytes = (const char*)(dict->offsets + count + 1);
+    dict->byte_size = tail_size - (count + 2) * sizeof(uint64_t);
+    return validate_offsets(dict->offsets, (size_t)count, dict->byte_size);
+
+corrupt:
+    set_error("Corrupt dictionary column data");
+    return -1;
+}
+
+/* Copy the dictionary in the tail of a DICT_STRING section into the column */
+static int load_dictionary(cdb_column_t* col, const uint8_t* tail, uint64_t tail_size) {
+    cdb_file_dictionary_t dict;
+    if (parse_dictionary(tail, tail_size, &dict) < 0) return -1;
+    if (cdb_dict_reserve(col, (size_t)dict.size) < 0 ||
+        cdb_string_reserve(col, (size_t)dict.byte_size) < 0) {
         return -1;
     }
     
-    FILE* f = fopen(filename, "wb");
-    if (!f) {
-        set_error("Failed to open file for writing");
+    if (dict.size > 0) {
+        memcpy(col->dict_offsets, dict.offsets, ((size_t)dict.size + 1) * sizeof(uint64_t));
+    }
+    if (dict.byte_size > 0) {
+        memcpy(col->string_data, dict.bytes, (size_t)dict.byte_size);
+    }
+    col->dict_size = (size_t)dict.size;
+    col->string_data_size = (size_t)dict.byte_size;
+    return 0;
+}
+
+/* Whether a stored encoding is valid for a column entry */
+static int encoding_supported(const cdb_file_column_t* entry, uint8_t encoding) {
+    switch (encoding) {
+        case CDB_FILE_ENCODING_PLAIN:
+            return 1;
+        case CDB_FILE_ENCODING_RLE:
+            break;
+        case CDB_FILE_ENCODING_DELTA:
+            if (entry->data_type == CDB_TYPE_BOOL) return 0;
+            /* fall through */
+        case CDB_FILE_ENCODING_FOR:
+            if (is_float_type(entry->data_type)) return 0;
+            break;
+        default:
+            return 0;
+    }
+    /* Chunked encodings: one chunk per (valid) row group of a fixed-width column */
+    return has_zone_maps(entry->data_type) &&
+           entry->row_group_rows != 0 && entry->row_group_rows % 64 == 0;
+}
+
+static void free_directory(cdb_file_directory_t* dir) {
+    if (!dir->columns) return;
+    for (uint32_t i = 0; i < dir->num_columns; i++) {
+        free(dir->columns[i].name);
+    }
+    free(dir->columns);
+    dir->columns = NULL;
+}
+
+/* Checksum of a directory's header and column metadata, minus the segment link appends rewrite */
+static uint32_t directory_checksum(const uint8_t* directory, size_t size) {
+    uint32_t crc = cdb_crc32c(0, directory, CDB_HEADER_SIZE - sizeof(uint32_t));
+    return cdb_crc32c(crc, directory + CDB_HEADER_SIZE + CDB_SEGMENT_LINK_SIZE,
+                      size - CDB_HEADER_SIZE - CDB_SEGMENT_LINK_SIZE);
+}
+
+/* Check the directory parsed from start up to the file position against its checksum */
+static int check_directory(FILE* f, uint64_t start, uint32_t expected) {
+    uint64_t end = cdb_ftell(f);
+    size_t size = (size_t)(end - start);
+    uint8_t* bytes = (uint8_t*)malloc(size);
+    if (!bytes) {
+        set_error("Failed to allocate column metadata");
         return -1;
     }
+    int status = -1;
+    if (cdb_fseek(f, start) != 0 || read_exact(f, bytes, size) < 0 || cdb_fseek(f, end) != 0) {
+        set_error("Truncated CDB column metadata");
+    } else if (directory_checksum(bytes, size) != expected) {
+        set_error("CDB metadata checksum mismatch");
+    } else {
+        status = 0;
+    }
+    free(bytes);
+    return status;
+}
+
+/* Read a header (with the given magic) and column metadata at the current
+ * position, leaving f positioned after the metadata */
+static int parse_directory(FILE* f, uint32_t expected_magic, cdb_file_directory_t* dir) {
+    uint32_t magic, header_checksum;
+    uint64_t start = cdb_ftell(f);
     
-    /* Get current time */
-    time_t now = time(NULL);
+    memset(dir, 0, sizeof(*dir));
     
-    /* Write header */
-    uint32_t magic = CDB_MAGIC_HEADER;
-    uint32_t version = CDB_VERSION;
-    uint32_t num_cols = db->num_columns;
-    uint32_t num_rows = db->columns[0].num_rows;
+    if (read_exact(f, &magic, sizeof(uint32_t)) < 0 || magic != expected_magic) {
+        set_error(expected_magic == CDB_MAGIC_HEADER ? "Invalid CDB file format" : "Corrupt CDB segment directory");
+        return -1;
+    }
     
-    fwrite(&magic, sizeof(uint32_t), 1, f);
-    fwrite(&version, sizeof(uint32_t), 1, f);
-    fwrite(&num_cols, sizeof(uint32_t), 1, f);
-    fwrite(&num_rows, sizeof(uint32_t), 1, f);
-    fwrite(&now, sizeof(uint64_t), 1, f);
+    if (read_exact(f, &dir->version, sizeof(uint32_t)) < 0 ||
+        dir->version < (expected_magic == CDB_MAGIC_HEADER ? CDB_MIN_VERSION : CDB_SEGMENT_VERSION) ||
+        dir->version > CDB_VERSION) {
+        set_error("Unsupported CDB file version");
+        return -1;
+    }
     
-    uint32_t flags = 0;
-    fwrite(&flags, sizeof(uint32_t), 1, f);
+    if (read_exact(f, &dir->num_columns, sizeof(uint32_t)) < 0 ||
+        read_exact(f, &dir->num_rows, sizeof(uint32_t)) < 0 ||
+        read_exact(f, &dir->timestamp, sizeof(uint64_t)) < 0 ||
+        read_exact(f, &dir->flags, sizeof(uint32_t)) < 0 ||
+        read_exact(f, &header_checksum, sizeof(uint32_t)) < 0) {
+        set_error("Truncated CDB header");
+        return -1;
+    }
+    if (dir->version >= CDB_ENCODING_VERSION && (dir->flags & ~(uint32_t)CDB_KNOWN_FLAGS)) {
+        set_error("Unsupported CDB file features");
+        return -1;
+    }
+    if (dir->version >= CDB_SEGMENT_VERSION &&
+        (read_exact(f, &dir->segment_link, sizeof(uint64_t)) < 0 ||
+         read_exact(f, expected_magic == CDB_MAGIC_HEADER ? &dir->committed_size : &dir->first_row,
+                    sizeof(uint64_t)) < 0)) {
+        set_error("Truncated CDB header");
+        return -1;
+    }
     
-    /* Placeholder for header checksum (will update later) */
-    uint32_t header_checksum = 0;
-    long checksum_pos = ftell(f);
-    fwrite(&header_checksum, sizeof(uint32_t), 1, f);
+    dir->columns = (cdb_file_column_t*)calloc(dir->num_columns ? dir->num_columns : 1,
+                                              sizeof(cdb_file_column_t));
+    if (!dir->columns) {
+        set_error("Failed to allocate column metadata");
+        return -1;
+    }
     
-    /* Write column metadata */
-    for (size_t i = 0; i < db->num_columns; i++) {
-        cdb_column_t* col = &db->columns[i];
+    for (uint32_t i = 0; i < dir->num_columns; i++) {
+        cdb_file_column_t* entry = &dir->columns[i];
+        uint8_t dtype;
+        uint16_t name_len;
         
-        uint8_t dtype = col->data_type;
-        fwrite(&dtype, sizeof(uint8_t), 1, f);
+        if (read_exact(f, &dtype, sizeof(uint8_t)) < 0 ||
+            read_exact(f, &name_len, sizeof(uint16_t)) < 0) {
+            goto truncated;
+        }
+        if (dtype > CDB_TYPE_DICT_STRING ||
+            (dtype == CDB_TYPE_DICT_STRING && dir->version < CDB_DICT_STRING_VERSION)) {
+            set_error("Invalid column type in CDB file");
+            free_directory(dir);
+            return -1;
+        }
+        entry->data_type = (cdb_data_type_t)dtype;
         
-        uint16_t name_len = (uint16_t)strlen(col->name);
-        fwrite(&name_len, sizeof(uint16_t), 1, f);
-        fwrite(col->name, sizeof(char), name_len, f);
+        entry->name = (char*)malloc(name_len + 1);
+        if (!entry->name) {
+            set_error("Failed to allocate column name");
+            free_directory(dir);
+            return -1;
+        }
+        if (read_exact(f, entry->name, name_len) < 0) goto truncated;
+        entry->name[name_len] = '\0';
         
-        /* Calculate data size */
-        uint64_t data_offset = ftell(f) + 24;  /* Will be filled later */
-        uint64_t data_size = 0;
+        if (read_exact(f, &entry->data_offset, sizeof(uint64_t)) < 0 ||
+            read_exact(f, &entry->data_size, sizeof(uint64_t)) < 0 ||
+            read_exact(f, &entry->null_bitmap_size, sizeof(uint64_t)) < 0) {
+            goto truncated;
+        }
         
-        switch (col->data_type) {
-            case CDB_TYPE_INT32:
-                data_size = col->num_rows * sizeof(int32_t);
-                break;
-            case CDB_TYPE_INT64:
-                data_size = col->num_rows * sizeof(int64_t);
-                break;
-            case CDB_TYPE_FLOAT32:
-                data_size = col->num_rows * sizeof(float);
-                break;
-            case CDB_TYPE_FLOAT64:
-                data_size = col->num_rows * sizeof(double);
-                break;
-            case CDB_TYPE_STRING: {
-                /* For strings, need length prefix for each */
-                for (size_t j = 0; j < col->num_rows; j++) {
-                    char** strings = (char**)col->data;
-                    if (strings[j]) {
-                        data_size += sizeof(uint32_t) + strlen(strings[j]);
-                    } else {
-                        data_size += sizeof(uint32_t);
-                    }
-                }
-                break;
+        entry->null_count = CDB_NULL_COUNT_UNKNOWN;
+        if (dir->version >= CDB_NULL_COUNT_VERSION) {
+            if (read_exact(f, &entry->null_count, sizeof(uint64_t)) < 0) goto truncated;
+            if (entry->null_count > dir->num_rows) {
+                set_error("Corrupt column metadata");
+                free_directory(dir);
+                return -1;
             }
-            case CDB_TYPE_BOOL:
-                data_size = col->num_rows * sizeof(uint8_t);
-                break;
         }
         
-        uint64_t null_bitmap_size = (col->num_rows + 7) / 8;
+        if (dir->version >= CDB_ZONE_MAP_VERSION) {
+            if (read_exact(f, &entry->row_group_rows, sizeof(uint64_t)) < 0 ||
+                read_exact(f, &entry->zone_map_offset, sizeof(uint64_t)) < 0) {
+                goto truncated;
+            }
+            if (entry->zone_map_offset != 0 &&
+                (entry->row_group_rows == 0 || entry->row_group_rows % 64 != 0 ||
+                 !has_zone_maps(entry->data_type))) {
+                set_error("Corrupt column metadata");
+                free_directory(dir);
+                return -1;
+            }
+        }
         
-        fwrite(&data_offset, sizeof(uint64_t), 1, f);
-        fwrite(&data_size, sizeof(uint64_t), 1, f);
-        fwrite(&null_bitmap_size, sizeof(uint64_t), 1, f);
-    }
-    
-    /* Write column data */
-    for (size_t i = 0; i < db->num_columns; i++) {
-        cdb_column_t* col = &db->columns[i];
+        entry->encoding = CDB_FILE_ENCODING_PLAIN;
+        if (entry->data_type == CDB_TYPE_STRING && dir->version < CDB_STRING_OFFSETS_VERSION) {
+            entry->encoding = CDB_FILE_ENCODING_LENGTH_PREFIXED;
+        }
+        if (dir->version >= CDB_ENCODING_VERSION) {
+            uint8_t encoding;
+            if (read_exact(f, &encoding, sizeof(uint8_t)) < 0) goto truncated;
+            if (!encoding_supported(entry, encoding)) {
+                set_error("Invalid column encoding in CDB file");
+                free_directory(dir);
+                return -1;
+            }
+            entry->encoding = (cdb_file_encoding_t)encoding;
+        }
         
-        if (col->data_type == CDB_TYPE_STRING) {
-            /* Write strings with length prefix */
-            for (size_t j = 0; j < col->num_rows; j++) {
-                char** strings = (char**)col->data;
-                uint32_t str_len = strings[j] ? (uint32_t)strlen(strings[j]) : 0;
-                fwrite(&str_len, sizeof(uint32_t), 1, f);
-                if (str_len > 0) {
-                    fwrite(strings[j], sizeof(char), str_len, f);
-                }
+        entry->compression = CDB_COMPRESSION_NONE;
+        entry->stored_data_size = entry->data_size;
+        entry->stored_bitmap_size = entry->null_bitmap_size;
+        if (dir->version >= CDB_COMPRESSION_VERSION) {
+            uint8_t compression;
+            if (read_exact(f, &compression, sizeof(uint8_t)) < 0 ||
+                read_exact(f, &entry->stored_data_size, sizeof(uint64_t)) < 0 ||
+                read_exact(f, &entry->stored_bitmap_size, sizeof(uint64_t)) < 0) {
+                goto truncated;
             }
-        } else {
-            /* Write binary data directly */
-            size_t element_size = 0;
-            switch (col->data_type) {
-                case CDB_TYPE_INT32: element_size = sizeof(int32_t); break;
-                case CDB_TYPE_INT64: element_size = sizeof(int64_t); break;
-                case CDB_TYPE_FLOAT32: element_size = sizeof(float); break;
-                case CDB_TYPE_FLOAT64: element_size = sizeof(double); break;
-                case CDB_TYPE_BOOL: element_size = sizeof(uint8_t); break;
-                default: element_size = 0;
+            /* Codecs missing from this build are only an error once the column is read */
+            if (compression > CDB_COMPRESSION_LZ4 ||
+                (compression == CDB_COMPRESSION_NONE &&
+                 (entry->stored_data_size != entry->data_size ||
+                  entry->stored_bitmap_size != entry->null_bitmap_size))) {
+                set_error("Invalid column compression in CDB file");
+                free_directory(dir);
+                return -1;
+            }
+            entry->compression = (cdb_compression_t)compression;
+        }
+        
+        if (dir->version >= CDB_COLUMN_FLAGS_VERSION) {
+            uint8_t column_flags;
+            if (read_exact(f, &column_flags, sizeof(uint8_t)) < 0) goto truncated;
+            if ((column_flags & ~CDB_COLUMN_SORTED) ||
+                ((column_flags & CDB_COLUMN_SORTED) && !has_zone_maps(entry->data_type))) {
+                set_error("Invalid column flags in CDB file");
+                free_directory(dir);
+                return -1;
             }
-            
-            if (element_size > 0) {
-                fwrite(col->data, element_size, col->num_rows, f);
+            entry->sorted = (column_flags & CDB_COLUMN_SORTED) != 0;
+        }
+        
+        if (dir->version >= CDB_INDEX_VERSION) {
+            uint8_t index_kind;
+            if (read_exact(f, &index_kind, sizeof(uint8_t)) < 0 ||
+                read_exact(f, &entry->index_offset, sizeof(uint64_t)) < 0 ||
+                read_exact(f, &entry->index_size, sizeof(uint64_t)) < 0) goto truncated;
+            if (index_kind > CDB_INDEX_AUTO || (index_kind == CDB_INDEX_NONE) != (entry->index_size == 0) ||
+                entry->index_size % 8 != 0 || entry->index_offset % 8 != 0 ||
+                (index_kind != CDB_INDEX_NONE && !cdb_index_supported(entry->data_type))) {
+                set_error("Invalid column index in CDB file");
+                free_directory(dir);
+                return -1;
             }
+            entry->index_kind = (cdb_index_kind_t)index_kind;
+        }
+        
+        if (dir->version >= CDB_CHECKSUM_VERSION) {
+            if (read_exact(f, &entry->checksum, sizeof(uint32_t)) < 0) goto truncated;
+            entry->has_checksum = 1;
+        }
+        
+        uint64_t min_data_size = (uint64_t)dir->num_rows * cdb_type_size(entry->data_type);
+        if (entry->data_type == CDB_TYPE_STRING) {
+            min_data_size = entry->encoding == CDB_FILE_ENCODING_PLAIN
+                ? ((uint64_t)dir->num_rows + 1) * sizeof(uint64_t)
+                : (uint64_t)dir->num_rows * sizeof(uint32_t);
+        } else if (entry->data_type == CDB_TYPE_DICT_STRING) {
+            min_data_size = dict_codes_size(dir->num_rows) + 2 * sizeof(uint64_t);
+        }
+        
+        if (cdb_encoding_is_chunked(entry->encoding)) {
+            /* Encoded sections only need room for their chunk offset table */
+            min_data_size = (row_group_count(dir->num_rows, entry->row_group_rows) + 1) * sizeof(uint64_t);
         }
         
-        /* Write null bitmap */
-        uint64_t bitmap_size = (col->num_rows + 7) / 8;
-        fwrite(col->null_bitmap, sizeof(uint8_t), bitmap_size, f);
+        int variable_size = entry->data_type == CDB_TYPE_STRING || entry->data_type == CDB_TYPE_DICT_STRING ||
+                            cdb_encoding_is_chunked(entry->encoding);
+        if (entry->null_bitmap_size != ((uint64_t)dir->num_rows + 7) / 8 ||
+            entry->data_size < min_data_size ||
+            (!variable_size && entry->data_size != min_data_size)) {
+            set_error("Corrupt column metadata");
+            free_directory(dir);
+            return -1;
+        }
     }
     
-    /* Calculate file size for footer */
-    uint64_t file_size = ftell(f) + 16;  /* +16 for footer */
-    
-    /* Write footer */
-    uint32_t footer_magic = CDB_MAGIC_FOOTER;
-    fwrite(&footer_magic, sizeof(uint32_t), 1, f);
-    fwrite(&file_size, sizeof(uint64_t), 1, f);
+    if (dir->version >= CDB_CHECKSUM_VERSION && check_directory(f, start, header_checksum) < 0) {
+        free_directory(dir);
+        return -1;
+    }
     
-    /* Calculate overall checksum */
-    uint32_t file_checksum = 0;  /* TODO: implement full checksum */
-    fwrite(&file_checksum, sizeof(uint32_t), 1, f);
+    /* Version 1 wrote bogus offsets; its columns are packed right after the metadata */
+    if (dir->version == 1) {
+        uint64_t offset = cdb_ftell(f);
+        for (uint32_t i = 0; i < dir->num_columns; i++) {
+            dir->columns[i].data_offset = offset;
+            offset += dir->columns[i].data_size + dir->columns[i].null_bitmap_size;
+        }
+    }
     
-    fclose(f);
     return 0;
+
+truncated:
+    set_error("Truncated CDB column metadata");
+    free_directory(dir);
+    return -1;
 }
 
-/* Load database from file */
-int cdb_load_from(cdb_database_t* db, const char* filename) {
-    if (!db || !filename) {
-        set_error("Invalid database or filename");
+/* Read the header and column metadata at the start of a file */
+static int read_directory(FILE* f, cdb_file_directory_t* dir) {
+    if (parse_directory(f, CDB_MAGIC_HEADER, dir) < 0) return -1;
+    if (dir->version >= CDB_SEGMENT_VERSION && dir->committed_size < cdb_ftell(f)) {
+        set_error("Corrupt CDB header");
+        free_directory(dir);
         return -1;
     }
-    
-    FILE* f = fopen(filename, "rb");
-    if (!f) {
-        set_error("Failed to open file for reading");
-        return -1;
+    return 0;
+}
+
+/* Appended segments of a file, oldest first */
+typedef struct {
+    cdb_file_directory_t* dirs;
+    size_t count;
+    uint64_t num_rows;  /* Rows of the whole file */
+} cdb_file_segments_t;
+
+static void free_segments(cdb_file_segments_t* segs) {
+    for (size_t i = 0; i < segs->count; i++) {
+        free_directory(&segs->dirs[i]);
+    }
+    free(segs->dirs);
+    memset(segs, 0, sizeof(*segs));
+}
+
+/* Follow the segment links of a file back from the newest segment. Each
+ * link points below the last, and every segment continues the rows of the
+ * one before with the base's columns. */
+static int read_segments(FILE* f, const cdb_file_directory_t* base, cdb_file_segments_t* segs) {
+    memset(segs, 0, sizeof(*segs));
+    segs->num_rows = base->num_rows;
+    size_t capacity = 0;
+    uint64_t limit = base->committed_size;
+    for (uint64_t link = base->segment_link; link != 0;) {
+        if (link < CDB_HEADER_SIZE || link >= limit) {
+            set_error("Corrupt CDB segment link");
+            free_segments(segs);
+            return -1;
+        }
+        if (segs->count == capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            cdb_file_directory_t* grown = (cdb_file_directory_t*)realloc(segs->dirs, capacity * sizeof(cdb_file_directory_t));
+            if (!grown) {
+                set_error("Failed to allocate segment directories");
+                free_segments(segs);
+                return -1;
+            }
+            segs->dirs = grown;
+        }
+        if (cdb_fseek(f, link) != 0 || parse_directory(f, CDB_MAGIC_SEGMENT, &segs->dirs[segs->count]) < 0) {
+            free_segments(segs);
+            return -1;
+        }
+        limit = link;
+        link = segs->dirs[segs->count++].segment_link;
     }
     
-    /* Read and verify header */
-    uint32_t magic, version, num_cols, num_rows;
-    uint64_t timestamp;
-    uint32_t flags, header_checksum;
-    
-    fread(&magic, sizeof(uint32_t), 1, f);
-    if (magic != CDB_MAGIC_HEADER) {
-        set_error("Invalid CDB file format");
-        fclose(f);
+    /* Oldest first */
+    for (size_t i = 0; i < segs->count / 2; i++) {
+        cdb_file_directory_t tmp = segs->dirs[i];
+        segs->dirs[i] = segs->dirs[segs->count - 1 - i];
+        segs->dirs[segs->count - 1 - i] = tmp;
+    }
+    for (size_t i = 0; i < segs->count; i++) {
+        const cdb_file_directory_t* seg = &segs->dirs[i];
+        int same_columns = seg->num_columns == base->num_columns && seg->first_row == segs->num_rows;
+        for (uint32_t c = 0; same_columns && c < seg->num_columns; c++) {
+            same_columns = seg->columns[c].data_type == base->columns[c].data_type &&
+                           strcmp(seg->columns[c].name, base->columns[c].name) == 0;
+        }
+        segs->num_rows += seg->num_rows;
+        if (!same_columns || segs->num_rows > UINT32_MAX) {
+            set_error("Corrupt CDB segment directory");
+            free_segments(segs);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* How cdb_save_to writes one column; buffers live only while the column is written */
+typedef struct {
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint64_t zone_map_offset;
+    cdb_file_encoding_t encoding;
+    uint8_t* encoded;   /* Encoded section, NULL for plain data */
+    cdb_compression_t compression;
+    uint8_t* compressed_data;    /* NULL: the data block is stored as is */
+    uint64_t stored_data_size;
+    uint8_t* compressed_bitmap;  /* NULL: the null bitmap is stored as is */
+    uint64_t stored_bitmap_size;
+    int sorted;         /* Declared sorted, or found to be */
+    const cdb_index_t* index;  /* Index written after the zone maps, NULL for none */
+    cdb_index_t* built_index;  /* Built for this save when the column's own is stale */
+    uint64_t index_offset;
+    uint64_t index_size;
+    uint32_t checksum;  /* CRC32C of the stored data block and null bitmap, once written */
+} cdb_save_plan_t;
+
+static void release_save_plan(cdb_save_plan_t* plan) {
+    free(plan->encoded);
+    free(plan->compressed_data);
+    free(plan->compressed_bitmap);
+    cdb_index_free(plan->built_index);
+    plan->encoded = NULL;
+    plan->compressed_data = NULL;
+    plan->compressed_bitmap = NULL;
+    plan->built_index = NULL;
+    plan->index = NULL;
+}
+
+#define CDB_WRITE_BUFFER_SIZE (1 << 20)  /* Largest staging buffer of a column write */
+
+/* Buffered positional output of one column section: small writes (bitmap,
+ * zone maps, padding) are staged and large ones go straight to the file,
+ * so a section is a few big writes. Sections are written concurrently. */
+typedef struct {
+    int fd;
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    uint64_t pos;   /* File offset of the next byte, staged or not */
+    int failed;
+    uint64_t check_left;  /* Bytes still to add to crc */
+    uint32_t crc;
+} cdb_output_t;
+
+static void output_flush(cdb_output_t* out) {
+    if (out->used > 0 && write_at(out->fd, out->buffer, out->used, out->pos - out->used) < 0) out->failed = 1;
+    out->used = 0;
+}
+
+/* Add the leading bytes of the section to its checksum */
+static void output_check(cdb_output_t* out, const void* data, size_t size) {
+    size_t n = size < out->check_left ? size : (size_t)out->check_left;
+    if (n == 0) return;
+    out->crc = cdb_crc32c(out->crc, data, n);
+    out->check_left -= n;
+}
+
+static void output_write(cdb_output_t* out, const void* data, size_t size) {
+    if (size == 0) return;
+    if (out->used + size > out->capacity) {
+        output_flush(out);
+        if (size > out->capacity / 2) {
+            /* A buffer's worth at a time, so the checksum reads bytes still in cache */
+            const uint8_t* p = (const uint8_t*)data;
+            while (size > 0) {
+                size_t n = size < CDB_WRITE_BUFFER_SIZE ? size : CDB_WRITE_BUFFER_SIZE;
+                output_check(out, p, n);
+                if (write_at(out->fd, p, n, out->pos) < 0) out->failed = 1;
+                out->pos += n;
+                p += n;
+                size -= n;
+            }
+            return;
+        }
+    }
+    output_check(out, data, size);
+    memcpy(out->buffer + out->used, data, size);
+    out->used += size;
+    out->pos += size;
+}
+
+/* Zero padding up to the next multiple of alignment (at most CDB_DATA_ALIGNMENT) */
+static void output_align(cdb_output_t* out, uint64_t alignment) {
+    static const uint8_t padding[CDB_DATA_ALIGNMENT] = {0};
+    uint64_t aligned = (out->pos + alignment - 1) & ~(alignment - 1);
+    output_write(out, padding, (size_t)(aligned - out->pos));
+}
+
+/* Destination of a plain data section: the output, or a buffer being filled */
+typedef struct {
+    cdb_output_t* out;
+    uint8_t* buffer;
+    uint64_t pos;
+} cdb_sink_t;
+
+static void sink_write(cdb_sink_t* sink, const void* data, size_t size) {
+    if (size == 0) return;
+    if (sink->buffer) {
+        memcpy(sink->buffer + sink->pos, data, size);
+    } else {
+        output_write(sink->out, data, size);
+    }
+    sink->pos += size;
+}
+
+/* Write a column's data section in the plain layout described in CDB_FILE_FORMAT.md */
+static void write_plain_data(cdb_sink_t* sink, const cdb_column_t* col) {
+    static const uint8_t padding[8] = {0};
+    if (col->data_type == CDB_TYPE_STRING) {
+        /* Offsets, then all string bytes in one go */
+        sink_write(sink, col->data, (col->num_rows + 1) * sizeof(uint64_t));
+        sink_write(sink, col->string_data, col->string_data_size);
+    } else if (col->data_type == CDB_TYPE_DICT_STRING) {
+        /* Codes, then the dictionary on the next 8-byte boundary */
+        uint64_t dict_size = col->dict_size;
+        uint64_t no_entries = 0;
+        sink_write(sink, col->data, col->num_rows * sizeof(uint32_t));
+        sink_write(sink, padding, (size_t)(dict_codes_size(col->num_rows) - col->num_rows * sizeof(uint32_t)));
+        sink_write(sink, &dict_size, sizeof(uint64_t));
+        if (col->dict_offsets) {
+            sink_write(sink, col->dict_offsets, (col->dict_size + 1) * sizeof(uint64_t));
+        } else {
+            sink_write(sink, &no_entries, sizeof(uint64_t));
+        }
+        sink_write(sink, col->string_data, col->string_data_size);
+    } else {
+        /* Binary values directly */
+        sink_write(sink, col->data, col->num_rows * cdb_type_size(col->data_type));
+    }
+}
+
+/* Compress one block for a plan; keep it as is (NULL) when compression does not shrink it */
+static int compress_plan_block(cdb_compression_t codec, int level, const void* block, uint64_t size,
+                               uint8_t** compressed, uint64_t* stored_size) {
+    if (cdb_compress_block(codec, level, block, size, compressed, stored_size) < 0) {
         return -1;
     }
+    if (*stored_size >= size) {
+        free(*compressed);
+        *compressed = NULL;
+        *stored_size = size;
+    }
+    return 0;
+}
+
+/* Compress a column's data section and null bitmap as independent blocks */
+static int compress_column(cdb_compression_t codec, int level, const cdb_column_t* col, cdb_save_plan_t* plan) {
+    const void* data = plan->encoded ? (const void*)plan->encoded : col->data;
+    uint8_t* staged = NULL;
+    if (!plan->encoded && (col->data_type == CDB_TYPE_STRING || col->data_type == CDB_TYPE_DICT_STRING)) {
+        /* Variable-size sections are assembled in memory first */
+        staged = (uint8_t*)malloc(plan->data_size ? (size_t)plan->data_size : 1);
+        if (!staged) {
+            set_error("Failed to allocate compression buffer");
+            return -1;
+        }
+        cdb_sink_t sink = {NULL, staged, 0};
+        write_plain_data(&sink, col);
+        data = staged;
+    }
     
-    fread(&version, sizeof(uint32_t), 1, f);
-    if (version != CDB_VERSION) {
-        set_error("Unsupported CDB file version");
-        fclose(f);
+    int status = compress_plan_block(codec, level, data, plan->data_size, &plan->compressed_data,
+                                     &plan->stored_data_size);
+    free(staged);
+    if (status < 0 ||
+        compress_plan_block(codec, level, col->null_bitmap, plan->stored_bitmap_size,
+                            &plan->compressed_bitmap, &plan->stored_bitmap_size) < 0) {
         return -1;
     }
     
-    fread(&num_cols, sizeof(uint32_t), 1, f);
-    fread(&num_rows, sizeof(uint32_t), 1, f);
-    fread(&timestamp, sizeof(uint64_t), 1, f);
-    fread(&flags, sizeof(uint32_t), 1, f);
-    fread(&header_checksum, sizeof(uint32_t), 1, f);
-    
-    /* Read column metadata and create columns */
-    for (uint32_t i = 0; i < num_cols; i++) {
-        uint8_t dtype;
-        uint16_t name_len;
-        
-        fread(&dtype, sizeof(uint8_t), 1, f);
-        fread(&name_len, sizeof(uint16_t), 1, f);
-        
-        char* col_name = (char*)malloc(name_len + 1);
-        if (!col_name) {
-            set_error("Failed to allocate column name");
-            fclose(f);
-            return -1;
+    /* A column where neither block shrank is written uncompressed */
+    if (plan->compressed_data || plan->compressed_bitmap) plan->compression = codec;
+    return 0;
+}
+
+/* Decide how a column is stored: plain, encoded and/or compressed */
+static int plan_column(const cdb_database_t* db, const cdb_column_t* col, cdb_compression_t codec, int level,
+                       cdb_save_plan_t* plan) {
+    plan->data_size = column_data_size(col);
+    plan->sorted = col->sorted || (has_zone_maps(col->data_type) && cdb_rows_in_order(col, 0));
+    if (col->index_kind != CDB_INDEX_NONE) {
+        /* The database is only read here: a stale index is rebuilt for this file alone */
+        plan->index = col->index;
+        if (!cdb_index_current(col)) {
+            plan->built_index = cdb_index_build(col, (cdb_index_kind_t)col->index_kind);
+            if (!plan->built_index) return -1;
+            plan->index = plan->built_index;
         }
-        
-        fread(col_name, sizeof(char), name_len, f);
-        col_name[name_len] = '\0';
-        
-        uint64_t data_offset, data_size, null_bitmap_size;
-        fread(&data_offset, sizeof(uint64_t), 1, f);
-        fread(&data_size, sizeof(uint64_t), 1, f);
-        fread(&null_bitmap_size, sizeof(uint64_t), 1, f);
-        
-        /* Add column */
-        if (cdb_add_column(db, col_name, (cdb_data_type_t)dtype) < 0) {
-            free(col_name);
-            fclose(f);
+        size_t index_size;
+        cdb_index_data(plan->index, &index_size);
+        plan->index_size = index_size;
+    }
+    if (db->encode_columns) {
+        uint64_t encoded_size;
+        if (cdb_encode_column(col, db->row_group_rows, &plan->encoding, &plan->encoded, &encoded_size) < 0) {
             return -1;
         }
-        
-        free(col_name);
+        if (plan->encoded) plan->data_size = encoded_size;
     }
+    plan->stored_data_size = plan->data_size;
+    plan->stored_bitmap_size = (col->num_rows + 7) / 8;
+    if (codec != CDB_COMPRESSION_NONE) return compress_column(codec, level, col, plan);
+    return 0;
+}
+
+/* Place a planned column's section at offset; returns the offset just past it */
+static uint64_t layout_column(const cdb_column_t* col, uint64_t row_group_rows, cdb_save_plan_t* plan,
+                              uint64_t offset) {
+    plan->data_offset = offset;
+    uint64_t end = offset + plan->stored_data_size + plan->stored_bitmap_size;
     
-    /* Read column data */
-    for (size_t i = 0; i < db->num_columns; i++) {
-        cdb_column_t* col = &db->columns[i];
-        
-        if (col->data_type == CDB_TYPE_STRING) {
-            /* Read strings with length prefix */
-            char** strings = (char**)col->data;
-            for (uint32_t j = 0; j < num_rows; j++) {
-                uint32_t str_len;
-                fread(&str_len, sizeof(uint32_t), 1, f);
-                
-                if (str_len > 0) {
-                    char* str = (char*)malloc(str_len + 1);
-                    if (!str) {
-                        set_error("Failed to allocate string");
-                        fclose(f);
-                        return -1;
-                    }
-                    fread(str, sizeof(char), str_len, f);
-                    str[str_len] = '\0';
-                    strings[j] = str;
-                } else {
-                    strings[j] = (char*)malloc(1);
-                    if (strings[j]) strings[j][0] = '\0';
-                }
-            }
-        } else {
-            /* Read binary data */
-            size_t element_size = 0;
-            switch (col->data_type) {
-                case CDB_TYPE_INT32: element_size = sizeof(int32_t); break;
-                case CDB_TYPE_INT64: element_size = sizeof(int64_t); break;
-                case CDB_TYPE_FLOAT32: element_size = sizeof(float); break;
-                case CDB_TYPE_FLOAT64: element_size = sizeof(double); break;
-                case CDB_TYPE_BOOL: element_size = sizeof(uint8_t); break;
-                default: element_size = 0;
-            }
-            
-            if (element_size > 0) {
-                fread(col->data, element_size, num_rows, f);
-            }
+    /* Zone maps follow the (stored) null bitmap on an 8-byte boundary */
+    if (has_zone_maps(col->data_type) && col->num_rows > 0) {
+        plan->zone_map_offset = (end + 7) & ~(uint64_t)7;
+        end = plan->zone_map_offset + row_group_count(col->num_rows, row_group_rows) * sizeof(cdb_zone_map_t);
+    }
+    
+    /* Then the index, also 8-byte aligned */
+    if (plan->index) {
+        plan->index_offset = (end + 7) & ~(uint64_t)7;
+        end = plan->index_offset + plan->index_size;
+    }
+    return end;
+}
+
+/* Write one laid-out column section: data, null bitmap, zone maps and index */
+static void write_column_section(cdb_output_t* out, const cdb_column_t* col, uint64_t row_group_rows,
+                                 const cdb_save_plan_t* plan) {
+    if (plan->compressed_data) {
+        output_write(out, plan->compressed_data, (size_t)plan->stored_data_size);
+    } else if (plan->encoded) {
+        /* Chunk offset table and chunks */
+        output_write(out, plan->encoded, (size_t)plan->data_size);
+    } else {
+        cdb_sink_t sink = {out, NULL, 0};
+        write_plain_data(&sink, col);
+    }
+    
+    output_write(out, plan->compressed_bitmap ? plan->compressed_bitmap : col->null_bitmap,
+                 (size_t)plan->stored_bitmap_size);
+    
+    /* One zone map per row group */
+    if (plan->zone_map_offset) {
+        output_align(out, 8);
+        for (size_t start = 0; start < col->num_rows; start += (size_t)row_group_rows) {
+            size_t end = col->num_rows - start < row_group_rows ? col->num_rows : start + (size_t)row_group_rows;
+            cdb_zone_map_t zone;
+            compute_zone_map(col, start, end, &zone);
+            output_write(out, &zone, sizeof(cdb_zone_map_t));
         }
-        
-        /* Read null bitmap */
-        uint64_t bitmap_size = (num_rows + 7) / 8;
-        fread(col->null_bitmap, sizeof(uint8_t), bitmap_size, f);
-        
-        /* Set row count */
-        col->num_rows = num_rows;
     }
     
-    fclose(f);
-    return 0;
+    if (plan->index) {
+        size_t index_size;
+        const void* block = cdb_index_data(plan->index, &index_size);
+        output_align(out, 8);
+        output_write(out, block, index_size);
+    }
+}
+
+static uint8_t* put_bytes(uint8_t* p, const void* value, size_t size) {
+    memcpy(p, value, size);
+    return p + size;
+}
+
+/* Bytes of the header and column metadata; they depend only on the column names */
+static size_t directory_size(const cdb_database_t* db) {
+    size_t size = CDB_HEADER_SIZE + CDB_SEGMENT_LINK_SIZE;
+    for (size_t i = 0; i < db->num_columns; i++) {
+        size += 5 * sizeof(uint8_t) + sizeof(uint16_t) + strlen(db->columns[i].name) + 10 * sizeof(uint64_t) +
+                sizeof(uint32_t);
+    }
+    return size;
+}
+
+/* Fill in the header and column metadata once every section has been written.
+ * link and extent are the segment link and the committed size (file
+ * directories) or first row (segment directories). Returns the directory
+ * checksum. */
+static uint32_t build_directory(const cdb_database_t* db, const cdb_save_plan_t* plans, uint32_t flags,
+                                uint32_t magic, uint64_t link, uint64_t extent, uint8_t* directory) {
+    uint32_t version = CDB_VERSION;
+    uint32_t num_cols = (uint32_t)db->num_columns;
+    uint32_t num_rows = (uint32_t)cdb_get_num_rows((cdb_database_t*)db);
+    uint64_t now = (uint64_t)time(NULL);
+    uint32_t header_checksum = 0;  /* Filled in last */
+    uint8_t* p = directory;
+    
+    p = put_bytes(p, &magic, sizeof(uint32_t));
+    p = put_bytes(p, &version, sizeof(uint32_t));
+    p = put_bytes(p, &num_cols, sizeof(uint32_t));
+    p = put_bytes(p, &num_rows, sizeof(uint32_t));
+    p = put_bytes(p, &now, sizeof(uint64_t));
+    p = put_bytes(p, &flags, sizeof(uint32_t));
+    p = put_bytes(p, &header_checksum, sizeof(uint32_t));
+    p = put_bytes(p, &link, sizeof(uint64_t));
+    p = put_bytes(p, &extent, sizeof(uint64_t));
+    
+    uint64_t row_group_rows = db->row_group_rows;
+    for (size_t i = 0; i < db->num_columns; i++) {
+        const cdb_column_t* col = &db->columns[i];
+        const cdb_save_plan_t* plan = &plans[i];
+        uint8_t dtype = (uint8_t)col->data_type;
+        uint16_t name_len = (uint16_t)strlen(col->name);
+        uint64_t null_bitmap_size = (col->num_rows + 7) / 8;
+        uint64_t null_count = col->null_count;
+        uint8_t encoding = (uint8_t)plan->encoding;
+        uint8_t compression = (uint8_t)plan->compression;
+        uint8_t column_flags = plan->sorted ? CDB_COLUMN_SORTED : 0;
+        uint8_t index_kind = col->index_kind;
+        
+        p = put_bytes(p, &dtype, sizeof(uint8_t));
+        p = put_bytes(p, &name_len, sizeof(uint16_t));
+        p = put_bytes(p, col->name, name_len);
+        p = put_bytes(p, &plan->data_offset, sizeof(uint64_t));
+        p = put_bytes(p, &plan->data_size, sizeof(uint64_t));
+        p = put_bytes(p, &null_bitmap_size, sizeof(uint64_t));
+        p = put_bytes(p, &null_count, sizeof(uint64_t));
+        p = put_bytes(p, &row_group_rows, sizeof(uint64_t));
+        p = put_bytes(p, &plan->zone_map_offset, sizeof(uint64_t));
+        p = put_bytes(p, &encoding, sizeof(uint8_t));
+        p = put_bytes(p, &compression, sizeof(uint8_t));
+        p = put_bytes(p, &plan->stored_data_size, sizeof(uint64_t));
+        p = put_bytes(p, &plan->stored_bitmap_size, sizeof(uint64_t));
+        p = put_bytes(p, &column_flags, sizeof(uint8_t));
+        p = put_bytes(p, &index_kind, sizeof(uint8_t));
+        p = put_bytes(p, &plan->index_offset, sizeof(uint64_t));
+        p = put_bytes(p, &plan->index_size, sizeof(uint64_t));
+        p = put_bytes(p, &plan->checksum, sizeof(uint32_t));
+    }
+    
+    header_checksum = directory_checksum(directory, (size_t)(p - directory));
+    put_bytes(directory + CDB_HEADER_SIZE - sizeof(uint32_t), &header_checksum, sizeof(uint32_t));
+    return header_checksum;
+}
+
+/* Threads worth starting for count independent column tasks */
+static size_t pool_threads(const cdb_database_t* db, size_t count) {
+    size_t threads = db->num_threads ? db->num_threads : cdb_cpu_count();
+    if (threads > count) threads = count;
+    return threads ? threads : 1;
+}
+
+/* A batch of columns being saved: planned by one round of pool tasks, laid
+ * out in order, then written by a second round */
+typedef struct {
+    cdb_database_t* db;
+    cdb_save_plan_t* plans;
+    size_t first;
+    int fd;
+    cdb_compression_t codec;
+    int level;
+} cdb_save_batch_t;
+
+static int run_plan_task(void* ctx, size_t index) {
+    cdb_save_batch_t* batch = (cdb_save_batch_t*)ctx;
+    size_t i = batch->first + index;
+    return plan_column(batch->db, &batch->db->columns[i], batch->codec, batch->level, &batch->plans[i]);
+}
+
+static int run_write_task(void* ctx, size_t index) {
+    cdb_save_batch_t* batch = (cdb_save_batch_t*)ctx;
+    size_t i = batch->first + index;
+    cdb_column_t* col = &batch->db->columns[i];
+    cdb_save_plan_t* plan = &batch->plans[i];
+    
+    /* Size the staging buffer to the section: small sections become one write */
+    uint64_t section_size = layout_column(col, batch->db->row_group_rows, plan, plan->data_offset) - plan->data_offset;
+    cdb_output_t out = {batch->fd, NULL, 0, 0, plan->data_offset, 0, 0, 0};
+    out.check_left = plan->stored_data_size + plan->stored_bitmap_size;
+    out.capacity = section_size < CDB_WRITE_BUFFER_SIZE ? (size_t)section_size + 1 : CDB_WRITE_BUFFER_SIZE;
+    out.buffer = (uint8_t*)malloc(out.capacity);
+    if (!out.buffer) {
+        set_error("Failed to allocate save buffers");
+        return -1;
+    }
+    
+    write_column_section(&out, col, batch->db->row_group_rows, plan);
+    output_flush(&out);
+    free(out.buffer);
+    plan->checksum = out.crc;
+    release_save_plan(plan);
+    if (out.failed) {
+        set_error("Failed to write file");
+        return -1;
+    }
+    return 0;
+}
+
+/* Write every column section of db from *offset on, in batches: the pool
+ * encodes and compresses a batch, the batch is laid out after the previous
+ * one, and the pool writes its sections concurrently with positional
+ * writes. Leaves *offset just past the last section. */
+static int write_columns(cdb_database_t* db, int fd, cdb_save_plan_t* plans, cdb_compression_t codec, int level,
+                         uint64_t* offset, uint32_t* flags) {
+    /* A batch per round of the pool bounds how many encoded columns are held at once */
+    cdb_thread_pool_t* pool = cdb_pool_create(pool_threads(db, db->num_columns));
+    size_t batch_size = pool ? 2 * cdb_pool_size(pool) : 1;
+    cdb_save_batch_t batch = {db, plans, 0, fd, codec, level};
+    int status = 0;
+    for (; status == 0 && batch.first < db->num_columns; batch.first += batch_size) {
+        size_t count = db->num_columns - batch.first < batch_size ? db->num_columns - batch.first : batch_size;
+        status = cdb_pool_run(pool, count, run_plan_task, &batch);
+        for (size_t i = batch.first; status == 0 && i < batch.first + count; i++) {
+            *offset = (*offset + CDB_DATA_ALIGNMENT - 1) & ~(uint64_t)(CDB_DATA_ALIGNMENT - 1);
+            *offset = layout_column(&db->columns[i], db->row_group_rows, &plans[i], *offset);
+            if (plans[i].encoded) *flags |= CDB_FLAG_ENCODED_COLUMNS;
+            if (plans[i].compression != CDB_COMPRESSION_NONE) *flags |= CDB_FLAG_COMPRESSED_COLUMNS;
+        }
+        if (status == 0) status = cdb_pool_run(pool, count, run_write_task, &batch);
+    }
+    cdb_pool_destroy(pool);
+    return status;
+}
+
+/* Footer recording the size of the file it ends and its directory's checksum */
+static void build_footer(uint64_t file_size, uint32_t file_checksum, uint8_t* footer) {
+    uint32_t footer_magic = CDB_MAGIC_FOOTER;
+    put_bytes(put_bytes(put_bytes(footer, &footer_magic, sizeof(uint32_t)), &file_size, sizeof(uint64_t)),
+              &file_checksum, sizeof(uint32_t));
+}
+
+/* Flush a file's data to stable storage */
+static int sync_file(int fd) {
+    uint64_t start = cdb_stat_start();
+#ifdef _WIN32
+    int status = _commit(fd);
+#else
+    int status = fsync(fd);
+#endif
+    cdb_stat_time(CDB_STAT_SYNC_NS, start);
+    return status;
+}
+
+/* Replace target with the finished temporary file, durably: on POSIX the
+ * rename is atomic and the directory is synced so it survives a crash */
+static int replace_file(const char* temp, const char* target) {
+#ifdef _WIN32
+    return MoveFileExA(temp, target, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+#else
+    if (rename(temp, target) != 0) return -1;
+    
+    const char* slash = strrchr(target, '/');
+    size_t dir_len = slash ? (size_t)(slash - target) : 0;
+    char* dir = (char*)malloc(dir_len + 2);
+    if (!dir) return 0;  /* The file is in place; only the directory sync is skipped */
+    if (slash) {
+        memcpy(dir, target, dir_len ? dir_len : 1);
+        dir[dir_len ? dir_len : 1] = '\0';
+    } else {
+        memcpy(dir, ".", 2);
+    }
+    int fd = open(dir, O_RDONLY);
+    free(dir);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return 0;
+#endif
+}
+
+/* Open a temporary file next to target that no other save is using: the name
+ * carries the process id and a per-process counter, and it is created
+ * exclusively in case a crashed process left one of the same name */
+static FILE* open_temp_file(const char* target, char* temp, size_t temp_size) {
+#ifdef _WIN32
+    static volatile LONG counter;
+    unsigned long pid = (unsigned long)GetCurrentProcessId();
+#else
+    static unsigned long counter;
+    unsigned long pid = (unsigned long)getpid();
+#endif
+    for (int attempt = 0; attempt < 16; attempt++) {
+#ifdef _WIN32
+        unsigned long id = (unsigned long)InterlockedIncrement(&counter);
+#else
+        unsigned long id = __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED);
+#endif
+        snprintf(temp, temp_size, "%s.%lu.%lu.tmp", target, pid, id);
+        FILE* f = fopen(temp, "wbx");
+        if (f || errno != EEXIST) return f;
+    }
+    return NULL;
+}
+
+/* Save database to file */
+int cdb_save_to(cdb_database_t* db, const char* filename) {
+    if (!db) {
+        set_error("Invalid database or filename");
+        return -1;
+    }
+    return cdb_save_with_codec(db, filename, db->compression, db->compression_level);
+}
+
+/* Save with a block codec for this save only; the database is only read
+ * unless it is memory-mapped, so saves of one database may run concurrently.
+ * The file is written next to the target under a name of its own
+ * (filename.<pid>.<n>.tmp), so concurrent saves never share one: the column
+ * sections, a footer, then the header and metadata over the space reserved
+ * for them at the start. It is synced and renamed over the target, so a
+ * crash leaves either the old file or the new one. */
+int cdb_save_with_codec(cdb_database_t* db, const char* filename, cdb_compression_t codec, int level) {
+    if (!db || !filename) {
+        set_error("Invalid database or filename");
+        return -1;
+    }
+    if (cdb_check_compression(codec, level) < 0) return -1;
+    uint64_t start = cdb_stat_start();
+    
+    /* Every column must be readable before anything is written */
+    for (size_t i = 0; i < db->num_columns; i++) {
+        if (cdb_column_ensure_loaded(db, &db->columns[i]) < 0) return -1;
+    }
+
+#ifdef _WIN32
+    /* Windows cannot replace a file that is still mapped */
+    if (db->mapping && db->filename && strcmp(db->filename, filename) == 0) {
+        cdb_write_lock(db);
+        int status = 0;
+        for (size_t i = 0; i < db->num_columns && status == 0; i++) {
+            status = cdb_column_unmap(&db->columns[i]);
+        }
+        if (status == 0) cdb_unmap_file(db);
+        cdb_write_unlock(db);
+        if (status < 0) return -1;
+    }
+#endif
+
+    size_t dir_size = directory_size(db);
+    size_t name_len = strlen(filename);
+    cdb_save_plan_t* plans = (cdb_save_plan_t*)calloc(db->num_columns ? db->num_columns : 1, sizeof(cdb_save_plan_t));
+    uint8_t* directory = (uint8_t*)calloc(dir_size, 1);
+    size_t temp_size = name_len + 48;
+    char* temp = (char*)malloc(temp_size);
+    if (!plans || !directory || !temp) {
+        set_error("Failed to allocate save buffers");
+        free(plans);
+        free(directory);
+        free(temp);
+        return -1;
+    }
+    
+    int status = -1;
+    FILE* f = open_temp_file(filename, temp, temp_size);
+    if (!f) {
+        set_error("Failed to open file for writing");
+        goto done;
+    }
+    
+    uint32_t flags = 0;
+    uint64_t offset = dir_size;
+    if (write_columns(db, cdb_fileno(f), plans, codec, level, &offset, &flags) < 0) goto done;
+    
+    /* Footer, then the header and metadata over the space reserved for them */
+    uint8_t footer[CDB_FOOTER_SIZE];
+    uint32_t checksum = build_directory(db, plans, flags, CDB_MAGIC_HEADER, 0, offset + CDB_FOOTER_SIZE, directory);
+    build_footer(offset + CDB_FOOTER_SIZE, checksum, footer);
+    if (write_at(cdb_fileno(f), footer, sizeof(footer), offset) < 0 ||
+        write_at(cdb_fileno(f), directory, dir_size, 0) < 0 ||
+        sync_file(cdb_fileno(f)) != 0) {
+        set_error("Failed to write file");
+        goto done;
+    }
+    status = 0;
+
+done:
+    if (f && fclose(f) != 0 && status == 0) {
+        set_error("Failed to write file");
+        status = -1;
+    }
+    if (status == 0 && replace_file(temp, filename) < 0) {
+        set_error("Failed to replace file");
+        status = -1;
+    }
+    if (f && status < 0) remove(temp);
+    for (size_t i = 0; i < db->num_columns; i++) {
+        release_save_plan(&plans[i]);
+    }
+    free(plans);
+    free(directory);
+    free(temp);
+    cdb_stat_add(CDB_STAT_SAVES, 1);
+    cdb_stat_time(CDB_STAT_SAVE_NS, start);
+    return status;
+}
+
+/* Whether db has the file's columns, in the file's order */
+static int same_schema(const cdb_database_t* db, const cdb_file_directory_t* dir) {
+    if (db->num_columns != dir->num_columns) return 0;
+    for (size_t i = 0; i < db->num_columns; i++) {
+        if (db->columns[i].data_type != dir->columns[i].data_type ||
+            strcmp(db->columns[i].name, dir->columns[i].name) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Write every row of part as a new segment of the file: its column
+ * sections, its directory and a footer go past the committed end, then one
+ * small write of the segment link in the header commits them. base is
+ * updated to match the header. */
+static int write_segment(cdb_database_t* part, FILE* f, cdb_file_directory_t* base, uint64_t file_rows,
+                         cdb_compression_t codec, int level) {
+    size_t dir_size = directory_size(part);
+    cdb_save_plan_t* plans = (cdb_save_plan_t*)calloc(part->num_columns ? part->num_columns : 1, sizeof(cdb_save_plan_t));
+    uint8_t* directory = (uint8_t*)calloc(dir_size, 1);
+    int fd = cdb_fileno(f);
+    int status = -1;
+    if (!plans || !directory) {
+        set_error("Failed to allocate save buffers");
+        goto done;
+    }
+    
+    uint32_t flags = 0;
+    uint64_t offset = base->committed_size;
+    if (write_columns(part, fd, plans, codec, level, &offset, &flags) < 0) goto done;
+    
+    uint64_t dir_offset = (offset + 7) & ~(uint64_t)7;
+    uint64_t file_size = dir_offset + dir_size + CDB_FOOTER_SIZE;
+    uint8_t footer[CDB_FOOTER_SIZE];
+    uint8_t link[CDB_SEGMENT_LINK_SIZE];
+    uint32_t checksum = build_directory(part, plans, flags, CDB_MAGIC_SEGMENT, base->segment_link, file_rows,
+                                        directory);
+    build_footer(file_size, checksum, footer);
+    put_bytes(put_bytes(link, &dir_offset, sizeof(uint64_t)), &file_size, sizeof(uint64_t));
+    
+    /* The segment must be on disk before the link that publishes it */
+    if (write_at(fd, directory, dir_size, dir_offset) < 0 ||
+        write_at(fd, footer, sizeof(footer), dir_offset + dir_size) < 0 ||
+        sync_file(fd) != 0 ||
+        write_at(fd, link, sizeof(link), CDB_HEADER_SIZE) < 0 ||
+        sync_file(fd) != 0) {
+        set_error("Failed to write file");
+        goto done;
+    }
+    base->segment_link = dir_offset;
+    base->committed_size = file_size;
+    status = 0;
+
+done:
+    for (size_t i = 0; plans && i < part->num_columns; i++) {
+        release_save_plan(&plans[i]);
+    }
+    free(plans);
+    free(directory);
+    return status;
+}
+
+/* Write the rows the file lacks as a new segment */
+static int append_segment(cdb_database_t* db, FILE* f, cdb_file_directory_t* base, uint64_t file_rows,
+                          cdb_compression_t codec, int level) {
+    size_t num_rows = cdb_get_num_rows(db);
+    for (size_t i = 0; i < db->num_columns; i++) {
+        if (db->columns[i].num_rows != num_rows) {
+            set_error("Every column must have the same number of rows to append");
+            return -1;
+        }
+    }
+    if (num_rows < file_rows) {
+        set_error("Database has fewer rows than the file");
+        return -1;
+    }
+    if (num_rows == file_rows) return 0;
+    if (num_rows > UINT32_MAX) {
+        set_error("Too many rows for a CDB file");
+        return -1;
+    }
+    
+    /* Copy the new rows into a database of their own and save that */
+    cdb_database_t* part = cdb_create_database();
+    cdb_selection_t sel = {NULL, num_rows};
+    sel.words = (uint64_t*)calloc((num_rows + 63) / 64, sizeof(uint64_t));
+    if (!part || !sel.words) {
+        set_error("Failed to allocate segment");
+        cdb_free_database(part);
+        free(sel.words);
+        return -1;
+    }
+    for (size_t row = (size_t)file_rows; row < num_rows; row++) {
+        sel.words[row / 64] |= (uint64_t)1 << (row % 64);
+    }
+    part->row_group_rows = db->row_group_rows;
+    part->encode_columns = db->encode_columns;
+    part->num_threads = db->num_threads;
+    int status = cdb_filter(db, &sel, NULL, 0, part);
+    free(sel.words);
+    if (status == 0) status = write_segment(part, f, base, file_rows, codec, level);
+    cdb_free_database(part);
+    return status;
+}
+
+/* Append with a block codec for the new segment only */
+int cdb_save_append_with_codec(cdb_database_t* db, const char* filename, cdb_compression_t codec, int level) {
+    if (!db || !filename) {
+        set_error("Invalid database or filename");
+        return -1;
+    }
+    if (cdb_check_compression(codec, level) < 0) return -1;
+    
+    /* A missing file, or one from before segments, is written in full */
+    uint64_t start = cdb_stat_start();
+    FILE* f = fopen(filename, "r+b");
+    if (!f) return cdb_save_with_codec(db, filename, codec, level);
+    cdb_file_directory_t dir;
+    if (read_directory(f, &dir) < 0) {
+        fclose(f);
+        return -1;
+    }
+    if (dir.version < CDB_SEGMENT_VERSION) {
+        free_directory(&dir);
+        fclose(f);
+        return cdb_save_with_codec(db, filename, codec, level);
+    }
+    
+    cdb_file_segments_t segs;
+    int status = read_segments(f, &dir, &segs);
+    if (status == 0) {
+        if (!same_schema(db, &dir)) {
+            set_error("Database columns do not match the file");
+            status = -1;
+        }
+        for (size_t i = 0; status == 0 && i < db->num_columns; i++) {
+            status = cdb_column_ensure_loaded(db, &db->columns[i]);
+        }
+        if (status == 0) status = append_segment(db, f, &dir, segs.num_rows, codec, level);
+        free_segments(&segs);
+    }
+    free_directory(&dir);
+    if (fclose(f) != 0 && status == 0) {
+        set_error("Failed to write file");
+        status = -1;
+    }
+    cdb_stat_add(CDB_STAT_SAVES, 1);
+    cdb_stat_time(CDB_STAT_SAVE_NS, start);
+    return status;
+}
+
+/* Append the rows added since the file was saved or loaded */
+int cdb_save_append(cdb_database_t* db, const char* filename) {
+    if (!db) {
+        set_error("Invalid database or filename");
+        return -1;
+    }
+    return cdb_save_append_with_codec(db, filename, db->compression, db->compression_level);
+}
+
+/* Merge a file's segments: load it whole and write it again in one piece */
+int cdb_compact(const char* filename, cdb_compression_t codec, int level) {
+    if (cdb_check_compression(codec, level) < 0) return -1;
+    cdb_database_t* db = cdb_create_database();
+    if (!db) return -1;
+    int status = cdb_load_from(db, filename);
+    if (status == 0) status = cdb_save_with_codec(db, filename, codec, level);
+    cdb_free_database(db);
+    return status;
+}
+
+struct cdb_writer {
+    char* filename;
+    cdb_database_t* buffer;     /* Rows not written yet */
+    size_t flush_rows;
+    cdb_compression_t codec;
+    int level;
+    FILE* f;                    /* Open once the base is written */
+    cdb_file_directory_t base;
+    uint64_t file_rows;         /* Rows written to the file */
+};
+
+/* Drop a buffered column's rows from rows on */
+static void truncate_column(cdb_column_t* col, size_t rows) {
+    if (rows >= col->num_rows) return;
+    if (rows % 8) col->null_bitmap[rows / 8] &= (uint8_t)((1u << (rows % 8)) - 1);
+    memset(col->null_bitmap + (rows + 7) / 8, 0, (col->num_rows + 7) / 8 - (rows + 7) / 8);
+    if (col->data_type == CDB_TYPE_STRING) {
+        col->string_data_size = (size_t)((const uint64_t*)col->data)[rows];
+    }
+    col->num_rows = rows;
+    col->null_count = cdb_count_nulls(col->null_bitmap, rows);
+}
+
+/* Empty the buffer for the next rows, keeping its memory. Dictionaries
+ * start over too, so each part of the file only holds its own values. */
+static void clear_buffer(cdb_database_t* buffer) {
+    for (size_t i = 0; i < buffer->num_columns; i++) {
+        cdb_column_t* col = &buffer->columns[i];
+        truncate_column(col, 0);
+        if (col->data_type == CDB_TYPE_DICT_STRING) {
+            free(col->dict_index);
+            col->dict_index = NULL;
+            col->dict_index_capacity = 0;
+            col->dict_size = 0;
+            col->string_data_size = 0;
+        }
+    }
+}
+
+/* Write the buffered rows: the first ones as the base of the file (also
+ * when there are none, so closing always leaves a file), later ones as
+ * segments. Each write commits on its own. */
+static int writer_flush(cdb_writer_t* writer, int force) {
+    size_t rows = cdb_get_num_rows(writer->buffer);
+    if (rows == 0 && (writer->f || !force)) return 0;
+    if (writer->file_rows + rows > UINT32_MAX) {
+        set_error("Too many rows for a CDB file");
+        return -1;
+    }
+    
+    if (writer->f) {
+        if (write_segment(writer->buffer, writer->f, &writer->base, writer->file_rows,
+                          writer->codec, writer->level) < 0) {
+            return -1;
+        }
+    } else {
+        if (cdb_save_with_codec(writer->buffer, writer->filename, writer->codec, writer->level) < 0) return -1;
+        writer->f = fopen(writer->filename, "r+b");
+        if (!writer->f) {
+            set_error("Failed to open file for writing");
+            return -1;
+        }
+        if (read_directory(writer->f, &writer->base) < 0) {
+            fclose(writer->f);
+            writer->f = NULL;
+            return -1;
+        }
+    }
+    writer->file_rows += rows;
+    clear_buffer(writer->buffer);
+    return 0;
+}
+
+/* Start a file with the columns and save settings of schema */
+cdb_writer_t* cdb_writer_open_with_codec(const char* filename, cdb_database_t* schema, size_t flush_rows,
+                                         cdb_compression_t codec, int level) {
+    if (!filename || !schema) {
+        set_error("Invalid filename or schema");
+        return NULL;
+    }
+    if (cdb_check_compression(codec, level) < 0) return NULL;
+    
+    cdb_writer_t* writer = (cdb_writer_t*)calloc(1, sizeof(cdb_writer_t));
+    if (!writer) {
+        set_error("Failed to allocate writer");
+        return NULL;
+    }
+    writer->flush_rows = flush_rows ? flush_rows : CDB_DEFAULT_FLUSH_ROWS;
+    writer->codec = codec;
+    writer->level = level;
+    writer->filename = (char*)malloc(strlen(filename) + 1);
+    writer->buffer = cdb_create_database();
+    if (!writer->filename || !writer->buffer) {
+        set_error("Failed to allocate writer");
+        cdb_writer_abort(writer);
+        return NULL;
+    }
+    memcpy(writer->filename, filename, strlen(filename) + 1);
+    
+    cdb_read_lock(schema);
+    writer->buffer->row_group_rows = schema->row_group_rows;
+    writer->buffer->encode_columns = schema->encode_columns;
+    writer->buffer->num_threads = schema->num_threads;
+    int status = 0;
+    for (size_t i = 0; status == 0 && i < schema->num_columns; i++) {
+        status = cdb_add_column(writer->buffer, schema->columns[i].name, schema->columns[i].data_type);
+    }
+    cdb_read_unlock(schema);
+    
+    /* One allocation per column for the whole buffer */
+    if (status == 0) status = cdb_reserve_all(writer->buffer, writer->flush_rows);
+    if (status < 0) {
+        cdb_writer_abort(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+cdb_writer_t* cdb_writer_open(const char* filename, cdb_database_t* schema, size_t flush_rows) {
+    if (!schema) {
+        set_error("Invalid filename or schema");
+        return NULL;
+    }
+    return cdb_writer_open_with_codec(filename, schema, flush_rows, schema->compression, schema->compression_level);
+}
+
+/* Buffer the rows of a batch with the writer's columns, writing them out
+ * once flush_rows rows are in. If that write fails the rows stay buffered
+ * for the next flush. */
+int cdb_writer_write(cdb_writer_t* writer, cdb_database_t* batch) {
+    if (!writer || !batch) {
+        set_error("Invalid writer or batch");
+        return -1;
+    }
+    cdb_database_t* buffer = writer->buffer;
+    size_t buffered = cdb_get_num_rows(buffer);
+    
+    cdb_read_lock(batch);
+    int status = 0;
+    if (batch->num_columns != buffer->num_columns) {
+        set_error("Batch columns do not match the writer's");
+        status = -1;
+    }
+    for (size_t i = 0; status == 0 && i < batch->num_columns; i++) {
+        if (batch->columns[i].data_type != buffer->columns[i].data_type ||
+            strcmp(batch->columns[i].name, buffer->columns[i].name) != 0) {
+            set_error("Batch columns do not match the writer's");
+            status = -1;
+        } else if (batch->columns[i].num_rows != batch->columns[0].num_rows) {
+            set_error("Every column must have the same number of rows to append");
+            status = -1;
+        }
+    }
+    for (size_t i = 0; status == 0 && i < batch->num_columns; i++) {
+        status = cdb_column_ensure_loaded(batch, &batch->columns[i]);
+        if (status == 0) status = cdb_append_column(buffer, i, &batch->columns[i]);
+    }
+    cdb_read_unlock(batch);
+    
+    /* A batch goes in whole or not at all */
+    if (status < 0) {
+        for (size_t i = 0; i < buffer->num_columns; i++) {
+            truncate_column(&buffer->columns[i], buffered);
+        }
+        return -1;
+    }
+    return cdb_get_num_rows(buffer) >= writer->flush_rows ? writer_flush(writer, 0) : 0;
+}
+
+/* Write the buffered rows now */
+int cdb_writer_flush(cdb_writer_t* writer) {
+    if (!writer) {
+        set_error("Invalid writer");
+        return -1;
+    }
+    return writer_flush(writer, 0);
+}
+
+/* Rows written to the file so far, not counting buffered ones */
+uint64_t cdb_writer_rows_written(const cdb_writer_t* writer) {
+    return writer ? writer->file_rows : 0;
+}
+
+/* Write the rest and release the writer */
+int cdb_writer_close(cdb_writer_t* writer) {
+    if (!writer) {
+        set_error("Invalid writer");
+        return -1;
+    }
+    int status = writer_flush(writer, 1);
+    if (writer->f && fclose(writer->f) != 0 && status == 0) {
+        set_error("Failed to write file");
+        status = -1;
+    }
+    writer->f = NULL;
+    cdb_writer_abort(writer);
+    return status;
+}
+
+/* Release the writer without writing the buffered rows */
+void cdb_writer_abort(cdb_writer_t* writer) {
+    if (!writer) return;
+    if (writer->f) fclose(writer->f);
+    free_directory(&writer->base);
+    cdb_free_database(writer->buffer);
+    free(writer->filename);
+    free(writer);
+}
+
+/* Read one column's data and null bitmap from its file section;
+ * load_file_columns has already reserved num_rows rows */
+#define CDB_READ_CHUNK_SIZE (1 << 20)  /* Bytes read per call while checksumming */
+
+/* read_at that adds the bytes to *crc (when crc is set) a chunk at a time,
+ * while they are still in cache */
+static int read_checked(int fd, void* buf, size_t size, uint64_t offset, uint32_t* crc) {
+    if (!crc) return read_at(fd, buf, size, offset);
+    uint8_t* p = (uint8_t*)buf;
+    while (size > 0) {
+        size_t n = size < CDB_READ_CHUNK_SIZE ? size : CDB_READ_CHUNK_SIZE;
+        if (read_at(fd, p, n, offset) < 0) return -1;
+        *crc = cdb_crc32c(*crc, p, n);
+        p += n;
+        offset += n;
+        size -= n;
+    }
+    return 0;
+}
+
+/* The stored blocks of a mapped or unloaded column, once, against its checksum */
+static int verify_column(cdb_column_t* col, const uint8_t* stored) {
+    if (!col->file_unverified) return 0;
+    if (cdb_crc32c(0, stored, (size_t)(col->file_stored_size + col->file_stored_bitmap)) != col->file_checksum) {
+        set_error("Column checksum mismatch");
+        return -1;
+    }
+    col->file_unverified = 0;
+    return 0;
+}
+
+static int read_column(int fd, cdb_column_t* col, const cdb_file_column_t* entry, size_t num_rows) {
+    uint64_t offset = entry->data_offset;
+    uint8_t* encoded = NULL;
+    uint32_t crc = 0;
+    uint32_t* check = entry->has_checksum ? &crc : NULL;
+    if (cdb_encoding_is_chunked(entry->encoding)) {
+        /* Read the encoded section; it is decoded once the null bitmap is in */
+        encoded = (uint8_t*)malloc((size_t)entry->data_size);
+        if (!encoded) {
+            set_error("Failed to allocate column buffer");
+            return -1;
+        }
+        if (read_checked(fd, encoded, (size_t)entry->data_size, offset, check) < 0) {
+            free(encoded);
+            set_error("Truncated column data");
+            return -1;
+        }
+    } else if (entry->encoding == CDB_FILE_ENCODING_LENGTH_PREFIXED) {
+        /* Read the whole section once, then split it into strings */
+        uint8_t* bytes = (uint8_t*)malloc(entry->data_size ? (size_t)entry->data_size : 1);
+        if (!bytes) {
+            set_error("Failed to allocate string buffer");
+            return -1;
+        }
+        if (read_at(fd, bytes, (size_t)entry->data_size, offset) < 0) {
+            free(bytes);
+            set_error("Truncated column data");
+            return -1;
+        }
+        int status = decode_length_prefixed(col, bytes, entry->data_size, num_rows);
+        free(bytes);
+        if (status < 0) return -1;
+    } else if (col->data_type == CDB_TYPE_STRING) {
+        /* Offsets straight into the offsets array, bytes straight into the arena */
+        size_t offsets_size = (num_rows + 1) * sizeof(uint64_t);
+        size_t byte_size = (size_t)entry->data_size - offsets_size;
+        if (read_checked(fd, col->data, offsets_size, offset, check) < 0 ||
+            cdb_string_reserve(col, byte_size) < 0 ||
+            read_checked(fd, col->string_data, byte_size, offset + offsets_size, check) < 0) {
+            set_error("Truncated column data");
+            return -1;
+        }
+        if (validate_offsets((const uint64_t*)col->data, num_rows, byte_size) < 0) return -1;
+        col->string_data_size = byte_size;
+    } else if (col->data_type == CDB_TYPE_DICT_STRING) {
+        /* Codes straight into the column, then the (small) dictionary */
+        uint64_t codes_size = dict_codes_size(num_rows);
+        uint64_t tail_size = entry->data_size - codes_size;
+        uint8_t* tail = (uint8_t*)malloc((size_t)tail_size);
+        if (!tail) {
+            set_error("Failed to allocate dictionary buffer");
+            return -1;
+        }
+        /* The checksum also covers the padding after the codes */
+        uint8_t padding[sizeof(uint64_t)];
+        size_t padding_size = (size_t)(codes_size - num_rows * sizeof(uint32_t));
+        int status = -1;
+        if (read_checked(fd, col->data, num_rows * sizeof(uint32_t), offset, check) < 0 ||
+            (check && read_checked(fd, padding, padding_size, offset + num_rows * sizeof(uint32_t), check) < 0) ||
+            read_checked(fd, tail, (size_t)tail_size, offset + codes_size, check) < 0) {
+            set_error("Truncated column data");
+        } else {
+            status = load_dictionary(col, tail, tail_size);
+        }
+        free(tail);
+        if (status < 0) return -1;
+    } else if (read_checked(fd, col->data, (size_t)entry->data_size, offset, check) < 0) {
+        set_error("Truncated column data");
+        return -1;
+    }
+    
+    /* Read null bitmap */
+    if (read_checked(fd, col->null_bitmap, (size_t)entry->null_bitmap_size, offset + entry->data_size, check) < 0) {
+        free(encoded);
+        set_error("Truncated null bitmap");
+        return -1;
+    }
+    if (check && crc != entry->checksum) {
+        free(encoded);
+        set_error("Column checksum mismatch");
+        return -1;
+    }
+    col->null_count = entry->null_count != CDB_NULL_COUNT_UNKNOWN
+        ? (size_t)entry->null_count
+        : cdb_count_nulls(col->null_bitmap, num_rows);
+    
+    if (encoded) {
+        int status = cdb_decode_column(entry->encoding, col->data_type, encoded, entry->data_size,
+                                       num_rows, (size_t)entry->row_group_rows,
+                                       col->null_count ? col->null_bitmap : NULL, col->data);
+        free(encoded);
+        if (status < 0) return -1;
+    }
+    
+    /* Set row count */
+    col->num_rows = num_rows;
+    return 0;
+}
+
+/* Find a column's metadata entry by name */
+static const cdb_file_column_t* find_file_column(const cdb_file_directory_t* dir, const char* name) {
+    for (uint32_t i = 0; i < dir->num_columns; i++) {
+        if (strcmp(dir->columns[i].name, name) == 0) {
+            return &dir->columns[i];
+        }
+    }
+    return NULL;
+}
+
+/* Resolve the requested columns (all of them when names is NULL) against the directory */
+static const cdb_file_column_t** select_file_columns(const cdb_file_directory_t* dir,
+                                                      const char* const* names, size_t* count) {
+    size_t n = names ? *count : dir->num_columns;
+    const cdb_file_column_t** selected =
+        (const cdb_file_column_t**)malloc((n ? n : 1) * sizeof(cdb_file_column_t*));
+    if (!selected) {
+        set_error("Failed to allocate column selection");
+        return NULL;
+    }
+    
+    for (size_t i = 0; i < n; i++) {
+        selected[i] = names ? find_file_column(dir, names[i]) : &dir->columns[i];
+        if (!selected[i]) {
+            set_error("Column not found in file");
+            free(selected);
+            return NULL;
+        }
+    }
+    
+    *count = n;
+    return selected;
+}
+
+static int materialize_stored_column(cdb_column_t* col, const uint8_t* stored_data,
+                                     const uint8_t* stored_bitmap);
+
+/* Register a compressed column, still unloaded; its blocks are read by a load task */
+static cdb_column_t* add_compressed_column(cdb_database_t* db, const cdb_file_column_t* entry, size_t num_rows) {
+    cdb_column_t* col = cdb_add_column_deferred(db, entry->name, entry->data_type);
+    if (!col) return NULL;
+    col->num_rows = num_rows;
+    col->null_count = (size_t)entry->null_count;
+    col->file_encoding = (uint8_t)entry->encoding;
+    col->file_offset = entry->data_offset;
+    col->file_data_size = entry->data_size;
+    col->file_group_rows = (size_t)entry->row_group_rows;
+    col->file_compression = (uint8_t)entry->compression;
+    col->file_stored_size = entry->stored_data_size;
+    col->file_stored_bitmap = entry->stored_bitmap_size;
+    col->file_checksum = entry->checksum;
+    col->file_unverified = (uint8_t)entry->has_checksum;
+    col->storage = CDB_STORAGE_UNLOADED;
+    return col;
+}
+
+/* Read a compressed column's stored blocks and decompress them into the column */
+static int read_compressed_column(int fd, cdb_column_t* col) {
+    uint64_t stored_size = col->file_stored_size + col->file_stored_bitmap;
+    uint8_t* stored = (uint8_t*)malloc(stored_size ? (size_t)stored_size : 1);
+    if (!stored) {
+        set_error("Failed to allocate column buffer");
+        return -1;
+    }
+    uint32_t crc = 0;
+    int status = -1;
+    if (read_checked(fd, stored, (size_t)stored_size, col->file_offset, col->file_unverified ? &crc : NULL) < 0) {
+        set_error("Truncated column data");
+    } else if (col->file_unverified && crc != col->file_checksum) {
+        set_error("Column checksum mismatch");
+    } else {
+        col->file_unverified = 0;
+        status = materialize_stored_column(col, stored, stored + col->file_stored_size);
+    }
+    free(stored);
+    return status;
+}
+
+/* Give a loaded column the index saved with it, from the mapping if there is one */
+static int read_column_index(int fd, const uint8_t* mapping, size_t mapping_size,
+                             cdb_column_t* col, const cdb_file_column_t* entry) {
+    col->index_kind = (uint8_t)entry->index_kind;
+    if (entry->index_kind == CDB_INDEX_NONE) return 0;
+    
+    uint64_t* block = (uint64_t*)malloc((size_t)entry->index_size);
+    if (!block) {
+        set_error("Failed to allocate column index");
+        return -1;
+    }
+    if (mapping) {
+        if (entry->index_offset > mapping_size || entry->index_size > mapping_size - entry->index_offset) {
+            free(block);
+            set_error("Column index extends past end of file");
+            return -1;
+        }
+        memcpy(block, mapping + entry->index_offset, (size_t)entry->index_size);
+    } else if (read_at(fd, block, (size_t)entry->index_size, entry->index_offset) < 0) {
+        free(block);
+        set_error("Truncated column index");
+        return -1;
+    }
+    col->index = cdb_index_load(block, (size_t)entry->index_size, col);
+    return col->index ? 0 : -1;
+}
+
+/* The columns of one load; each is read and decoded by its own pool task */
+typedef struct {
+    cdb_database_t* db;
+    int fd;
+    size_t num_rows;
+    size_t first_column;                  /* Database index of the first loaded column */
+    const cdb_file_column_t** entries;
+} cdb_load_t;
+
+static int run_load_task(void* ctx, size_t index) {
+    cdb_load_t* load = (cdb_load_t*)ctx;
+    cdb_column_t* col = &load->db->columns[load->first_column + index];
+    int status = col->storage == CDB_STORAGE_UNLOADED
+        ? read_compressed_column(load->fd, col)
+        : read_column(load->fd, col, load->entries[index], load->num_rows);
+    if (status == 0) {
+        col->sorted = load->entries[index]->sorted;
+        status = read_column_index(load->fd, NULL, 0, col, load->entries[index]);
+    }
+    return status;
+}
+
+/* Load the selected columns of one directory into db: register them all,
+ * then read, decompress and decode them concurrently with positional reads */
+static int load_directory_columns(cdb_database_t* db, int fd, const cdb_file_directory_t* dir,
+                                  const cdb_file_column_t** selected, size_t num_names) {
+    cdb_load_t load = {db, fd, dir->num_rows, db->num_columns, selected};
+    int status = 0;
+    for (size_t i = 0; status == 0 && i < num_names; i++) {
+        const cdb_file_column_t* entry = selected[i];
+        if (entry->compression != CDB_COMPRESSION_NONE) {
+            if (!add_compressed_column(db, entry, dir->num_rows)) status = -1;
+        } else if (cdb_add_column(db, entry->name, entry->data_type) < 0) {
+            status = -1;
+        }
+    }
+    
+    /* The header has the row count: allocate every column once, up front.
+     * Column pointers are stable once every column has been added. */
+    if (status == 0) {
+        status = cdb_reserve_columns(db, load.first_column, dir->num_rows);
+    }
+    if (status == 0) {
+        cdb_thread_pool_t* pool = cdb_pool_create(pool_threads(db, num_names));
+        status = cdb_pool_run(pool, num_names, run_load_task, &load);
+        cdb_pool_destroy(pool);
+    }
+    
+    /* Nothing backs an unloaded column without a mapping; leave failed ones empty */
+    for (size_t i = load.first_column; i < db->num_columns; i++) {
+        cdb_column_t* col = &db->columns[i];
+        if (col->storage == CDB_STORAGE_UNLOADED) {
+            col->storage = CDB_STORAGE_HEAP;
+            col->num_rows = 0;
+            col->null_count = 0;
+        }
+    }
+    return status;
+}
+
+/* Append the rows of every segment of a file to the columns loaded from its
+ * base, which start at first_column: each segment is loaded on its own,
+ * then copied over */
+static int load_segments(cdb_database_t* db, FILE* f, const cdb_file_directory_t* base,
+                         const char* const* names, size_t num_names, size_t first_column) {
+    if (base->segment_link == 0) return 0;
+    
+    cdb_file_segments_t segs;
+    if (read_segments(f, base, &segs) < 0) return -1;
+    int status = 0;
+    for (size_t s = 0; status == 0 && s < segs.count; s++) {
+        size_t count = num_names;
+        const cdb_file_column_t** selected = select_file_columns(&segs.dirs[s], names, &count);
+        cdb_database_t* part = selected ? cdb_create_database() : NULL;
+        status = part ? 0 : -1;
+        if (status == 0) {
+            part->num_threads = db->num_threads;
+            status = load_directory_columns(part, cdb_fileno(f), &segs.dirs[s], selected, count);
+        }
+        for (size_t i = 0; status == 0 && i < count; i++) {
+            status = cdb_append_column(db, first_column + i, &part->columns[i]);
+        }
+        cdb_free_database(part);
+        free(selected);
+    }
+    free_segments(&segs);
+    return status;
+}
+
+/* Load the selected columns of a file: its base, then its segments */
+static int load_file_columns(cdb_database_t* db, const char* filename,
+                             const char* const* names, size_t num_names) {
+    if (!db || !filename || (!names && num_names > 0)) {
+        set_error("Invalid database or filename");
+        return -1;
+    }
+    
+    uint64_t start = cdb_stat_start();
+    FILE* f = fopen(filename, "rb");
+    if (!f) {
+        set_error("Failed to open file for reading");
+        return -1;
+    }
+    
+    cdb_file_directory_t dir;
+    if (read_directory(f, &dir) < 0) {
+        fclose(f);
+        return -1;
+    }
+    
+    /* Resolve every name first so a bad request loads nothing */
+    const cdb_file_column_t** selected = select_file_columns(&dir, names, &num_names);
+    if (!selected) {
+        free_directory(&dir);
+        fclose(f);
+        return -1;
+    }
+    
+    size_t first_column = db->num_columns;
+    int status = load_directory_columns(db, cdb_fileno(f), &dir, selected, num_names);
+    if (status == 0) status = load_segments(db, f, &dir, names, num_names, first_column);
+    
+    free(selected);
+    free_directory(&dir);
+    fclose(f);
+    cdb_stat_add(CDB_STAT_LOADS, 1);
+    cdb_stat_time(CDB_STAT_LOAD_NS, start);
+    return status;
+}
+
+/* Load database from file */
+int cdb_load_from(cdb_database_t* db, const char* filename) {
+    cdb_write_lock(db);
+    int status = load_file_columns(db, filename, NULL, 0);
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Load only the named columns from file */
+int cdb_load_columns(cdb_database_t* db, const char* filename,
+                     const char* const* names, size_t num_names) {
+    if (!names) {
+        set_error("Invalid column names");
+        return -1;
+    }
+    cdb_write_lock(db);
+    int status = load_file_columns(db, filename, names, num_names);
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Map a whole file read-only */
+static int map_file(const char* filename, void** base, size_t* size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return -1;
+    
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return -1;
+    }
+    
+    /* The view keeps the mapping alive once both handles are closed */
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return -1;
+    
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view) return -1;
+    
+    *base = view;
+    *size = (size_t)file_size.QuadPart;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    
+    void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return -1;
+    
+    *base = view;
+    *size = (size_t)st.st_size;
+#endif
+    return 0;
+}
+
+/* Release the database's file mapping */
+void cdb_unmap_file(cdb_database_t* db) {
+    if (!db || !db->mapping) return;
+#ifdef _WIN32
+    UnmapViewOfFile(db->mapping);
+#else
+    munmap(db->mapping, db->mapping_size);
+#endif
+    db->mapping = NULL;
+    db->mapping_size = 0;
+}
+
+/* Open a file by mapping it: fixed-width columns point into the mapping,
+ * everything else is materialized on first access */
+static int map_file_columns(cdb_database_t* db, const char* filename,
+                            const char* const* names, size_t num_names) {
+    if (!db || !filename || (!names && num_names > 0)) {
+        set_error("Invalid database or filename");
+        return -1;
+    }
+    if (db->mapping) {
+        set_error("Database already has a mapped file");
+        return -1;
+    }
+    
+    uint64_t start = cdb_stat_start();
+    FILE* f = fopen(filename, "rb");
+    if (!f) {
+        set_error("Failed to open file for reading");
+        return -1;
+    }
+    
+    cdb_file_directory_t dir;
+    int status = read_directory(f, &dir);
+    fclose(f);
+    if (status < 0) return -1;
+    
+    const cdb_file_column_t** selected = select_file_columns(&dir, names, &num_names);
+    if (!selected) {
+        free_directory(&dir);
+        return -1;
+    }
+    
+    void* base;
+    size_t size;
+    if (map_file(filename, &base, &size) < 0) {
+        set_error("Failed to map file");
+        free(selected);
+        free_directory(&dir);
+        return -1;
+    }
+    
+    for (size_t i = 0; i < num_names; i++) {
+        const cdb_file_column_t* entry = selected[i];
+        if (entry->data_offset > size ||
+            entry->stored_data_size + entry->stored_bitmap_size > size - entry->data_offset) {
+            set_error("Column data extends past end of file");
+            goto fail;
+        }
+    }
+    
+    db->mapping = base;
+    db->mapping_size = size;
+    db->filename = (char*)malloc(strlen(filename) + 1);
+    if (db->filename) memcpy(db->filename, filename, strlen(filename) + 1);
+    
+    size_t first_column = db->num_columns;
+    for (size_t i = 0; i < num_names; i++) {
+        const cdb_file_column_t* entry = selected[i];
+        
+        if (dir.num_rows == 0) {
+            if (cdb_add_column(db, entry->name, entry->data_type) < 0 ||
+                read_column_index(-1, (const uint8_t*)base, size, &db->columns[db->num_columns - 1], entry) < 0) {
+                goto fail_mapped;
+            }
+            continue;
+        }
+        
+        cdb_column_t* col = cdb_add_column_deferred(db, entry->name, entry->data_type);
+        if (!col) goto fail_mapped;
+        
+        col->num_rows = dir.num_rows;
+        col->null_count = entry->null_count != CDB_NULL_COUNT_UNKNOWN
+            ? (size_t)entry->null_count
+            : cdb_count_nulls((const uint8_t*)base + entry->data_offset + entry->data_size, dir.num_rows);
+        col->file_encoding = (uint8_t)entry->encoding;
+        col->file_offset = entry->data_offset;
+        col->file_data_size = entry->data_size;
+        col->file_group_rows = (size_t)entry->row_group_rows;
+        col->file_compression = (uint8_t)entry->compression;
+        col->file_stored_size = entry->stored_data_size;
+        col->file_stored_bitmap = entry->stored_bitmap_size;
+        col->file_checksum = entry->checksum;
+        col->file_unverified = (uint8_t)entry->has_checksum;
+        col->sorted = entry->sorted;
+        col->storage = CDB_STORAGE_UNLOADED;
+        if (read_column_index(-1, (const uint8_t*)base, size, col, entry) < 0) goto fail_mapped;
+        
+        /* Aligned plain data (values, string offsets, codes) is usable in place;
+         * compressed columns are decompressed on first access */
+        uint8_t* section = (uint8_t*)base + entry->data_offset;
+        size_t alignment = entry->data_type == CDB_TYPE_DICT_STRING
+            ? sizeof(uint64_t) : cdb_type_size(entry->data_type);
+        if (entry->encoding == CDB_FILE_ENCODING_PLAIN && entry->compression == CDB_COMPRESSION_NONE &&
+            entry->data_offset % alignment == 0) {
+            if (entry->data_type == CDB_TYPE_STRING) {
+                size_t offsets_size = (col->num_rows + 1) * sizeof(uint64_t);
+                const uint64_t* offsets = (const uint64_t*)section;
+                if (offsets[col->num_rows] != entry->data_size - offsets_size) {
+                    set_error("Corrupt string column offsets");
+                    goto fail_mapped;
+                }
+                col->string_data = (char*)section + offsets_size;
+                col->string_data_size = (size_t)(entry->data_size - offsets_size);
+            } else if (entry->data_type == CDB_TYPE_DICT_STRING) {
+                uint64_t codes_size = dict_codes_size(col->num_rows);
+                cdb_file_dictionary_t dict;
+                if (parse_dictionary(section + codes_size, entry->data_size - codes_size, &dict) < 0) {
+                    goto fail_mapped;
+                }
+                col->dict_offsets = (uint64_t*)dict.offsets;
+                col->dict_size = (size_t)dict.size;
+                col->dict_capacity = (size_t)dict.size;
+                col->string_data = (char*)dict.bytes;
+                col->string_data_size = (size_t)dict.byte_size;
+            }
+            col->data = section;
+            col->null_bitmap = section + entry->data_size;
+            col->capacity = col->num_rows;
+            col->storage = CDB_STORAGE_MAPPED;
+        }
+        col->file_pending = col->file_unverified || col->storage == CDB_STORAGE_UNLOADED;
+    }
+    
+    /* Rows of appended segments are read into the heap */
+    if (dir.segment_link) {
+        f = fopen(filename, "rb");
+        status = f ? load_segments(db, f, &dir, names, num_names, first_column) : -1;
+        if (!f) set_error("Failed to open file for reading");
+        if (f) fclose(f);
+        if (status < 0) goto fail_mapped;
+    }
+    
+    free(selected);
+    free_directory(&dir);
+    cdb_stat_add(CDB_STAT_LOADS, 1);
+    cdb_stat_time(CDB_STAT_LOAD_NS, start);
+    return 0;
+
+fail:
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+#else
+    munmap(base, size);
+#endif
+fail_mapped:
+    free(selected);
+    free_directory(&dir);
+    return -1;
+}
+
+/* Memory-map a database file */
+int cdb_open_mmap(cdb_database_t* db, const char* filename) {
+    cdb_write_lock(db);
+    int status = map_file_columns(db, filename, NULL, 0);
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Memory-map only the named columns */
+int cdb_open_mmap_columns(cdb_database_t* db, const char* filename,
+                          const char* const* names, size_t num_names) {
+    if (!names) {
+        set_error("Invalid column names");
+        return -1;
+    }
+    cdb_write_lock(db);
+    int status = map_file_columns(db, filename, names, num_names);
+    cdb_write_unlock(db);
+    return status;
+}
+
+/* Build owned storage for an unloaded column from its plain data section and null bitmap */
+static int materialize_column(cdb_column_t* col, const uint8_t* bytes, const uint8_t* bitmap) {
+    size_t num_rows = col->num_rows;
+    
+    /* Build owned storage through the normal growth path */
+    col->storage = CDB_STORAGE_HEAP;
+    col->capacity = 0;
+    col->num_rows = 0;
+    if (cdb_column_reserve(col, num_rows) < 0) goto fail;
+    
+    if (cdb_encoding_is_chunked((cdb_file_encoding_t)col->file_encoding)) {
+        if (cdb_decode_column((cdb_file_encoding_t)col->file_encoding, col->data_type, bytes,
+                              col->file_data_size, num_rows, col->file_group_rows,
+                              col->null_count ? bitmap : NULL, col->data) < 0) {
+            goto fail;
+        }
+    } else if (col->file_encoding == CDB_FILE_ENCODING_LENGTH_PREFIXED) {
+        if (decode_length_prefixed(col, bytes, col->file_data_size, num_rows) < 0) goto fail;
+    } else if (col->data_type == CDB_TYPE_STRING) {
+        size_t offsets_size = (num_rows + 1) * sizeof(uint64_t);
+        size_t byte_size = (size_t)col->file_data_size - offsets_size;
+        memcpy(col->data, bytes, offsets_size);
+        if (validate_offsets((const uint64_t*)col->data, num_rows, byte_size) < 0 ||
+            cdb_string_reserve(col, byte_size) < 0) {
+            goto fail;
+        }
+        memcpy(col->string_data, bytes + offsets_size, byte_size);
+        col->string_data_size = byte_size;
+    } else if (col->data_type == CDB_TYPE_DICT_STRING) {
+        /* The dictionary may be misaligned in the mapping; parse an aligned copy */
+        uint64_t codes_size = dict_codes_size(num_rows);
+        uint64_t tail_size = col->file_data_size - codes_size;
+        uint8_t* tail = (uint8_t*)malloc((size_t)tail_size);
+        if (!tail) {
+            set_error("Failed to allocate dictionary buffer");
+            goto fail;
+        }
+        memcpy(col->data, bytes, num_rows * sizeof(uint32_t));
+        memcpy(tail, bytes + codes_size, (size_t)tail_size);
+        int status = load_dictionary(col, tail, tail_size);
+        free(tail);
+        if (status < 0) goto fail;
+    } else {
+        memcpy(col->data, bytes, (size_t)col->file_data_size);
+    }
+    memcpy(col->null_bitmap, bitmap, (num_rows + 7) / 8);
+    
+    col->num_rows = num_rows;
+    return 0;
+
+fail:
+    cdb_data_free(col->data);
+    free(col->null_bitmap);
+    free(col->string_data);
+    free(col->dict_offsets);
+    col->data = NULL;
+    col->null_bitmap = NULL;
+    col->string_data = NULL;
+    col->string_data_size = 0;
+    col->string_data_capacity = 0;
+    col->dict_offsets = NULL;
+    col->dict_size = 0;
+    col->dict_capacity = 0;
+    col->capacity = 0;
+    col->num_rows = num_rows;
+    col->storage = CDB_STORAGE_UNLOADED;
+    return -1;
+}
+
+/* Plain bytes of a stored block: the block itself when it was kept uncompressed
+ * (stored at its plain size), otherwise a decompressed copy returned in *owned */
+static const uint8_t* expand_block(cdb_compression_t codec, const uint8_t* stored, uint64_t stored_size,
+                                   uint64_t size, uint8_t** owned) {
+    *owned = NULL;
+    if (codec == CDB_COMPRESSION_NONE || stored_size == size) return stored;
+    
+    *owned = (uint8_t*)malloc(size ? (size_t)size : 1);
+    if (!*owned) {
+        set_error("Failed to allocate decompression buffer");
+        return NULL;
+    }
+    if (cdb_decompress_block(codec, stored, stored_size, *owned, size) < 0) {
+        free(*owned);
+        *owned = NULL;
+        return NULL;
+    }
+    return *owned;
+}
+
+/* Decompress an unloaded column's stored blocks and build its storage from them */
+static int materialize_stored_column(cdb_column_t* col, const uint8_t* stored_data, const uint8_t* stored_bitmap) {
+    cdb_compression_t codec = (cdb_compression_t)col->file_compression;
+    uint8_t* data_owned = NULL;
+    uint8_t* bitmap_owned = NULL;
+    int status = -1;
+    
+    const uint8_t* data = expand_block(codec, stored_data, col->file_stored_size, col->file_data_size, &data_owned);
+    const uint8_t* bitmap = data
+        ? expand_block(codec, stored_bitmap, col->file_stored_bitmap, (col->num_rows + 7) / 8, &bitmap_owned)
+        : NULL;
+    if (bitmap) status = materialize_column(col, data, bitmap);
+    
+    free(data_owned);
+    free(bitmap_owned);
+    return status;
+}
+
+/* Materialize an unloaded column from the file mapping */
+int cdb_column_ensure_loaded(cdb_database_t* db, cdb_column_t* col) {
+    if (!col || !db->mapping || !CDB_LOAD_ACQUIRE(&col->file_pending)) return 0;
+    
+    /* Readers of a mapped database may race to load one column: the first
+     * one verifies and materializes it, the others wait and then find it
+     * loaded. Columns used in place are verified on first access too. */
+    int status = 0;
+    cdb_rwlock_write(db->load_lock);
+    if (col->file_pending) {
+        const uint8_t* bytes = (const uint8_t*)db->mapping + col->file_offset;
+        if (col->storage != CDB_STORAGE_HEAP) status = verify_column(col, bytes);
+        if (status == 0 && col->storage == CDB_STORAGE_UNLOADED) {
+            status = materialize_stored_column(col, bytes, bytes + col->file_stored_size);
+        }
+        if (status == 0) CDB_STORE_RELEASE(&col->file_pending, 0);
+    }
+    cdb_rwlock_write_unlock(db->load_lock);
+    return status;
+}
+
+/* Set the row group size used by later saves */
+int cdb_set_row_group_size(cdb_database_t* db, size_t rows) {
+    if (!db) {
+        set_error("Invalid database");
+        return -1;
+    }
+    if (rows == 0 || rows % 64 != 0) {
+        set_error("Row group size must be a positive multiple of 64");
+        return -1;
+    }
+    cdb_write_lock(db);
+    db->row_group_rows = rows;
+    cdb_write_unlock(db);
+    return 0;
+}
+
+/* Enable or disable lightweight encodings in later saves */
+int cdb_set_column_encoding(cdb_database_t* db, int enabled) {
+    if (!db) {
+        set_error("Invalid database");
+        return -1;
+    }
+    cdb_write_lock(db);
+    db->encode_columns = enabled != 0;
+    cdb_write_unlock(db);
+    return 0;
+}
+
+/* Check that a codec is built in and accepts a level */
+int cdb_check_compression(cdb_compression_t codec, int level) {
+    if (!cdb_compression_available(codec)) {
+        set_error("Compression codec not available");
+        return -1;
+    }
+    if (level < 0 || level > cdb_compression_max_level(codec)) {
+        set_error("Compression level out of range");
+        return -1;
+    }
+    return 0;
+}
+
+/* Set the block compression of later saves */
+int cdb_set_compression(cdb_database_t* db, cdb_compression_t codec, int level) {
+    if (!db) {
+        set_error("Invalid database");
+        return -1;
+    }
+    if (cdb_check_compression(codec, level) < 0) return -1;
+    cdb_write_lock(db);
+    db->compression = codec;
+    db->compression_level = level;
+    cdb_write_unlock(db);
+    return 0;
+}
+
+/* Set how many threads later saves and loads spread columns over */
+int cdb_set_num_threads(cdb_database_t* db, size_t num_threads) {
+    if (!db) {
+        set_error("Invalid database");
+        return -1;
+    }
+    cdb_write_lock(db);
+    db->num_threads = num_threads;
+    cdb_write_unlock(db);
+    return 0;
+}
+
+/* Reads slices of a column's data section and null bitmap for a scan: straight
+ * from the file, or from decompressed copies of a compressed column's blocks */
+typedef struct {
+    FILE* f;
+    const cdb_file_column_t* entry;
+    uint8_t* stored;  /* Compressed columns: both blocks, read on first use */
+    uint8_t* data_owned;
+    uint8_t* bitmap_owned;
+    const uint8_t* data;
+    const uint8_t* bitmap;
+} cdb_section_reader_t;
+
+static int section_read(cdb_section_reader_t* r, int from_bitmap, uint64_t offset, void* dest, size_t size) {
+    const cdb_file_column_t* entry = r->entry;
+    uint64_t limit = from_bitmap ? entry->null_bitmap_size : entry->data_size;
+    const char* truncated = from_bitmap ? "Truncated null bitmap" : "Truncated column data";
+    if (offset > limit || size > limit - offset) {
+        set_error(truncated);
+        return -1;
+    }
+    if (size == 0) return 0;  /* Empty string batches have nothing (and nowhere) to copy */
+    
+    if (entry->compression == CDB_COMPRESSION_NONE) {
+        uint64_t base = entry->data_offset + (from_bitmap ? entry->stored_data_size : 0);
+        if (cdb_fseek(r->f, base + offset) != 0 || read_exact(r->f, dest, size) < 0) {
+            set_error(truncated);
+            return -1;
+        }
+        return 0;
+    }
+    
+    if (!r->stored) {
+        /* Compressed blocks cannot be read piecewise: expand both once */
+        uint64_t stored_size = entry->stored_data_size + entry->stored_bitmap_size;
+        r->stored = (uint8_t*)malloc(stored_size ? (size_t)stored_size : 1);
+        if (!r->stored) {
+            set_error("Failed to allocate scan buffers");
+            return -1;
+        }
+        if (cdb_fseek(r->f, entry->data_offset) != 0 || read_exact(r->f, r->stored, (size_t)stored_size) < 0) {
+            set_error("Truncated column data");
+            return -1;
+        }
+        r->data = expand_block(entry->compression, r->stored, entry->stored_data_size,
+                               entry->data_size, &r->data_owned);
+        if (!r->data) return -1;
+        r->bitmap = expand_block(entry->compression, r->stored + entry->stored_data_size,
+                                 entry->stored_bitmap_size, entry->null_bitmap_size, &r->bitmap_owned);
+        if (!r->bitmap) return -1;
+    }
+    if (!r->data || !r->bitmap) return -1;
+    memcpy(dest, (from_bitmap ? r->bitmap : r->data) + offset, size);
+    return 0;
+}
+
+static void section_reader_free(cdb_section_reader_t* r) {
+    free(r->stored);
+    free(r->data_owned);
+    free(r->bitmap_owned);
+}
+
+/* BETWEEN bounds of a scan, in the type the caller gave them */
+typedef struct {
+    int is_float;
+    int64_t lo_i, hi_i;
+    double lo_f, hi_f;
+} cdb_scan_bounds_t;
+
+/* Whether [min, max] of a column of the given type intersects / lies inside the bounds */
+static int zone_overlaps(const cdb_scan_bounds_t* b, int float_col, const cdb_zone_map_t* z) {
+    if (!float_col && !b->is_float) return z->max.i >= b->lo_i && z->min.i <= b->hi_i;
+    double min = float_col ? z->min.f : (double)z->min.i;
+    double max = float_col ? z->max.f : (double)z->max.i;
+    return max >= b->lo_f && min <= b->hi_f;
+}
+
+static int zone_inside(const cdb_scan_bounds_t* b, int float_col, const cdb_zone_map_t* z) {
+    if (!float_col && !b->is_float) return z->min.i >= b->lo_i && z->max.i <= b->hi_i;
+    double min = float_col ? z->min.f : (double)z->min.i;
+    double max = float_col ? z->max.f : (double)z->max.i;
+    return min >= b->lo_f && max <= b->hi_f;
+}
+
+/* Append row indices [start, start + count) to a scan result */
+static int scan_emit(cdb_scan_result_t* result, size_t* capacity, uint64_t start, size_t count,
+                     const uint64_t* rows) {
+    if (result->num_rows + count > *capacity) {
+        size_t new_capacity = *capacity ? *capacity : 1024;
+        while (new_capacity < result->num_rows + count) new_capacity *= 2;
+        uint64_t* grown = (uint64_t*)realloc(result->rows, new_capacity * sizeof(uint64_t));
+        if (!grown) {
+            set_error("Failed to allocate scan result");
+            return -1;
+        }
+        result->rows = grown;
+        *capacity = new_capacity;
+    }
+    for (size_t k = 0; k < count; k++) {
+        result->rows[result->num_rows++] = rows ? rows[k] : start + k;
+    }
+    return 0;
+}
+
+/* Filter one row group's values against the bounds, collecting matches in hits */
+#define CDB_SCAN_LOOP(T, MATCH)                                                     \
+    do {                                                                            \
+        const T* v = (const T*)values;                                              \
+        for (size_t base = 0; base < n; base += 64) {                               \
+            uint64_t nulls = bitmap ? cdb_null_word(bitmap, base, n) : 0;           \
+            size_t count = n - base < 64 ? n - base : 64;                           \
+            for (size_t k = 0; k < count; k++) {                                    \
+                if (!((nulls >> k) & 1) && (MATCH)) hits[num_hits++] = start + base + k; \
+            }                                                                       \
+        }                                                                           \
+    } while (0)
+
+static size_t scan_group(cdb_data_type_t type, const cdb_scan_bounds_t* b, const void* values,
+                         const uint8_t* bitmap, uint64_t start, size_t n, uint64_t* hits) {
+    size_t num_hits = 0;
+    switch (type) {
+        case CDB_TYPE_INT32:
+            if (b->is_float) CDB_SCAN_LOOP(int32_t, v[base + k] >= b->lo_f && v[base + k] <= b->hi_f);
+            else CDB_SCAN_LOOP(int32_t, v[base + k] >= b->lo_i && v[base + k] <= b->hi_i);
+            break;
+        case CDB_TYPE_INT64:
+            if (b->is_float) CDB_SCAN_LOOP(int64_t, (double)v[base + k] >= b->lo_f && (double)v[base + k] <= b->hi_f);
+            else CDB_SCAN_LOOP(int64_t, v[base + k] >= b->lo_i && v[base + k] <= b->hi_i);
+            break;
+        case CDB_TYPE_BOOL:
+            if (b->is_float) CDB_SCAN_LOOP(uint8_t, v[base + k] >= b->lo_f && v[base + k] <= b->hi_f);
+            else CDB_SCAN_LOOP(uint8_t, v[base + k] >= b->lo_i && v[base + k] <= b->hi_i);
+            break;
+        case CDB_TYPE_FLOAT32:
+            CDB_SCAN_LOOP(float, v[base + k] >= b->lo_f && v[base + k] <= b->hi_f);
+            break;
+        case CDB_TYPE_FLOAT64:
+            CDB_SCAN_LOOP(double, v[base + k] >= b->lo_f && v[base + k] <= b->hi_f);
+            break;
+        default:
+            break;
+    }
+    return num_hits;
+}
+
+#undef CDB_SCAN_LOOP
+
+/* Scan a column of one directory (the base or a segment) group by group,
+ * skipping groups its zone maps rule out; rows are counted from dir->first_row */
+static int scan_directory(FILE* f, const cdb_file_directory_t* dir, const char* column_name,
+                          const cdb_scan_bounds_t* bounds, cdb_scan_result_t* result, size_t* result_capacity) {
+    int status = -1;
+    cdb_zone_map_t* zones = NULL;
+    uint8_t* values = NULL;
+    uint8_t* bitmap = NULL;
+    uint64_t* hits = NULL;
+    uint64_t* chunk_table = NULL;
+    uint8_t* chunk = NULL;
+    size_t chunk_capacity = 0;
+    size_t capacity = *result_capacity;
+    cdb_section_reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.f = f;
+    
+    const cdb_file_column_t* entry = find_file_column(dir, column_name);
+    if (!entry) {
+        set_error("Column not found in file");
+        goto done;
+    }
+    if (!has_zone_maps(entry->data_type)) {
+        set_error("Range scans require a numeric or bool column");
+        goto done;
+    }
+    reader.entry = entry;
+    
+    /* Files without zone maps are scanned in default-sized groups */
+    int chunked = cdb_encoding_is_chunked(entry->encoding);
+    uint64_t group_rows = entry->zone_map_offset || chunked ? entry->row_group_rows : CDB_DEFAULT_ROW_GROUP_ROWS;
+    uint64_t num_groups = row_group_count(dir->num_rows, group_rows);
+    size_t elem_size = cdb_type_size(entry->data_type);
+    int float_col = is_float_type(entry->data_type);
+    result->groups_total += (size_t)num_groups;
+    
+    /* Zone maps first: one small read for the whole column */
+    if (entry->zone_map_offset) {
+        zones = (cdb_zone_map_t*)malloc((size_t)num_groups * sizeof(cdb_zone_map_t));
+        if (!zones) {
+            set_error("Failed to allocate zone maps");
+            goto done;
+        }
+        if (cdb_fseek(f, entry->zone_map_offset) != 0 ||
+            read_exact(f, zones, (size_t)num_groups * sizeof(cdb_zone_map_t)) < 0) {
+            set_error("Truncated zone maps");
+            goto done;
+        }
+    }
+    
+    /* Encoded columns: the chunk offset table locates each group's chunk */
+    uint64_t table_size = (num_groups + 1) * sizeof(uint64_t);
+    if (chunked) {
+        chunk_table = (uint64_t*)malloc((size_t)table_size);
+        if (!chunk_table) {
+            set_error("Failed to allocate chunk table");
+            goto done;
+        }
+        if (section_read(&reader, 0, 0, chunk_table, (size_t)table_size) < 0) goto done;
+    }
+    
+    size_t max_rows = dir->num_rows < group_rows ? dir->num_rows : (size_t)group_rows;
+    values = (uint8_t*)malloc(max_rows * elem_size + 1);
+    bitmap = (uint8_t*)malloc(max_rows / 8 + 1);
+    hits = (uint64_t*)malloc((max_rows + 1) * sizeof(uint64_t));
+    if (!values || !bitmap || !hits) {
+        set_error("Failed to allocate scan buffers");
+        goto done;
+    }
+    
+    for (uint64_t g = 0; g < num_groups; g++) {
+        uint64_t start = g * group_rows;
+        size_t n = (size_t)(dir->num_rows - start < group_rows ? dir->num_rows - start : group_rows);
+        uint64_t group_nulls = zones ? zones[g].null_count : entry->null_count;
+        
+        if (zones) {
+            if (group_nulls >= n || !zone_overlaps(bounds, float_col, &zones[g])) continue;
+            /* Every row matches: no need to read the group at all. Zone maps
+             * do not count NaN, so a float group may hide rows that never match */
+            if (group_nulls == 0 && !float_col && zone_inside(bounds, float_col, &zones[g])) {
+                if (scan_emit(result, &capacity, dir->first_row + start, n, NULL) < 0) goto done;
+                continue;
+            }
+        }
+        
+        /* Read only this group's slice of the values and of the null bitmap */
+        const uint8_t* group_bitmap = NULL;
+        if (group_nulls != 0) {
+            if (section_read(&reader, 1, start / 8, bitmap, (n + 7) / 8) < 0) goto done;
+            group_bitmap = bitmap;
+        }
+        if (chunked) {
+            uint64_t begin = chunk_table[g], end = chunk_table[g + 1];
+            if (begin < table_size || end < begin || end > entry->data_size) {
+                set_error("Corrupt encoded column data");
+                goto done;
+            }
+            if (end - begin > chunk_capacity) {
+                free(chunk);
+                chunk_capacity = (size_t)(end - begin);
+                chunk = (uint8_t*)malloc(chunk_capacity);
+                if (!chunk) {
+                    set_error("Failed to allocate scan buffers");
+                    goto done;
+                }
+            }
+            if (section_read(&reader, 0, begin, chunk, (size_t)(end - begin)) < 0) goto done;
+            if (cdb_decode_chunk(entry->encoding, entry->data_type, chunk, end - begin, n, values) < 0) {
+                goto done;
+            }
+        } else if (section_read(&reader, 0, start * elem_size, values, n * elem_size) < 0) {
+            goto done;
+        }
+        result->groups_read++;
+        cdb_stat_add(CDB_STAT_ROWS_SCANNED, n);
+        
+        size_t num_hits = scan_group(entry->data_type, bounds, values, group_bitmap, dir->first_row + start, n, hits);
+        if (scan_emit(result, &capacity, 0, num_hits, hits) < 0) goto done;
+    }
+    status = 0;
+
+done:
+    *result_capacity = capacity;
+    free(zones);
+    free(values);
+    free(bitmap);
+    free(hits);
+    free(chunk_table);
+    free(chunk);
+    section_reader_free(&reader);
+    return status;
+}
+
+/* Scan a column of a file: its base, then each appended segment */
+static int scan_between(const char* filename, const char* column_name,
+                        const cdb_scan_bounds_t* bounds, cdb_scan_result_t* result) {
+    if (!filename || !column_name || !result) {
+        set_error("Invalid filename, column or result");
+        return -1;
+    }
+    memset(result, 0, sizeof(*result));
+    
+    FILE* f = fopen(filename, "rb");
+    if (!f) {
+        set_error("Failed to open file for reading");
+        return -1;
+    }
+    
+    cdb_file_directory_t dir;
+    if (read_directory(f, &dir) < 0) {
+        fclose(f);
+        return -1;
+    }
+    
+    size_t capacity = 0;
+    cdb_file_segments_t segs;
+    int status = scan_directory(f, &dir, column_name, bounds, result, &capacity);
+    if (status == 0 && dir.segment_link && (status = read_segments(f, &dir, &segs)) == 0) {
+        for (size_t s = 0; status == 0 && s < segs.count; s++) {
+            status = scan_directory(f, &segs.dirs[s], column_name, bounds, result, &capacity);
+        }
+        free_segments(&segs);
+    }
+    if (status < 0) cdb_free_scan_result(result);
+    free_directory(&dir);
+    fclose(f);
+    return status;
+}
+
+/* Rows of a saved column with lo <= value <= hi, integer bounds */
+int cdb_scan_between_int64(const char* filename, const char* column_name,
+                           int64_t lo, int64_t hi, cdb_scan_result_t* result) {
+    cdb_scan_bounds_t bounds = {0, lo, hi, (double)lo, (double)hi};
+    return scan_between(filename, column_name, &bounds, result);
+}
+
+/* Rows of a saved column with lo <= value <= hi, floating-point bounds */
+int cdb_scan_between_float64(const char* filename, const char* column_name,
+                             double lo, double hi, cdb_scan_result_t* result) {
+    cdb_scan_bounds_t bounds = {1, 0, 0, lo, hi};
+    return scan_between(filename, column_name, &bounds, result);
+}
+
+/* Release the rows of a scan result */
+void cdb_free_scan_result(cdb_scan_result_t* result) {
+    if (!result) return;
+    free(result->rows);
+    memset(result, 0, sizeof(*result));
+}
+
+/* One selected column of a streaming reader, in the part being read */
+typedef struct {
+    cdb_section_reader_t section;
+    uint64_t* chunk_table;   /* Encoded columns: the part's chunk offsets */
+    uint8_t* chunk;
+    size_t chunk_capacity;
+    uint8_t* group;          /* Encoded columns: one decoded row group */
+    size_t group_capacity;
+    uint64_t group_index;    /* Row group held in group, or UINT64_MAX */
+    uint8_t* bits;           /* A batch's null bitmap bytes, before shifting */
+    size_t bits_capacity;
+    uint8_t* dictionary;     /* DICT_STRING: the part's dictionary (the section tail) */
+    uint64_t dictionary_size;
+} cdb_reader_column_t;
+
+/* A batch to read: where it starts, and into which buffer */
+typedef struct {
+    size_t slot;
+    size_t batch_rows;
+    size_t part;
+    uint64_t row;
+    size_t rows;             /* Rows read; 0 at the end of the file */
+} cdb_reader_job_t;
+
+struct cdb_reader {
+    FILE* f;
+    cdb_file_directory_t base;
+    cdb_file_segments_t segs;
+    size_t num_columns;
+    size_t* positions;          /* Directory position of each selected column */
+    cdb_reader_column_t* columns;
+    size_t open_part;           /* Part the column states are for, or SIZE_MAX */
+    size_t part;                /* Next batch: 0 = the base, s + 1 = segment s */
+    uint64_t row;               /* Next batch: first row within its part */
+    cdb_database_t* batches[2]; /* One handed out, the other being read */
+    size_t dict_part[2];        /* Part whose dictionaries a batch holds, or SIZE_MAX */
+    size_t current;             /* Buffer of the last batch handed out */
+    int handed_out;
+    cdb_worker_t* worker;       /* Reads the next batch ahead; NULL reads on demand */
+    int prefetching;
+    cdb_reader_job_t job;
+};
+
+static const cdb_file_directory_t* reader_part(const cdb_reader_t* reader, size_t part) {
+    return part == 0 ? &reader->base : &reader->segs.dirs[part - 1];
+}
+
+/* Grow a reader buffer to at least size bytes */
+static int reader_reserve(uint8_t** buffer, size_t* capacity, size_t size) {
+    if (size <= *capacity) return 0;
+    uint8_t* grown = (uint8_t*)realloc(*buffer, size);
+    if (!grown) {
+        set_error("Failed to allocate reader buffers");
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = size;
+    return 0;
+}
+
+/* Drop the per-part state of every column, keeping the reusable buffers */
+static void reader_close_part(cdb_reader_t* reader) {
+    for (size_t c = 0; reader->columns && c < reader->num_columns; c++) {
+        cdb_reader_column_t* rc = &reader->columns[c];
+        section_reader_free(&rc->section);
+        memset(&rc->section, 0, sizeof(rc->section));
+        free(rc->chunk_table);
+        free(rc->dictionary);
+        rc->chunk_table = NULL;
+        rc->dictionary = NULL;
+        rc->dictionary_size = 0;
+        rc->group_index = UINT64_MAX;
+    }
+    reader->open_part = SIZE_MAX;
+}
+
+/* Read what a part's columns need before any of their rows: chunk offset
+ * tables and dictionaries */
+static int reader_open_part(cdb_reader_t* reader, size_t part) {
+    reader_close_part(reader);
+    const cdb_file_directory_t* dir = reader_part(reader, part);
+    for (size_t c = 0; c < reader->num_columns; c++) {
+        const cdb_file_column_t* entry = &dir->columns[reader->positions[c]];
+        cdb_reader_column_t* rc = &reader->columns[c];
+        rc->section.f = reader->f;
+        rc->section.entry = entry;
+        
+        if (cdb_encoding_is_chunked(entry->encoding)) {
+            uint64_t group_rows = entry->row_group_rows;
+            uint64_t table_size = (row_group_count(dir->num_rows, group_rows) + 1) * sizeof(uint64_t);
+            size_t max_rows = dir->num_rows < group_rows ? dir->num_rows : (size_t)group_rows;
+            rc->chunk_table = (uint64_t*)malloc((size_t)table_size);
+            if (!rc->chunk_table) {
+                set_error("Failed to allocate chunk table");
+                return -1;
+            }
+            if (section_read(&rc->section, 0, 0, rc->chunk_table, (size_t)table_size) < 0 ||
+                reader_reserve(&rc->group, &rc->group_capacity, max_rows * cdb_type_size(entry->data_type) + 1) < 0) {
+                return -1;
+            }
+        } else if (entry->data_type == CDB_TYPE_DICT_STRING) {
+            uint64_t codes_size = dict_codes_size(dir->num_rows);
+            if (entry->data_size < codes_size) {
+                set_error("Corrupt dictionary column data");
+                return -1;
+            }
+            rc->dictionary_size = entry->data_size - codes_size;
+            rc->dictionary = (uint8_t*)malloc(rc->dictionary_size ? (size_t)rc->dictionary_size : 1);
+            if (!rc->dictionary) {
+                set_error("Failed to allocate dictionary buffer");
+                return -1;
+            }
+            if (section_read(&rc->section, 0, codes_size, rc->dictionary, (size_t)rc->dictionary_size) < 0) return -1;
+        }
+    }
+    reader->open_part = part;
+    return 0;
+}
+
+/* Copy n bits starting at bit shift of src (span bytes) to the start of dest */
+static void copy_bits(uint8_t* dest, const uint8_t* src, size_t shift, size_t n, size_t span) {
+    size_t bytes = (n + 7) / 8;
+    if (shift == 0) {
+        memcpy(dest, src, bytes);
+    } else {
+        for (size_t k = 0; k < bytes; k++) {
+            uint8_t next = k + 1 < span ? src[k + 1] : 0;
+            dest[k] = (uint8_t)((src[k] >> shift) | (next << (8 - shift)));
+        }
+    }
+    if (n % 8) dest[bytes - 1] &= (uint8_t)((1u << (n % 8)) - 1);
+}
+
+/* Values of rows [start, start + n) of an encoded column: each row group
+ * is decoded whole, straight into out when the batch covers all of it */
+static int reader_decode_rows(cdb_reader_column_t* rc, const cdb_file_directory_t* dir,
+                              uint64_t start, size_t n, uint8_t* out) {
+    const cdb_file_column_t* entry = rc->section.entry;
+    uint64_t group_rows = entry->row_group_rows;
+    uint64_t table_size = (row_group_count(dir->num_rows, group_rows) + 1) * sizeof(uint64_t);
+    size_t elem_size = cdb_type_size(entry->data_type);
+    
+    for (size_t done = 0; done < n;) {
+        uint64_t row = start + done;
+        uint64_t g = row / group_rows;
+        uint64_t group_start = g * group_rows;
+        size_t group_n = (size_t)(dir->num_rows - group_start < group_rows ? dir->num_rows - group_start : group_rows);
+        size_t skip = (size_t)(row - group_start);
+        size_t count = group_n - skip < n - done ? group_n - skip : n - done;
+        uint8_t* dest = out + done * elem_size;
+        int whole = skip == 0 && count == group_n;
+        
+        if (whole || g != rc->group_index) {
+            uint64_t begin = rc->chunk_table[g], end = rc->chunk_table[g + 1];
+            if (begin < table_size || end < begin || end > entry->data_size) {
+                set_error("Corrupt encoded column data");
+                return -1;
+            }
+            if (reader_reserve(&rc->chunk, &rc->chunk_capacity, (size_t)(end - begin)) < 0 ||
+                section_read(&rc->section, 0, begin, rc->chunk, (size_t)(end - begin)) < 0 ||
+                cdb_decode_chunk(entry->encoding, entry->data_type, rc->chunk, end - begin, group_n,
+                                 whole ? dest : rc->group) < 0) {
+                return -1;
+            }
+            if (!whole) rc->group_index = g;
+        }
+        if (!whole) memcpy(dest, rc->group + skip * elem_size, count * elem_size);
+        done += count;
+    }
+    return 0;
+}
+
+/* Read rows [start, start + n) of a part's column into a batch column */
+static int reader_read_column(cdb_reader_column_t* rc, const cdb_file_directory_t* dir, cdb_column_t* col,
+                              uint64_t start, size_t n, int new_dictionary) {
+    const cdb_file_column_t* entry = rc->section.entry;
+    size_t elem_size = cdb_type_size(col->data_type);
+    col->num_rows = 0;
+    col->null_count = 0;
+    if (cdb_column_reserve(col, n) < 0) return -1;
+    
+    /* Null bits: the batch's bytes, shifted down to its first row; rows
+     * past the batch stay "not null" for appends to a taken batch */
+    memset(col->null_bitmap, 0, (col->capacity + 7) / 8);
+    if (entry->null_count != 0) {
+        size_t shift = (size_t)(start % 8);
+        size_t span = (shift + n + 7) / 8;
+        if (reader_reserve(&rc->bits, &rc->bits_capacity, span) < 0 ||
+            section_read(&rc->section, 1, start / 8, rc->bits, span) < 0) {
+            return -1;
+        }
+        copy_bits(col->null_bitmap, rc->bits, shift, n, span);
+        col->null_count = cdb_count_nulls(col->null_bitmap, n);
+    }
+    
+    if (cdb_encoding_is_chunked(entry->encoding)) {
+        if (reader_decode_rows(rc, dir, start, n, (uint8_t*)col->data) < 0) return -1;
+        /* NULL rows read back as 0, as in loaded columns */
+        for (size_t base = 0; col->null_count && base < n; base += 64) {
+            uint64_t nulls = cdb_null_word(col->null_bitmap, base, n);
+            size_t count = n - base < 64 ? n - base : 64;
+            for (size_t k = 0; k < count; k++) {
+                if ((nulls >> k) & 1) memset((uint8_t*)col->data + (base + k) * elem_size, 0, elem_size);
+            }
+        }
+    } else if (col->data_type == CDB_TYPE_STRING) {
+        /* The batch's offsets, then the bytes between the first and the last */
+        uint64_t offsets_size = ((uint64_t)dir->num_rows + 1) * sizeof(uint64_t);
+        uint64_t* offsets = (uint64_t*)col->data;
+        if (section_read(&rc->section, 0, start * sizeof(uint64_t), offsets, (n + 1) * sizeof(uint64_t)) < 0) {
+            return -1;
+        }
+        uint64_t first = offsets[0], last = offsets[n];
+        if (entry->data_size < offsets_size || last < first || last > entry->data_size - offsets_size) {
+            set_error("Corrupt string column offsets");
+            return -1;
+        }
+        for (size_t j = 0; j <= n; j++) {
+            offsets[j] -= first;
+        }
+        if (validate_offsets(offsets, n, last - first) < 0 ||
+            cdb_string_reserve(col, (size_t)(last - first)) < 0 ||
+            section_read(&rc->section, 0, offsets_size + first, col->string_data, (size_t)(last - first)) < 0) {
+            return -1;
+        }
+        col->string_data_size = (size_t)(last - first);
+    } else if (col->data_type == CDB_TYPE_DICT_STRING) {
+        if (new_dictionary) {
+            /* The value -> code hash is for the old dictionary */
+            free(col->dict_index);
+            col->dict_index = NULL;
+            col->dict_index_capacity = 0;
+            if (load_dictionary(col, rc->dictionary, rc->dictionary_size) < 0) return -1;
+        }
+        if (section_read(&rc->section, 0, start * sizeof(uint32_t), col->data, n * sizeof(uint32_t)) < 0) return -1;
+    } else if (section_read(&rc->section, 0, start * elem_size, col->data, n * elem_size) < 0) {
+        return -1;
+    }
+    
+    col->num_rows = n;
+    col->sorted = entry->sorted;
+    return 0;
+}
+
+/* Empty batch buffer with the selected columns */
+static cdb_database_t* reader_new_batch(const cdb_reader_t* reader) {
+    cdb_database_t* batch = cdb_create_database();
+    for (size_t c = 0; batch && c < reader->num_columns; c++) {
+        const cdb_file_column_t* entry = &reader->base.columns[reader->positions[c]];
+        if (cdb_add_column(batch, entry->name, entry->data_type) < 0) {
+            cdb_free_database(batch);
+            batch = NULL;
+        }
+    }
+    return batch;
+}
+
+/* Read the batch described by reader->job; the read position moves past
+ * it only once every column is in */
+static int reader_fill(void* ctx) {
+    cdb_reader_t* reader = (cdb_reader_t*)ctx;
+    cdb_reader_job_t* job = &reader->job;
+    size_t num_parts = reader->segs.count + 1;
+    size_t part = job->part;
+    uint64_t row = job->row;
+    while (part < num_parts && row >= reader_part(reader, part)->num_rows) {
+        part++;
+        row = 0;
+    }
+    job->rows = 0;
+    if (part == num_parts) {
+        reader->part = part;
+        reader->row = 0;
+        return 0;
+    }
+    
+    const cdb_file_directory_t* dir = reader_part(reader, part);
+    if (reader->open_part != part && reader_open_part(reader, part) < 0) return -1;
+    if (!reader->batches[job->slot] && !(reader->batches[job->slot] = reader_new_batch(reader))) return -1;
+    
+    cdb_database_t* batch = reader->batches[job->slot];
+    size_t n = dir->num_rows - row < job->batch_rows ? (size_t)(dir->num_rows - row) : job->batch_rows;
+    int new_dictionary = reader->dict_part[job->slot] != part;
+    reader->dict_part[job->slot] = SIZE_MAX;
+    for (size_t c = 0; c < reader->num_columns; c++) {
+        if (reader_read_column(&reader->columns[c], dir, &batch->columns[c], row, n, new_dictionary) < 0) return -1;
+    }
+    reader->dict_part[job->slot] = part;
+    
+    reader->part = part;
+    reader->row = row + n;
+    job->rows = n;
+    return 0;
+}
+
+/* Open a file for streaming reads of the named columns */
+cdb_reader_t* cdb_reader_open(const char* filename, const char* const* names, size_t num_names) {
+    if (!filename || (!names && num_names > 0)) {
+        set_error("Invalid filename or column names");
+        return NULL;
+    }
+    cdb_reader_t* reader = (cdb_reader_t*)calloc(1, sizeof(cdb_reader_t));
+    if (!reader) {
+        set_error("Failed to allocate reader");
+        return NULL;
+    }
+    reader->open_part = SIZE_MAX;
+    reader->dict_part[0] = reader->dict_part[1] = SIZE_MAX;
+    reader->current = 1;
+    
+    const cdb_file_column_t** selected = NULL;
+    reader->f = fopen(filename, "rb");
+    if (!reader->f) {
+        set_error("Failed to open file for reading");
+        goto fail;
+    }
+    if (read_directory(reader->f, &reader->base) < 0) goto fail;
+    if (reader->base.segment_link && read_segments(reader->f, &reader->base, &reader->segs) < 0) goto fail;
+    
+    selected = select_file_columns(&reader->base, names, &num_names);
+    if (!selected) goto fail;
+    reader->num_columns = num_names;
+    reader->positions = (size_t*)malloc((num_names ? num_names : 1) * sizeof(size_t));
+    reader->columns = (cdb_reader_column_t*)calloc(num_names ? num_names : 1, sizeof(cdb_reader_column_t));
+    if (!reader->positions || !reader->columns) {
+        set_error("Failed to allocate reader");
+        goto fail;
+    }
+    for (size_t c = 0; c < num_names; c++) {
+        reader->positions[c] = (size_t)(selected[c] - reader->base.columns);
+        reader->columns[c].group_index = UINT64_MAX;
+    }
+    
+    /* Length-prefixed strings (format v1/v2) cannot be read by row range */
+    for (size_t c = 0; c < num_names; c++) {
+        if (selected[c]->encoding == CDB_FILE_ENCODING_LENGTH_PREFIXED) {
+            set_error("Streaming reads need string columns of format v3 or later");
+            goto fail;
+        }
+    }
+    free(selected);
+    
+    reader->worker = cdb_worker_create();
+    return reader;
+
+fail:
+    free(selected);
+    cdb_reader_close(reader);
+    return NULL;
+}
+
+/* Hand out the next batch and start reading the one after it */
+int cdb_reader_next_batch(cdb_reader_t* reader, size_t batch_rows, cdb_database_t** out_batch) {
+    if (!reader || batch_rows == 0 || !out_batch) {
+        set_error("Invalid reader, batch size or output");
+        return -1;
+    }
+    *out_batch = NULL;
+    reader->handed_out = 0;
+    
+    cdb_reader_job_t* job = &reader->job;
+    int ready = 0;
+    if (reader->prefetching) {
+        reader->prefetching = 0;
+        if (cdb_worker_wait(reader->worker) < 0) return -1;
+        if (job->batch_rows == batch_rows) {
+            ready = 1;
+        } else {
+            /* Read ahead at another size: read it again at this one */
+            reader->part = job->part;
+            reader->row = job->row;
+        }
+    }
+    if (!ready) {
+        job->slot = 1 - reader->current;
+        job->batch_rows = batch_rows;
+        job->part = reader->part;
+        job->row = reader->row;
+        if (reader_fill(reader) < 0) return -1;
+    }
+    if (job->rows == 0) return 0;
+    
+    reader->current = job->slot;
+    reader->handed_out = 1;
+    *out_batch = reader->batches[job->slot];
+    
+    /* The other buffer is free: fill it while the caller works on this one */
+    if (reader->worker) {
+        job->slot = 1 - reader->current;
+        job->part = reader->part;
+        job->row = reader->row;
+        cdb_worker_post(reader->worker, reader_fill, reader);
+        reader->prefetching = 1;
+    }
+    return 1;
+}
+
+/* Take over the batch last handed out; the reader reads into a new one */
+cdb_database_t* cdb_reader_take_batch(cdb_reader_t* reader) {
+    if (!reader || !reader->handed_out) {
+        set_error("No batch to take");
+        return NULL;
+    }
+    cdb_database_t* batch = reader->batches[reader->current];
+    reader->batches[reader->current] = NULL;
+    reader->dict_part[reader->current] = SIZE_MAX;
+    reader->handed_out = 0;
+    return batch;
+}
+
+/* Stop reading ahead and release the reader */
+void cdb_reader_close(cdb_reader_t* reader) {
+    if (!reader) return;
+    if (reader->prefetching) cdb_worker_wait(reader->worker);
+    cdb_worker_destroy(reader->worker);
+    
+    reader_close_part(reader);
+    for (size_t c = 0; reader->columns && c < reader->num_columns; c++) {
+        free(reader->columns[c].chunk);
+        free(reader->columns[c].group);
+        free(reader->columns[c].bits);
+    }
+    free(reader->columns);
+    free(reader->positions);
+    cdb_free_database(reader->batches[0]);
+    cdb_free_database(reader->batches[1]);
+    free_segments(&reader->segs);
+    free_directory(&reader->base);
+    if (reader->f) fclose(reader->f);
+    free(reader);
 }
 
 /* Backwards compatibility: open loads from file */
@@ -0,0 +1,599 @@
+/*
+ * ColumnDB Filter Implementation
+ * Comparison predicates evaluated a column at a time into selection
+ * bitmaps, AND/OR of selections, and gathering of the selected rows
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include "column_db_internal.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* x86 builds with GCC/Clang get an AVX2 copy of the kernels, picked at runtime */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CDB_FILTER_AVX2_DISPATCH 1
+#endif
+
+/* Pack 64 bytes holding 0 or 1 into a word, byte i to bit i */
+static uint64_t pack_hits(const uint8_t* hits) {
+    uint64_t word = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < 64; i++) word |= (uint64_t)hits[i] << i;
+#else
+    for (size_t k = 0; k < 8; k++) {
+        uint64_t bytes;
+        memcpy(&bytes, hits + 8 * k, sizeof(bytes));
+        /* The multiply gathers the low bit of every byte into the top byte */
+        word |= ((bytes * 0x0102040810204080ULL) >> 56) << (8 * k);
+    }
+#endif
+    return word;
+}
+
+#define CDB_KERNEL_SUFFIX _base
+#define CDB_KERNEL_TARGET
+#include "column_db_filter_kernels.h"
+#undef CDB_KERNEL_SUFFIX
+#undef CDB_KERNEL_TARGET
+
+#ifdef CDB_FILTER_AVX2_DISPATCH
+#define CDB_KERNEL_SUFFIX _avx2
+#define CDB_KERNEL_TARGET __attribute__((target("avx2")))
+#include "column_db_filter_kernels.h"
+#undef CDB_KERNEL_SUFFIX
+#undef CDB_KERNEL_TARGET
+#endif
+
+typedef struct cdb_compare_kernels {
+    void (*compare)(const cdb_column_t* col, cdb_cmp_op_t op, const cdb_value_t* value, uint64_t* out);
+    void (*compare_codes)(const cdb_column_t* col, cdb_cmp_op_t op, uint32_t code, uint64_t* out);
+} cdb_compare_kernels_t;
+
+/* Pick the widest kernel set the CPU supports (once) */
+static const cdb_compare_kernels_t* select_kernels(void) {
+    static const cdb_compare_kernels_t base = {compare_base, compare_codes_base};
+#ifdef CDB_FILTER_AVX2_DISPATCH
+    static const cdb_compare_kernels_t avx2 = {compare_avx2, compare_codes_avx2};
+    static const cdb_compare_kernels_t* kernels = NULL;
+    if (!kernels) {
+        __builtin_cpu_init();
+        kernels = __builtin_cpu_supports("avx2") ? &avx2 : &base;
+    }
+    return kernels;
+#else
+    return &base;
+#endif
+}
+
+/* Number of set bits */
+static unsigned popcount64(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (unsigned)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Index of the lowest set bit (x must be non-zero) */
+static unsigned count_trailing_zeros(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (unsigned)index;
+#else
+    unsigned index = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+static size_t selection_words(size_t num_rows) {
+    return (num_rows + 63) / 64;
+}
+
+/* Bits of the rows that exist in word w */
+static uint64_t row_mask(size_t num_rows, size_t w) {
+    size_t rows = num_rows - w * 64;
+    return rows >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << rows) - 1;
+}
+
+/* Three-way bytewise comparison, shorter strings first on a common prefix */
+static int compare_bytes(const char* a, size_t a_len, const char* b, size_t b_len) {
+    size_t len = a_len < b_len ? a_len : b_len;
+    int cmp = len ? memcmp(a, b, len) : 0;
+    if (cmp != 0) return cmp;
+    return a_len < b_len ? -1 : (a_len > b_len ? 1 : 0);
+}
+
+static int comparison_holds(int cmp, cdb_cmp_op_t op) {
+    switch (op) {
+        case CDB_CMP_EQ: return cmp == 0;
+        case CDB_CMP_NE: return cmp != 0;
+        case CDB_CMP_LT: return cmp < 0;
+        case CDB_CMP_LE: return cmp <= 0;
+        case CDB_CMP_GT: return cmp > 0;
+        case CDB_CMP_GE: return cmp >= 0;
+        default: return 0;
+    }
+}
+
+/* STRING columns: compare each row's bytes */
+static void compare_strings(const cdb_column_t* col, cdb_cmp_op_t op, const char* value, uint64_t* out) {
+    const uint64_t* offsets = (const uint64_t*)col->data;
+    size_t value_len = strlen(value);
+    
+    for (size_t row = 0; row < col->num_rows; row++) {
+        const char* bytes = col->string_data ? col->string_data + offsets[row] : "";
+        int cmp = compare_bytes(bytes, (size_t)(offsets[row + 1] - offsets[row]), value, value_len);
+        if (comparison_holds(cmp, op)) out[row / 64] |= (uint64_t)1 << (row % 64);
+    }
+}
+
+/* DICT_STRING columns: compare each distinct value once, then the codes */
+static int compare_dictionary(const cdb_column_t* col, cdb_cmp_op_t op, const char* value, uint64_t* out) {
+    size_t value_len = strlen(value);
+    uint8_t* matches = (uint8_t*)malloc(col->dict_size ? col->dict_size : 1);
+    if (!matches) {
+        set_error("Failed to allocate dictionary matches");
+        return -1;
+    }
+    
+    int64_t equal_code = -1;
+    for (size_t code = 0; code < col->dict_size; code++) {
+        uint64_t start = col->dict_offsets[code];
+        int cmp = compare_bytes(col->string_data ? col->string_data + start : "",
+                                (size_t)(col->dict_offsets[code + 1] - start), value, value_len);
+        matches[code] = (uint8_t)comparison_holds(cmp, op);
+        if (cmp == 0) equal_code = (int64_t)code;
+    }
+    
+    if (op == CDB_CMP_EQ || op == CDB_CMP_NE) {
+        /* At most one code is equal: compare codes with the vector kernel */
+        if (equal_code >= 0) {
+            select_kernels()->compare_codes(col, op, (uint32_t)equal_code, out);
+        } else if (op == CDB_CMP_NE) {
+            for (size_t w = 0; w < selection_words(col->num_rows); w++) out[w] = row_mask(col->num_rows, w);
+        }
+    } else {
+        const uint32_t* codes = (const uint32_t*)col->data;
+        for (size_t row = 0; row < col->num_rows; row++) {
+            if (codes[row] < col->dict_size && matches[codes[row]]) {
+                out[row / 64] |= (uint64_t)1 << (row % 64);
+            }
+        }
+    }
+    free(matches);
+    return 0;
+}
+
+static int value_is_nan(const cdb_column_t* col, const cdb_value_t* value) {
+    if (col->data_type == CDB_TYPE_FLOAT32) return isnan(value->as.f32);
+    if (col->data_type == CDB_TYPE_FLOAT64) return isnan(value->as.f64);
+    return 0;
+}
+
+#define CDB_BOUND_SEARCH(T, KEY)                                                 \
+    do {                                                                         \
+        const T* values = (const T*)col->data;                                   \
+        T key = (KEY);                                                           \
+        while (lo < hi) {                                                        \
+            size_t mid = lo + (hi - lo) / 2;                                     \
+            if (after_equal ? values[mid] <= key : values[mid] < key) {          \
+                lo = mid + 1;                                                    \
+            } else {                                                             \
+                hi = mid;                                                        \
+            }                                                                    \
+        }                                                                        \
+    } while (0)
+
+/* First row of a sorted column with a value >= c (> c if after_equal); c is not NaN */
+static size_t sorted_bound(const cdb_column_t* col, const cdb_value_t* c, int after_equal) {
+    size_t lo = col->null_count;
+    size_t hi = col->num_rows;
+    switch (col->data_type) {
+        case CDB_TYPE_INT32: CDB_BOUND_SEARCH(int32_t, c->as.i32); break;
+        case CDB_TYPE_INT64: CDB_BOUND_SEARCH(int64_t, c->as.i64); break;
+        case CDB_TYPE_FLOAT32: CDB_BOUND_SEARCH(float, c->as.f32); break;
+        case CDB_TYPE_FLOAT64: CDB_BOUND_SEARCH(double, c->as.f64); break;
+        case CDB_TYPE_BOOL: CDB_BOUND_SEARCH(uint8_t, (uint8_t)(c->as.b ? 1 : 0)); break;
+        default: break;
+    }
+    return lo;
+}
+
+#undef CDB_BOUND_SEARCH
+
+/* Rows of a sorted column holding lo <= value <= hi */
+int cdb_range(const cdb_column_t* col, const cdb_value_t* lo, const cdb_value_t* hi,
+              size_t* start, size_t* end) {
+    if (!col || !start || !end) {
+        set_error("Invalid column or range");
+        return -1;
+    }
+    if (col->storage == CDB_STORAGE_UNLOADED) {
+        set_error("Column is not loaded");
+        return -1;
+    }
+    if (!col->sorted) {
+        set_error("Column is not sorted");
+        return -1;
+    }
+    if ((lo && lo->is_null) || (hi && hi->is_null)) {
+        set_error("Range bounds must not be NULL");
+        return -1;
+    }
+    
+    /* NaN bounds match nothing, like the scans */
+    if ((lo && value_is_nan(col, lo)) || (hi && value_is_nan(col, hi))) {
+        *start = *end = col->null_count;
+        return 0;
+    }
+    *start = lo ? sorted_bound(col, lo, 0) : col->null_count;
+    *end = hi ? sorted_bound(col, hi, 1) : col->num_rows;
+    if (*end < *start) *end = *start;
+    return 0;
+}
+
+/* Set the bits of rows [begin, end) */
+static void select_rows(uint64_t* words, size_t begin, size_t end) {
+    size_t row = begin;
+    while (row < end) {
+        if (row % 64 == 0 && end - row >= 64) {
+            words[row / 64] = ~(uint64_t)0;
+            row += 64;
+        } else {
+            words[row / 64] |= (uint64_t)1 << (row % 64);
+            row++;
+        }
+    }
+}
+
+/* Comparison on a sorted column: at most two runs of rows, found by binary search */
+static void select_sorted(const cdb_column_t* col, cdb_cmp_op_t op, const cdb_value_t* value, uint64_t* out) {
+    size_t first = col->null_count;
+    size_t n = col->num_rows;
+    size_t below = sorted_bound(col, value, 0);   /* First row >= value */
+    size_t above = sorted_bound(col, value, 1);   /* First row > value */
+    
+    switch (op) {
+        case CDB_CMP_EQ: select_rows(out, below, above); break;
+        case CDB_CMP_NE:
+            select_rows(out, first, below);
+            select_rows(out, above, n);
+            break;
+        case CDB_CMP_LT: select_rows(out, first, below); break;
+        case CDB_CMP_LE: select_rows(out, first, above); break;
+        case CDB_CMP_GT: select_rows(out, above, n); break;
+        case CDB_CMP_GE: select_rows(out, below, n); break;
+        default: break;
+    }
+}
+
+/* Select the rows of a column that satisfy a comparison */
+int cdb_select(const cdb_column_t* col, cdb_cmp_op_t op, const cdb_value_t* value, cdb_selection_t* out) {
+    if (!col || !out) {
+        set_error("Invalid column or selection");
+        return -1;
+    }
+    out->words = NULL;
+    out->num_rows = 0;
+    if (op < CDB_CMP_EQ || op > CDB_CMP_IS_NOT_NULL) {
+        set_error("Unknown comparison operator");
+        return -1;
+    }
+    if (op < CDB_CMP_IS_NULL && !value) {
+        set_error("Comparison requires a value");
+        return -1;
+    }
+    if (col->storage == CDB_STORAGE_UNLOADED) {
+        set_error("Column is not loaded");
+        return -1;
+    }
+    
+    size_t n = col->num_rows;
+    size_t num_words = selection_words(n);
+    uint64_t* words = (uint64_t*)calloc(num_words ? num_words : 1, sizeof(uint64_t));
+    if (!words) {
+        set_error("Failed to allocate selection");
+        return -1;
+    }
+    int is_string = (col->data_type == CDB_TYPE_STRING || col->data_type == CDB_TYPE_DICT_STRING);
+    
+    if (op == CDB_CMP_IS_NULL || op == CDB_CMP_IS_NOT_NULL) {
+        for (size_t w = 0; w < num_words; w++) {
+            uint64_t nulls = col->null_count ? cdb_null_word(col->null_bitmap, w * 64, n) : 0;
+            words[w] = (op == CDB_CMP_IS_NULL ? nulls : ~nulls) & row_mask(n, w);
+        }
+    } else if (value->is_null || (is_string && !value->as.str)) {
+        /* Comparing with NULL is never true */
+    } else if (col->sorted && !value_is_nan(col, value)) {
+        /* NULL rows come first and are never selected */
+        select_sorted(col, op, value, words);
+    } else if ((op == CDB_CMP_EQ || op == CDB_CMP_NE) && cdb_index_current(col)) {
+        cdb_index_select(col, value, words);
+        if (op == CDB_CMP_NE) {
+            for (size_t w = 0; w < num_words; w++) {
+                uint64_t nulls = col->null_count ? cdb_null_word(col->null_bitmap, w * 64, n) : 0;
+                words[w] = ~(words[w] | nulls) & row_mask(n, w);
+            }
+        }
+    } else {
+        if (col->data_type == CDB_TYPE_STRING) {
+            compare_strings(col, op, value->as.str, words);
+        } else if (col->data_type == CDB_TYPE_DICT_STRING) {
+            if (compare_dictionary(col, op, value->as.str, words) < 0) {
+                free(words);
+                return -1;
+            }
+        } else if (cdb_type_size(col->data_type) > 0) {
+            select_kernels()->compare(col, op, value, words);
+        } else {
+            free(words);
+            set_error("Unknown data type");
+            return -1;
+        }
+        cdb_stat_add(CDB_STAT_ROWS_SCANNED, n);
+        
+        /* NULL rows never match */
+        if (col->null_count) {
+            for (size_t w = 0; w < num_words; w++) {
+                words[w] &= ~cdb_null_word(col->null_bitmap, w * 64, n);
+            }
+        }
+    }
+    
+    out->words = words;
+    out->num_rows = n;
+    return 0;
+}
+
+static int check_same_rows(const cdb_selection_t* sel, const cdb_selection_t* other) {
+    if (!sel || !other || !sel->words || !other->words) {
+        set_error("Invalid selection");
+        return -1;
+    }
+    if (sel->num_rows != other->num_rows) {
+        set_error("Selections have different row counts");
+        return -1;
+    }
+    return 0;
+}
+
+int cdb_selection_and(cdb_selection_t* sel, const cdb_selection_t* other) {
+    if (check_same_rows(sel, other) < 0) return -1;
+    for (size_t w = 0; w < selection_words(sel->num_rows); w++) sel->words[w] &= other->words[w];
+    return 0;
+}
+
+int cdb_selection_or(cdb_selection_t* sel, const cdb_selection_t* other) {
+    if (check_same_rows(sel, other) < 0) return -1;
+    for (size_t w = 0; w < selection_words(sel->num_rows); w++) sel->words[w] |= other->words[w];
+    return 0;
+}
+
+/* Number of selected rows */
+size_t cdb_selection_count(const cdb_selection_t* sel) {
+    if (!sel || !sel->words) return 0;
+    size_t count = 0;
+    for (size_t w = 0; w < selection_words(sel->num_rows); w++) count += popcount64(sel->words[w]);
+    return count;
+}
+
+void cdb_selection_free(cdb_selection_t* sel) {
+    if (!sel) return;
+    free(sel->words);
+    sel->words = NULL;
+    sel->num_rows = 0;
+}
+
+/* Evaluate a compiled filter with a stack of selections */
+int cdb_where(cdb_database_t* db, const cdb_predicate_t* terms, size_t num_terms, cdb_selection_t* out) {
+    if (!db || !terms || num_terms == 0 || !out) {
+        set_error("Invalid database or filter");
+        return -1;
+    }
+    out->words = NULL;
+    out->num_rows = 0;
+    
+    cdb_selection_t* stack = (cdb_selection_t*)calloc(num_terms, sizeof(cdb_selection_t));
+    if (!stack) {
+        set_error("Failed to allocate filter stack");
+        return -1;
+    }
+    
+    size_t depth = 0;
+    int status = 0;
+    for (size_t t = 0; status == 0 && t < num_terms; t++) {
+        const cdb_predicate_t* term = &terms[t];
+        if (term->kind == CDB_PRED_COMPARE) {
+            cdb_column_t* col = cdb_get_column(db, term->column);
+            status = col ? cdb_select(col, term->op, &term->value, &stack[depth]) : -1;
+            if (status == 0) depth++;
+        } else if ((term->kind == CDB_PRED_AND || term->kind == CDB_PRED_OR) && depth >= 2) {
+            cdb_selection_t* top = &stack[depth - 1];
+            status = term->kind == CDB_PRED_AND ? cdb_selection_and(&stack[depth - 2], top)
+                                                : cdb_selection_or(&stack[depth - 2], top);
+            cdb_selection_free(top);
+            depth--;
+        } else {
+            set_error("Malformed filter");
+            status = -1;
+        }
+    }
+    if (status == 0 && depth != 1) {
+        set_error("Malformed filter");
+        status = -1;
+    }
+    
+    if (status == 0) {
+        *out = stack[0];
+    } else {
+        for (size_t i = 0; i < depth; i++) cdb_selection_free(&stack[i]);
+    }
+    free(stack);
+    return status;
+}
+
+/* Gather loop for elements of type T: whole words are copied at once,
+ * other words one selected row at a time */
+#define GATHER_FIXED(name, T)                                                       \
+static void name(const T* values, const cdb_selection_t* sel, T* out) {             \
+    size_t count = 0;                                                               \
+    for (size_t w = 0; w < selection_words(sel->num_rows); w++) {                   \
+        uint64_t word = sel->words[w];                                              \
+        if (word == ~(uint64_t)0) {                                                 \
+            memcpy(out + count, values + w * 64, 64 * sizeof(T));                   \
+            count += 64;                                                            \
+            continue;                                                               \
+        }                                                                           \
+        for (; word; word &= word - 1) {                                            \
+            out[count++] = values[w * 64 + count_trailing_zeros(word)];             \
+        }                                                                           \
+    }                                                                               \
+}
+
+GATHER_FIXED(gather_8, uint8_t)
+GATHER_FIXED(gather_32, uint32_t)
+GATHER_FIXED(gather_64, uint64_t)
+
+#undef GATHER_FIXED
+
+/* Copy the selected fixed-width values, with one dispatch on the element size */
+static void gather_fixed(const cdb_column_t* src, const cdb_selection_t* sel, cdb_column_t* dst) {
+    switch (cdb_type_size(src->data_type)) {
+        case 1:
+            gather_8((const uint8_t*)src->data, sel, (uint8_t*)dst->data);
+            break;
+        case 4:
+            gather_32((const uint32_t*)src->data, sel, (uint32_t*)dst->data);
+            break;
+        default:
+            gather_64((const uint64_t*)src->data, sel, (uint64_t*)dst->data);
+            break;
+    }
+}
+
+/* Copy the selected STRING values into the destination's offsets and bytes */
+static int gather_strings(const cdb_column_t* src, const cdb_selection_t* sel, cdb_column_t* dst) {
+    const uint64_t* offsets = (const uint64_t*)src->data;
+    size_t total_bytes = 0;
+    for (size_t w = 0; w < selection_words(sel->num_rows); w++) {
+        for (uint64_t word = sel->words[w]; word; word &= word - 1) {
+            size_t row = w * 64 + count_trailing_zeros(word);
+            total_bytes += (size_t)(offsets[row + 1] - offsets[row]);
+        }
+    }
+    if (cdb_string_reserve(dst, total_bytes) < 0) return -1;
+    
+    uint64_t* out = (uint64_t*)dst->data;
+    size_t count = 0;
+    for (size_t w = 0; w < selection_words(sel->num_rows); w++) {
+        for (uint64_t word = sel->words[w]; word; word &= word - 1) {
+            size_t row = w * 64 + count_trailing_zeros(word);
+            size_t len = (size_t)(offsets[row + 1] - offsets[row]);
+            if (len > 0) {
+                memcpy(dst->string_data + dst->string_data_size, src->string_data + offsets[row], len);
+            }
+            dst->string_data_size += len;
+            out[++count] = dst->string_data_size;
+        }
+    }
+    return 0;
+}
+
+/* Share-nothing copy of a dictionary; codes stay valid, unused entries are kept */
+static int copy_dictionary(const cdb_column_t* src, cdb_column_t* dst) {
+    if (src->dict_size == 0) return 0;
+    if (cdb_dict_reserve(dst, src->dict_size) < 0 ||
+        cdb_string_reserve(dst, src->string_data_size) < 0) {
+        return -1;
+    }
+    memcpy(dst->dict_offsets, src->dict_offsets, (src->dict_size + 1) * sizeof(uint64_t));
+    if (src->string_data_size > 0) {
+        memcpy(dst->string_data, src->string_data, src->string_data_size);
+    }
+    dst->dict_size = src->dict_size;
+    dst->string_data_size = src->string_data_size;
+    return 0;
+}
+
+/* Fill an empty column with the selected rows of src */
+static int gather_column(const cdb_column_t* src, const cdb_selection_t* sel, size_t count, cdb_column_t* dst) {
+    if (cdb_column_reserve(dst, count) < 0) return -1;
+    
+    if (src->data_type == CDB_TYPE_STRING) {
+        if (gather_strings(src, sel, dst) < 0) return -1;
+    } else {
+        if (src->data_type == CDB_TYPE_DICT_STRING && copy_dictionary(src, dst) < 0) return -1;
+        gather_fixed(src, sel, dst);
+    }
+    
+    if (src->null_count) {
+        size_t out_row = 0;
+        for (size_t w = 0; w < selection_words(sel->num_rows); w++) {
+            uint64_t nulls = cdb_null_word(src->null_bitmap, w * 64, src->num_rows);
+            for (uint64_t word = sel->words[w]; word; word &= word - 1) {
+                if ((nulls >> count_trailing_zeros(word)) & 1) {
+                    dst->null_bitmap[out_row / 8] |= (uint8_t)(1u << (out_row % 8));
+                    dst->null_count++;
+                }
+                out_row++;
+            }
+        }
+    }
+    dst->num_rows = count;
+    dst->sorted = src->sorted;  /* Selections keep row order */
+    return 0;
+}
+
+/* Copy the selected rows of some columns into another database */
+int cdb_filter(cdb_database_t* db, const cdb_selection_t* sel,
+               const char* const* names, size_t num_names, cdb_database_t* dst) {
+    if (!db || !sel || !sel->words || !dst || (names == NULL && num_names > 0)) {
+        set_error("Invalid database or selection");
+        return -1;
+    }
+    if (db == dst) {
+        set_error("Filter output must be another database");
+        return -1;
+    }
+    if (!names) num_names = db->num_columns;
+    
+    /* Check every column before copying anything */
+    for (size_t i = 0; i < num_names; i++) {
+        cdb_column_t* col = names ? cdb_get_column(db, names[i]) : cdb_get_column_by_index(db, i);
+        if (!col) return -1;
+        if (col->num_rows != sel->num_rows) {
+            char message[256];
+            snprintf(message, sizeof(message), "Selection does not match the rows of column '%s'", col->name);
+            set_error(message);
+            return -1;
+        }
+    }
+    
+    size_t count = cdb_selection_count(sel);
+    cdb_write_lock(dst);
+    int status = 0;
+    for (size_t i = 0; status == 0 && i < num_names; i++) {
+        const cdb_column_t* col = names ? cdb_get_column(db, names[i]) : &db->columns[i];
+        status = cdb_add_column(dst, col->name, col->data_type);
+        if (status == 0) {
+            status = gather_column(col, sel, count, &dst->columns[dst->num_columns - 1]);
+        }
+    }
+    cdb_write_unlock(dst);
+    return status;
+}
@@ -0,0 +1,88 @@
+/*
+ * ColumnDB compare kernels, compiled once per instruction set.
+ *
+ * Included by column_db_filter.c with CDB_KERNEL_SUFFIX and CDB_KERNEL_TARGET
+ * defined, like column_db_kernels.h. Each 64-row block is compared into one
+ * byte per row with a fixed trip count, which the compiler vectorizes, and
+ * the bytes are then packed into the block's selection word.
+ */
+
+#define CDB_KERNEL_PASTE2(name, suffix) name##suffix
+#define CDB_KERNEL_PASTE(name, suffix) CDB_KERNEL_PASTE2(name, suffix)
+#define CDB_KERNEL_NAME(name) CDB_KERNEL_PASTE(name, CDB_KERNEL_SUFFIX)
+
+/* Selection words of values[i] OP c; bits past n are 0 */
+#define CDB_COMPARE_LOOP(OP)                                                             \
+    for (size_t base = 0; base < n; base += 64) {                                       \
+        const T* block = values + base;                                                 \
+        uint8_t hits[64];                                                               \
+        if (n - base >= 64) {                                                           \
+            for (size_t i = 0; i < 64; i++) hits[i] = (uint8_t)(block[i] OP c);         \
+        } else {                                                                        \
+            size_t len = n - base;                                                      \
+            for (size_t i = 0; i < len; i++) hits[i] = (uint8_t)(block[i] OP c);        \
+            memset(hits + len, 0, 64 - len);                                            \
+        }                                                                               \
+        out[base / 64] = pack_hits(hits);                                               \
+    }
+
+#define CDB_COMPARE_KERNEL(name, TYPE)                                                  \
+static CDB_KERNEL_TARGET void CDB_KERNEL_NAME(name)(const TYPE* values, size_t n,      \
+                                                    cdb_cmp_op_t op, TYPE c,            \
+                                                    uint64_t* out) {                    \
+    typedef TYPE T;                                                                     \
+    switch (op) {                                                                       \
+        case CDB_CMP_EQ: CDB_COMPARE_LOOP(==) break;                                    \
+        case CDB_CMP_NE: CDB_COMPARE_LOOP(!=) break;                                    \
+        case CDB_CMP_LT: CDB_COMPARE_LOOP(<) break;                                     \
+        case CDB_CMP_LE: CDB_COMPARE_LOOP(<=) break;                                    \
+        case CDB_CMP_GT: CDB_COMPARE_LOOP(>) break;                                     \
+        case CDB_CMP_GE: CDB_COMPARE_LOOP(>=) break;                                    \
+        default: break;                                                                 \
+    }                                                                                   \
+}
+
+CDB_COMPARE_KERNEL(compare_int32, int32_t)
+CDB_COMPARE_KERNEL(compare_int64, int64_t)
+CDB_COMPARE_KERNEL(compare_float32, float)
+CDB_COMPARE_KERNEL(compare_float64, double)
+CDB_COMPARE_KERNEL(compare_uint8, uint8_t)    /* BOOL */
+CDB_COMPARE_KERNEL(compare_uint32, uint32_t)  /* DICT_STRING codes */
+
+/* Compare a fixed-width column with a value of its type, ignoring NULLs */
+static CDB_KERNEL_TARGET void CDB_KERNEL_NAME(compare)(const cdb_column_t* col, cdb_cmp_op_t op,
+                                                       const cdb_value_t* value, uint64_t* out) {
+    size_t n = col->num_rows;
+    
+    switch (col->data_type) {
+        case CDB_TYPE_INT32:
+            CDB_KERNEL_NAME(compare_int32)((const int32_t*)col->data, n, op, value->as.i32, out);
+            break;
+        case CDB_TYPE_INT64:
+            CDB_KERNEL_NAME(compare_int64)((const int64_t*)col->data, n, op, value->as.i64, out);
+            break;
+        case CDB_TYPE_FLOAT32:
+            CDB_KERNEL_NAME(compare_float32)((const float*)col->data, n, op, value->as.f32, out);
+            break;
+        case CDB_TYPE_FLOAT64:
+            CDB_KERNEL_NAME(compare_float64)((const double*)col->data, n, op, value->as.f64, out);
+            break;
+        case CDB_TYPE_BOOL:
+            CDB_KERNEL_NAME(compare_uint8)((const uint8_t*)col->data, n, op, value->as.b ? 1 : 0, out);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Compare the codes of a DICT_STRING column with one code */
+static CDB_KERNEL_TARGET void CDB_KERNEL_NAME(compare_codes)(const cdb_column_t* col, cdb_cmp_op_t op,
+                                                             uint32_t code, uint64_t* out) {
+    CDB_KERNEL_NAME(compare_uint32)((const uint32_t*)col->data, col->num_rows, op, code, out);
+}
+
+#undef CDB_COMPARE_KERNEL
+#undef CDB_COMPARE_LOOP
+#undef CDB_KERNEL_NAME
+#undef CDB_KERNEL_PASTE
+#undef CDB_KERNEL_PASTE2
@@ -0,0 +1,576 @@
+/*
+ * ColumnDB Group-By Implementation
+ * Hash aggregation: each task groups a range of rows into its own table,
+ * then the partial tables are merged in row order into the result
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include "column_db_internal.h"
+
+#define GROUP_CHUNK 1024            /* Rows whose groups are found before aggregating them */
+#define GROUP_TASK_MIN_ROWS 65536   /* Fewer rows per task are not worth a thread */
+#define GROUP_MIN_SLOTS 1024
+#define NO_GROUP UINT32_MAX
+#define MAX_GROUPS ((size_t)UINT32_MAX - 1)
+
+/* Binary operations the states reduce with, as in the aggregate kernels */
+#define CDB_STEP_SUM(acc, v) ((acc) + (v))
+#define CDB_STEP_WRAP_SUM(acc, v) ((int64_t)((uint64_t)(acc) + (uint64_t)(int64_t)(v)))  /* Wraps like int64 */
+#define CDB_STEP_MIN(acc, v) ((v) < (acc) ? (v) : (acc))  /* Skips NaN values */
+#define CDB_STEP_MAX(acc, v) ((v) > (acc) ? (v) : (acc))
+
+/* One aggregate of one group; integer inputs reduce in i, floats and
+ * every MEAN in f */
+typedef struct {
+    size_t count;         /* Non-NULL values (every row for COUNT(*)), NaN excluded for MIN/MAX */
+    int64_t i;
+    double f;
+} group_state_t;
+
+/* An aggregate resolved against its value column */
+typedef struct {
+    cdb_agg_op_t op;
+    const cdb_column_t* col;   /* NULL: COUNT(*) */
+    int is_float;
+} group_agg_t;
+
+/* Open addressing slot: the key sits next to its group so a probe touches one line */
+typedef struct {
+    int64_t key;
+    uint32_t group;
+} group_slot_t;
+
+typedef struct {
+    group_slot_t* slots;       /* INT32/INT64/BOOL keys; linear probing */
+    size_t slot_bits;
+    uint32_t* code_groups;     /* DICT_STRING keys: group of every code */
+    uint32_t null_group;
+    
+    /* Groups in order of first appearance */
+    int64_t* keys;
+    size_t* first_rows;
+    group_state_t* states;     /* num_aggs per group */
+    size_t num_groups;
+    size_t capacity;
+} group_table_t;
+
+typedef struct {
+    const cdb_column_t* key;
+    const group_agg_t* aggs;
+    size_t num_aggs;
+    const group_state_t* identity;  /* Initial state of each aggregate */
+    size_t num_rows;
+    size_t rows_per_task;
+    group_table_t* tables;          /* One per task */
+} group_job_t;
+
+static int is_float_type(cdb_data_type_t type) {
+    return type == CDB_TYPE_FLOAT32 || type == CDB_TYPE_FLOAT64;
+}
+
+static int row_is_null(const cdb_column_t* col, size_t row) {
+    return col->null_count && ((col->null_bitmap[row / 8] >> (row % 8)) & 1);
+}
+
+/* Fibonacci hashing: the multiply spreads sequential keys over the top bits */
+static size_t hash_slot(int64_t key, size_t bits) {
+    return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+static int table_init(group_table_t* table, const cdb_column_t* key) {
+    memset(table, 0, sizeof(*table));
+    table->null_group = NO_GROUP;
+    
+    if (key->data_type == CDB_TYPE_DICT_STRING) {
+        table->code_groups = (uint32_t*)malloc((key->dict_size ? key->dict_size : 1) * sizeof(uint32_t));
+        if (!table->code_groups) goto oom;
+        memset(table->code_groups, 0xFF, key->dict_size * sizeof(uint32_t));
+        return 0;
+    }
+    
+    table->slot_bits = 10;
+    table->slots = (group_slot_t*)malloc(GROUP_MIN_SLOTS * sizeof(group_slot_t));
+    if (!table->slots) goto oom;
+    for (size_t s = 0; s < GROUP_MIN_SLOTS; s++) table->slots[s].group = NO_GROUP;
+    return 0;
+
+oom:
+    set_error("Memory allocation failed");
+    return -1;
+}
+
+static void table_free(group_table_t* table) {
+    free(table->slots);
+    free(table->code_groups);
+    free(table->keys);
+    free(table->first_rows);
+    free(table->states);
+}
+
+/* Append a group first seen at row; NO_GROUP if out of memory */
+static uint32_t add_group(group_table_t* table, const group_job_t* job, int64_t key, size_t row) {
+    if (table->num_groups == table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 64;
+        if (capacity > MAX_GROUPS) capacity = MAX_GROUPS;
+        if (capacity == table->num_groups) {
+            set_error("Too many groups");
+            return NO_GROUP;
+        }
+        int64_t* keys = (int64_t*)realloc(table->keys, capacity * sizeof(int64_t));
+        if (keys) table->keys = keys;
+        size_t* first_rows = (size_t*)realloc(table->first_rows, capacity * sizeof(size_t));
+        if (first_rows) table->first_rows = first_rows;
+        group_state_t* states = (group_state_t*)realloc(table->states,
+                                                        (capacity * job->num_aggs + 1) * sizeof(group_state_t));
+        if (states) table->states = states;
+        if (!keys || !first_rows || !states) {
+            set_error("Memory allocation failed");
+            return NO_GROUP;
+        }
+        table->capacity = capacity;
+    }
+    
+    uint32_t group = (uint32_t)table->num_groups++;
+    table->keys[group] = key;
+    table->first_rows[group] = row;
+    memcpy(table->states + group * job->num_aggs, job->identity, job->num_aggs * sizeof(group_state_t));
+    return group;
+}
+
+/* Double the slot array once it is half full */
+static int grow_slots(group_table_t* table) {
+    size_t bits = table->slot_bits + 1;
+    size_t num_slots = (size_t)1 << bits;
+    group_slot_t* slots = (group_slot_t*)malloc(num_slots * sizeof(group_slot_t));
+    if (!slots) {
+        set_error("Memory allocation failed");
+        return -1;
+    }
+    for (size_t s = 0; s < num_slots; s++) slots[s].group = NO_GROUP;
+    
+    for (size_t g = 0; g < table->num_groups; g++) {
+        if (g == table->null_group) continue;
+        size_t s = hash_slot(table->keys[g], bits);
+        while (slots[s].group != NO_GROUP) s = (s + 1) & (num_slots - 1);
+        slots[s].key = table->keys[g];
+        slots[s].group = (uint32_t)g;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_bits = bits;
+    return 0;
+}
+
+/* Group of a key, added at row if it is new; NO_GROUP if out of memory */
+static uint32_t hash_group(group_table_t* table, const group_job_t* job, int64_t key, size_t row) {
+    size_t mask = ((size_t)1 << table->slot_bits) - 1;
+    size_t s = hash_slot(key, table->slot_bits);
+    for (;;) {
+        group_slot_t* slot = &table->slots[s];
+        if (slot->group == NO_GROUP) break;
+        if (slot->key == key) return slot->group;
+        s = (s + 1) & mask;
+    }
+    
+    uint32_t group = add_group(table, job, key, row);
+    if (group == NO_GROUP) return NO_GROUP;
+    table->slots[s].key = key;
+    table->slots[s].group = group;
+    if ((table->num_groups + 1) * 2 > ((size_t)1 << table->slot_bits) && grow_slots(table) < 0) {
+        return NO_GROUP;
+    }
+    return group;
+}
+
+static uint32_t null_group(group_table_t* table, const group_job_t* job, size_t row) {
+    if (table->null_group == NO_GROUP) table->null_group = add_group(table, job, 0, row);
+    return table->null_group;
+}
+
+/* Groups of rows [start, start + n), one loop per key type */
+#define GROUP_HASH_LOOP(TYPE)                                                            \
+    do {                                                                                 \
+        const TYPE* keys = (const TYPE*)key->data;                                       \
+        for (size_t i = 0; i < n; i++) {                                                 \
+            size_t row = start + i;                                                      \
+            groups[i] = row_is_null(key, row) ? null_group(table, job, row)              \
+                                              : hash_group(table, job, (int64_t)keys[row], row); \
+            if (groups[i] == NO_GROUP) return -1;                                        \
+        }                                                                                \
+    } while (0)
+
+static int find_groups(group_table_t* table, const group_job_t* job, size_t start, size_t n, uint32_t* groups) {
+    const cdb_column_t* key = job->key;
+    
+    switch (key->data_type) {
+        case CDB_TYPE_INT32: GROUP_HASH_LOOP(int32_t); break;
+        case CDB_TYPE_INT64: GROUP_HASH_LOOP(int64_t); break;
+        case CDB_TYPE_BOOL: GROUP_HASH_LOOP(uint8_t); break;
+        case CDB_TYPE_DICT_STRING: {
+            /* Codes are dense: index the groups directly, no hashing */
+            const uint32_t* codes = (const uint32_t*)key->data;
+            for (size_t i = 0; i < n; i++) {
+                size_t row = start + i;
+                uint32_t group;
+                if (row_is_null(key, row)) {
+                    group = null_group(table, job, row);
+                } else {
+                    group = table->code_groups[codes[row]];
+                    if (group == NO_GROUP) {
+                        group = add_group(table, job, codes[row], row);
+                        table->code_groups[codes[row]] = group;
+                    }
+                }
+                if (group == NO_GROUP) return -1;
+                groups[i] = group;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return 0;
+}
+
+#undef GROUP_HASH_LOOP
+
+/* Fold the values of rows [start, start + n) into their groups' states;
+ * with SKIP_NAN, NaN values are left out of the count as well */
+#define GROUP_UPDATE_LOOP(TYPE, FIELD, STEP, SKIP_NAN)                                   \
+    do {                                                                                 \
+        const TYPE* values = (const TYPE*)col->data;                                     \
+        for (size_t i = 0; i < n; i++) {                                                 \
+            size_t row = start + i;                                                      \
+            if (row_is_null(col, row)) continue;                                         \
+            if (SKIP_NAN && values[row] != values[row]) continue;                        \
+            group_state_t* state = &states[(size_t)groups[i] * num_aggs];                \
+            state->FIELD = STEP(state->FIELD, values[row]);                              \
+            state->count++;                                                              \
+        }                                                                                \
+    } while (0)
+
+#define GROUP_UPDATE_TYPES(INT_FIELD, INT_STEP, STEP, SKIP_NAN)                          \
+    switch (col->data_type) {                                                            \
+        case CDB_TYPE_INT32: GROUP_UPDATE_LOOP(int32_t, INT_FIELD, INT_STEP, 0); break;  \
+        case CDB_TYPE_INT64: GROUP_UPDATE_LOOP(int64_t, INT_FIELD, INT_STEP, 0); break;  \
+        case CDB_TYPE_BOOL: GROUP_UPDATE_LOOP(uint8_t, INT_FIELD, INT_STEP, 0); break;   \
+        case CDB_TYPE_FLOAT32: GROUP_UPDATE_LOOP(float, f, STEP, SKIP_NAN); break;       \
+        case CDB_TYPE_FLOAT64: GROUP_UPDATE_LOOP(double, f, STEP, SKIP_NAN); break;      \
+        default: break;                                                                  \
+    }
+
+static void update_states(const group_agg_t* agg, group_state_t* states, size_t num_aggs,
+                          const uint32_t* groups, size_t start, size_t n) {
+    const cdb_column_t* col = agg->col;
+    
+    if (!col) {
+        for (size_t i = 0; i < n; i++) states[(size_t)groups[i] * num_aggs].count++;
+        return;
+    }
+    if (agg->op == CDB_AGG_COUNT) {
+        for (size_t i = 0; i < n; i++) {
+            if (!row_is_null(col, start + i)) states[(size_t)groups[i] * num_aggs].count++;
+        }
+        return;
+    }
+    
+    /* Integer sums wrap like int64 arithmetic; means sum in a double, which cannot overflow */
+    switch (agg->op) {
+        case CDB_AGG_SUM:
+            GROUP_UPDATE_TYPES(i, CDB_STEP_WRAP_SUM, CDB_STEP_SUM, 0)
+            break;
+        case CDB_AGG_MEAN:
+            GROUP_UPDATE_TYPES(f, CDB_STEP_SUM, CDB_STEP_SUM, 0)
+            break;
+        case CDB_AGG_MIN:
+            GROUP_UPDATE_TYPES(i, CDB_STEP_MIN, CDB_STEP_MIN, 1)
+            break;
+        case CDB_AGG_MAX:
+            GROUP_UPDATE_TYPES(i, CDB_STEP_MAX, CDB_STEP_MAX, 1)
+            break;
+        default:
+            break;
+    }
+}
+
+#undef GROUP_UPDATE_TYPES
+#undef GROUP_UPDATE_LOOP
+
+/* Group one task's range of rows into its own table */
+static int group_task(void* ctx, size_t index) {
+    const group_job_t* job = (const group_job_t*)ctx;
+    group_table_t* table = &job->tables[index];
+    size_t begin = index * job->rows_per_task;
+    size_t end = begin + job->rows_per_task < job->num_rows ? begin + job->rows_per_task : job->num_rows;
+    uint32_t groups[GROUP_CHUNK];
+    
+    for (size_t start = begin; start < end; start += GROUP_CHUNK) {
+        size_t n = end - start < GROUP_CHUNK ? end - start : GROUP_CHUNK;
+        if (find_groups(table, job, start, n, groups) < 0) return -1;
+        for (size_t a = 0; a < job->num_aggs; a++) {
+            update_states(&job->aggs[a], table->states + a, job->num_aggs, groups, start, n);
+        }
+    }
+    return 0;
+}
+
+static void merge_state(const group_agg_t* agg, group_state_t* dst, const group_state_t* src) {
+    switch (agg->op) {
+        case CDB_AGG_MIN:
+            dst->i = CDB_STEP_MIN(dst->i, src->i);
+            dst->f = CDB_STEP_MIN(dst->f, src->f);
+            break;
+        case CDB_AGG_MAX:
+            dst->i = CDB_STEP_MAX(dst->i, src->i);
+            dst->f = CDB_STEP_MAX(dst->f, src->f);
+            break;
+        default:
+            dst->i = CDB_STEP_WRAP_SUM(dst->i, src->i);
+            dst->f += src->f;
+            break;
+    }
+    dst->count += src->count;
+}
+
+/* Merge a later task's table into the first; groups it adds keep row order */
+static int merge_table(group_table_t* into, const group_table_t* from, const group_job_t* job) {
+    for (size_t g = 0; g < from->num_groups; g++) {
+        int64_t key = from->keys[g];
+        size_t row = from->first_rows[g];
+        uint32_t group;
+        if (g == from->null_group) {
+            group = null_group(into, job, row);
+        } else if (into->code_groups) {
+            group = into->code_groups[key];
+            if (group == NO_GROUP) {
+                group = add_group(into, job, key, row);
+                into->code_groups[key] = group;
+            }
+        } else {
+            group = hash_group(into, job, key, row);
+        }
+        if (group == NO_GROUP) return -1;
+        
+        for (size_t a = 0; a < job->num_aggs; a++) {
+            merge_state(&job->aggs[a], &into->states[(size_t)group * job->num_aggs + a],
+                        &from->states[g * job->num_aggs + a]);
+        }
+    }
+    return 0;
+}
+
+static const char* agg_name(cdb_agg_op_t op) {
+    static const char* const names[] = {"sum", "min", "max", "count", "mean"};
+    return names[op];
+}
+
+/* Add one aggregate's column of per-group results to dst */
+static int emit_aggregate(cdb_database_t* dst, const cdb_group_agg_t* spec, const group_agg_t* agg,
+                          const group_table_t* table, size_t num_aggs, size_t a) {
+    char default_name[256];
+    const char* name = spec->output;
+    if (!name) {
+        if (spec->column) {
+            snprintf(default_name, sizeof(default_name), "%s_%s", agg_name(agg->op), spec->column);
+        } else {
+            snprintf(default_name, sizeof(default_name), "count");
+        }
+        name = default_name;
+    }
+    
+    size_t n = table->num_groups;
+    int is_float = agg->op == CDB_AGG_MEAN || (agg->op != CDB_AGG_COUNT && agg->is_float);
+    void* values = malloc((n ? n : 1) * (is_float ? sizeof(double) : sizeof(int64_t)));
+    uint8_t* nulls = (uint8_t*)calloc(n / 8 + 1, 1);
+    if (!values || !nulls) {
+        free(values);
+        free(nulls);
+        set_error("Memory allocation failed");
+        return -1;
+    }
+    
+    for (size_t g = 0; g < n; g++) {
+        const group_state_t* state = &table->states[g * num_aggs + a];
+        if (agg->op == CDB_AGG_COUNT) {
+            ((int64_t*)values)[g] = (int64_t)state->count;
+            continue;
+        }
+        if (state->count == 0) {
+            /* SQL semantics: aggregates over no values are NULL */
+            nulls[g / 8] |= (uint8_t)(1u << (g % 8));
+            if (is_float) ((double*)values)[g] = 0.0;
+            else ((int64_t*)values)[g] = 0;
+        } else if (agg->op == CDB_AGG_MEAN) {
+            ((double*)values)[g] = state->f / (double)state->count;
+        } else if (is_float) {
+            ((double*)values)[g] = state->f;
+        } else {
+            ((int64_t*)values)[g] = state->i;
+        }
+    }
+    
+    cdb_data_type_t type = is_float ? CDB_TYPE_FLOAT64 : CDB_TYPE_INT64;
+    int status = cdb_add_column(dst, name, type);
+    if (status == 0) {
+        status = is_float ? cdb_append_float64_array(dst, name, (const double*)values, n, nulls)
+                          : cdb_append_int64_array(dst, name, (const int64_t*)values, n, nulls);
+    }
+    free(values);
+    free(nulls);
+    return status;
+}
+
+/* Resolve the key and value columns and check they can be grouped */
+static int resolve_group_by(cdb_database_t* db, const char* key_column, const cdb_group_agg_t* aggs,
+                            size_t num_aggs, group_agg_t* resolved, const cdb_column_t** key) {
+    *key = cdb_get_column(db, key_column);
+    if (!*key) return -1;
+    switch ((*key)->data_type) {
+        case CDB_TYPE_INT32:
+        case CDB_TYPE_INT64:
+        case CDB_TYPE_BOOL:
+        case CDB_TYPE_DICT_STRING:
+            break;
+        default:
+            set_error("Group-by key must be an int32, int64, bool or dictionary column");
+            return -1;
+    }
+    
+    for (size_t a = 0; a < num_aggs; a++) {
+        resolved[a].op = aggs[a].op;
+        resolved[a].col = NULL;
+        resolved[a].is_float = 0;
+        if (aggs[a].op < CDB_AGG_SUM || aggs[a].op > CDB_AGG_MEAN) {
+            set_error("Unknown aggregate operation");
+            return -1;
+        }
+        if (!aggs[a].column) {
+            if (aggs[a].op != CDB_AGG_COUNT) {
+                set_error("Only COUNT may omit its column");
+                return -1;
+            }
+            continue;
+        }
+        
+        const cdb_column_t* col = cdb_get_column(db, aggs[a].column);
+        if (!col) return -1;
+        if (col->num_rows != (*key)->num_rows) {
+            char message[256];
+            snprintf(message, sizeof(message), "Column '%s' has a different row count than the key", col->name);
+            set_error(message);
+            return -1;
+        }
+        if (aggs[a].op != CDB_AGG_COUNT && col->data_type != CDB_TYPE_INT32 &&
+            col->data_type != CDB_TYPE_INT64 && col->data_type != CDB_TYPE_BOOL &&
+            !is_float_type(col->data_type)) {
+            set_error("Aggregate requires a numeric or bool column");
+            return -1;
+        }
+        resolved[a].col = col;
+        resolved[a].is_float = is_float_type(col->data_type);
+    }
+    return 0;
+}
+
+/* Group a database's rows by one key column */
+int cdb_group_by(cdb_database_t* db, const char* key_column,
+                 const cdb_group_agg_t* aggs, size_t num_aggs, cdb_database_t* dst) {
+    if (!db || !key_column || !dst || (!aggs && num_aggs > 0)) {
+        set_error("Invalid database or aggregates");
+        return -1;
+    }
+    if (db == dst) {
+        set_error("Group-by output must be another database");
+        return -1;
+    }
+    
+    group_agg_t* resolved = (group_agg_t*)malloc((num_aggs + 1) * sizeof(group_agg_t));
+    group_state_t* identity = (group_state_t*)calloc(num_aggs + 1, sizeof(group_state_t));
+    if (!resolved || !identity) {
+        free(resolved);
+        free(identity);
+        set_error("Memory allocation failed");
+        return -1;
+    }
+    
+    group_job_t job;
+    memset(&job, 0, sizeof(job));
+    int status = resolve_group_by(db, key_column, aggs, num_aggs, resolved, &job.key);
+    for (size_t a = 0; status == 0 && a < num_aggs; a++) {
+        if (aggs[a].op == CDB_AGG_MIN) {
+            identity[a].i = INT64_MAX;
+            identity[a].f = HUGE_VAL;
+        } else if (aggs[a].op == CDB_AGG_MAX) {
+            identity[a].i = INT64_MIN;
+            identity[a].f = -HUGE_VAL;
+        }
+    }
+    job.aggs = resolved;
+    job.num_aggs = num_aggs;
+    job.identity = identity;
+    job.num_rows = status == 0 ? job.key->num_rows : 0;
+    
+    /* Split the rows into whole 64-row blocks, one range per task */
+    size_t threads = db->num_threads ? db->num_threads : cdb_cpu_count();
+    size_t num_tasks = (job.num_rows + GROUP_TASK_MIN_ROWS - 1) / GROUP_TASK_MIN_ROWS;
+    if (num_tasks > threads) num_tasks = threads;
+    if (num_tasks == 0) num_tasks = 1;
+    job.rows_per_task = ((job.num_rows + num_tasks - 1) / num_tasks + 63) / 64 * 64;
+    if (job.rows_per_task == 0) job.rows_per_task = 64;
+    num_tasks = (job.num_rows + job.rows_per_task - 1) / job.rows_per_task;
+    if (num_tasks == 0) num_tasks = 1;
+    
+    size_t tables_ready = 0;
+    if (status == 0) {
+        job.tables = (group_table_t*)calloc(num_tasks, sizeof(group_table_t));
+        if (!job.tables) {
+            set_error("Memory allocation failed");
+            status = -1;
+        }
+    }
+    for (; status == 0 && tables_ready < num_tasks; tables_ready++) {
+        status = table_init(&job.tables[tables_ready], job.key);
+    }
+    
+    if (status == 0) {
+        cdb_thread_pool_t* pool = num_tasks > 1 ? cdb_pool_create(num_tasks) : NULL;
+        status = cdb_pool_run(pool, num_tasks, group_task, &job);
+        cdb_pool_destroy(pool);
+        if (status == 0) cdb_stat_add(CDB_STAT_ROWS_SCANNED, job.num_rows);
+    }
+    for (size_t t = 1; status == 0 && t < num_tasks; t++) {
+        status = merge_table(&job.tables[0], &job.tables[t], &job);
+    }
+    
+    if (status == 0) {
+        /* Each group's first row selects its key, in order of first appearance */
+        const group_table_t* table = &job.tables[0];
+        cdb_selection_t sel;
+        sel.num_rows = job.num_rows;
+        sel.words = (uint64_t*)calloc(job.num_rows / 64 + 1, sizeof(uint64_t));
+        if (!sel.words) {
+            set_error("Memory allocation failed");
+            status = -1;
+        } else {
+            for (size_t g = 0; g < table->num_groups; g++) {
+                sel.words[table->first_rows[g] / 64] |= (uint64_t)1 << (table->first_rows[g] % 64);
+            }
+            cdb_write_lock(dst);
+            status = cdb_filter(db, &sel, &key_column, 1, dst);
+            for (size_t a = 0; status == 0 && a < num_aggs; a++) {
+                status = emit_aggregate(dst, &aggs[a], &resolved[a], table, num_aggs, a);
+            }
+            cdb_write_unlock(dst);
+            cdb_selection_free(&sel);
+        }
+    }
+    
+    for (size_t t = 0; t < tables_ready; t++) table_free(&job.tables[t]);
+    free(job.tables);
+    free(resolved);
+    free(identity);
+    return status;
+}
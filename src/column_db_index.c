@@ -0,0 +1,619 @@
+/*
+ * ColumnDB Index Implementation
+ * Secondary indexes over one column: hash indexes keep the row numbers of
+ * every distinct value, bitmap indexes keep them as roaring-style
+ * containers of 65536 rows. Either kind is one block of 8-byte words that
+ * is saved to and loaded from the file as is.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "column_db_internal.h"
+
+#define INDEX_HEADER_WORDS 6
+#define INDEX_CHUNK_ROWS 65536
+#define INDEX_CHUNK_WORDS (INDEX_CHUNK_ROWS / 64)
+#define INDEX_ARRAY_MAX 4096        /* Containers with more rows are bitmaps */
+#define INDEX_BITMAP_ROWS_PER_KEY 64 /* CDB_INDEX_AUTO picks a bitmap index from this many rows per value */
+#define INDEX_MIN_SLOTS 64
+
+/* Rows of one value within one chunk of 65536 rows. Up to INDEX_ARRAY_MAX
+ * rows are a sorted array of uint16 offsets, more are a 1024-word bitmap. */
+typedef struct {
+    uint32_t chunk;
+    uint32_t count;
+    uint64_t offset;   /* First payload word */
+} cdb_index_container_t;
+
+/* Block layout (see CDB_FILE_FORMAT.md): header words, slots and key rows,
+ * key starts, then row numbers (HASH) or containers and payload (BITMAP) */
+struct cdb_index {
+    cdb_index_kind_t kind;
+    size_t num_rows;       /* Rows indexed; the index is stale once the column has more */
+    size_t num_keys;       /* Distinct non-NULL values */
+    size_t num_slots;      /* Power of two */
+    size_t num_entries;    /* Row numbers (HASH) or containers (BITMAP) */
+    size_t num_words;      /* BITMAP payload words */
+    uint64_t* block;
+    size_t block_size;
+    const uint32_t* slots;       /* Key + 1 by hash, 0 for an empty slot */
+    const uint32_t* key_rows;    /* First row holding each key */
+    const uint64_t* starts;      /* num_keys + 1 offsets into the entries */
+    const uint32_t* rows;
+    const cdb_index_container_t* containers;
+    const uint64_t* words;
+};
+
+static size_t words_for(size_t bytes) {
+    return (bytes + 7) / 8;
+}
+
+/* Words of a block with these sizes; fills the index's array pointers when block is set */
+static size_t index_layout(cdb_index_t* index, uint64_t* block) {
+    size_t pos = INDEX_HEADER_WORDS;
+    size_t slots_at = pos;
+    pos += words_for((index->num_slots + index->num_keys) * sizeof(uint32_t));
+    size_t starts_at = pos;
+    pos += index->num_keys + 1;
+    size_t entries_at = pos;
+    if (index->kind == CDB_INDEX_HASH) {
+        pos += words_for(index->num_entries * sizeof(uint32_t));
+    } else {
+        pos += index->num_entries * (sizeof(cdb_index_container_t) / 8);
+    }
+    size_t words_at = pos;
+    pos += index->num_words;
+    
+    if (block) {
+        index->block = block;
+        index->block_size = pos * 8;
+        index->slots = (const uint32_t*)(block + slots_at);
+        index->key_rows = index->slots + index->num_slots;
+        index->starts = block + starts_at;
+        index->rows = (const uint32_t*)(block + entries_at);
+        index->containers = (const cdb_index_container_t*)(block + entries_at);
+        index->words = block + words_at;
+    }
+    return pos;
+}
+
+/* splitmix64 finalizer: spreads nearby integers over the whole table */
+static uint64_t hash_int(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/* FNV-1a hash of a byte range */
+static uint64_t hash_bytes(const char* data, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static const char* row_string(const cdb_column_t* col, size_t row, size_t* len) {
+    const uint64_t* offsets = (const uint64_t*)col->data;
+    *len = (size_t)(offsets[row + 1] - offsets[row]);
+    return col->string_data ? col->string_data + offsets[row] : "";
+}
+
+/* Integer key of a row: its value, or its code in a DICT_STRING column */
+static int64_t row_key(const cdb_column_t* col, size_t row) {
+    switch (col->data_type) {
+        case CDB_TYPE_INT32: return ((const int32_t*)col->data)[row];
+        case CDB_TYPE_INT64: return ((const int64_t*)col->data)[row];
+        case CDB_TYPE_BOOL: return ((const uint8_t*)col->data)[row];
+        case CDB_TYPE_DICT_STRING: return ((const uint32_t*)col->data)[row];
+        default: return 0;
+    }
+}
+
+static uint64_t row_hash(const cdb_column_t* col, size_t row) {
+    if (col->data_type == CDB_TYPE_STRING) {
+        size_t len;
+        const char* value = row_string(col, row, &len);
+        return hash_bytes(value, len);
+    }
+    return hash_int((uint64_t)row_key(col, row));
+}
+
+static int rows_equal(const cdb_column_t* col, size_t a, size_t b) {
+    if (col->data_type == CDB_TYPE_STRING) {
+        size_t len_a, len_b;
+        const char* value_a = row_string(col, a, &len_a);
+        const char* value_b = row_string(col, b, &len_b);
+        return len_a == len_b && (len_a == 0 || memcmp(value_a, value_b, len_a) == 0);
+    }
+    return row_key(col, a) == row_key(col, b);
+}
+
+int cdb_index_supported(cdb_data_type_t type) {
+    return type != CDB_TYPE_FLOAT32 && type != CDB_TYPE_FLOAT64;
+}
+
+void cdb_index_free(cdb_index_t* index) {
+    if (!index) return;
+    free(index->block);
+    free(index);
+}
+
+cdb_index_kind_t cdb_index_built_kind(const cdb_index_t* index) {
+    return index ? index->kind : CDB_INDEX_NONE;
+}
+
+const void* cdb_index_data(const cdb_index_t* index, size_t* size) {
+    *size = index->block_size;
+    return index->block;
+}
+
+/* Whether a column's index covers all of its rows */
+int cdb_index_current(const cdb_column_t* col) {
+    return col->index && col->index->num_rows == col->num_rows;
+}
+
+/* Distinct values of a column: the key of every row (UINT32_MAX for NULL),
+ * an open-addressing table of keys and the first row of each key */
+typedef struct {
+    uint32_t* row_keys;
+    uint32_t* slots;
+    size_t num_slots;
+    uint32_t* key_rows;
+    uint64_t* key_hashes;
+    size_t num_keys;
+    size_t key_capacity;
+} index_keys_t;
+
+static void free_keys(index_keys_t* keys) {
+    free(keys->row_keys);
+    free(keys->slots);
+    free(keys->key_rows);
+    free(keys->key_hashes);
+}
+
+static int grow_key_slots(index_keys_t* keys) {
+    size_t num_slots = keys->num_slots * 2;
+    uint32_t* slots = (uint32_t*)calloc(num_slots, sizeof(uint32_t));
+    if (!slots) return -1;
+    for (size_t k = 0; k < keys->num_keys; k++) {
+        size_t s = (size_t)keys->key_hashes[k] & (num_slots - 1);
+        while (slots[s]) s = (s + 1) & (num_slots - 1);
+        slots[s] = (uint32_t)(k + 1);
+    }
+    free(keys->slots);
+    keys->slots = slots;
+    keys->num_slots = num_slots;
+    return 0;
+}
+
+static int find_keys(const cdb_column_t* col, index_keys_t* keys) {
+    size_t n = col->num_rows;
+    memset(keys, 0, sizeof(*keys));
+    keys->num_slots = INDEX_MIN_SLOTS;
+    keys->row_keys = (uint32_t*)malloc((n ? n : 1) * sizeof(uint32_t));
+    keys->slots = (uint32_t*)calloc(keys->num_slots, sizeof(uint32_t));
+    if (!keys->row_keys || !keys->slots) return -1;
+    
+    for (size_t row = 0; row < n; row++) {
+        if (col->null_count && ((col->null_bitmap[row / 8] >> (row % 8)) & 1)) {
+            keys->row_keys[row] = UINT32_MAX;
+            continue;
+        }
+        uint64_t hash = row_hash(col, row);
+        size_t mask = keys->num_slots - 1;
+        size_t s = (size_t)hash & mask;
+        uint32_t key = UINT32_MAX;
+        for (; keys->slots[s]; s = (s + 1) & mask) {
+            uint32_t k = keys->slots[s] - 1;
+            if (keys->key_hashes[k] == hash && rows_equal(col, keys->key_rows[k], row)) {
+                key = k;
+                break;
+            }
+        }
+        
+        if (key == UINT32_MAX) {
+            if (keys->num_keys == keys->key_capacity) {
+                size_t capacity = keys->key_capacity ? keys->key_capacity * 2 : 64;
+                uint32_t* key_rows = (uint32_t*)realloc(keys->key_rows, capacity * sizeof(uint32_t));
+                if (key_rows) keys->key_rows = key_rows;
+                uint64_t* key_hashes = (uint64_t*)realloc(keys->key_hashes, capacity * sizeof(uint64_t));
+                if (key_hashes) keys->key_hashes = key_hashes;
+                if (!key_rows || !key_hashes) return -1;
+                keys->key_capacity = capacity;
+            }
+            key = (uint32_t)keys->num_keys++;
+            keys->key_rows[key] = (uint32_t)row;
+            keys->key_hashes[key] = hash;
+            keys->slots[s] = key + 1;
+            if (keys->num_keys * 2 > keys->num_slots && grow_key_slots(keys) < 0) return -1;
+        }
+        keys->row_keys[row] = key;
+    }
+    return 0;
+}
+
+/* Allocate an index block for the sizes already set, copying the key table in */
+static int alloc_block(cdb_index_t* index, const index_keys_t* keys) {
+    size_t num_words = index_layout(index, NULL);
+    uint64_t* block = (uint64_t*)calloc(num_words, sizeof(uint64_t));
+    if (!block) return -1;
+    index_layout(index, block);
+    
+    block[0] = (uint64_t)index->kind;
+    block[1] = index->num_rows;
+    block[2] = index->num_keys;
+    block[3] = index->num_slots;
+    block[4] = index->num_entries;
+    block[5] = index->num_words;
+    memcpy((uint32_t*)index->slots, keys->slots, index->num_slots * sizeof(uint32_t));
+    memcpy((uint32_t*)index->key_rows, keys->key_rows, index->num_keys * sizeof(uint32_t));
+    return 0;
+}
+
+/* Row numbers grouped by key, ascending within each key */
+static int group_rows(const cdb_column_t* col, const index_keys_t* keys, uint64_t** starts_out, uint32_t** rows_out) {
+    size_t n = col->num_rows;
+    uint64_t* starts = (uint64_t*)calloc(keys->num_keys + 1, sizeof(uint64_t));
+    uint32_t* rows = (uint32_t*)malloc((n - col->null_count + 1) * sizeof(uint32_t));
+    if (!starts || !rows) {
+        free(starts);
+        free(rows);
+        return -1;
+    }
+    
+    for (size_t row = 0; row < n; row++) {
+        if (keys->row_keys[row] != UINT32_MAX) starts[keys->row_keys[row] + 1]++;
+    }
+    for (size_t k = 0; k < keys->num_keys; k++) starts[k + 1] += starts[k];
+    
+    /* Fill with a cursor per key, then shift the cursors back into starts */
+    for (size_t row = 0; row < n; row++) {
+        uint32_t key = keys->row_keys[row];
+        if (key != UINT32_MAX) rows[starts[key]++] = (uint32_t)row;
+    }
+    for (size_t k = keys->num_keys; k > 0; k--) starts[k] = starts[k - 1];
+    starts[0] = 0;
+    
+    *starts_out = starts;
+    *rows_out = rows;
+    return 0;
+}
+
+/* Containers of one key's ascending rows; fills them in when index->block is set */
+static void build_containers(cdb_index_t* index, const uint32_t* rows, size_t count,
+                             size_t* num_containers, size_t* num_words) {
+    cdb_index_container_t* containers = (cdb_index_container_t*)index->containers;
+    uint64_t* words = (uint64_t*)index->words;
+    size_t i = 0;
+    while (i < count) {
+        uint32_t chunk = rows[i] / INDEX_CHUNK_ROWS;
+        size_t end = i;
+        while (end < count && rows[end] / INDEX_CHUNK_ROWS == chunk) end++;
+        size_t rows_in_chunk = end - i;
+        size_t container_words = rows_in_chunk > INDEX_ARRAY_MAX
+            ? INDEX_CHUNK_WORDS
+            : words_for(rows_in_chunk * sizeof(uint16_t));
+        
+        if (index->block) {
+            cdb_index_container_t* c = &containers[*num_containers];
+            c->chunk = chunk;
+            c->count = (uint32_t)rows_in_chunk;
+            c->offset = *num_words;
+            uint64_t* payload = words + *num_words;
+            for (size_t r = i; r < end; r++) {
+                uint32_t offset = rows[r] % INDEX_CHUNK_ROWS;
+                if (rows_in_chunk > INDEX_ARRAY_MAX) {
+                    payload[offset / 64] |= (uint64_t)1 << (offset % 64);
+                } else {
+                    ((uint16_t*)payload)[r - i] = (uint16_t)offset;
+                }
+            }
+        }
+        (*num_containers)++;
+        *num_words += container_words;
+        i = end;
+    }
+}
+
+/* Build an index over every row of a loaded column */
+cdb_index_t* cdb_index_build(const cdb_column_t* col, cdb_index_kind_t kind) {
+    if (!cdb_index_supported(col->data_type)) {
+        set_error("Indexes need an integer, bool or string column");
+        return NULL;
+    }
+    if (col->num_rows >= UINT32_MAX) {
+        set_error("Column is too large to index");
+        return NULL;
+    }
+    
+    index_keys_t keys;
+    uint64_t* starts = NULL;
+    uint32_t* rows = NULL;
+    cdb_index_t* index = (cdb_index_t*)calloc(1, sizeof(cdb_index_t));
+    if (!index || find_keys(col, &keys) < 0 || group_rows(col, &keys, &starts, &rows) < 0) goto oom;
+    
+    size_t num_values = col->num_rows - col->null_count;
+    if (kind == CDB_INDEX_AUTO) {
+        kind = keys.num_keys * INDEX_BITMAP_ROWS_PER_KEY <= num_values ? CDB_INDEX_BITMAP : CDB_INDEX_HASH;
+    }
+    index->kind = kind;
+    index->num_rows = col->num_rows;
+    index->num_keys = keys.num_keys;
+    index->num_slots = keys.num_slots;
+    
+    if (kind == CDB_INDEX_HASH) {
+        index->num_entries = num_values;
+        if (alloc_block(index, &keys) < 0) goto oom;
+        memcpy((uint32_t*)index->rows, rows, num_values * sizeof(uint32_t));
+        memcpy((uint64_t*)index->starts, starts, (keys.num_keys + 1) * sizeof(uint64_t));
+    } else {
+        /* Size the containers, then fill them into the block */
+        size_t num_containers = 0;
+        size_t num_words = 0;
+        for (size_t k = 0; k < keys.num_keys; k++) {
+            build_containers(index, rows + starts[k], (size_t)(starts[k + 1] - starts[k]),
+                             &num_containers, &num_words);
+        }
+        index->num_entries = num_containers;
+        index->num_words = num_words;
+        if (alloc_block(index, &keys) < 0) goto oom;
+        
+        uint64_t* key_starts = (uint64_t*)index->starts;
+        num_containers = 0;
+        num_words = 0;
+        for (size_t k = 0; k < keys.num_keys; k++) {
+            key_starts[k] = num_containers;
+            build_containers(index, rows + starts[k], (size_t)(starts[k + 1] - starts[k]),
+                             &num_containers, &num_words);
+        }
+        key_starts[keys.num_keys] = num_containers;
+    }
+    
+    free_keys(&keys);
+    free(starts);
+    free(rows);
+    return index;
+
+oom:
+    if (index) free_keys(&keys);
+    free(starts);
+    free(rows);
+    cdb_index_free(index);
+    set_error("Failed to allocate column index");
+    return NULL;
+}
+
+/* Check a block read from a file against the column it indexes, then take it over */
+cdb_index_t* cdb_index_load(uint64_t* block, size_t size, const cdb_column_t* col) {
+    cdb_index_t* index = (cdb_index_t*)calloc(1, sizeof(cdb_index_t));
+    if (!index) {
+        free(block);
+        set_error("Failed to allocate column index");
+        return NULL;
+    }
+    if (size < INDEX_HEADER_WORDS * 8 || size % 8 != 0) goto corrupt;
+    
+    index->kind = (cdb_index_kind_t)block[0];
+    index->num_rows = (size_t)block[1];
+    index->num_keys = (size_t)block[2];
+    index->num_slots = (size_t)block[3];
+    index->num_entries = (size_t)block[4];
+    index->num_words = (size_t)block[5];
+    size_t max_words = size / 8;
+    if ((index->kind != CDB_INDEX_HASH && index->kind != CDB_INDEX_BITMAP) ||
+        index->num_rows != col->num_rows || index->num_keys > index->num_rows ||
+        index->num_slots < INDEX_MIN_SLOTS || (index->num_slots & (index->num_slots - 1)) ||
+        index->num_slots <= index->num_keys || index->num_slots > max_words * 2 ||
+        index->num_entries > max_words * 2 || index->num_words > max_words ||
+        index_layout(index, NULL) != max_words) {
+        goto corrupt;
+    }
+    index_layout(index, block);
+    
+    for (size_t s = 0; s < index->num_slots; s++) {
+        if (index->slots[s] > index->num_keys) goto corrupt;
+    }
+    for (size_t k = 0; k < index->num_keys; k++) {
+        if (index->key_rows[k] >= index->num_rows || index->starts[k] > index->starts[k + 1]) goto corrupt;
+    }
+    if (index->starts[0] != 0 || index->starts[index->num_keys] != index->num_entries) goto corrupt;
+    
+    if (index->kind == CDB_INDEX_HASH) {
+        for (size_t e = 0; e < index->num_entries; e++) {
+            if (index->rows[e] >= index->num_rows) goto corrupt;
+        }
+    } else {
+        size_t num_chunks = (index->num_rows + INDEX_CHUNK_ROWS - 1) / INDEX_CHUNK_ROWS;
+        for (size_t e = 0; e < index->num_entries; e++) {
+            const cdb_index_container_t* c = &index->containers[e];
+            size_t container_words = c->count > INDEX_ARRAY_MAX
+                ? INDEX_CHUNK_WORDS
+                : words_for(c->count * sizeof(uint16_t));
+            if (c->chunk >= num_chunks || c->count == 0 || c->count > INDEX_CHUNK_ROWS ||
+                c->offset > index->num_words || container_words > index->num_words - c->offset) {
+                goto corrupt;
+            }
+            if (c->count <= INDEX_ARRAY_MAX) {
+                const uint16_t* offsets = (const uint16_t*)(index->words + c->offset);
+                for (uint32_t i = 0; i < c->count; i++) {
+                    if ((size_t)c->chunk * INDEX_CHUNK_ROWS + offsets[i] >= index->num_rows) goto corrupt;
+                }
+            } else if (c->chunk == num_chunks - 1 && index->num_rows % INDEX_CHUNK_ROWS) {
+                /* No bits for rows past the end in the last chunk */
+                const uint64_t* bits = index->words + c->offset;
+                size_t rows = index->num_rows % INDEX_CHUNK_ROWS;
+                if (rows % 64 && bits[rows / 64] >> (rows % 64)) goto corrupt;
+                for (size_t w = (rows + 63) / 64; w < INDEX_CHUNK_WORDS; w++) {
+                    if (bits[w]) goto corrupt;
+                }
+            }
+        }
+    }
+    return index;
+
+corrupt:
+    free(block);
+    free(index);
+    set_error("Corrupt column index in CDB file");
+    return NULL;
+}
+
+/* Key of a value compared with the column, or UINT32_MAX if no row holds it */
+static uint32_t find_value(const cdb_column_t* col, const cdb_index_t* index, const cdb_value_t* value) {
+    uint64_t hash;
+    int64_t key = 0;
+    size_t len = 0;
+    
+    switch (col->data_type) {
+        case CDB_TYPE_INT32: key = value->as.i32; break;
+        case CDB_TYPE_INT64: key = value->as.i64; break;
+        case CDB_TYPE_BOOL: key = value->as.b; break;
+        case CDB_TYPE_STRING: len = strlen(value->as.str); break;
+        case CDB_TYPE_DICT_STRING: {
+            /* Rows hold codes: find the value's code without touching the dictionary index */
+            len = strlen(value->as.str);
+            key = -1;
+            for (size_t code = 0; code < col->dict_size; code++) {
+                uint64_t start = col->dict_offsets[code];
+                if (col->dict_offsets[code + 1] - start == len &&
+                    (len == 0 || memcmp(col->string_data + start, value->as.str, len) == 0)) {
+                    key = (int64_t)code;
+                    break;
+                }
+            }
+            if (key < 0) return UINT32_MAX;
+            break;
+        }
+        default:
+            return UINT32_MAX;
+    }
+    hash = col->data_type == CDB_TYPE_STRING ? hash_bytes(value->as.str, len) : hash_int((uint64_t)key);
+    
+    size_t mask = index->num_slots - 1;
+    for (size_t s = (size_t)hash & mask; index->slots[s]; s = (s + 1) & mask) {
+        uint32_t k = index->slots[s] - 1;
+        size_t row = index->key_rows[k];
+        if (col->data_type == CDB_TYPE_STRING) {
+            size_t row_len;
+            const char* row_value = row_string(col, row, &row_len);
+            if (row_len == len && (len == 0 || memcmp(row_value, value->as.str, len) == 0)) return k;
+        } else if (row_key(col, row) == key) {
+            return k;
+        }
+    }
+    return UINT32_MAX;
+}
+
+/* Set the selection bits of the rows equal to value (not NULL) */
+void cdb_index_select(const cdb_column_t* col, const cdb_value_t* value, uint64_t* words) {
+    const cdb_index_t* index = col->index;
+    uint32_t key = find_value(col, index, value);
+    if (key == UINT32_MAX) return;
+    
+    size_t first = (size_t)index->starts[key];
+    size_t last = (size_t)index->starts[key + 1];
+    if (index->kind == CDB_INDEX_HASH) {
+        for (size_t e = first; e < last; e++) {
+            words[index->rows[e] / 64] |= (uint64_t)1 << (index->rows[e] % 64);
+        }
+        return;
+    }
+    
+    size_t total_words = (index->num_rows + 63) / 64;
+    for (size_t e = first; e < last; e++) {
+        const cdb_index_container_t* c = &index->containers[e];
+        const uint64_t* payload = index->words + c->offset;
+        size_t base = (size_t)c->chunk * INDEX_CHUNK_WORDS;
+        if (c->count > INDEX_ARRAY_MAX) {
+            size_t n = total_words - base < INDEX_CHUNK_WORDS ? total_words - base : INDEX_CHUNK_WORDS;
+            for (size_t w = 0; w < n; w++) words[base + w] |= payload[w];
+        } else {
+            const uint16_t* offsets = (const uint16_t*)payload;
+            for (uint32_t i = 0; i < c->count; i++) {
+                size_t row = (size_t)c->chunk * INDEX_CHUNK_ROWS + offsets[i];
+                words[row / 64] |= (uint64_t)1 << (row % 64);
+            }
+        }
+    }
+}
+
+/* Build (or rebuild) a column's index and keep it declared for saves */
+int cdb_create_index(cdb_database_t* db, const char* column_name, cdb_index_kind_t kind) {
+    if (kind != CDB_INDEX_HASH && kind != CDB_INDEX_BITMAP && kind != CDB_INDEX_AUTO) {
+        set_error("Unknown index kind");
+        return -1;
+    }
+    
+    cdb_write_lock(db);
+    cdb_column_t* col = cdb_get_column(db, column_name);
+    cdb_index_t* index = col ? cdb_index_build(col, kind) : NULL;
+    if (index) {
+        cdb_index_free(col->index);
+        col->index = index;
+        col->index_kind = (uint8_t)kind;
+    }
+    cdb_write_unlock(db);
+    return index ? 0 : -1;
+}
+
+int cdb_drop_index(cdb_database_t* db, const char* column_name) {
+    cdb_write_lock(db);
+    int idx = cdb_get_column_index(db, column_name);
+    if (idx >= 0) {
+        cdb_column_t* col = &db->columns[idx];
+        cdb_index_free(col->index);
+        col->index = NULL;
+        col->index_kind = CDB_INDEX_NONE;
+    }
+    cdb_write_unlock(db);
+    return idx >= 0 ? 0 : -1;
+}
+
+/* Kind of a column's up-to-date index */
+cdb_index_kind_t cdb_get_index_kind(const cdb_column_t* col) {
+    return col && cdb_index_current(col) ? col->index->kind : CDB_INDEX_NONE;
+}
+
+/* Whether appends left a declared index behind its column */
+int cdb_has_stale_indexes(const cdb_database_t* db) {
+    for (size_t c = 0; db && c < db->num_columns; c++) {
+        const cdb_column_t* col = &db->columns[c];
+        if (col->index_kind != CDB_INDEX_NONE && col->storage != CDB_STORAGE_UNLOADED &&
+            !cdb_index_current(col)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Rebuild the declared indexes that appends made stale */
+int cdb_refresh_indexes(cdb_database_t* db) {
+    if (!db) {
+        set_error("Invalid database");
+        return -1;
+    }
+    
+    cdb_write_lock(db);
+    int status = 0;
+    for (size_t c = 0; status == 0 && c < db->num_columns; c++) {
+        cdb_column_t* col = &db->columns[c];
+        if (col->index_kind == CDB_INDEX_NONE || col->storage == CDB_STORAGE_UNLOADED ||
+            cdb_index_current(col)) {
+            continue;
+        }
+        cdb_index_t* index = cdb_index_build(col, (cdb_index_kind_t)col->index_kind);
+        if (!index) {
+            status = -1;
+        } else {
+            cdb_index_free(col->index);
+            col->index = index;
+        }
+    }
+    cdb_write_unlock(db);
+    return status;
+}
@@ -0,0 +1,286 @@
+#ifndef COLUMN_DB_INTERNAL_H
+#define COLUMN_DB_INTERNAL_H
+
+/*
+ * Internal helpers shared between the ColumnDB C sources.
+ * Not part of the public API in include/column_db.h.
+ */
+
+#include "../include/column_db.h"
+
+/* Thread-local storage class (C99 has none of its own) */
+#if defined(_MSC_VER)
+#define CDB_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define CDB_THREAD_LOCAL __thread
+#else
+#define CDB_THREAD_LOCAL _Thread_local
+#endif
+
+/* Flag publication between threads: a store that releases the writes before it
+ * and a load that acquires them (plain volatile accesses do both on MSVC) */
+#if defined(_MSC_VER)
+#define CDB_LOAD_ACQUIRE(p) (*(volatile const uint8_t*)(p))
+#define CDB_STORE_RELEASE(p, v) ((void)(*(volatile uint8_t*)(p) = (uint8_t)(v)))
+#else
+#define CDB_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define CDB_STORE_RELEASE(p, v) __atomic_store_n((p), (uint8_t)(v), __ATOMIC_RELEASE)
+#endif
+
+/* On-disk encodings of a column section (values 2+ are stored in the column metadata) */
+typedef enum {
+    CDB_FILE_ENCODING_PLAIN = 0,            /* Raw values; strings as offsets + bytes */
+    CDB_FILE_ENCODING_LENGTH_PREFIXED = 1,  /* Strings as uint32 length + bytes (format v1/v2) */
+    CDB_FILE_ENCODING_RLE = 2,              /* Per row group: runs of equal values */
+    CDB_FILE_ENCODING_DELTA = 3,            /* Per row group: first value + bit-packed deltas */
+    CDB_FILE_ENCODING_FOR = 4               /* Per row group: minimum + bit-packed offsets */
+} cdb_file_encoding_t;
+
+/* Whether a section is stored as one encoded chunk per row group */
+static inline int cdb_encoding_is_chunked(cdb_file_encoding_t encoding) {
+    return encoding >= CDB_FILE_ENCODING_RLE;
+}
+
+/* Null bits of rows [base, base + 64), bit i for row base + i.
+ * Rows at or past num_rows read as NULL so partial words need no special case. */
+static inline uint64_t cdb_null_word(const uint8_t* null_bitmap, size_t base, size_t num_rows) {
+    size_t remaining = num_rows - base;
+    size_t bytes = remaining >= 64 ? 8 : (remaining + 7) / 8;
+    const uint8_t* p = null_bitmap + base / 8;
+    
+    uint64_t word = 0;
+    for (size_t k = 0; k < bytes; k++) {
+        word |= (uint64_t)p[k] << (8 * k);
+    }
+    if (remaining < 64) {
+        word |= ~(uint64_t)0 << remaining;
+    }
+    return word;
+}
+
+/* Number of NULL rows among the first num_rows bits of a bitmap */
+size_t cdb_count_nulls(const uint8_t* null_bitmap, size_t num_rows);
+
+/* CRC32C of size bytes, continuing from crc (0 to start) */
+uint32_t cdb_crc32c(uint32_t crc, const void* data, size_t size);
+
+/* Whether rows from first_row on keep a column sorted, given the rows before it are */
+int cdb_rows_in_order(const cdb_column_t* col, size_t first_row);
+
+/* Column indexes (column_db_index.c). The index is one block of 8-byte
+ * words that is written to and read from files as is. */
+typedef struct cdb_index cdb_index_t;
+
+int cdb_index_supported(cdb_data_type_t type);
+cdb_index_t* cdb_index_build(const cdb_column_t* col, cdb_index_kind_t kind);  /* AUTO picks a kind */
+void cdb_index_free(cdb_index_t* index);
+cdb_index_kind_t cdb_index_built_kind(const cdb_index_t* index);
+const void* cdb_index_data(const cdb_index_t* index, size_t* size);
+
+/* Take over a malloc'd block read from a file once it checks out against col */
+cdb_index_t* cdb_index_load(uint64_t* block, size_t size, const cdb_column_t* col);
+
+/* Whether col->index covers all of its rows */
+int cdb_index_current(const cdb_column_t* col);
+
+/* OR the rows equal to value into selection words (the index must be current) */
+void cdb_index_select(const cdb_column_t* col, const cdb_value_t* value, uint64_t* words);
+
+/* Encode a fixed-width column with the lightweight encoding that saves the most.
+ * Sets *encoding to PLAIN and *section to NULL when raw values are about as small;
+ * otherwise *section is a malloc'd chunk offset table followed by the chunks. */
+int cdb_encode_column(const cdb_column_t* col, size_t group_rows, cdb_file_encoding_t* encoding,
+                      uint8_t** section, uint64_t* size);
+
+/* Bounds of chunk g within an encoded section, after checking the offset table */
+int cdb_encoded_chunk(const uint8_t* section, uint64_t size, size_t num_groups, size_t g,
+                      uint64_t* offset, uint64_t* chunk_size);
+
+/* Decode one chunk of n rows into out */
+int cdb_decode_chunk(cdb_file_encoding_t encoding, cdb_data_type_t type,
+                     const uint8_t* chunk, uint64_t chunk_size, size_t n, void* out);
+
+/* Decode a whole encoded section; rows set in null_bitmap (may be NULL) read back as 0 */
+int cdb_decode_column(cdb_file_encoding_t encoding, cdb_data_type_t type,
+                      const uint8_t* section, uint64_t size, size_t num_rows, size_t group_rows,
+                      const uint8_t* null_bitmap, void* out);
+
+/* Highest compression level accepted for a codec; 0 selects the codec's default */
+int cdb_compression_max_level(cdb_compression_t codec);
+
+/* Check that a codec is built in and accepts level; -1 with the error set if not */
+int cdb_check_compression(cdb_compression_t codec, int level);
+
+/* Save with a codec for this save only, leaving the database's setting alone */
+int cdb_save_with_codec(cdb_database_t* db, const char* filename, cdb_compression_t codec, int level);
+int cdb_save_append_with_codec(cdb_database_t* db, const char* filename, cdb_compression_t codec, int level);
+cdb_writer_t* cdb_writer_open_with_codec(const char* filename, cdb_database_t* schema, size_t flush_rows,
+                                         cdb_compression_t codec, int level);
+
+/* Arrow exports that call on_release(ctx) once everything they produced is
+ * released; it also runs, before they return, when they fail */
+int cdb_export_arrow_hooked(cdb_database_t* db, struct ArrowSchema* out_schema, struct ArrowArray* out_array,
+                            void (*on_release)(void* ctx), void* ctx);
+int cdb_export_arrow_stream_hooked(cdb_database_t* db, struct ArrowArrayStream* out_stream,
+                                   void (*on_release)(void* ctx), void* ctx);
+
+/* Compress size bytes of src into a malloc'd block */
+int cdb_compress_block(cdb_compression_t codec, int level, const void* src, uint64_t size,
+                       uint8_t** out, uint64_t* out_size);
+
+/* Decompress a block that must expand to exactly size bytes */
+int cdb_decompress_block(cdb_compression_t codec, const void* src, uint64_t src_size,
+                         void* dst, uint64_t size);
+
+/* Number of online CPUs (at least 1) */
+size_t cdb_cpu_count(void);
+
+/* Thread pool running batches of independent tasks; the caller works too */
+typedef struct cdb_thread_pool cdb_thread_pool_t;
+
+/* num_threads counts the caller (0 = one per CPU). NULL means run inline. */
+cdb_thread_pool_t* cdb_pool_create(size_t num_threads);
+size_t cdb_pool_size(const cdb_thread_pool_t* pool);
+
+/* Run task(ctx, i) for every i < count and wait; -1 if any task failed.
+ * A NULL pool runs the tasks inline, in order. */
+int cdb_pool_run(cdb_thread_pool_t* pool, size_t count, int (*task)(void* ctx, size_t index), void* ctx);
+void cdb_pool_destroy(cdb_thread_pool_t* pool);
+
+/* Background thread running one job at a time alongside the caller */
+typedef struct cdb_worker cdb_worker_t;
+
+cdb_worker_t* cdb_worker_create(void);  /* NULL if its thread could not start */
+void cdb_worker_post(cdb_worker_t* worker, int (*job)(void* ctx), void* ctx);  /* After waiting for the last job */
+int cdb_worker_wait(cdb_worker_t* worker);  /* -1 if the posted job failed */
+void cdb_worker_destroy(cdb_worker_t* worker);
+
+/* Reader/writer lock: any number of readers, or one writer. The writer
+ * may lock it again (for reading or writing) without blocking. */
+typedef struct cdb_rwlock cdb_rwlock_t;
+
+cdb_rwlock_t* cdb_rwlock_create(void);  /* NULL if out of memory */
+void cdb_rwlock_destroy(cdb_rwlock_t* lock);
+void cdb_rwlock_read(cdb_rwlock_t* lock);
+void cdb_rwlock_write(cdb_rwlock_t* lock);
+int cdb_rwlock_try_read(cdb_rwlock_t* lock);   /* 1 if acquired without waiting */
+int cdb_rwlock_try_write(cdb_rwlock_t* lock);
+void cdb_rwlock_read_unlock(cdb_rwlock_t* lock);
+void cdb_rwlock_write_unlock(cdb_rwlock_t* lock);
+
+/* Statistics counters (column_db_stats.c), in the order of cdb_stats_t */
+typedef enum {
+    CDB_STAT_BYTES_READ = 0,
+    CDB_STAT_BYTES_WRITTEN,
+    CDB_STAT_ALLOCATIONS,
+    CDB_STAT_REALLOCS,
+    CDB_STAT_REALLOC_BYTES,
+    CDB_STAT_ROWS_SCANNED,
+    CDB_STAT_SAVES,
+    CDB_STAT_SAVE_NS,
+    CDB_STAT_LOADS,
+    CDB_STAT_LOAD_NS,
+    CDB_STAT_READ_NS,
+    CDB_STAT_WRITE_NS,
+    CDB_STAT_SYNC_NS,
+    CDB_STAT_ENCODE_NS,
+    CDB_STAT_DECODE_NS,
+    CDB_STAT_COUNT
+} cdb_stat_t;
+
+#ifdef CDB_NO_STATS
+#define cdb_stats_on() 0
+#define cdb_stat_add(stat, n) ((void)0)
+#define cdb_stat_start() ((uint64_t)0)
+#define cdb_stat_time(stat, start) ((void)(start))
+#else
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CDB_ATOMIC_ADD64(p, n) ((void)_InterlockedExchangeAdd64((volatile __int64*)(p), (__int64)(n)))
+#define CDB_ATOMIC_LOAD_INT(p) (*(volatile int*)(p))
+#else
+#define CDB_ATOMIC_ADD64(p, n) ((void)__atomic_fetch_add((p), (n), __ATOMIC_RELAXED))
+#define CDB_ATOMIC_LOAD_INT(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#endif
+
+extern int cdb_stats_flag;
+extern uint64_t cdb_stat_counters[CDB_STAT_COUNT];
+
+/* Monotonic clock in nanoseconds */
+uint64_t cdb_stat_clock(void);
+
+static inline int cdb_stats_on(void) {
+    return CDB_ATOMIC_LOAD_INT(&cdb_stats_flag);
+}
+
+static inline void cdb_stat_add(cdb_stat_t stat, uint64_t n) {
+    if (cdb_stats_on()) CDB_ATOMIC_ADD64(&cdb_stat_counters[stat], n);
+}
+
+/* Start of a timed span; 0 (nothing to time) while counting is off */
+static inline uint64_t cdb_stat_start(void) {
+    return cdb_stats_on() ? cdb_stat_clock() : 0;
+}
+
+static inline void cdb_stat_time(cdb_stat_t stat, uint64_t start) {
+    if (start) CDB_ATOMIC_ADD64(&cdb_stat_counters[stat], cdb_stat_clock() - start);
+}
+#endif
+
+/* A column buffer was allocated (old_size 0) or grown from old_size bytes */
+static inline void cdb_stat_growth(size_t old_size) {
+    if (old_size == 0) {
+        cdb_stat_add(CDB_STAT_ALLOCATIONS, 1);
+    } else {
+        cdb_stat_add(CDB_STAT_REALLOCS, 1);
+        cdb_stat_add(CDB_STAT_REALLOC_BYTES, old_size);
+    }
+}
+
+/* Set the calling thread's error message returned by cdb_get_error() */
+void set_error(const char* msg);
+
+/* Size in bytes of one element of the given type (0 for unknown types) */
+size_t cdb_type_size(cdb_data_type_t type);
+
+/* Grow a column's data array and null bitmap to hold at least min_capacity rows */
+int cdb_column_reserve(cdb_column_t* col, size_t min_capacity);
+
+/* Grow a string column's byte buffer to hold at least min_bytes */
+int cdb_string_reserve(cdb_column_t* col, size_t min_bytes);
+
+/* Grow a DICT_STRING column's dictionary offsets to hold at least min_entries values */
+int cdb_dict_reserve(cdb_column_t* col, size_t min_entries);
+
+/* Column data arrays of at least CDB_HUGE_ALLOC_MIN bytes start on a huge
+ * page boundary and are rounded up to whole huge pages */
+#define CDB_HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define CDB_HUGE_ALLOC_MIN ((size_t)8 << 20)
+
+/* Bytes actually allocated for a data array of size bytes */
+size_t cdb_data_alloc_size(size_t size);
+
+/* Grow a data array; NULL (data untouched) if out of memory. Arrays are
+ * not realloc/free compatible: only use these two on them. */
+void* cdb_data_resize(void* data, size_t old_size, size_t new_size);
+void cdb_data_free(void* data);
+
+/* Reserve room for num_rows rows in every heap column from first_column on */
+int cdb_reserve_columns(cdb_database_t* db, size_t first_column, size_t num_rows);
+
+/* Register a column without allocating storage (used by the file loaders) */
+cdb_column_t* cdb_add_column_deferred(cdb_database_t* db, const char* name, cdb_data_type_t type);
+
+/* Append all rows of src (same type, another database) to column col_index of db */
+int cdb_append_column(cdb_database_t* db, size_t col_index, const cdb_column_t* src);
+
+/* Copy a mapped column into owned heap buffers */
+int cdb_column_unmap(cdb_column_t* col);
+
+/* Materialize an unloaded column from the database's file mapping */
+int cdb_column_ensure_loaded(cdb_database_t* db, cdb_column_t* col);
+
+/* Release the database's file mapping (columns must no longer reference it) */
+void cdb_unmap_file(cdb_database_t* db);
+
+#endif /* COLUMN_DB_INTERNAL_H */
@@ -0,0 +1,118 @@
+/*
+ * ColumnDB aggregate kernels, compiled once per instruction set.
+ *
+ * Included by column_db_aggregate.c with CDB_KERNEL_SUFFIX (appended to
+ * every function name) and CDB_KERNEL_TARGET (function attribute, may be
+ * empty) defined. The loops keep CDB_AGG_LANES independent accumulators so
+ * the compiler can vectorize them for that target without reassociating.
+ */
+
+#define CDB_KERNEL_PASTE2(name, suffix) name##suffix
+#define CDB_KERNEL_PASTE(name, suffix) CDB_KERNEL_PASTE2(name, suffix)
+#define CDB_KERNEL_NAME(name) CDB_KERNEL_PASTE(name, CDB_KERNEL_SUFFIX)
+
+/* Reduce the non-NULL values of a column, 64 rows (one bitmap word) at a time */
+#define CDB_REDUCE_KERNEL(name, T, ACC_T, INIT, STEP)                                   \
+static CDB_KERNEL_TARGET ACC_T CDB_KERNEL_NAME(name)(const T* values,                   \
+                                                     const uint8_t* null_bitmap,        \
+                                                     size_t n) {                        \
+    ACC_T lanes[CDB_AGG_LANES];                                                         \
+    for (size_t k = 0; k < CDB_AGG_LANES; k++) lanes[k] = (INIT);                       \
+                                                                                        \
+    for (size_t base = 0; base < n; base += 64) {                                       \
+        uint64_t nulls = block_nulls(null_bitmap, base, n);                             \
+        const T* block = values + base;                                                 \
+        if (nulls == 0) {                                                               \
+            /* All 64 rows valid: dense, vectorizable loop */                           \
+            for (size_t i = 0; i < 64; i += CDB_AGG_LANES) {                            \
+                for (size_t k = 0; k < CDB_AGG_LANES; k++) {                            \
+                    lanes[k] = STEP(lanes[k], block[i + k]);                            \
+                }                                                                       \
+            }                                                                           \
+        } else {                                                                        \
+            /* Visit only the valid rows of the word */                                 \
+            for (uint64_t valid = ~nulls; valid; valid &= valid - 1) {                  \
+                lanes[0] = STEP(lanes[0], block[count_trailing_zeros(valid)]);          \
+            }                                                                           \
+        }                                                                               \
+    }                                                                                   \
+                                                                                        \
+    ACC_T acc = lanes[0];                                                               \
+    for (size_t k = 1; k < CDB_AGG_LANES; k++) acc = STEP(acc, lanes[k]);               \
+    return acc;                                                                         \
+}
+
+CDB_REDUCE_KERNEL(sum_int32, int32_t, int64_t, 0, CDB_STEP_SUM)
+CDB_REDUCE_KERNEL(min_int32, int32_t, int32_t, INT32_MAX, CDB_STEP_MIN)
+CDB_REDUCE_KERNEL(max_int32, int32_t, int32_t, INT32_MIN, CDB_STEP_MAX)
+CDB_REDUCE_KERNEL(sum_int64, int64_t, uint64_t, 0, CDB_STEP_SUM)  /* Wraps like int64 arithmetic */
+CDB_REDUCE_KERNEL(fsum_int64, int64_t, double, 0.0, CDB_STEP_SUM) /* For MEAN, cannot overflow */
+CDB_REDUCE_KERNEL(min_int64, int64_t, int64_t, INT64_MAX, CDB_STEP_MIN)
+CDB_REDUCE_KERNEL(max_int64, int64_t, int64_t, INT64_MIN, CDB_STEP_MAX)
+CDB_REDUCE_KERNEL(sum_float32, float, double, 0.0, CDB_STEP_SUM)
+CDB_REDUCE_KERNEL(min_float32, float, float, HUGE_VALF, CDB_STEP_MIN)
+CDB_REDUCE_KERNEL(max_float32, float, float, -HUGE_VALF, CDB_STEP_MAX)
+CDB_REDUCE_KERNEL(sum_float64, double, double, 0.0, CDB_STEP_SUM)
+CDB_REDUCE_KERNEL(min_float64, double, double, HUGE_VAL, CDB_STEP_MIN)
+CDB_REDUCE_KERNEL(max_float64, double, double, -HUGE_VAL, CDB_STEP_MAX)
+CDB_REDUCE_KERNEL(sum_bool, uint8_t, uint64_t, 0, CDB_STEP_SUM)
+CDB_REDUCE_KERNEL(min_bool, uint8_t, uint8_t, 1, CDB_STEP_MIN)
+CDB_REDUCE_KERNEL(max_bool, uint8_t, uint8_t, 0, CDB_STEP_MAX)
+
+/* SUM, MIN, MAX or MEAN (as a sum) of a fixed-width column with at least one valid row */
+static CDB_KERNEL_TARGET void CDB_KERNEL_NAME(reduce)(const cdb_column_t* col, cdb_agg_op_t op,
+                                                      cdb_agg_result_t* result) {
+    const uint8_t* nulls = col->null_count ? col->null_bitmap : NULL;  /* Skip the bitmap entirely */
+    size_t n = col->num_rows;
+    
+    switch (col->data_type) {
+        case CDB_TYPE_INT32: {
+            const int32_t* values = (const int32_t*)col->data;
+            if (op == CDB_AGG_MIN) result->i = CDB_KERNEL_NAME(min_int32)(values, nulls, n);
+            else if (op == CDB_AGG_MAX) result->i = CDB_KERNEL_NAME(max_int32)(values, nulls, n);
+            else result->i = CDB_KERNEL_NAME(sum_int32)(values, nulls, n);
+            break;
+        }
+        case CDB_TYPE_INT64: {
+            const int64_t* values = (const int64_t*)col->data;
+            if (op == CDB_AGG_MIN) result->i = CDB_KERNEL_NAME(min_int64)(values, nulls, n);
+            else if (op == CDB_AGG_MAX) result->i = CDB_KERNEL_NAME(max_int64)(values, nulls, n);
+            else if (op == CDB_AGG_SUM) result->i = (int64_t)CDB_KERNEL_NAME(sum_int64)(values, nulls, n);
+            else {
+                result->f = CDB_KERNEL_NAME(fsum_int64)(values, nulls, n);
+                result->is_float = 1;
+            }
+            break;
+        }
+        case CDB_TYPE_FLOAT32: {
+            const float* values = (const float*)col->data;
+            if (op == CDB_AGG_MIN) result->f = CDB_KERNEL_NAME(min_float32)(values, nulls, n);
+            else if (op == CDB_AGG_MAX) result->f = CDB_KERNEL_NAME(max_float32)(values, nulls, n);
+            else result->f = CDB_KERNEL_NAME(sum_float32)(values, nulls, n);
+            result->is_float = 1;
+            break;
+        }
+        case CDB_TYPE_FLOAT64: {
+            const double* values = (const double*)col->data;
+            if (op == CDB_AGG_MIN) result->f = CDB_KERNEL_NAME(min_float64)(values, nulls, n);
+            else if (op == CDB_AGG_MAX) result->f = CDB_KERNEL_NAME(max_float64)(values, nulls, n);
+            else result->f = CDB_KERNEL_NAME(sum_float64)(values, nulls, n);
+            result->is_float = 1;
+            break;
+        }
+        case CDB_TYPE_BOOL: {
+            const uint8_t* values = (const uint8_t*)col->data;
+            if (op == CDB_AGG_MIN) result->i = CDB_KERNEL_NAME(min_bool)(values, nulls, n);
+            else if (op == CDB_AGG_MAX) result->i = CDB_KERNEL_NAME(max_bool)(values, nulls, n);
+            else result->i = (int64_t)CDB_KERNEL_NAME(sum_bool)(values, nulls, n);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+#undef CDB_REDUCE_KERNEL
+#undef CDB_KERNEL_NAME
+#undef CDB_KERNEL_PASTE
+#undef CDB_KERNEL_PASTE2
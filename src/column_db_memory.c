@@ -0,0 +1,76 @@
+/*
+ * ColumnDB column memory
+ * Allocation of column data arrays. Small arrays use the C heap; large
+ * ones start on a huge page boundary and fill whole huge pages, so the
+ * kernel can back them with transparent huge pages.
+ */
+
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE  /* posix_memalign, madvise */
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "column_db_internal.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#define SMALL_ALIGNMENT 64  /* Windows only: _aligned_realloc needs a fixed alignment */
+
+/* Whether an array of this many bytes takes the huge page path */
+static int is_large(size_t size) {
+    return size >= CDB_HUGE_ALLOC_MIN;
+}
+
+/* Bytes actually allocated for a request of size bytes */
+size_t cdb_data_alloc_size(size_t size) {
+    if (!is_large(size)) return size;
+    return (size + CDB_HUGE_PAGE_SIZE - 1) / CDB_HUGE_PAGE_SIZE * CDB_HUGE_PAGE_SIZE;
+}
+
+static void* alloc_large(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, CDB_HUGE_PAGE_SIZE);
+#else
+    void* data = NULL;
+    if (posix_memalign(&data, CDB_HUGE_PAGE_SIZE, size) != 0) return NULL;
+#ifdef MADV_HUGEPAGE
+    madvise(data, size, MADV_HUGEPAGE);  /* Only advice: failure is harmless */
+#endif
+    return data;
+#endif
+}
+
+/* Grow an array from old_size to new_size bytes (both as returned by
+ * cdb_data_alloc_size). On failure data is left as it was. */
+void* cdb_data_resize(void* data, size_t old_size, size_t new_size) {
+    cdb_stat_growth(old_size);
+    if (!is_large(new_size)) {
+#ifdef _WIN32
+        return _aligned_realloc(data, new_size ? new_size : 1, SMALL_ALIGNMENT);
+#else
+        return realloc(data, new_size ? new_size : 1);
+#endif
+    }
+    
+    /* realloc would give up the alignment: move to a fresh block */
+    void* grown = alloc_large(new_size);
+    if (!grown) return NULL;
+    if (data) {
+        memcpy(grown, data, old_size < new_size ? old_size : new_size);
+        cdb_data_free(data);
+    }
+    return grown;
+}
+
+void cdb_data_free(void* data) {
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    free(data);
+#endif
+}
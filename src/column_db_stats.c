@@ -0,0 +1,107 @@
+/*
+ * ColumnDB statistics
+ * Process-wide counters of file I/O, column buffer growth, scanned rows
+ * and save/load time (see cdb_stats_t). Hot paths bump them through the
+ * inline helpers in column_db_internal.h, which do nothing while counting
+ * is off.
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L  /* clock_gettime */
+#endif
+
+#include <string.h>
+#include "column_db_internal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef CDB_NO_STATS
+int cdb_set_stats_enabled(int enabled) {
+    (void)enabled;
+    set_error("Statistics were compiled out (CDB_NO_STATS)");
+    return -1;
+}
+
+int cdb_stats_enabled(void) {
+    return 0;
+}
+
+void cdb_get_stats(cdb_stats_t* out) {
+    if (out) memset(out, 0, sizeof(*out));
+}
+
+void cdb_reset_stats(void) {
+}
+#else
+int cdb_stats_flag = 0;
+uint64_t cdb_stat_counters[CDB_STAT_COUNT];
+
+uint64_t cdb_stat_clock(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+int cdb_set_stats_enabled(int enabled) {
+#if defined(_MSC_VER)
+    InterlockedExchange((volatile LONG*)&cdb_stats_flag, enabled ? 1 : 0);
+#else
+    __atomic_store_n(&cdb_stats_flag, enabled ? 1 : 0, __ATOMIC_RELAXED);
+#endif
+    return 0;
+}
+
+int cdb_stats_enabled(void) {
+    return cdb_stats_on();
+}
+
+/* A snapshot: counters that other threads are bumping may be a step apart */
+static uint64_t counter(cdb_stat_t stat) {
+#if defined(_MSC_VER)
+    return (uint64_t)_InterlockedExchangeAdd64((volatile __int64*)&cdb_stat_counters[stat], 0);
+#else
+    return __atomic_load_n(&cdb_stat_counters[stat], __ATOMIC_RELAXED);
+#endif
+}
+
+void cdb_get_stats(cdb_stats_t* out) {
+    if (!out) return;
+    out->bytes_read = counter(CDB_STAT_BYTES_READ);
+    out->bytes_written = counter(CDB_STAT_BYTES_WRITTEN);
+    out->allocations = counter(CDB_STAT_ALLOCATIONS);
+    out->reallocs = counter(CDB_STAT_REALLOCS);
+    out->realloc_bytes = counter(CDB_STAT_REALLOC_BYTES);
+    out->rows_scanned = counter(CDB_STAT_ROWS_SCANNED);
+    out->saves = counter(CDB_STAT_SAVES);
+    out->save_ns = counter(CDB_STAT_SAVE_NS);
+    out->loads = counter(CDB_STAT_LOADS);
+    out->load_ns = counter(CDB_STAT_LOAD_NS);
+    out->read_ns = counter(CDB_STAT_READ_NS);
+    out->write_ns = counter(CDB_STAT_WRITE_NS);
+    out->sync_ns = counter(CDB_STAT_SYNC_NS);
+    out->encode_ns = counter(CDB_STAT_ENCODE_NS);
+    out->decode_ns = counter(CDB_STAT_DECODE_NS);
+}
+
+void cdb_reset_stats(void) {
+    for (int stat = 0; stat < CDB_STAT_COUNT; stat++) {
+#if defined(_MSC_VER)
+        InterlockedExchange64((volatile __int64*)&cdb_stat_counters[stat], 0);
+#else
+        __atomic_store_n(&cdb_stat_counters[stat], 0, __ATOMIC_RELAXED);
+#endif
+    }
+}
+#endif /* CDB_NO_STATS */
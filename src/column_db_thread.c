@@ -0,0 +1,506 @@
+/*
+ * ColumnDB threading helpers
+ * A small thread pool that runs batches of independent tasks, on pthreads
+ * or Win32 threads. The calling thread works through each batch too.
+ * Also a single background worker for jobs that overlap the caller's work,
+ * and a reader/writer lock for callers that share a database.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* pthread_rwlockattr_setkind_np */
+#endif
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L  /* sysconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "column_db_internal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+typedef CRITICAL_SECTION cdb_mutex_t;
+typedef CONDITION_VARIABLE cdb_cond_t;
+typedef HANDLE cdb_thread_t;
+#else
+#include <pthread.h>
+#include <unistd.h>
+typedef pthread_mutex_t cdb_mutex_t;
+typedef pthread_cond_t cdb_cond_t;
+typedef pthread_t cdb_thread_t;
+#endif
+
+#define CDB_MAX_THREADS 256
+
+struct cdb_thread_pool {
+    cdb_thread_t* threads;
+    size_t num_workers;       /* Threads besides the caller */
+    cdb_mutex_t lock;
+    cdb_cond_t work_ready;    /* A new batch was posted, or shutdown */
+    cdb_cond_t work_done;     /* The last worker left the batch */
+    
+    /* Current batch; tasks are claimed one at a time */
+    int (*task)(void* ctx, size_t index);
+    void* ctx;
+    size_t count;
+    size_t next;
+    size_t active;            /* Workers that have not finished the batch */
+    int failed;
+    char error[256];          /* Error of the first failed task, for the caller */
+    uint64_t generation;      /* Bumped for every batch */
+    int shutdown;
+};
+
+static void mutex_init(cdb_mutex_t* m) {
+#ifdef _WIN32
+    InitializeCriticalSection(m);
+#else
+    pthread_mutex_init(m, NULL);
+#endif
+}
+
+static void mutex_destroy(cdb_mutex_t* m) {
+#ifdef _WIN32
+    DeleteCriticalSection(m);
+#else
+    pthread_mutex_destroy(m);
+#endif
+}
+
+static void mutex_lock(cdb_mutex_t* m) {
+#ifdef _WIN32
+    EnterCriticalSection(m);
+#else
+    pthread_mutex_lock(m);
+#endif
+}
+
+static void mutex_unlock(cdb_mutex_t* m) {
+#ifdef _WIN32
+    LeaveCriticalSection(m);
+#else
+    pthread_mutex_unlock(m);
+#endif
+}
+
+static void cond_init(cdb_cond_t* c) {
+#ifdef _WIN32
+    InitializeConditionVariable(c);
+#else
+    pthread_cond_init(c, NULL);
+#endif
+}
+
+static void cond_destroy(cdb_cond_t* c) {
+#ifdef _WIN32
+    (void)c;
+#else
+    pthread_cond_destroy(c);
+#endif
+}
+
+static void cond_wait(cdb_cond_t* c, cdb_mutex_t* m) {
+#ifdef _WIN32
+    SleepConditionVariableCS(c, m, INFINITE);
+#else
+    pthread_cond_wait(c, m);
+#endif
+}
+
+static void cond_broadcast(cdb_cond_t* c) {
+#ifdef _WIN32
+    WakeAllConditionVariable(c);
+#else
+    pthread_cond_broadcast(c);
+#endif
+}
+
+/* Run tasks of the current batch until none are left; a failure stops
+ * everyone from claiming more. Called with the lock held. */
+static void pool_work(cdb_thread_pool_t* pool) {
+    while (!pool->failed && pool->next < pool->count) {
+        size_t index = pool->next++;
+        mutex_unlock(&pool->lock);
+        int status = pool->task(pool->ctx, index);
+        mutex_lock(&pool->lock);
+        if (status < 0 && !pool->failed) {
+            /* Errors are per thread: keep the task's message for the caller */
+            pool->failed = 1;
+            snprintf(pool->error, sizeof(pool->error), "%s", cdb_get_error());
+        }
+    }
+}
+
+static void pool_worker(cdb_thread_pool_t* pool) {
+    uint64_t seen = 0;
+    mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen) {
+            cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) break;
+        seen = pool->generation;
+        
+        pool_work(pool);
+        if (--pool->active == 0) cond_broadcast(&pool->work_done);
+    }
+    mutex_unlock(&pool->lock);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI pool_thread(LPVOID arg) {
+    pool_worker((cdb_thread_pool_t*)arg);
+    return 0;
+}
+#else
+static void* pool_thread(void* arg) {
+    pool_worker((cdb_thread_pool_t*)arg);
+    return NULL;
+}
+#endif
+
+/* Number of online CPUs (at least 1) */
+size_t cdb_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+#endif
+}
+
+/* Create a pool of num_threads threads in total, counting the caller.
+ * Returns NULL (run inline) for a single thread or if no worker could start. */
+cdb_thread_pool_t* cdb_pool_create(size_t num_threads) {
+    if (num_threads == 0) num_threads = cdb_cpu_count();
+    if (num_threads > CDB_MAX_THREADS) num_threads = CDB_MAX_THREADS;
+    if (num_threads <= 1) return NULL;
+    
+    cdb_thread_pool_t* pool = (cdb_thread_pool_t*)calloc(1, sizeof(cdb_thread_pool_t));
+    if (!pool) return NULL;
+    pool->threads = (cdb_thread_t*)malloc((num_threads - 1) * sizeof(cdb_thread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    mutex_init(&pool->lock);
+    cond_init(&pool->work_ready);
+    cond_init(&pool->work_done);
+    
+    /* Threads that fail to start are simply not part of the pool */
+    for (size_t t = 0; t + 1 < num_threads; t++) {
+#ifdef _WIN32
+        pool->threads[pool->num_workers] = CreateThread(NULL, 0, pool_thread, pool, 0, NULL);
+        if (!pool->threads[pool->num_workers]) break;
+#else
+        if (pthread_create(&pool->threads[pool->num_workers], NULL, pool_thread, pool) != 0) break;
+#endif
+        pool->num_workers++;
+    }
+    if (pool->num_workers == 0) {
+        cdb_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/* Number of threads that work on a batch, counting the caller */
+size_t cdb_pool_size(const cdb_thread_pool_t* pool) {
+    return pool ? pool->num_workers + 1 : 1;
+}
+
+/* Run task(ctx, i) for every i < count and wait for all of them */
+int cdb_pool_run(cdb_thread_pool_t* pool, size_t count, int (*task)(void* ctx, size_t index), void* ctx) {
+    if (!pool || count <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            if (task(ctx, i) < 0) return -1;
+        }
+        return 0;
+    }
+    
+    mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->count = count;
+    pool->next = 0;
+    pool->failed = 0;
+    pool->active = pool->num_workers;
+    pool->generation++;
+    cond_broadcast(&pool->work_ready);
+    
+    pool_work(pool);
+    
+    /* Workers may still be running the last tasks, or not have woken up yet */
+    while (pool->active > 0) {
+        cond_wait(&pool->work_done, &pool->lock);
+    }
+    int failed = pool->failed;
+    mutex_unlock(&pool->lock);
+    if (failed) {
+        set_error(pool->error);
+        return -1;
+    }
+    return 0;
+}
+
+/* Stop and join the workers */
+void cdb_pool_destroy(cdb_thread_pool_t* pool) {
+    if (!pool) return;
+    
+    mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    cond_broadcast(&pool->work_ready);
+    mutex_unlock(&pool->lock);
+    
+    for (size_t t = 0; t < pool->num_workers; t++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool->threads[t], INFINITE);
+        CloseHandle(pool->threads[t]);
+#else
+        pthread_join(pool->threads[t], NULL);
+#endif
+    }
+    cond_destroy(&pool->work_ready);
+    cond_destroy(&pool->work_done);
+    mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+struct cdb_worker {
+    cdb_thread_t thread;
+    cdb_mutex_t lock;
+    cdb_cond_t posted;        /* A job was posted, or shutdown */
+    cdb_cond_t done;          /* The posted job finished */
+    int (*job)(void* ctx);    /* Posted and not finished yet, or NULL */
+    void* ctx;
+    int status;
+    char error[256];          /* Error of a failed job, for the caller */
+    int shutdown;
+};
+
+static void worker_loop(cdb_worker_t* worker) {
+    mutex_lock(&worker->lock);
+    for (;;) {
+        while (!worker->shutdown && !worker->job) {
+            cond_wait(&worker->posted, &worker->lock);
+        }
+        if (!worker->job) break;
+        
+        mutex_unlock(&worker->lock);
+        int status = worker->job(worker->ctx);
+        mutex_lock(&worker->lock);
+        worker->status = status;
+        if (status < 0) snprintf(worker->error, sizeof(worker->error), "%s", cdb_get_error());
+        worker->job = NULL;
+        cond_broadcast(&worker->done);
+    }
+    mutex_unlock(&worker->lock);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_thread(LPVOID arg) {
+    worker_loop((cdb_worker_t*)arg);
+    return 0;
+}
+#else
+static void* worker_thread(void* arg) {
+    worker_loop((cdb_worker_t*)arg);
+    return NULL;
+}
+#endif
+
+/* Start a background worker; NULL if its thread could not start */
+cdb_worker_t* cdb_worker_create(void) {
+    cdb_worker_t* worker = (cdb_worker_t*)calloc(1, sizeof(cdb_worker_t));
+    if (!worker) return NULL;
+    mutex_init(&worker->lock);
+    cond_init(&worker->posted);
+    cond_init(&worker->done);
+
+#ifdef _WIN32
+    worker->thread = CreateThread(NULL, 0, worker_thread, worker, 0, NULL);
+    int started = worker->thread != NULL;
+#else
+    int started = pthread_create(&worker->thread, NULL, worker_thread, worker) == 0;
+#endif
+    if (!started) {
+        cond_destroy(&worker->posted);
+        cond_destroy(&worker->done);
+        mutex_destroy(&worker->lock);
+        free(worker);
+        return NULL;
+    }
+    return worker;
+}
+
+/* Run job(ctx) on the worker; the previous job must have been waited for */
+void cdb_worker_post(cdb_worker_t* worker, int (*job)(void* ctx), void* ctx) {
+    mutex_lock(&worker->lock);
+    worker->job = job;
+    worker->ctx = ctx;
+    cond_broadcast(&worker->posted);
+    mutex_unlock(&worker->lock);
+}
+
+/* Wait for the posted job; -1 with its error if it failed */
+int cdb_worker_wait(cdb_worker_t* worker) {
+    mutex_lock(&worker->lock);
+    while (worker->job) {
+        cond_wait(&worker->done, &worker->lock);
+    }
+    int status = worker->status;
+    mutex_unlock(&worker->lock);
+    if (status < 0) {
+        set_error(worker->error);
+        return -1;
+    }
+    return 0;
+}
+
+/* Finish a posted job, then stop and join the thread */
+void cdb_worker_destroy(cdb_worker_t* worker) {
+    if (!worker) return;
+    
+    mutex_lock(&worker->lock);
+    worker->shutdown = 1;
+    cond_broadcast(&worker->posted);
+    mutex_unlock(&worker->lock);
+
+#ifdef _WIN32
+    WaitForSingleObject(worker->thread, INFINITE);
+    CloseHandle(worker->thread);
+#else
+    pthread_join(worker->thread, NULL);
+#endif
+    cond_destroy(&worker->posted);
+    cond_destroy(&worker->done);
+    mutex_destroy(&worker->lock);
+    free(worker);
+}
+
+/* The lock's writer is recorded as the address of a thread-local marker;
+ * only the writer itself stores or clears it, so a thread comparing it
+ * with its own marker always sees a definite answer */
+static CDB_THREAD_LOCAL char thread_marker;
+
+struct cdb_rwlock {
+#ifdef _WIN32
+    SRWLOCK lock;
+#else
+    pthread_rwlock_t lock;
+#endif
+    const char* volatile writer;  /* &thread_marker of the writer, or NULL */
+    size_t depth;                 /* Nested acquisitions by the writer */
+};
+
+cdb_rwlock_t* cdb_rwlock_create(void) {
+    cdb_rwlock_t* lock = (cdb_rwlock_t*)malloc(sizeof(cdb_rwlock_t));
+    if (!lock) return NULL;
+#ifdef _WIN32
+    InitializeSRWLock(&lock->lock);
+#else
+    /* glibc prefers readers by default, so a steady stream of them would
+     * starve writers; other platforms already let a waiting writer in */
+    pthread_rwlockattr_t attr;
+    if (pthread_rwlockattr_init(&attr) != 0) {
+        free(lock);
+        return NULL;
+    }
+#ifdef __GLIBC__
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    int status = pthread_rwlock_init(&lock->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    if (status != 0) {
+        free(lock);
+        return NULL;
+    }
+#endif
+    lock->writer = NULL;
+    lock->depth = 0;
+    return lock;
+}
+
+void cdb_rwlock_destroy(cdb_rwlock_t* lock) {
+    if (!lock) return;
+#ifndef _WIN32
+    pthread_rwlock_destroy(&lock->lock);
+#endif
+    free(lock);
+}
+
+/* Nested acquisition by the writer: just count it */
+static int rwlock_reenter(cdb_rwlock_t* lock) {
+    if (lock->writer != &thread_marker) return 0;
+    lock->depth++;
+    return 1;
+}
+
+static void rwlock_became_writer(cdb_rwlock_t* lock) {
+    lock->writer = &thread_marker;
+    lock->depth = 1;
+}
+
+void cdb_rwlock_read(cdb_rwlock_t* lock) {
+    if (rwlock_reenter(lock)) return;
+#ifdef _WIN32
+    AcquireSRWLockShared(&lock->lock);
+#else
+    pthread_rwlock_rdlock(&lock->lock);
+#endif
+}
+
+void cdb_rwlock_write(cdb_rwlock_t* lock) {
+    if (rwlock_reenter(lock)) return;
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&lock->lock);
+#else
+    pthread_rwlock_wrlock(&lock->lock);
+#endif
+    rwlock_became_writer(lock);
+}
+
+int cdb_rwlock_try_read(cdb_rwlock_t* lock) {
+    if (rwlock_reenter(lock)) return 1;
+#ifdef _WIN32
+    return TryAcquireSRWLockShared(&lock->lock) != 0;
+#else
+    return pthread_rwlock_tryrdlock(&lock->lock) == 0;
+#endif
+}
+
+int cdb_rwlock_try_write(cdb_rwlock_t* lock) {
+    if (rwlock_reenter(lock)) return 1;
+#ifdef _WIN32
+    if (!TryAcquireSRWLockExclusive(&lock->lock)) return 0;
+#else
+    if (pthread_rwlock_trywrlock(&lock->lock) != 0) return 0;
+#endif
+    rwlock_became_writer(lock);
+    return 1;
+}
+
+void cdb_rwlock_read_unlock(cdb_rwlock_t* lock) {
+    if (lock->writer == &thread_marker) {
+        cdb_rwlock_write_unlock(lock);
+        return;
+    }
+#ifdef _WIN32
+    ReleaseSRWLockShared(&lock->lock);
+#else
+    pthread_rwlock_unlock(&lock->lock);
+#endif
+}
+
+void cdb_rwlock_write_unlock(cdb_rwlock_t* lock) {
+    if (--lock->depth > 0) return;
+    lock->writer = NULL;
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&lock->lock);
+#else
+    pthread_rwlock_unlock(&lock->lock);
+#endif
+}
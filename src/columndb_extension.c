@@ -1,21 +1,114 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <string.h>
 #include "../include/column_db.h"
+#include "column_db_internal.h"
 
 /* Python C extension for ColumnDB */
 
 typedef struct {
     PyObject_HEAD
     cdb_database_t* db;
+    Py_ssize_t exports;   /* Live buffer exports of column memory */
 } PyColumnDBObject;
 
+/* Exporter for one column's data or null bitmap (see get_column_buffer) */
+typedef struct {
+    PyObject_HEAD
+    PyColumnDBObject* owner;
+    size_t column_index;
+    int bitmap;           /* Export the null bitmap instead of the values */
+    Py_ssize_t shape[1];
+    Py_ssize_t strides[1];
+} PyColumnBufferObject;
+
+/* Streaming reader over a saved file (see open_reader) */
+typedef struct {
+    PyObject_HEAD
+    cdb_reader_t* reader;
+    int busy;             /* A next_batch call is running without the GIL */
+} PyReaderObject;
+
+/* Streaming writer of a file (see open_writer) */
+typedef struct {
+    PyObject_HEAD
+    cdb_writer_t* writer;
+    int busy;             /* A call is running without the GIL */
+} PyWriterObject;
+
 /* Forward declarations */
 static PyTypeObject PyColumnDBType;
+static PyTypeObject PyColumnBufferType;
+static PyTypeObject PyReaderType;
+static PyTypeObject PyWriterType;
+
+/* Per-database locking. Long C calls run with the GIL released, so every
+ * method holds the database lock: shared to read, alone to modify (the C
+ * library's modifying calls re-enter it). The lock is only ever waited for
+ * with the GIL released, so a thread holding it can always get the GIL back. */
+static void lock_read(PyColumnDBObject* self) {
+    if (cdb_try_read_lock(self->db)) return;
+    Py_BEGIN_ALLOW_THREADS
+    cdb_read_lock(self->db);
+    Py_END_ALLOW_THREADS
+}
+
+static void lock_write(PyColumnDBObject* self) {
+    if (cdb_try_write_lock(self->db)) return;
+    Py_BEGIN_ALLOW_THREADS
+    cdb_write_lock(self->db);
+    Py_END_ALLOW_THREADS
+}
+
+static void unlock_read(PyColumnDBObject* self) {
+    cdb_read_unlock(self->db);
+}
+
+static void unlock_write(PyColumnDBObject* self) {
+    cdb_write_unlock(self->db);
+}
+
+/* Take the write lock to grow columns. Refused while column memory is
+ * exported: a realloc would leave memoryviews/numpy arrays pointing at
+ * freed memory. */
+static int lock_for_update(PyColumnDBObject* self) {
+    lock_write(self);
+    if (self->exports > 0) {
+        unlock_write(self);
+        PyErr_SetString(PyExc_BufferError,
+                        "Existing exports of column data: database cannot be modified");
+        return -1;
+    }
+    return 0;
+}
+
+/* Look up a column and return it with the read lock held. Columns of a
+ * mapped file are materialized on first use, which can take a while and
+ * waits for other threads loading the same column, so it runs without the GIL. */
+static cdb_column_t* lock_column(PyColumnDBObject* self, const char* name) {
+    lock_read(self);
+    cdb_column_t* col;
+    if (self->db->mapping) {
+        Py_BEGIN_ALLOW_THREADS
+        col = cdb_get_column(self->db, name);
+        Py_END_ALLOW_THREADS
+    } else {
+        col = cdb_get_column(self->db, name);
+    }
+    if (!col) {
+        /* A column that exists but cannot be read is corrupt or unreadable on disk */
+        PyErr_SetString(cdb_get_column_index(self->db, name) < 0 ? PyExc_ValueError : PyExc_IOError,
+                        cdb_get_error());
+        unlock_read(self);
+    }
+    return col;
+}
 
 /* Create a new database object */
 static PyObject* PyColumnDB_new(PyTypeObject* type, PyObject* args, PyObject* kwds) {
     PyColumnDBObject* self = (PyColumnDBObject*)type->tp_alloc(type, 0);
     if (self != NULL) {
+        self->exports = 0;
         self->db = cdb_create_database();
         if (self->db == NULL) {
             Py_DECREF(self);
@@ -42,13 +135,18 @@ static PyObject* PyColumnDB_add_column(PyColumnDBObject* self, PyObject* args) {
         return NULL;
     }
     
-    if (type < CDB_TYPE_INT32 || type > CDB_TYPE_BOOL) {
+    if (type < CDB_TYPE_INT32 || type > CDB_TYPE_DICT_STRING) {
         PyErr_SetString(PyExc_ValueError, "Invalid data type");
         return NULL;
     }
     
-    if (cdb_add_column(self->db, name, (cdb_data_type_t)type) < 0) {
+    lock_write(self);
+    int status = cdb_add_column(self->db, name, (cdb_data_type_t)type);
+    if (status < 0) {
         PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
         return NULL;
     }
     
@@ -64,8 +162,15 @@ static PyObject* PyColumnDB_insert_int32(PyColumnDBObject* self, PyObject* args)
         return NULL;
     }
     
-    if (cdb_insert_int32(self->db, column_name, value) < 0) {
+    if (lock_for_update(self) < 0) {
+        return NULL;
+    }
+    int status = cdb_insert_int32(self->db, column_name, value);
+    if (status < 0) {
         PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
         return NULL;
     }
     
@@ -81,8 +186,15 @@ static PyObject* PyColumnDB_insert_int64(PyColumnDBObject* self, PyObject* args)
         return NULL;
     }
     
-    if (cdb_insert_int64(self->db, column_name, value) < 0) {
+    if (lock_for_update(self) < 0) {
+        return NULL;
+    }
+    int status = cdb_insert_int64(self->db, column_name, value);
+    if (status < 0) {
         PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
         return NULL;
     }
     
@@ -98,8 +210,15 @@ static PyObject* PyColumnDB_insert_float32(PyColumnDBObject* self, PyObject* arg
         return NULL;
     }
     
-    if (cdb_insert_float32(self->db, column_name, value) < 0) {
+    if (lock_for_update(self) < 0) {
+        return NULL;
+    }
+    int status = cdb_insert_float32(self->db, column_name, value);
+    if (status < 0) {
         PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
         return NULL;
     }
     
@@ -115,8 +234,15 @@ static PyObject* PyColumnDB_insert_float64(PyColumnDBObject* self, PyObject* arg
         return NULL;
     }
     
-    if (cdb_insert_float64(self->db, column_name, value) < 0) {
+    if (lock_for_update(self) < 0) {
+        return NULL;
+    }
+    int status = cdb_insert_float64(self->db, column_name, value);
+    if (status < 0) {
         PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
         return NULL;
     }
     
@@ -132,8 +258,15 @@ static PyObject* PyColumnDB_insert_string(PyColumnDBObject* self, PyObject* args
         return NULL;
     }
     
-    if (cdb_insert_string(self->db, column_name, value) < 0) {
+    if (lock_for_update(self) < 0) {
+        return NULL;
+    }
+    int status = cdb_insert_string(self->db, column_name, value);
+    if (status < 0) {
         PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
         return NULL;
     }
     
@@ -149,8 +282,15 @@ static PyObject* PyColumnDB_insert_bool(PyColumnDBObject* self, PyObject* args)
         return NULL;
     }
     
-    if (cdb_insert_bool(self->db, column_name, (uint8_t)value) < 0) {
+    if (lock_for_update(self) < 0) {
+        return NULL;
+    }
+    int status = cdb_insert_bool(self->db, column_name, (uint8_t)value);
+    if (status < 0) {
         PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
         return NULL;
     }
     
@@ -165,24 +305,363 @@ static PyObject* PyColumnDB_insert_null(PyColumnDBObject* self, PyObject* args)
         return NULL;
     }
     
-    if (cdb_insert_null(self->db, column_name) < 0) {
+    if (lock_for_update(self) < 0) {
+        return NULL;
+    }
+    int status = cdb_insert_null(self->db, column_name);
+    if (status < 0) {
+        PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
+        return NULL;
+    }
+    
+    Py_RETURN_NONE;
+}
+
+/* Check that a buffer's item format matches a fixed-width column type */
+static int buffer_matches_type(const Py_buffer* view, cdb_data_type_t type) {
+    const char* fmt = view->format ? view->format : "B";
+    if (*fmt == '@' || *fmt == '=') fmt++;
+    if (fmt[0] == '\0' || fmt[1] != '\0') return 0;
+    if ((size_t)view->itemsize != cdb_type_size(type)) return 0;
+    
+    switch (type) {
+        case CDB_TYPE_INT32:
+        case CDB_TYPE_INT64:
+            return strchr("bhilqn", fmt[0]) != NULL;
+        case CDB_TYPE_FLOAT32:
+            return fmt[0] == 'f';
+        case CDB_TYPE_FLOAT64:
+            return fmt[0] == 'd';
+        case CDB_TYPE_BOOL:
+            return strchr("?bB", fmt[0]) != NULL;
+        default:
+            return 0;
+    }
+}
+
+/* UTF-8 of a str for the C API, which takes NUL-terminated strings: like
+ * the "s" argument format, refuse strings with embedded NUL characters
+ * rather than store them cut short */
+static const char* utf8_without_nul(PyObject* str) {
+    Py_ssize_t size;
+    const char* utf8 = PyUnicode_AsUTF8AndSize(str, &size);
+    if (utf8 && strlen(utf8) != (size_t)size) {
+        PyErr_SetString(PyExc_ValueError, "embedded null character");
+        return NULL;
+    }
+    return utf8;
+}
+
+/* Append a list of str/None values to a string column */
+static int append_string_sequence(PyColumnDBObject* self, const char* column_name,
+                                  PyObject* data, const uint8_t* null_bitmap) {
+    PyObject* seq = PySequence_Fast(data, "string columns require a sequence of str or None");
+    if (!seq) return -1;
+    
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    const char** values = (const char**)PyMem_Malloc((n > 0 ? n : 1) * sizeof(char*));
+    if (!values) {
+        Py_DECREF(seq);
+        PyErr_NoMemory();
+        return -1;
+    }
+    
+    PyObject** items = PySequence_Fast_ITEMS(seq);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        if (items[i] == Py_None) {
+            values[i] = NULL;
+        } else if (PyUnicode_Check(items[i])) {
+            values[i] = utf8_without_nul(items[i]);
+            if (!values[i]) goto fail;
+        } else {
+            PyErr_Format(PyExc_TypeError, "expected str or None at index %zd", i);
+            goto fail;
+        }
+    }
+    
+    if (lock_for_update(self) < 0) goto fail;
+    int status = cdb_append_string_array(self->db, column_name, values, (size_t)n, null_bitmap);
+    if (status < 0) {
         PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) goto fail;
+    
+    PyMem_Free(values);
+    Py_DECREF(seq);
+    return 0;
+
+fail:
+    PyMem_Free(values);
+    Py_DECREF(seq);
+    return -1;
+}
+
+/* Bulk append method: buffer-protocol objects for numeric/bool columns,
+ * sequences of str/None for string columns */
+static PyObject* PyColumnDB_append_array(PyColumnDBObject* self, PyObject* args) {
+    const char* column_name;
+    PyObject* data;
+    PyObject* null_obj = Py_None;
+    
+    if (!PyArg_ParseTuple(args, "sO|O", &column_name, &data, &null_obj)) {
+        return NULL;
+    }
+    
+    /* Values are converted before the write lock is taken: that may run Python code */
+    cdb_column_t* col = lock_column(self, column_name);
+    if (!col) {
+        return NULL;
+    }
+    cdb_data_type_t type = col->data_type;
+    unlock_read(self);
+    
+    Py_buffer null_view = {0};
+    int has_nulls = (null_obj != Py_None);
+    if (has_nulls && PyObject_GetBuffer(null_obj, &null_view, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+    
+    int status = 0;
+    if (type == CDB_TYPE_STRING || type == CDB_TYPE_DICT_STRING) {
+        Py_ssize_t n = PySequence_Size(data);
+        if (n < 0) {
+            status = -1;
+        } else if (has_nulls && null_view.len < (n + 7) / 8) {
+            PyErr_SetString(PyExc_ValueError, "null_bitmap is too short");
+            status = -1;
+        } else {
+            status = append_string_sequence(self, column_name, data,
+                                            has_nulls ? (const uint8_t*)null_view.buf : NULL);
+        }
+    } else {
+        Py_buffer view;
+        if (PyObject_GetBuffer(data, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+            if (has_nulls) PyBuffer_Release(&null_view);
+            return NULL;
+        }
+        
+        Py_ssize_t n = view.itemsize > 0 ? view.len / view.itemsize : 0;
+        if (!buffer_matches_type(&view, type)) {
+            PyErr_Format(PyExc_TypeError, "buffer format '%s' (itemsize %zd) does not match column '%s'",
+                         view.format ? view.format : "B", view.itemsize, column_name);
+            status = -1;
+        } else if (has_nulls && null_view.len < (n + 7) / 8) {
+            PyErr_SetString(PyExc_ValueError, "null_bitmap is too short");
+            status = -1;
+        } else if (lock_for_update(self) < 0) {
+            status = -1;
+        } else {
+            Py_BEGIN_ALLOW_THREADS
+            status = cdb_append_array(self->db, column_name, view.buf, (size_t)n,
+                                      has_nulls ? (const uint8_t*)null_view.buf : NULL);
+            Py_END_ALLOW_THREADS
+            if (status < 0) {
+                PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+            }
+            unlock_write(self);
+        }
+        PyBuffer_Release(&view);
+    }
+    
+    if (has_nulls) PyBuffer_Release(&null_view);
+    if (status < 0) return NULL;
+    
+    Py_RETURN_NONE;
+}
+
+/* Convert one cell of a row to the value its column expects */
+static int convert_row_value(PyObject* item, cdb_data_type_t type, cdb_value_t* value) {
+    value->is_null = (item == Py_None);
+    if (value->is_null) {
+        value->as.str = NULL;
+        return 0;
+    }
+    
+    switch (type) {
+        case CDB_TYPE_INT32: {
+            long v = PyLong_AsLong(item);
+            if (v == -1 && PyErr_Occurred()) return -1;
+            if (v < INT32_MIN || v > INT32_MAX) {
+                PyErr_SetString(PyExc_OverflowError, "value out of range for an int32 column");
+                return -1;
+            }
+            value->as.i32 = (int32_t)v;
+            return 0;
+        }
+        case CDB_TYPE_INT64: {
+            long long v = PyLong_AsLongLong(item);
+            if (v == -1 && PyErr_Occurred()) return -1;
+            value->as.i64 = (int64_t)v;
+            return 0;
+        }
+        case CDB_TYPE_FLOAT32:
+        case CDB_TYPE_FLOAT64: {
+            double v = PyFloat_AsDouble(item);
+            if (v == -1.0 && PyErr_Occurred()) return -1;
+            if (type == CDB_TYPE_FLOAT32) {
+                value->as.f32 = (float)v;
+            } else {
+                value->as.f64 = v;
+            }
+            return 0;
+        }
+        case CDB_TYPE_BOOL: {
+            int v = PyObject_IsTrue(item);
+            if (v < 0) return -1;
+            value->as.b = (uint8_t)v;
+            return 0;
+        }
+        case CDB_TYPE_STRING:
+        case CDB_TYPE_DICT_STRING:
+            if (!PyUnicode_Check(item)) {
+                PyErr_SetString(PyExc_TypeError, "string columns require str or None");
+                return -1;
+            }
+            value->as.str = utf8_without_nul(item);
+            return value->as.str ? 0 : -1;
+        default:
+            PyErr_SetString(PyExc_TypeError, "unsupported column type");
+            return -1;
+    }
+}
+
+/* Insert a batch of rows, each a sequence with one value per column in
+ * column order. Values are converted column by column, so the type is
+ * switched on once per column rather than once per value. */
+static PyObject* PyColumnDB_insert_rows(PyColumnDBObject* self, PyObject* args) {
+    PyObject* rows_obj;
+    
+    if (!PyArg_ParseTuple(args, "O", &rows_obj)) {
+        return NULL;
+    }
+    
+    PyObject* rows = PySequence_Fast(rows_obj, "rows must be a sequence of sequences");
+    if (!rows) {
         return NULL;
     }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(rows);
+    
+    /* As in append_array, conversion may run Python code, so it happens
+     * outside the write lock against a snapshot of the column types */
+    lock_read(self);
+    size_t num_columns = self->db->num_columns;
+    cdb_data_type_t* types = (cdb_data_type_t*)PyMem_Malloc((num_columns > 0 ? num_columns : 1) *
+                                                            sizeof(cdb_data_type_t));
+    if (types) {
+        for (size_t c = 0; c < num_columns; c++) {
+            types[c] = self->db->columns[c].data_type;
+        }
+    }
+    unlock_read(self);
+    
+    PyObject** row_seqs = (PyObject**)PyMem_Calloc(n > 0 ? (size_t)n : 1, sizeof(PyObject*));
+    cdb_value_t* values = (cdb_value_t*)PyMem_Malloc((n > 0 ? (size_t)n : 1) * (num_columns > 0 ? num_columns : 1) *
+                                                     sizeof(cdb_value_t));
+    int status = -1;
+    if (!types || !row_seqs || !values) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    if (num_columns == 0) {
+        PyErr_SetString(PyExc_ValueError, "database has no columns");
+        goto done;
+    }
+    
+    PyObject** items = PySequence_Fast_ITEMS(rows);
+    for (Py_ssize_t r = 0; r < n; r++) {
+        row_seqs[r] = PySequence_Fast(items[r], "each row must be a sequence");
+        if (!row_seqs[r]) goto done;
+        if ((size_t)PySequence_Fast_GET_SIZE(row_seqs[r]) != num_columns) {
+            PyErr_Format(PyExc_ValueError, "row %zd has %zd values, expected %zu",
+                         r, PySequence_Fast_GET_SIZE(row_seqs[r]), num_columns);
+            goto done;
+        }
+    }
+    
+    for (size_t c = 0; c < num_columns; c++) {
+        for (Py_ssize_t r = 0; r < n; r++) {
+            PyObject* item = PySequence_Fast_GET_ITEM(row_seqs[r], c);
+            if (convert_row_value(item, types[c], &values[(size_t)r * num_columns + c]) < 0) {
+                goto done;
+            }
+        }
+    }
+    
+    if (lock_for_update(self) < 0) goto done;
+    int changed = (self->db->num_columns != num_columns);
+    for (size_t c = 0; !changed && c < num_columns; c++) {
+        changed = (self->db->columns[c].data_type != types[c]);
+    }
+    if (changed) {
+        PyErr_SetString(PyExc_RuntimeError, "columns changed while the rows were converted");
+    } else {
+        Py_BEGIN_ALLOW_THREADS
+        status = cdb_append_rows(self->db, values, (size_t)n);
+        Py_END_ALLOW_THREADS
+        if (status < 0) {
+            PyErr_SetString(PyExc_RuntimeError, cdb_get_error());
+        }
+    }
+    unlock_write(self);
+
+done:
+    if (row_seqs) {
+        for (Py_ssize_t r = 0; r < n; r++) {
+            Py_XDECREF(row_seqs[r]);
+        }
+    }
+    PyMem_Free(row_seqs);
+    PyMem_Free(values);
+    PyMem_Free(types);
+    Py_DECREF(rows);
+    if (status < 0) return NULL;
     
     Py_RETURN_NONE;
 }
 
 /* Get num rows method */
 static PyObject* PyColumnDB_get_num_rows(PyColumnDBObject* self, PyObject* Py_UNUSED(args)) {
-    return PyLong_FromSize_t(cdb_get_num_rows(self->db));
+    lock_read(self);
+    size_t rows = cdb_get_num_rows(self->db);
+    unlock_read(self);
+    return PyLong_FromSize_t(rows);
 }
 
 /* Get num columns method */
 static PyObject* PyColumnDB_get_num_columns(PyColumnDBObject* self, PyObject* Py_UNUSED(args)) {
-    return PyLong_FromSize_t(cdb_get_num_columns(self->db));
+    lock_read(self);
+    size_t columns = cdb_get_num_columns(self->db);
+    unlock_read(self);
+    return PyLong_FromSize_t(columns);
 }
 
+/* Fill list with the rows of a fixed-width column of C type T, NULL rows
+ * as None; the type was dispatched once, so the loop reads data directly */
+#define COLUMN_TO_LIST(T, CONVERT)                                                  \
+    do {                                                                            \
+        const T* values = (const T*)col->data;                                      \
+        for (size_t i = 0; i < n; i++) {                                            \
+            PyObject* value;                                                        \
+            if (i % 64 == 0 && col->null_count > 0) {                               \
+                nulls = cdb_null_word(col->null_bitmap, i, n);                      \
+            }                                                                       \
+            if ((nulls >> (i % 64)) & 1) {                                          \
+                value = Py_None;                                                    \
+                Py_INCREF(Py_None);                                                 \
+            } else if (!(value = CONVERT(values[i]))) {                             \
+                goto fail;                                                          \
+            }                                                                       \
+            PyList_SET_ITEM(list, i, value);                                        \
+        }                                                                           \
+    } while (0)
+
+#define INT32_TO_PY(v) PyLong_FromLong((long)(v))
+#define BOOL_TO_PY(v) PyBool_FromLong((v) != 0)
+
 /* Get column data method */
 static PyObject* PyColumnDB_get_column_data(PyColumnDBObject* self, PyObject* args) {
     const char* column_name;
@@ -191,67 +670,161 @@ static PyObject* PyColumnDB_get_column_data(PyColumnDBObject* self, PyObject* ar
         return NULL;
     }
     
-    cdb_column_t* col = cdb_get_column(self->db, column_name);
+    cdb_column_t* col = lock_column(self, column_name);
     if (!col) {
-        PyErr_SetString(PyExc_ValueError, cdb_get_error());
         return NULL;
     }
     
     /* Build a list of values */
-    PyObject* result = PyList_New(col->num_rows);
-    if (!result) {
+    size_t n = col->num_rows;
+    PyObject* list = PyList_New((Py_ssize_t)n);
+    if (!list) {
+        unlock_read(self);
         return NULL;
     }
     
-    for (size_t i = 0; i < col->num_rows; i++) {
-        PyObject* value;
-        
-        if (cdb_is_null(col, i)) {
-            value = Py_None;
-            Py_INCREF(Py_None);
-        } else {
-            switch (col->data_type) {
-                case CDB_TYPE_INT32:
-                    value = PyLong_FromLong(cdb_get_int32(col, i));
-                    break;
-                case CDB_TYPE_INT64:
-                    value = PyLong_FromLongLong(cdb_get_int64(col, i));
-                    break;
-                case CDB_TYPE_FLOAT32:
-                    value = PyFloat_FromDouble(cdb_get_float32(col, i));
-                    break;
-                case CDB_TYPE_FLOAT64:
-                    value = PyFloat_FromDouble(cdb_get_float64(col, i));
-                    break;
-                case CDB_TYPE_STRING:
-                    value = PyUnicode_FromString(cdb_get_string(col, i));
-                    break;
-                case CDB_TYPE_BOOL:
-                    value = PyBool_FromLong(cdb_get_bool(col, i));
-                    break;
-                default:
+    /* Null bits are fetched a word (64 rows) at a time, and never without NULLs */
+    uint64_t nulls = 0;
+    switch (col->data_type) {
+        case CDB_TYPE_INT32:
+            COLUMN_TO_LIST(int32_t, INT32_TO_PY);
+            break;
+        case CDB_TYPE_INT64:
+            COLUMN_TO_LIST(int64_t, PyLong_FromLongLong);
+            break;
+        case CDB_TYPE_FLOAT32:
+            COLUMN_TO_LIST(float, PyFloat_FromDouble);
+            break;
+        case CDB_TYPE_FLOAT64:
+            COLUMN_TO_LIST(double, PyFloat_FromDouble);
+            break;
+        case CDB_TYPE_BOOL:
+            COLUMN_TO_LIST(uint8_t, BOOL_TO_PY);
+            break;
+        case CDB_TYPE_STRING:
+        case CDB_TYPE_DICT_STRING:
+            for (size_t i = 0; i < n; i++) {
+                PyObject* value;
+                if (i % 64 == 0 && col->null_count > 0) {
+                    nulls = cdb_null_word(col->null_bitmap, i, n);
+                }
+                if ((nulls >> (i % 64)) & 1) {
                     value = Py_None;
                     Py_INCREF(Py_None);
+                } else {
+                    size_t length;
+                    const char* str = cdb_get_string(col, i, &length);
+                    value = PyUnicode_FromStringAndSize(str ? str : "", (Py_ssize_t)length);
+                    if (!value) goto fail;
+                }
+                PyList_SET_ITEM(list, i, value);
             }
-        }
-        
+            break;
+        default:
+            for (size_t i = 0; i < n; i++) {
+                Py_INCREF(Py_None);
+                PyList_SET_ITEM(list, i, Py_None);
+            }
+            break;
+    }
+    
+    unlock_read(self);
+    return list;
+
+fail:
+    unlock_read(self);
+    Py_DECREF(list);
+    return NULL;
+}
+
+#undef BOOL_TO_PY
+#undef INT32_TO_PY
+#undef COLUMN_TO_LIST
+
+/* Aggregate method: SUM/MIN/MAX/COUNT/MEAN of a column, None when NULL */
+static PyObject* PyColumnDB_aggregate(PyColumnDBObject* self, PyObject* args) {
+    const char* column_name;
+    int op;
+    
+    if (!PyArg_ParseTuple(args, "si", &column_name, &op)) {
+        return NULL;
+    }
+    
+    cdb_column_t* col = lock_column(self, column_name);
+    if (!col) {
+        return NULL;
+    }
+    
+    cdb_agg_result_t result;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = cdb_aggregate(col, (cdb_agg_op_t)op, &result);
+    Py_END_ALLOW_THREADS
+    if (status < 0) {
+        PyErr_SetString(PyExc_TypeError, cdb_get_error());
+    }
+    unlock_read(self);
+    if (status < 0) {
+        return NULL;
+    }
+    
+    if (result.is_null) {
+        Py_RETURN_NONE;
+    }
+    if (result.is_float) {
+        return PyFloat_FromDouble(result.f);
+    }
+    return PyLong_FromLongLong(result.i);
+}
+
+/* Get the distinct values of a DICT_STRING column, indexed by code */
+static PyObject* PyColumnDB_get_dictionary(PyColumnDBObject* self, PyObject* args) {
+    const char* column_name;
+    
+    if (!PyArg_ParseTuple(args, "s", &column_name)) {
+        return NULL;
+    }
+    
+    cdb_column_t* col = lock_column(self, column_name);
+    if (!col) {
+        return NULL;
+    }
+    if (col->data_type != CDB_TYPE_DICT_STRING) {
+        unlock_read(self);
+        PyErr_SetString(PyExc_TypeError, "Column is not dictionary-encoded");
+        return NULL;
+    }
+    
+    PyObject* result = PyList_New(col->dict_size);
+    if (!result) {
+        unlock_read(self);
+        return NULL;
+    }
+    
+    for (size_t code = 0; code < col->dict_size; code++) {
+        size_t length;
+        const char* str = cdb_dict_value(col, (uint32_t)code, &length);
+        PyObject* value = PyUnicode_FromStringAndSize(str ? str : "", (Py_ssize_t)length);
         if (!value) {
+            unlock_read(self);
             Py_DECREF(result);
             return NULL;
         }
-        
-        PyList_SET_ITEM(result, i, value);
+        PyList_SET_ITEM(result, code, value);
     }
     
+    unlock_read(self);
     return result;
 }
 
 /* Get column names */
 static PyObject* PyColumnDB_get_column_names(PyColumnDBObject* self, PyObject* args)
 {
+    lock_read(self);
     size_t num_cols = self->db->num_columns;
     PyObject* result = PyList_New(num_cols);
     if (!result) {
+        unlock_read(self);
         return NULL;
     }
     
@@ -263,6 +836,7 @@ static PyObject* PyColumnDB_get_column_names(PyColumnDBObject* self, PyObject* a
         
         PyObject* name_obj = PyUnicode_FromString(name);
         if (!name_obj) {
+            unlock_read(self);
             Py_DECREF(result);
             return NULL;
         }
@@ -270,59 +844,939 @@ static PyObject* PyColumnDB_get_column_names(PyColumnDBObject* self, PyObject* a
         PyList_SET_ITEM(result, i, name_obj);
     }
     
+    unlock_read(self);
     return result;
 }
 
-/* Save database to file */
+/* Buffer format character for a fixed-width column type */
+static const char* buffer_format_for_type(cdb_data_type_t type) {
+    switch (type) {
+        case CDB_TYPE_INT32: return "i";
+        case CDB_TYPE_INT64: return "q";
+        case CDB_TYPE_FLOAT32: return "f";
+        case CDB_TYPE_FLOAT64: return "d";
+        case CDB_TYPE_BOOL: return "?";
+        case CDB_TYPE_DICT_STRING: return "I";  /* Dictionary codes */
+        default: return NULL;
+    }
+}
+
+/* Expose column memory through the buffer protocol (read-only) */
+static int PyColumnBuffer_getbuffer(PyColumnBufferObject* self, Py_buffer* view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "Column buffers are read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    
+    /* Writers check exports under the write lock, so the memory stays put */
+    lock_read(self->owner);
+    cdb_column_t* col = &self->owner->db->columns[self->column_index];
+    Py_ssize_t itemsize;
+    const char* format;
+    
+    if (self->bitmap) {
+        itemsize = 1;
+        format = "B";
+        self->shape[0] = (Py_ssize_t)((col->num_rows + 7) / 8);
+        view->buf = col->null_bitmap;
+    } else {
+        itemsize = (Py_ssize_t)cdb_type_size(col->data_type);
+        format = buffer_format_for_type(col->data_type);
+        self->shape[0] = (Py_ssize_t)col->num_rows;
+        view->buf = col->data;
+    }
+    self->strides[0] = itemsize;
+    
+    view->obj = (PyObject*)self;
+    Py_INCREF(self);
+    view->len = self->shape[0] * itemsize;
+    view->readonly = 1;
+    view->itemsize = itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)format : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    
+    self->owner->exports++;
+    unlock_read(self->owner);
+    return 0;
+}
+
+static void PyColumnBuffer_releasebuffer(PyColumnBufferObject* self, Py_buffer* view) {
+    self->owner->exports--;
+}
+
+static void PyColumnBuffer_dealloc(PyColumnBufferObject* self) {
+    Py_XDECREF(self->owner);
+    PyObject_Del(self);
+}
+
+/* Build a memoryview over a column's values or null bitmap */
+static PyObject* make_column_view(PyColumnDBObject* self, PyObject* args, int bitmap) {
+    const char* column_name;
+    
+    if (!PyArg_ParseTuple(args, "s", &column_name)) {
+        return NULL;
+    }
+    
+    cdb_column_t* col = lock_column(self, column_name);
+    if (!col) {
+        return NULL;
+    }
+    size_t idx = (size_t)(col - self->db->columns);
+    cdb_data_type_t type = col->data_type;
+    unlock_read(self);
+    
+    if (!bitmap && type == CDB_TYPE_STRING) {
+        PyErr_SetString(PyExc_TypeError, "String columns cannot be exported as a buffer");
+        return NULL;
+    }
+    
+    PyColumnBufferObject* exporter = PyObject_New(PyColumnBufferObject, &PyColumnBufferType);
+    if (!exporter) {
+        return NULL;
+    }
+    Py_INCREF(self);
+    exporter->owner = self;
+    exporter->column_index = idx;
+    exporter->bitmap = bitmap;
+    
+    PyObject* view = PyMemoryView_FromObject((PyObject*)exporter);
+    Py_DECREF(exporter);
+    return view;
+}
+
+/* Get column buffer method */
+static PyObject* PyColumnDB_get_column_buffer(PyColumnDBObject* self, PyObject* args) {
+    return make_column_view(self, args, 0);
+}
+
+/* Get null count method */
+static PyObject* PyColumnDB_get_null_count(PyColumnDBObject* self, PyObject* args) {
+    const char* column_name;
+    
+    if (!PyArg_ParseTuple(args, "s", &column_name)) {
+        return NULL;
+    }
+    
+    cdb_column_t* col = lock_column(self, column_name);
+    if (!col) {
+        return NULL;
+    }
+    
+    size_t null_count = col->null_count;
+    unlock_read(self);
+    return PyLong_FromSize_t(null_count);
+}
+
+/* Get null bitmap method */
+static PyObject* PyColumnDB_get_null_bitmap(PyColumnDBObject* self, PyObject* args) {
+    return make_column_view(self, args, 1);
+}
+
+/* Save database to file, optionally compressing this save's columns */
 static PyObject* PyColumnDB_save(PyColumnDBObject* self, PyObject* args)
 {
     const char* filename;
-    if (!PyArg_ParseTuple(args, "s", &filename)) {
+    int codec = CDB_COMPRESSION_NONE;
+    int level = 0;
+    int append = 0;
+    if (!PyArg_ParseTuple(args, "s|iip", &filename, &codec, &level, &append)) {
+        return NULL;
+    }
+    
+    if (cdb_check_compression((cdb_compression_t)codec, level) < 0) {
+        PyErr_SetString(PyExc_ValueError, cdb_get_error());
         return NULL;
     }
     
-    int result = cdb_save(filename, self->db);
+    /* A save only reads the database, unless it is mapped: then columns
+     * are materialized, and saving over the mapped file moves them to the heap */
+    lock_read(self);
+    int exclusive = self->db->mapping != NULL;
+    if (exclusive) {
+        unlock_read(self);
+        if (lock_for_update(self) < 0) {
+            return NULL;
+        }
+    }
+    
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = append
+        ? cdb_save_append_with_codec(self->db, filename, (cdb_compression_t)codec, level)
+        : cdb_save_with_codec(self->db, filename, (cdb_compression_t)codec, level);
+    Py_END_ALLOW_THREADS
+    if (exclusive) {
+        unlock_write(self);
+    } else {
+        unlock_read(self);
+    }
     if (result != 0) {
-        PyErr_SetString(PyExc_IOError, "Failed to save database");
+        PyErr_Format(PyExc_IOError, "Failed to save database: %s", cdb_get_error());
         return NULL;
     }
     
     Py_RETURN_NONE;
 }
 
-/* Load database from file - instance method */
-static PyObject* PyColumnDB_load(PyColumnDBObject* self, PyObject* args)
+/* Set the row group size of later saves */
+static PyObject* PyColumnDB_set_row_group_size(PyColumnDBObject* self, PyObject* args)
 {
-    const char* filename;
-    if (!PyArg_ParseTuple(args, "s", &filename)) {
+    Py_ssize_t rows;
+    if (!PyArg_ParseTuple(args, "n", &rows)) {
         return NULL;
     }
     
-    int result = cdb_open(filename, self->db);
-    if (result != 0) {
-        PyErr_SetString(PyExc_IOError, "Failed to load database");
+    lock_write(self);
+    int status = rows > 0 ? cdb_set_row_group_size(self->db, (size_t)rows) : -1;
+    unlock_write(self);
+    if (status < 0) {
+        PyErr_SetString(PyExc_ValueError, "Row group size must be a positive multiple of 64");
         return NULL;
     }
     
     Py_RETURN_NONE;
 }
 
-/* Methods table */
-static PyMethodDef PyColumnDB_methods[] = {
-    {"add_column", (PyCFunction)PyColumnDB_add_column, METH_VARARGS, "Add a column to the database"},
-    {"insert_int32", (PyCFunction)PyColumnDB_insert_int32, METH_VARARGS, "Insert int32 value"},
-    {"insert_int64", (PyCFunction)PyColumnDB_insert_int64, METH_VARARGS, "Insert int64 value"},
-    {"insert_float32", (PyCFunction)PyColumnDB_insert_float32, METH_VARARGS, "Insert float32 value"},
-    {"insert_float64", (PyCFunction)PyColumnDB_insert_float64, METH_VARARGS, "Insert float64 value"},
-    {"insert_string", (PyCFunction)PyColumnDB_insert_string, METH_VARARGS, "Insert string value"},
-    {"insert_bool", (PyCFunction)PyColumnDB_insert_bool, METH_VARARGS, "Insert bool value"},
+/* Enable or disable lightweight column encodings in later saves */
+static PyObject* PyColumnDB_set_column_encoding(PyColumnDBObject* self, PyObject* args)
+{
+    int enabled;
+    if (!PyArg_ParseTuple(args, "p", &enabled)) {
+        return NULL;
+    }
+    
+    lock_write(self);
+    cdb_set_column_encoding(self->db, enabled);
+    unlock_write(self);
+    Py_RETURN_NONE;
+}
+
+/* Set the thread count of later saves and loads */
+static PyObject* PyColumnDB_set_num_threads(PyColumnDBObject* self, PyObject* args)
+{
+    Py_ssize_t threads;
+    if (!PyArg_ParseTuple(args, "n", &threads)) {
+        return NULL;
+    }
+    
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "Thread count must not be negative");
+        return NULL;
+    }
+    
+    lock_write(self);
+    cdb_set_num_threads(self->db, (size_t)threads);
+    unlock_write(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject* PyColumnDB_set_growth_factor(PyColumnDBObject* self, PyObject* args)
+{
+    double factor;
+    if (!PyArg_ParseTuple(args, "d", &factor)) {
+        return NULL;
+    }
+    
+    lock_write(self);
+    int status = cdb_set_growth_factor(self->db, factor);
+    if (status < 0) {
+        PyErr_SetString(PyExc_ValueError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+/* Reserve capacity in one column, or in all of them when no name is given.
+ * Growing moves the data, so exports block it like any other update. */
+static PyObject* PyColumnDB_reserve(PyColumnDBObject* self, PyObject* args)
+{
+    Py_ssize_t num_rows;
+    const char* column_name = NULL;
+    if (!PyArg_ParseTuple(args, "n|z", &num_rows, &column_name)) {
+        return NULL;
+    }
+    
+    if (num_rows < 0) {
+        PyErr_SetString(PyExc_ValueError, "Row count must not be negative");
+        return NULL;
+    }
+    
+    if (lock_for_update(self) < 0) {
+        return NULL;
+    }
+    int status;
+    if (column_name && cdb_get_column_index(self->db, column_name) < 0) {
+        PyErr_SetString(PyExc_ValueError, cdb_get_error());
+        status = -1;
+    } else {
+        Py_BEGIN_ALLOW_THREADS
+        status = column_name ? cdb_reserve(self->db, column_name, (size_t)num_rows)
+                             : cdb_reserve_all(self->db, (size_t)num_rows);
+        Py_END_ALLOW_THREADS
+        if (status < 0) {
+            PyErr_SetString(PyExc_MemoryError, cdb_get_error());
+        }
+    }
+    unlock_write(self);
+    if (status < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+/* Declare a column sorted (checked against its rows) or clear the flag */
+static PyObject* PyColumnDB_set_sorted(PyColumnDBObject* self, PyObject* args)
+{
+    const char* column_name;
+    int sorted = 1;
+    if (!PyArg_ParseTuple(args, "s|p", &column_name, &sorted)) {
+        return NULL;
+    }
+    
+    int status;
+    lock_write(self);
+    Py_BEGIN_ALLOW_THREADS
+    status = cdb_set_sorted(self->db, column_name, sorted);
+    Py_END_ALLOW_THREADS
+    if (status < 0) {
+        PyErr_SetString(PyExc_ValueError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* PyColumnDB_is_sorted(PyColumnDBObject* self, PyObject* args)
+{
+    const char* column_name;
+    if (!PyArg_ParseTuple(args, "s", &column_name)) {
+        return NULL;
+    }
+    
+    cdb_column_t* col = lock_column(self, column_name);
+    if (!col) {
+        return NULL;
+    }
+    int sorted = col->sorted;
+    unlock_read(self);
+    return PyBool_FromLong(sorted);
+}
+
+/* Binary-search a sorted column for the rows with low <= value <= high */
+static PyObject* PyColumnDB_range(PyColumnDBObject* self, PyObject* args)
+{
+    const char* column_name;
+    PyObject* low;
+    PyObject* high;
+    if (!PyArg_ParseTuple(args, "sOO", &column_name, &low, &high)) {
+        return NULL;
+    }
+    
+    /* Columns keep their type: convert the bounds without holding the lock */
+    cdb_column_t* col = lock_column(self, column_name);
+    if (!col) {
+        return NULL;
+    }
+    cdb_data_type_t type = col->data_type;
+    unlock_read(self);
+    
+    cdb_value_t bounds[2];
+    if (convert_row_value(low, type, &bounds[0]) < 0 || convert_row_value(high, type, &bounds[1]) < 0) {
+        return NULL;
+    }
+    
+    col = lock_column(self, column_name);
+    if (!col) {
+        return NULL;
+    }
+    size_t start, end;
+    int status = cdb_range(col, low == Py_None ? NULL : &bounds[0], high == Py_None ? NULL : &bounds[1],
+                           &start, &end);
+    if (status < 0) {
+        PyErr_SetString(PyExc_ValueError, cdb_get_error());
+    }
+    unlock_read(self);
+    if (status < 0) {
+        return NULL;
+    }
+    return Py_BuildValue("(nn)", (Py_ssize_t)start, (Py_ssize_t)end);
+}
+
+/* Build a column's index; kind is a cdb_index_kind_t value */
+static PyObject* PyColumnDB_create_index(PyColumnDBObject* self, PyObject* args)
+{
+    const char* column_name;
+    int kind = CDB_INDEX_AUTO;
+    if (!PyArg_ParseTuple(args, "s|i", &column_name, &kind)) {
+        return NULL;
+    }
+    
+    int status;
+    lock_write(self);
+    Py_BEGIN_ALLOW_THREADS
+    status = cdb_create_index(self->db, column_name, (cdb_index_kind_t)kind);
+    Py_END_ALLOW_THREADS
+    if (status < 0) {
+        PyErr_SetString(PyExc_ValueError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* PyColumnDB_drop_index(PyColumnDBObject* self, PyObject* args)
+{
+    const char* column_name;
+    if (!PyArg_ParseTuple(args, "s", &column_name)) {
+        return NULL;
+    }
+    
+    lock_write(self);
+    int status = cdb_drop_index(self->db, column_name);
+    if (status < 0) {
+        PyErr_SetString(PyExc_ValueError, cdb_get_error());
+    }
+    unlock_write(self);
+    if (status < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+/* Declared index kind of a column (0 for none); appends do not clear it */
+static PyObject* PyColumnDB_get_index(PyColumnDBObject* self, PyObject* args)
+{
+    const char* column_name;
+    if (!PyArg_ParseTuple(args, "s", &column_name)) {
+        return NULL;
+    }
+    
+    lock_read(self);
+    int idx = cdb_get_column_index(self->db, column_name);
+    int kind = idx >= 0 ? self->db->columns[idx].index_kind : CDB_INDEX_NONE;
+    unlock_read(self);
+    if (idx < 0) {
+        PyErr_Format(PyExc_ValueError, "Column '%s' not found", column_name);
+        return NULL;
+    }
+    return PyLong_FromLong(kind);
+}
+
+/* Convert an optional sequence of column names to a C array.
+ * Returns 0 and sets *names to NULL when columns is None. */
+static int parse_column_names(PyObject* columns, PyObject** seq_out,
+                              const char*** names, Py_ssize_t* count) {
+    *seq_out = NULL;
+    *names = NULL;
+    *count = 0;
+    if (columns == Py_None) return 0;
+    
+    PyObject* seq = PySequence_Fast(columns, "columns must be a sequence of str");
+    if (!seq) return -1;
+    
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    const char** values = (const char**)PyMem_Malloc((n > 0 ? n : 1) * sizeof(char*));
+    if (!values) {
+        Py_DECREF(seq);
+        PyErr_NoMemory();
+        return -1;
+    }
+    
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        values[i] = PyUnicode_Check(item) ? PyUnicode_AsUTF8(item) : NULL;
+        if (!values[i]) {
+            if (!PyErr_Occurred()) {
+                PyErr_SetString(PyExc_TypeError, "columns must be a sequence of str");
+            }
+            PyMem_Free(values);
+            Py_DECREF(seq);
+            return -1;
+        }
+    }
+    
+    *seq_out = seq;
+    *names = values;
+    *count = n;
+    return 0;
+}
+
+/* Load database from file - instance method */
+static PyObject* PyColumnDB_load(PyColumnDBObject* self, PyObject* args)
+{
+    const char* filename;
+    PyObject* columns = Py_None;
+    if (!PyArg_ParseTuple(args, "s|O", &filename, &columns)) {
+        return NULL;
+    }
+    
+    PyObject* seq;
+    const char** names;
+    Py_ssize_t count;
+    if (parse_column_names(columns, &seq, &names, &count) < 0) {
+        return NULL;
+    }
+    
+    int result;
+    lock_write(self);
+    Py_BEGIN_ALLOW_THREADS
+    result = names ? cdb_load_columns(self->db, filename, names, (size_t)count)
+                   : cdb_open(filename, self->db);
+    Py_END_ALLOW_THREADS
+    unlock_write(self);
+    PyMem_Free(names);
+    Py_XDECREF(seq);
+    
+    if (result != 0) {
+        PyErr_Format(PyExc_IOError, "Failed to load database: %s", cdb_get_error());
+        return NULL;
+    }
+    
+    Py_RETURN_NONE;
+}
+
+/* Open a database file by memory-mapping it */
+static PyObject* PyColumnDB_open_mmap(PyColumnDBObject* self, PyObject* args)
+{
+    const char* filename;
+    PyObject* columns = Py_None;
+    if (!PyArg_ParseTuple(args, "s|O", &filename, &columns)) {
+        return NULL;
+    }
+    
+    PyObject* seq;
+    const char** names;
+    Py_ssize_t count;
+    if (parse_column_names(columns, &seq, &names, &count) < 0) {
+        return NULL;
+    }
+    
+    int result;
+    lock_write(self);
+    Py_BEGIN_ALLOW_THREADS
+    result = names ? cdb_open_mmap_columns(self->db, filename, names, (size_t)count)
+                   : cdb_open_mmap(self->db, filename);
+    Py_END_ALLOW_THREADS
+    unlock_write(self);
+    PyMem_Free(names);
+    Py_XDECREF(seq);
+    
+    if (result != 0) {
+        PyErr_Format(PyExc_IOError, "Failed to map database: %s", cdb_get_error());
+        return NULL;
+    }
+    
+    Py_RETURN_NONE;
+}
+
+/* Methods table */
+#define FILTER_MAX_DEPTH 64
+
+/* A filter expression compiled to postfix terms. Column names and string
+ * values point into Python objects kept alive by refs. */
+typedef struct filter_program {
+    cdb_predicate_t* terms;
+    size_t count;
+    size_t capacity;
+    PyObject* refs;
+} filter_program_t;
+
+static int push_filter_term(filter_program_t* program, const cdb_predicate_t* term) {
+    if (program->count == program->capacity) {
+        size_t capacity = program->capacity ? program->capacity * 2 : 8;
+        cdb_predicate_t* terms = (cdb_predicate_t*)PyMem_Realloc(program->terms, capacity * sizeof(cdb_predicate_t));
+        if (!terms) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        program->terms = terms;
+        program->capacity = capacity;
+    }
+    program->terms[program->count++] = *term;
+    return 0;
+}
+
+/* Comparison operator of a filter term, -1 (with ValueError) for unknown ones */
+static int parse_filter_op(PyObject* op_obj) {
+    static const struct { const char* name; cdb_cmp_op_t op; } ops[] = {
+        {"==", CDB_CMP_EQ}, {"=", CDB_CMP_EQ}, {"!=", CDB_CMP_NE}, {"<", CDB_CMP_LT},
+        {"<=", CDB_CMP_LE}, {">", CDB_CMP_GT}, {">=", CDB_CMP_GE},
+        {"is null", CDB_CMP_IS_NULL}, {"is not null", CDB_CMP_IS_NOT_NULL},
+    };
+    const char* name = PyUnicode_Check(op_obj) ? PyUnicode_AsUTF8(op_obj) : NULL;
+    if (name) {
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+            if (strcmp(name, ops[i].name) == 0) return (int)ops[i].op;
+        }
+    }
+    if (!PyErr_Occurred()) {
+        PyErr_Format(PyExc_ValueError, "unknown filter operator %R", op_obj);
+    }
+    return -1;
+}
+
+/* Compile (column, op[, value]) or ("and"|"or", term, term, ...) */
+static int compile_filter(PyColumnDBObject* self, PyObject* where, int depth, filter_program_t* program) {
+    if (depth > FILTER_MAX_DEPTH) {
+        PyErr_SetString(PyExc_ValueError, "filter is nested too deeply");
+        return -1;
+    }
+    if (!PyTuple_Check(where) && !PyList_Check(where)) {
+        PyErr_SetString(PyExc_TypeError, "filter terms must be tuples");
+        return -1;
+    }
+    
+    /* The items are kept alive by refs, so Python code run while values are
+     * converted cannot free them */
+    PyObject* items = PySequence_Tuple(where);
+    if (!items || PyList_Append(program->refs, items) < 0) {
+        Py_XDECREF(items);
+        return -1;
+    }
+    Py_DECREF(items);
+    Py_ssize_t n = PyTuple_GET_SIZE(items);
+    if (n < 2) {
+        PyErr_SetString(PyExc_ValueError, "filter terms need a column and an operator");
+        return -1;
+    }
+    
+    PyObject* head = PyTuple_GET_ITEM(items, 0);
+    PyObject* second = PyTuple_GET_ITEM(items, 1);
+    if (PyUnicode_Check(head) && (PyTuple_Check(second) || PyList_Check(second))) {
+        const char* name = PyUnicode_AsUTF8(head);
+        if (!name) return -1;
+        cdb_predicate_t combine = {CDB_PRED_AND};
+        if (strcmp(name, "and") == 0) {
+            combine.kind = CDB_PRED_AND;
+        } else if (strcmp(name, "or") == 0) {
+            combine.kind = CDB_PRED_OR;
+        } else {
+            PyErr_Format(PyExc_ValueError, "unknown filter combinator '%s'", name);
+            return -1;
+        }
+        for (Py_ssize_t i = 1; i < n; i++) {
+            if (compile_filter(self, PyTuple_GET_ITEM(items, i), depth + 1, program) < 0) return -1;
+            if (i > 1 && push_filter_term(program, &combine) < 0) return -1;
+        }
+        return 0;
+    }
+    
+    cdb_predicate_t term = {CDB_PRED_COMPARE};
+    term.column = PyUnicode_Check(head) ? PyUnicode_AsUTF8(head) : NULL;
+    if (!term.column) {
+        if (!PyErr_Occurred()) PyErr_SetString(PyExc_TypeError, "filter column names must be str");
+        return -1;
+    }
+    int op = parse_filter_op(second);
+    if (op < 0) return -1;
+    term.op = (cdb_cmp_op_t)op;
+    
+    int takes_value = (term.op != CDB_CMP_IS_NULL && term.op != CDB_CMP_IS_NOT_NULL);
+    if (n != (takes_value ? 3 : 2)) {
+        PyErr_Format(PyExc_ValueError, "filter operator '%s' takes %s", PyUnicode_AsUTF8(second),
+                     takes_value ? "one value" : "no value");
+        return -1;
+    }
+    
+    /* Column types never change, so the type can be read now and used later */
+    lock_read(self);
+    int idx = cdb_get_column_index(self->db, term.column);
+    cdb_data_type_t type = idx >= 0 ? self->db->columns[idx].data_type : CDB_TYPE_INT32;
+    unlock_read(self);
+    if (idx < 0) {
+        PyErr_Format(PyExc_ValueError, "Column '%s' not found", term.column);
+        return -1;
+    }
+    
+    if (takes_value) {
+        PyObject* value = PyTuple_GET_ITEM(items, 2);
+        if (value == Py_None) {
+            PyErr_SetString(PyExc_ValueError, "compare with None using 'is null' or 'is not null'");
+            return -1;
+        }
+        if (convert_row_value(value, type, &term.value) < 0) return -1;
+    } else {
+        memset(&term.value, 0, sizeof(term.value));
+    }
+    return push_filter_term(program, &term);
+}
+
+/* Filter method: the selected rows of some columns, as a new database */
+static PyObject* PyColumnDB_filter(PyColumnDBObject* self, PyObject* args) {
+    PyObject* where;
+    PyObject* columns = Py_None;
+    if (!PyArg_ParseTuple(args, "O|O", &where, &columns)) {
+        return NULL;
+    }
+    
+    filter_program_t program = {NULL, 0, 0, PyList_New(0)};
+    PyObject* seq = NULL;
+    const char** names = NULL;
+    Py_ssize_t count = 0;
+    PyColumnDBObject* result = NULL;
+    if (!program.refs || compile_filter(self, where, 0, &program) < 0 ||
+        parse_column_names(columns, &seq, &names, &count) < 0) {
+        goto done;
+    }
+    
+    result = (PyColumnDBObject*)PyObject_CallObject((PyObject*)&PyColumnDBType, NULL);
+    if (!result) goto done;
+    
+    /* Bring indexes left behind by appends up to date first */
+    int status = 0;
+    lock_read(self);
+    int stale = cdb_has_stale_indexes(self->db);
+    unlock_read(self);
+    if (stale) {
+        lock_write(self);
+        Py_BEGIN_ALLOW_THREADS
+        status = cdb_refresh_indexes(self->db);
+        Py_END_ALLOW_THREADS
+        if (status < 0) {
+            PyErr_SetString(PyExc_ValueError, cdb_get_error());
+        }
+        unlock_write(self);
+        if (status < 0) {
+            Py_CLEAR(result);
+            goto done;
+        }
+    }
+    
+    lock_read(self);
+    Py_BEGIN_ALLOW_THREADS
+    cdb_selection_t selection;
+    status = cdb_where(self->db, program.terms, program.count, &selection);
+    if (status == 0) {
+        status = cdb_filter(self->db, &selection, names, (size_t)count, result->db);
+        cdb_selection_free(&selection);
+    }
+    Py_END_ALLOW_THREADS
+    if (status < 0) {
+        PyErr_SetString(PyExc_ValueError, cdb_get_error());
+        Py_CLEAR(result);
+    }
+    unlock_read(self);
+
+done:
+    PyMem_Free(names);
+    Py_XDECREF(seq);
+    PyMem_Free(program.terms);
+    Py_XDECREF(program.refs);
+    return (PyObject*)result;
+}
+
+/* Group rows by a key column; aggregates are (op, column or None, name or None) */
+static PyObject* PyColumnDB_group_by(PyColumnDBObject* self, PyObject* args) {
+    const char* key;
+    PyObject* aggregates;
+    if (!PyArg_ParseTuple(args, "sO", &key, &aggregates)) {
+        return NULL;
+    }
+    
+    PyObject* seq = PySequence_Fast(aggregates, "aggregates must be a sequence of tuples");
+    if (!seq) return NULL;
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    cdb_group_agg_t* aggs = (cdb_group_agg_t*)PyMem_Malloc((count > 0 ? count : 1) * sizeof(cdb_group_agg_t));
+    PyColumnDBObject* result = NULL;
+    if (!aggs) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        int op;
+        if (!PyTuple_Check(item)) {
+            PyErr_SetString(PyExc_TypeError, "aggregates must be a sequence of tuples");
+            goto done;
+        }
+        aggs[i].output = NULL;
+        if (!PyArg_ParseTuple(item, "iz|z", &op, &aggs[i].column, &aggs[i].output)) {
+            goto done;
+        }
+        aggs[i].op = (cdb_agg_op_t)op;
+    }
+    
+    result = (PyColumnDBObject*)PyObject_CallObject((PyObject*)&PyColumnDBType, NULL);
+    if (!result) goto done;
+    
+    int status;
+    lock_read(self);
+    Py_BEGIN_ALLOW_THREADS
+    status = cdb_group_by(self->db, key, aggs, (size_t)count, result->db);
+    Py_END_ALLOW_THREADS
+    if (status < 0) {
+        PyErr_SetString(PyExc_ValueError, cdb_get_error());
+        Py_CLEAR(result);
+    }
+    unlock_read(self);
+
+done:
+    PyMem_Free(aggs);
+    Py_DECREF(seq);
+    return (PyObject*)result;
+}
+
+/* Arrow exports count as exports of the database's memory and keep it
+ * alive until the consumer releases them, which may be on another thread */
+static void arrow_export_released(void* ctx) {
+    PyGILState_STATE state = PyGILState_Ensure();
+    PyColumnDBObject* self = (PyColumnDBObject*)ctx;
+    self->exports--;
+    Py_DECREF(self);
+    PyGILState_Release(state);
+}
+
+/* Capsule destructors release what no consumer took over */
+static void release_schema_capsule(PyObject* capsule) {
+    struct ArrowSchema* schema = (struct ArrowSchema*)PyCapsule_GetPointer(capsule, "arrow_schema");
+    if (schema->release) schema->release(schema);
+    PyMem_Free(schema);
+}
+
+static void release_array_capsule(PyObject* capsule) {
+    struct ArrowArray* array = (struct ArrowArray*)PyCapsule_GetPointer(capsule, "arrow_array");
+    if (array->release) array->release(array);
+    PyMem_Free(array);
+}
+
+static void release_stream_capsule(PyObject* capsule) {
+    struct ArrowArrayStream* stream = (struct ArrowArrayStream*)PyCapsule_GetPointer(capsule, "arrow_array_stream");
+    if (stream->release) stream->release(stream);
+    PyMem_Free(stream);
+}
+
+/* Capsule owning an empty Arrow struct, released by destructor unless a consumer moves it out */
+static PyObject* new_arrow_capsule(size_t size, const char* name, PyCapsule_Destructor destructor, void** out) {
+    void* ptr = PyMem_Malloc(size);
+    if (!ptr) return PyErr_NoMemory();
+    memset(ptr, 0, size);
+    PyObject* capsule = PyCapsule_New(ptr, name, destructor);
+    if (!capsule) {
+        PyMem_Free(ptr);
+        return NULL;
+    }
+    *out = ptr;
+    return capsule;
+}
+
+/* Arrow PyCapsule interface: the database as one struct array. Requested
+ * schemas are ignored, as the protocol allows. */
+static PyObject* PyColumnDB_arrow_c_array(PyColumnDBObject* self, PyObject* args) {
+    PyObject* requested_schema = Py_None;
+    if (!PyArg_ParseTuple(args, "|O", &requested_schema)) {
+        return NULL;
+    }
+    
+    void* schema = NULL;
+    void* array = NULL;
+    PyObject* schema_capsule = new_arrow_capsule(sizeof(struct ArrowSchema), "arrow_schema",
+                                                 release_schema_capsule, &schema);
+    if (!schema_capsule) return NULL;
+    PyObject* array_capsule = new_arrow_capsule(sizeof(struct ArrowArray), "arrow_array",
+                                                release_array_capsule, &array);
+    if (!array_capsule) {
+        Py_DECREF(schema_capsule);
+        return NULL;
+    }
+    
+    /* Undone by arrow_export_released, also when the export fails */
+    int status;
+    lock_read(self);
+    self->exports++;
+    Py_INCREF(self);
+    Py_BEGIN_ALLOW_THREADS
+    status = cdb_export_arrow_hooked(self->db, (struct ArrowSchema*)schema, (struct ArrowArray*)array,
+                                     arrow_export_released, self);
+    Py_END_ALLOW_THREADS
+    unlock_read(self);
+    if (status < 0) {
+        PyErr_Format(PyExc_ValueError, "Failed to export Arrow data: %s", cdb_get_error());
+        Py_DECREF(schema_capsule);
+        Py_DECREF(array_capsule);
+        return NULL;
+    }
+    return Py_BuildValue("(NN)", schema_capsule, array_capsule);
+}
+
+/* Arrow PyCapsule interface: a stream of that one struct array */
+static PyObject* PyColumnDB_arrow_c_stream(PyColumnDBObject* self, PyObject* args) {
+    PyObject* requested_schema = Py_None;
+    if (!PyArg_ParseTuple(args, "|O", &requested_schema)) {
+        return NULL;
+    }
+    
+    void* stream = NULL;
+    PyObject* capsule = new_arrow_capsule(sizeof(struct ArrowArrayStream), "arrow_array_stream",
+                                          release_stream_capsule, &stream);
+    if (!capsule) return NULL;
+    
+    int status;
+    lock_read(self);
+    self->exports++;
+    Py_INCREF(self);
+    Py_BEGIN_ALLOW_THREADS
+    status = cdb_export_arrow_stream_hooked(self->db, (struct ArrowArrayStream*)stream,
+                                            arrow_export_released, self);
+    Py_END_ALLOW_THREADS
+    unlock_read(self);
+    if (status < 0) {
+        PyErr_Format(PyExc_ValueError, "Failed to export Arrow data: %s", cdb_get_error());
+        Py_DECREF(capsule);
+        return NULL;
+    }
+    return capsule;
+}
+
+static PyMethodDef PyColumnDB_methods[] = {
+    {"add_column", (PyCFunction)PyColumnDB_add_column, METH_VARARGS, "Add a column to the database"},
+    {"insert_int32", (PyCFunction)PyColumnDB_insert_int32, METH_VARARGS, "Insert int32 value"},
+    {"insert_int64", (PyCFunction)PyColumnDB_insert_int64, METH_VARARGS, "Insert int64 value"},
+    {"insert_float32", (PyCFunction)PyColumnDB_insert_float32, METH_VARARGS, "Insert float32 value"},
+    {"insert_float64", (PyCFunction)PyColumnDB_insert_float64, METH_VARARGS, "Insert float64 value"},
+    {"insert_string", (PyCFunction)PyColumnDB_insert_string, METH_VARARGS, "Insert string value"},
+    {"insert_bool", (PyCFunction)PyColumnDB_insert_bool, METH_VARARGS, "Insert bool value"},
     {"insert_null", (PyCFunction)PyColumnDB_insert_null, METH_VARARGS, "Insert NULL value"},
+    {"append_array", (PyCFunction)PyColumnDB_append_array, METH_VARARGS, "Append a whole array of values to a column"},
+    {"filter", (PyCFunction)PyColumnDB_filter, METH_VARARGS, "Copy the rows matching a filter expression into a new database"},
+    {"group_by", (PyCFunction)PyColumnDB_group_by, METH_VARARGS, "Group rows by a key column and aggregate into a new database"},
+    {"insert_rows", (PyCFunction)PyColumnDB_insert_rows, METH_VARARGS, "Insert a batch of rows, one value per column in column order"},
     {"get_num_rows", (PyCFunction)PyColumnDB_get_num_rows, METH_NOARGS, "Get number of rows"},
     {"get_num_columns", (PyCFunction)PyColumnDB_get_num_columns, METH_NOARGS, "Get number of columns"},
     {"get_column_data", (PyCFunction)PyColumnDB_get_column_data, METH_VARARGS, "Get column data as list"},
     {"get_column_names", (PyCFunction)PyColumnDB_get_column_names, METH_NOARGS, "Get list of column names"},
-    {"save", (PyCFunction)PyColumnDB_save, METH_VARARGS, "Save database to file"},
+    {"aggregate", (PyCFunction)PyColumnDB_aggregate, METH_VARARGS, "Aggregate a column's non-NULL values"},
+    {"get_dictionary", (PyCFunction)PyColumnDB_get_dictionary, METH_VARARGS, "Get the distinct values of a dictionary-encoded column"},
+    {"get_column_buffer", (PyCFunction)PyColumnDB_get_column_buffer, METH_VARARGS, "Get a zero-copy memoryview of column data"},
+    {"get_null_bitmap", (PyCFunction)PyColumnDB_get_null_bitmap, METH_VARARGS, "Get a zero-copy memoryview of the null bitmap"},
+    {"get_null_count", (PyCFunction)PyColumnDB_get_null_count, METH_VARARGS, "Get the number of NULL values in a column"},
+    {"save", (PyCFunction)PyColumnDB_save, METH_VARARGS, "Save database to file, optionally with a compression codec and level, or append the new rows"},
+    {"set_row_group_size", (PyCFunction)PyColumnDB_set_row_group_size, METH_VARARGS, "Set rows per zone-mapped row group for saves"},
+    {"set_column_encoding", (PyCFunction)PyColumnDB_set_column_encoding, METH_VARARGS, "Enable or disable lightweight column encodings for saves"},
+    {"set_num_threads", (PyCFunction)PyColumnDB_set_num_threads, METH_VARARGS, "Set the thread count of saves and loads (0 = one per CPU)"},
+    {"set_growth_factor", (PyCFunction)PyColumnDB_set_growth_factor, METH_VARARGS, "Set the factor by which full columns grow"},
+    {"set_sorted", (PyCFunction)PyColumnDB_set_sorted, METH_VARARGS, "Declare a column sorted, or clear the flag"},
+    {"is_sorted", (PyCFunction)PyColumnDB_is_sorted, METH_VARARGS, "Whether a column is known to be sorted"},
+    {"range", (PyCFunction)PyColumnDB_range, METH_VARARGS, "Rows [start, end) of a sorted column within inclusive bounds"},
+    {"create_index", (PyCFunction)PyColumnDB_create_index, METH_VARARGS, "Build a hash or bitmap index on a column"},
+    {"drop_index", (PyCFunction)PyColumnDB_drop_index, METH_VARARGS, "Remove a column's index"},
+    {"get_index", (PyCFunction)PyColumnDB_get_index, METH_VARARGS, "Declared index kind of a column (0 = none)"},
+    {"reserve", (PyCFunction)PyColumnDB_reserve, METH_VARARGS, "Reserve capacity for a number of rows in one or all columns"},
     {"load", (PyCFunction)PyColumnDB_load, METH_VARARGS, "Load database from file"},
+    {"open_mmap", (PyCFunction)PyColumnDB_open_mmap, METH_VARARGS, "Memory-map a database file, loading columns lazily"},
+    {"__arrow_c_array__", (PyCFunction)PyColumnDB_arrow_c_array, METH_VARARGS, "Export as an Arrow struct array (schema and array capsules)"},
+    {"__arrow_c_stream__", (PyCFunction)PyColumnDB_arrow_c_stream, METH_VARARGS, "Export as an Arrow array stream capsule"},
     {NULL}
 };
 
@@ -339,8 +1793,517 @@ static PyTypeObject PyColumnDBType = {
     .tp_methods = PyColumnDB_methods,
 };
 
+/* Column buffer exporter type */
+static PyBufferProcs PyColumnBuffer_as_buffer = {
+    (getbufferproc)PyColumnBuffer_getbuffer,
+    (releasebufferproc)PyColumnBuffer_releasebuffer,
+};
+
+static PyTypeObject PyColumnBufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "columndb.ColumnBuffer",
+    .tp_doc = "Read-only view of a column's memory",
+    .tp_basicsize = sizeof(PyColumnBufferObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)PyColumnBuffer_dealloc,
+    .tp_as_buffer = &PyColumnBuffer_as_buffer,
+};
+
+/* Next batch of a streaming reader as a new database, or None at the end */
+static PyObject* PyReader_next_batch(PyReaderObject* self, PyObject* args) {
+    Py_ssize_t batch_rows;
+    if (!PyArg_ParseTuple(args, "n", &batch_rows)) {
+        return NULL;
+    }
+    if (batch_rows <= 0) {
+        PyErr_SetString(PyExc_ValueError, "batch_size must be positive");
+        return NULL;
+    }
+    if (!self->reader) {
+        PyErr_SetString(PyExc_ValueError, "Reader is closed");
+        return NULL;
+    }
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Reader is in use by another thread");
+        return NULL;
+    }
+    
+    /* The result is handed over, so Python code can keep every batch */
+    cdb_database_t* batch = NULL;
+    int status;
+    self->busy = 1;
+    Py_BEGIN_ALLOW_THREADS
+    status = cdb_reader_next_batch(self->reader, (size_t)batch_rows, &batch);
+    if (status > 0) batch = cdb_reader_take_batch(self->reader);
+    Py_END_ALLOW_THREADS
+    self->busy = 0;
+    if (status < 0 || (status > 0 && !batch)) {
+        PyErr_Format(PyExc_IOError, "Failed to read batch: %s", cdb_get_error());
+        return NULL;
+    }
+    if (status == 0) {
+        Py_RETURN_NONE;
+    }
+    
+    PyColumnDBObject* result = (PyColumnDBObject*)PyObject_CallObject((PyObject*)&PyColumnDBType, NULL);
+    if (!result) {
+        cdb_free_database(batch);
+        return NULL;
+    }
+    cdb_free_database(result->db);
+    result->db = batch;
+    return (PyObject*)result;
+}
+
+static PyObject* PyReader_close(PyReaderObject* self, PyObject* Py_UNUSED(args)) {
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Reader is in use by another thread");
+        return NULL;
+    }
+    if (self->reader) {
+        cdb_reader_t* reader = self->reader;
+        self->reader = NULL;
+        Py_BEGIN_ALLOW_THREADS
+        cdb_reader_close(reader);
+        Py_END_ALLOW_THREADS
+    }
+    Py_RETURN_NONE;
+}
+
+static void PyReader_dealloc(PyReaderObject* self) {
+    cdb_reader_close(self->reader);
+    PyObject_Del(self);
+}
+
+static PyMethodDef PyReader_methods[] = {
+    {"next_batch", (PyCFunction)PyReader_next_batch, METH_VARARGS, "Read the next batch of at most n rows, or None at the end"},
+    {"close", (PyCFunction)PyReader_close, METH_NOARGS, "Stop reading and release the file"},
+    {NULL}
+};
+
+static PyTypeObject PyReaderType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "columndb.Reader",
+    .tp_doc = "Streaming reader over a saved database file",
+    .tp_basicsize = sizeof(PyReaderObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)PyReader_dealloc,
+    .tp_methods = PyReader_methods,
+};
+
+/* Check that a writer can be used by this call and mark it in use */
+static int writer_enter(PyWriterObject* self) {
+    if (!self->writer) {
+        PyErr_SetString(PyExc_ValueError, "Writer is closed");
+        return -1;
+    }
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Writer is in use by another thread");
+        return -1;
+    }
+    self->busy = 1;
+    return 0;
+}
+
+/* Buffer a batch's rows, writing them out once enough are in */
+static PyObject* PyWriter_write(PyWriterObject* self, PyObject* args) {
+    PyColumnDBObject* batch;
+    if (!PyArg_ParseTuple(args, "O!", &PyColumnDBType, &batch)) {
+        return NULL;
+    }
+    if (writer_enter(self) < 0) {
+        return NULL;
+    }
+    
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = cdb_writer_write(self->writer, batch->db);
+    Py_END_ALLOW_THREADS
+    self->busy = 0;
+    if (status < 0) {
+        PyErr_Format(PyExc_IOError, "Failed to write batch: %s", cdb_get_error());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* PyWriter_flush(PyWriterObject* self, PyObject* Py_UNUSED(args)) {
+    if (writer_enter(self) < 0) {
+        return NULL;
+    }
+    
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = cdb_writer_flush(self->writer);
+    Py_END_ALLOW_THREADS
+    self->busy = 0;
+    if (status < 0) {
+        PyErr_Format(PyExc_IOError, "Failed to write batch: %s", cdb_get_error());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* PyWriter_rows_written(PyWriterObject* self, PyObject* Py_UNUSED(args)) {
+    return PyLong_FromUnsignedLongLong(cdb_writer_rows_written(self->writer));
+}
+
+/* Write the buffered rows and close the file; abort drops them instead */
+static PyObject* writer_finish(PyWriterObject* self, int abort) {
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Writer is in use by another thread");
+        return NULL;
+    }
+    if (!self->writer) {
+        Py_RETURN_NONE;
+    }
+    cdb_writer_t* writer = self->writer;
+    self->writer = NULL;
+    
+    int status = 0;
+    Py_BEGIN_ALLOW_THREADS
+    if (abort) {
+        cdb_writer_abort(writer);
+    } else {
+        status = cdb_writer_close(writer);
+    }
+    Py_END_ALLOW_THREADS
+    if (status < 0) {
+        PyErr_Format(PyExc_IOError, "Failed to close writer: %s", cdb_get_error());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* PyWriter_close(PyWriterObject* self, PyObject* Py_UNUSED(args)) {
+    return writer_finish(self, 0);
+}
+
+static PyObject* PyWriter_abort(PyWriterObject* self, PyObject* Py_UNUSED(args)) {
+    return writer_finish(self, 1);
+}
+
+/* A writer that is never closed keeps only the rows already written */
+static void PyWriter_dealloc(PyWriterObject* self) {
+    cdb_writer_abort(self->writer);
+    PyObject_Del(self);
+}
+
+static PyMethodDef PyWriter_methods[] = {
+    {"write", (PyCFunction)PyWriter_write, METH_VARARGS, "Buffer a batch's rows, writing them once enough are in"},
+    {"flush", (PyCFunction)PyWriter_flush, METH_NOARGS, "Write the buffered rows now"},
+    {"rows_written", (PyCFunction)PyWriter_rows_written, METH_NOARGS, "Rows written to the file so far"},
+    {"close", (PyCFunction)PyWriter_close, METH_NOARGS, "Write the buffered rows and close the file"},
+    {"abort", (PyCFunction)PyWriter_abort, METH_NOARGS, "Close the file without writing the buffered rows"},
+    {NULL}
+};
+
+static PyTypeObject PyWriterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "columndb.Writer",
+    .tp_doc = "Streaming writer of a database file",
+    .tp_basicsize = sizeof(PyWriterObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)PyWriter_dealloc,
+    .tp_methods = PyWriter_methods,
+};
+
+/* Range scan of a saved file using its zone maps.
+ * Returns (rows, groups_read, groups_total). Integer bounds compare exactly;
+ * if either bound is a float both are compared as doubles. */
+static PyObject* module_scan_between(PyObject* Py_UNUSED(module), PyObject* args)
+{
+    const char* filename;
+    const char* column_name;
+    PyObject* lo;
+    PyObject* hi;
+    if (!PyArg_ParseTuple(args, "ssOO", &filename, &column_name, &lo, &hi)) {
+        return NULL;
+    }
+    
+    cdb_scan_result_t result;
+    int status;
+    if (PyLong_Check(lo) && PyLong_Check(hi)) {
+        long long lo_i = PyLong_AsLongLong(lo);
+        long long hi_i = PyLong_AsLongLong(hi);
+        if (PyErr_Occurred()) {
+            return NULL;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        status = cdb_scan_between_int64(filename, column_name, lo_i, hi_i, &result);
+        Py_END_ALLOW_THREADS
+    } else {
+        double lo_f = PyFloat_AsDouble(lo);
+        double hi_f = PyFloat_AsDouble(hi);
+        if (PyErr_Occurred()) {
+            return NULL;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        status = cdb_scan_between_float64(filename, column_name, lo_f, hi_f, &result);
+        Py_END_ALLOW_THREADS
+    }
+    if (status < 0) {
+        PyErr_Format(PyExc_IOError, "Failed to scan database: %s", cdb_get_error());
+        return NULL;
+    }
+    
+    PyObject* rows = PyList_New((Py_ssize_t)result.num_rows);
+    if (!rows) {
+        cdb_free_scan_result(&result);
+        return NULL;
+    }
+    for (size_t i = 0; i < result.num_rows; i++) {
+        PyObject* row = PyLong_FromUnsignedLongLong(result.rows[i]);
+        if (!row) {
+            Py_DECREF(rows);
+            cdb_free_scan_result(&result);
+            return NULL;
+        }
+        PyList_SET_ITEM(rows, i, row);
+    }
+    
+    PyObject* ret = Py_BuildValue("(Nnn)", rows, (Py_ssize_t)result.groups_read,
+                                  (Py_ssize_t)result.groups_total);
+    cdb_free_scan_result(&result);
+    return ret;
+}
+
+/* Rewrite a file with appended segments as a single segment */
+static PyObject* module_compact(PyObject* Py_UNUSED(module), PyObject* args)
+{
+    const char* filename;
+    int codec = CDB_COMPRESSION_NONE;
+    int level = 0;
+    if (!PyArg_ParseTuple(args, "s|ii", &filename, &codec, &level)) {
+        return NULL;
+    }
+    
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = cdb_compact(filename, (cdb_compression_t)codec, level);
+    Py_END_ALLOW_THREADS
+    if (status < 0) {
+        PyErr_Format(PyExc_IOError, "Failed to compact database: %s", cdb_get_error());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+/* Open a saved file for streaming reads of some columns (all by default) */
+static PyObject* module_open_reader(PyObject* Py_UNUSED(module), PyObject* args)
+{
+    const char* filename;
+    PyObject* columns = Py_None;
+    if (!PyArg_ParseTuple(args, "s|O", &filename, &columns)) {
+        return NULL;
+    }
+    
+    PyObject* seq;
+    const char** names;
+    Py_ssize_t count;
+    if (parse_column_names(columns, &seq, &names, &count) < 0) {
+        return NULL;
+    }
+    
+    cdb_reader_t* reader;
+    Py_BEGIN_ALLOW_THREADS
+    reader = cdb_reader_open(filename, names, (size_t)count);
+    Py_END_ALLOW_THREADS
+    PyMem_Free(names);
+    Py_XDECREF(seq);
+    if (!reader) {
+        PyErr_Format(PyExc_IOError, "Failed to open reader: %s", cdb_get_error());
+        return NULL;
+    }
+    
+    PyReaderObject* self = PyObject_New(PyReaderObject, &PyReaderType);
+    if (!self) {
+        cdb_reader_close(reader);
+        return NULL;
+    }
+    self->reader = reader;
+    self->busy = 0;
+    return (PyObject*)self;
+}
+
+/* Start a file with a schema database's columns and save settings */
+static PyObject* module_open_writer(PyObject* Py_UNUSED(module), PyObject* args)
+{
+    const char* filename;
+    PyColumnDBObject* schema;
+    Py_ssize_t flush_rows = 0;
+    int codec = CDB_COMPRESSION_NONE;
+    int level = 0;
+    if (!PyArg_ParseTuple(args, "sO!|nii", &filename, &PyColumnDBType, &schema, &flush_rows, &codec, &level)) {
+        return NULL;
+    }
+    if (flush_rows < 0) {
+        PyErr_SetString(PyExc_ValueError, "flush_rows must be positive");
+        return NULL;
+    }
+    if (cdb_check_compression((cdb_compression_t)codec, level) < 0) {
+        PyErr_SetString(PyExc_ValueError, cdb_get_error());
+        return NULL;
+    }
+    
+    cdb_writer_t* writer;
+    Py_BEGIN_ALLOW_THREADS
+    writer = cdb_writer_open_with_codec(filename, schema->db, (size_t)flush_rows, (cdb_compression_t)codec, level);
+    Py_END_ALLOW_THREADS
+    if (!writer) {
+        PyErr_Format(PyExc_IOError, "Failed to open writer: %s", cdb_get_error());
+        return NULL;
+    }
+    
+    PyWriterObject* self = PyObject_New(PyWriterObject, &PyWriterType);
+    if (!self) {
+        cdb_writer_abort(writer);
+        return NULL;
+    }
+    self->writer = writer;
+    self->busy = 0;
+    return (PyObject*)self;
+}
+
+/* New database object taking over db */
+static PyObject* wrap_database(cdb_database_t* db) {
+    PyColumnDBObject* result = (PyColumnDBObject*)PyObject_CallObject((PyObject*)&PyColumnDBType, NULL);
+    if (!result) {
+        cdb_free_database(db);
+        return NULL;
+    }
+    cdb_free_database(result->db);
+    result->db = db;
+    return (PyObject*)result;
+}
+
+/* Import an Arrow struct array from its schema and array capsules */
+static PyObject* module_import_arrow(PyObject* Py_UNUSED(module), PyObject* args)
+{
+    PyObject* schema_capsule;
+    PyObject* array_capsule;
+    if (!PyArg_ParseTuple(args, "OO", &schema_capsule, &array_capsule)) {
+        return NULL;
+    }
+    
+    struct ArrowSchema* schema = (struct ArrowSchema*)PyCapsule_GetPointer(schema_capsule, "arrow_schema");
+    if (!schema) return NULL;
+    struct ArrowArray* array = (struct ArrowArray*)PyCapsule_GetPointer(array_capsule, "arrow_array");
+    if (!array) return NULL;
+    if (!schema->release || !array->release) {
+        PyErr_SetString(PyExc_ValueError, "Arrow capsule was already consumed");
+        return NULL;
+    }
+    
+    /* Move the structs out of the capsules, which then release nothing */
+    struct ArrowSchema schema_moved = *schema;
+    struct ArrowArray array_moved = *array;
+    schema->release = NULL;
+    array->release = NULL;
+    
+    cdb_database_t* db;
+    Py_BEGIN_ALLOW_THREADS
+    db = cdb_import_arrow(&schema_moved, &array_moved);
+    Py_END_ALLOW_THREADS
+    if (!db) {
+        PyErr_Format(PyExc_ValueError, "Failed to import Arrow data: %s", cdb_get_error());
+        return NULL;
+    }
+    return wrap_database(db);
+}
+
+/* Import every array of an Arrow array stream capsule */
+static PyObject* module_import_arrow_stream(PyObject* Py_UNUSED(module), PyObject* args)
+{
+    PyObject* capsule;
+    if (!PyArg_ParseTuple(args, "O", &capsule)) {
+        return NULL;
+    }
+    
+    struct ArrowArrayStream* stream = (struct ArrowArrayStream*)PyCapsule_GetPointer(capsule, "arrow_array_stream");
+    if (!stream) return NULL;
+    if (!stream->release) {
+        PyErr_SetString(PyExc_ValueError, "Arrow capsule was already consumed");
+        return NULL;
+    }
+    struct ArrowArrayStream stream_moved = *stream;
+    stream->release = NULL;
+    
+    cdb_database_t* db;
+    Py_BEGIN_ALLOW_THREADS
+    db = cdb_import_arrow_stream(&stream_moved);
+    Py_END_ALLOW_THREADS
+    if (!db) {
+        PyErr_Format(PyExc_ValueError, "Failed to import Arrow data: %s", cdb_get_error());
+        return NULL;
+    }
+    return wrap_database(db);
+}
+
+/* Whether a compression codec was built in */
+static PyObject* module_compression_available(PyObject* self, PyObject* args) {
+    int codec;
+    if (!PyArg_ParseTuple(args, "i", &codec)) {
+        return NULL;
+    }
+    return PyBool_FromLong(cdb_compression_available((cdb_compression_t)codec));
+}
+
+/* Snapshot of the C core's statistics counters */
+static PyObject* module_get_stats(PyObject* Py_UNUSED(module), PyObject* Py_UNUSED(args)) {
+    cdb_stats_t stats;
+    cdb_get_stats(&stats);
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K}",
+                         "bytes_read", (unsigned long long)stats.bytes_read,
+                         "bytes_written", (unsigned long long)stats.bytes_written,
+                         "allocations", (unsigned long long)stats.allocations,
+                         "reallocs", (unsigned long long)stats.reallocs,
+                         "realloc_bytes", (unsigned long long)stats.realloc_bytes,
+                         "rows_scanned", (unsigned long long)stats.rows_scanned,
+                         "saves", (unsigned long long)stats.saves,
+                         "save_ns", (unsigned long long)stats.save_ns,
+                         "loads", (unsigned long long)stats.loads,
+                         "load_ns", (unsigned long long)stats.load_ns,
+                         "read_ns", (unsigned long long)stats.read_ns,
+                         "write_ns", (unsigned long long)stats.write_ns,
+                         "sync_ns", (unsigned long long)stats.sync_ns,
+                         "encode_ns", (unsigned long long)stats.encode_ns,
+                         "decode_ns", (unsigned long long)stats.decode_ns);
+}
+
+/* Turn statistics counting on or off for the whole process */
+static PyObject* module_set_stats_enabled(PyObject* Py_UNUSED(module), PyObject* args) {
+    int enabled;
+    if (!PyArg_ParseTuple(args, "p", &enabled)) {
+        return NULL;
+    }
+    if (cdb_set_stats_enabled(enabled) < 0) {
+        PyErr_Format(PyExc_RuntimeError, "Failed to enable statistics: %s", cdb_get_error());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* module_reset_stats(PyObject* Py_UNUSED(module), PyObject* Py_UNUSED(args)) {
+    cdb_reset_stats();
+    Py_RETURN_NONE;
+}
+
 /* Module methods */
 static PyMethodDef module_methods[] = {
+    {"scan_between", (PyCFunction)module_scan_between, METH_VARARGS, "Scan a saved column for values in [lo, hi] using zone maps"},
+    {"compact", (PyCFunction)module_compact, METH_VARARGS, "Rewrite a file's appended segments as one"},
+    {"open_reader", (PyCFunction)module_open_reader, METH_VARARGS, "Open a saved file for streaming reads in batches"},
+    {"open_writer", (PyCFunction)module_open_writer, METH_VARARGS, "Start a file written in batches"},
+    {"import_arrow", (PyCFunction)module_import_arrow, METH_VARARGS, "Import an Arrow struct array from schema and array capsules"},
+    {"import_arrow_stream", (PyCFunction)module_import_arrow_stream, METH_VARARGS, "Import every array of an Arrow array stream capsule"},
+    {"compression_available", (PyCFunction)module_compression_available, METH_VARARGS, "Whether a compression codec was built in"},
+    {"get_stats", (PyCFunction)module_get_stats, METH_NOARGS, "Snapshot of the statistics counters"},
+    {"set_stats_enabled", (PyCFunction)module_set_stats_enabled, METH_VARARGS, "Turn statistics counting on or off"},
+    {"reset_stats", (PyCFunction)module_reset_stats, METH_NOARGS, "Zero the statistics counters"},
     {NULL}
 };
 
@@ -362,6 +2325,15 @@ PyMODINIT_FUNC PyInit_columndb(void) {
     if (PyType_Ready(&PyColumnDBType) < 0)
         return NULL;
     
+    if (PyType_Ready(&PyColumnBufferType) < 0)
+        return NULL;
+    
+    if (PyType_Ready(&PyReaderType) < 0)
+        return NULL;
+    
+    if (PyType_Ready(&PyWriterType) < 0)
+        return NULL;
+    
     Py_INCREF(&PyColumnDBType);
     if (PyModule_AddObject(m, "ColumnDB", (PyObject*)&PyColumnDBType) < 0) {
         Py_DECREF(&PyColumnDBType);
@@ -376,6 +2348,27 @@ PyMODINIT_FUNC PyInit_columndb(void) {
     PyModule_AddIntConstant(m, "TYPE_FLOAT64", CDB_TYPE_FLOAT64);
     PyModule_AddIntConstant(m, "TYPE_STRING", CDB_TYPE_STRING);
     PyModule_AddIntConstant(m, "TYPE_BOOL", CDB_TYPE_BOOL);
+    PyModule_AddIntConstant(m, "TYPE_DICT_STRING", CDB_TYPE_DICT_STRING);
+    
+    /* Add aggregate operation constants */
+    PyModule_AddIntConstant(m, "AGG_SUM", CDB_AGG_SUM);
+    PyModule_AddIntConstant(m, "AGG_MIN", CDB_AGG_MIN);
+    PyModule_AddIntConstant(m, "AGG_MAX", CDB_AGG_MAX);
+    PyModule_AddIntConstant(m, "AGG_COUNT", CDB_AGG_COUNT);
+    PyModule_AddIntConstant(m, "AGG_MEAN", CDB_AGG_MEAN);
+    PyModule_AddIntConstant(m, "DEFAULT_ROW_GROUP_ROWS", CDB_DEFAULT_ROW_GROUP_ROWS);
+    
+    /* Add compression codec constants */
+    PyModule_AddIntConstant(m, "COMPRESSION_NONE", CDB_COMPRESSION_NONE);
+    PyModule_AddIntConstant(m, "COMPRESSION_ZLIB", CDB_COMPRESSION_ZLIB);
+    PyModule_AddIntConstant(m, "COMPRESSION_ZSTD", CDB_COMPRESSION_ZSTD);
+    PyModule_AddIntConstant(m, "COMPRESSION_LZ4", CDB_COMPRESSION_LZ4);
+    
+    /* Add index kind constants */
+    PyModule_AddIntConstant(m, "INDEX_NONE", CDB_INDEX_NONE);
+    PyModule_AddIntConstant(m, "INDEX_HASH", CDB_INDEX_HASH);
+    PyModule_AddIntConstant(m, "INDEX_BITMAP", CDB_INDEX_BITMAP);
+    PyModule_AddIntConstant(m, "INDEX_AUTO", CDB_INDEX_AUTO);
     
     return m;
 }
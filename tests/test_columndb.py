@@ -2,8 +2,14 @@
 Unit tests for ColumnDB
 """
 
+import array
+import collections
+import os
+import random
+import tempfile
+import threading
 import unittest
-from columndb import ColumnDB, DataType
+from columndb import BatchWriter, ColumnDB, DataType
 
 
 class TestColumnDB(unittest.TestCase):
@@ -141,6 +147,19 @@ class TestColumnDB(unittest.TestCase):
         self.assertAlmostEqual(scores[0], 95.5, places=1)
         self.assertAlmostEqual(scores[1], 87.3, places=1)
     
+    def test_wide_table(self):
+        """Test name lookup across many columns"""
+        for i in range(300):
+            self.db.add_column(f"col{i}", DataType.INT32)
+        for i in range(300):
+            self.db.insert(f"col{i}", i)
+        
+        self.assertEqual(self.db.get_num_columns(), 300)
+        self.assertEqual(self.db.get_column_data("col0"), [0])
+        self.assertEqual(self.db.get_column_data("col299"), [299])
+        with self.assertRaises(RuntimeError):
+            self.db._db.add_column("col150", DataType.INT32)
+    
     def test_get_schema(self):
         """Test getting the database schema"""
         self.db.add_column("id", DataType.INT64)
@@ -186,6 +205,1807 @@ class TestColumnDB(unittest.TestCase):
         self.assertIn("columns=1", repr_str)
 
 
+class TestBulkAppend(unittest.TestCase):
+    """Test bulk columnar append"""
+    
+    def setUp(self):
+        self.db = ColumnDB()
+    
+    def test_append_int64_array(self):
+        """Test appending an array.array of int64 values"""
+        self.db.add_column("id", DataType.INT64)
+        self.db.append_array("id", array.array("q", range(1000)))
+        
+        self.assertEqual(self.db.get_num_rows(), 1000)
+        self.assertEqual(self.db.get_column_data("id"), list(range(1000)))
+    
+    def test_append_after_insert(self):
+        """Test mixing per-row inserts with bulk appends"""
+        self.db.add_column("value", DataType.FLOAT64)
+        self.db.insert("value", 1.5)
+        self.db.append_array("value", memoryview(array.array("d", [2.5, 3.5])))
+        
+        self.assertEqual(self.db.get_column_data("value"), [1.5, 2.5, 3.5])
+    
+    def test_append_with_null_bitmap(self):
+        """Test null bitmap handling on unaligned appends"""
+        self.db.add_column("value", DataType.INT32)
+        self.db.insert("value", 7)
+        # Rows 1 and 9 of the batch are NULL
+        self.db.append_array("value", array.array("i", range(10)), bytes([0x02, 0x02]))
+        
+        data = self.db.get_column_data("value")
+        self.assertEqual(len(data), 11)
+        self.assertEqual(data[0], 7)
+        self.assertIsNone(data[2])
+        self.assertIsNone(data[10])
+        self.assertEqual(data[3], 2)
+    
+    def test_append_bool_array(self):
+        """Test that bool appends normalize to True/False"""
+        self.db.add_column("flag", DataType.BOOL)
+        self.db.append_array("flag", bytes([0, 1, 5]))
+        
+        self.assertEqual(self.db.get_column_data("flag"), [False, True, True])
+    
+    def test_append_string_sequence(self):
+        """Test appending strings and None to a string column"""
+        self.db.add_column("name", DataType.STRING)
+        self.db.append_array("name", ["a", None, "c"])
+        
+        self.assertEqual(self.db.get_column_data("name"), ["a", None, "c"])
+        
+        # Embedded NUL would cut the string short in C: refused like insert()
+        with self.assertRaises(ValueError):
+            self.db.append_array("name", ["d", "q\x00r"])
+        self.assertEqual(self.db.get_column_data("name"), ["a", None, "c"])
+    
+    def test_append_type_mismatch(self):
+        """Test that a buffer of the wrong item type is rejected"""
+        self.db.add_column("id", DataType.INT64)
+        
+        with self.assertRaises(TypeError):
+            self.db.append_array("id", array.array("d", [1.0]))
+        with self.assertRaises(TypeError):
+            self.db.append_array("id", array.array("i", [1]))
+    
+    def test_append_nonexistent_column(self):
+        """Test appending to a missing column raises error"""
+        with self.assertRaises(ValueError):
+            self.db.append_array("missing", array.array("q", [1]))
+
+
+class TestRowInsert(unittest.TestCase):
+    """Test row-wise batch insertion"""
+    
+    def setUp(self):
+        self.db = ColumnDB()
+        self.db.add_column("id", DataType.INT32)
+        self.db.add_column("name", DataType.STRING)
+        self.db.add_column("score", DataType.FLOAT64)
+        self.db.add_column("active", DataType.BOOL)
+        self.db.add_column("city", DataType.DICT_STRING)
+    
+    def test_insert_rows_all_types(self):
+        """Test that every column type round-trips, with NULLs"""
+        self.db.insert_rows([
+            (1, "alice", 1.5, True, "paris"),
+            (2, None, None, False, "rome"),
+            (3, "carol", 3.5, None, "paris"),
+            [4, "dave", 4, 1, None],
+        ])
+        
+        self.assertEqual(self.db.get_num_rows(), 4)
+        self.assertEqual(self.db.get_column_data("id"), [1, 2, 3, 4])
+        self.assertEqual(self.db.get_column_data("name"), ["alice", None, "carol", "dave"])
+        self.assertEqual(self.db.get_column_data("score"), [1.5, None, 3.5, 4.0])
+        self.assertEqual(self.db.get_column_data("active"), [True, False, None, True])
+        self.assertEqual(self.db.get_column_data("city"), ["paris", "rome", "paris", None])
+        self.assertEqual(self.db.get_dictionary("city"), ["paris", "rome"])
+        self.assertEqual(self.db.get_null_count("name"), 1)
+    
+    def test_insert_rows_after_insert(self):
+        """Test mixing per-value inserts with row batches"""
+        for name, value in zip(("id", "name", "score", "active", "city"), (0, "zero", 0.0, False, "oslo")):
+            self.db.insert(name, value)
+        self.db.insert_rows([(i, str(i), float(i), i % 2 == 0, "oslo") for i in range(1, 1000)])
+        
+        self.assertEqual(self.db.get_column_data("id"), list(range(1000)))
+        self.assertEqual(self.db.get_column_data("name")[999], "999")
+        self.assertEqual(self.db.get_dictionary("city"), ["oslo"])
+    
+    def test_bad_rows_insert_nothing(self):
+        """Test that a bad row rejects the whole batch"""
+        self.db.insert_rows([(1, "a", 1.0, True, "x")])
+        
+        with self.assertRaises(ValueError):
+            self.db.insert_rows([(2, "b", 2.0, True, "y"), (3, "c")])
+        with self.assertRaises(TypeError):
+            self.db.insert_rows([(2, "b", 2.0, True, "y"), (3, 4, 3.0, True, "z")])
+        with self.assertRaises(OverflowError):
+            self.db.insert_rows([(2 ** 40, "b", 2.0, True, "y")])
+        with self.assertRaises(ValueError):
+            self.db.insert_rows([(2, "a\x00b", 2.0, True, "y")])
+        with self.assertRaises(ValueError):
+            self.db.insert_rows([(2, "b", 2.0, True, "y\x00z")])
+        
+        self.assertEqual(self.db.get_num_rows(), 1)
+        self.assertEqual(self.db.get_column_data("name"), ["a"])
+        self.assertEqual(self.db.get_dictionary("city"), ["x"])
+    
+    def test_uneven_columns_rejected(self):
+        """Test that rows cannot be appended once columns differ in length"""
+        self.db.insert("id", 1)
+        with self.assertRaises(RuntimeError):
+            self.db.insert_rows([(2, "b", 2.0, True, "y")])
+        self.assertEqual(self.db.get_column_data("name"), [])
+
+
+class TestCapacity(unittest.TestCase):
+    """Test capacity reservation and the growth factor"""
+    
+    def setUp(self):
+        self.db = ColumnDB()
+        self.db.add_column("id", DataType.INT64)
+        self.db.add_column("name", DataType.STRING)
+    
+    def test_reserve_keeps_data(self):
+        """Test that reserving more room leaves existing rows intact"""
+        self.db.insert_rows([(1, "a"), (2, None)])
+        self.db.reserve(2_000_000)
+        self.db.reserve(10, "id")
+        
+        self.assertEqual(self.db.get_column_data("id"), [1, 2])
+        self.assertEqual(self.db.get_column_data("name"), ["a", None])
+        self.db.append_array("id", array.array("q", range(1_500_000)))
+        self.assertEqual(self.db.get_column_data("id")[-1], 1_499_999)
+    
+    def test_growth_factor(self):
+        """Test ingest with a non-default growth factor"""
+        self.db.set_growth_factor(1.25)
+        for i in range(1000):
+            self.db.insert("id", i)
+        self.assertEqual(self.db.get_column_data("id"), list(range(1000)))
+        
+        for factor in (1.0, 0.5, 9.0, float("nan")):
+            with self.assertRaises(ValueError):
+                self.db.set_growth_factor(factor)
+    
+    def test_invalid_reserve(self):
+        """Test errors of reserve()"""
+        with self.assertRaises(ValueError):
+            self.db.reserve(10, "missing")
+        with self.assertRaises(ValueError):
+            self.db.reserve(-1)
+        
+        view = self.db.get_column_buffer("id")
+        with self.assertRaises(BufferError):
+            self.db.reserve(1000)
+        view.release()
+        self.db.reserve(1000)
+        
+        # Sizes that overflow size_t are refused, not wrapped
+        self.db.insert_rows([(i, "x") for i in range(100)])
+        for rows in (2 ** 61 + 16, 2 ** 63 - 1):
+            with self.assertRaises(MemoryError):
+                self.db.reserve(rows)
+            with self.assertRaises(MemoryError):
+                self.db.reserve(rows, "name")
+        self.assertEqual(self.db.get_column_data("id"), list(range(100)))
+
+
+class TestBufferExport(unittest.TestCase):
+    """Test zero-copy buffer export of columns"""
+    
+    def setUp(self):
+        self.db = ColumnDB()
+    
+    def test_column_buffer_values(self):
+        """Test that the buffer exposes column values with a typed format"""
+        self.db.add_column("id", DataType.INT64)
+        self.db.append_array("id", array.array("q", [1, 2, 3]))
+        
+        view = self.db.get_column_buffer("id")
+        self.assertEqual(view.format, "q")
+        self.assertTrue(view.readonly)
+        self.assertEqual(view.tolist(), [1, 2, 3])
+    
+    def test_float_and_bool_buffers(self):
+        """Test float64 and bool buffer formats"""
+        self.db.add_column("score", DataType.FLOAT64)
+        self.db.add_column("flag", DataType.BOOL)
+        self.db.insert("score", 1.5)
+        self.db.insert("flag", True)
+        
+        self.assertEqual(self.db.get_column_buffer("score").tolist(), [1.5])
+        self.assertEqual(self.db.get_column_buffer("flag").tolist(), [True])
+    
+    def test_null_bitmap_buffer(self):
+        """Test that the null bitmap view reflects NULL rows"""
+        self.db.add_column("value", DataType.INT32)
+        self.db.insert("value", 1)
+        self.db.insert("value", None)
+        
+        bitmap = self.db.get_null_bitmap("value")
+        self.assertEqual(bitmap.tobytes(), bytes([0x02]))
+    
+    def test_insert_blocked_while_exported(self):
+        """Test that inserts are refused while a view is alive"""
+        self.db.add_column("id", DataType.INT64)
+        self.db.insert("id", 1)
+        
+        view = self.db.get_column_buffer("id")
+        with self.assertRaises(BufferError):
+            self.db.insert("id", 2)
+        
+        view.release()
+        self.db.insert("id", 2)
+        self.assertEqual(self.db.get_num_rows(), 2)
+    
+    def test_string_column_not_exportable(self):
+        """Test that string columns cannot be exported as buffers"""
+        self.db.add_column("name", DataType.STRING)
+        
+        with self.assertRaises(TypeError):
+            self.db.get_column_buffer("name")
+
+
+class TestFilePersistence(unittest.TestCase):
+    """Test saving and loading .cdb files"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "test.cdb")
+        
+        self.db = ColumnDB()
+        self.db.add_column("id", DataType.INT64)
+        self.db.add_column("name", DataType.STRING)
+        self.db.add_column("score", DataType.FLOAT64)
+        self.db.add_column("flag", DataType.BOOL)
+        for i in range(100):
+            self.db.insert("id", i)
+            self.db.insert("name", None if i % 7 == 0 else f"name{i}")
+            self.db.insert("score", i * 0.5)
+            self.db.insert("flag", i % 2 == 0)
+        self.db.save(self.path)
+    
+    def tearDown(self):
+        self.tmpdir.cleanup()
+    
+    def assertRoundTrip(self, loaded):
+        self.assertEqual(loaded.get_num_rows(), 100)
+        self.assertEqual(loaded.get_column_data("id"), list(range(100)))
+        self.assertEqual(loaded.get_column_data("score"), [i * 0.5 for i in range(100)])
+        self.assertEqual(loaded.get_column_data("flag"), [i % 2 == 0 for i in range(100)])
+        names = loaded.get_column_data("name")
+        self.assertIsNone(names[0])
+        self.assertEqual(names[1], "name1")
+        self.assertEqual(names[99], "name99")
+    
+    def test_save_load_roundtrip(self):
+        """Test that all types survive a save/load cycle"""
+        self.assertRoundTrip(ColumnDB.load(self.path))
+    
+    def test_mmap_roundtrip(self):
+        """Test that a memory-mapped open sees the same data"""
+        self.assertRoundTrip(ColumnDB.load(self.path, mmap=True))
+    
+    def test_mmap_append_copies_to_heap(self):
+        """Test that appending to a mapped column leaves the file untouched"""
+        loaded = ColumnDB.load(self.path, mmap=True)
+        loaded.append_array("id", array.array("q", [100, 101]))
+        
+        self.assertEqual(loaded.get_column_data("id")[-3:], [99, 100, 101])
+        self.assertEqual(ColumnDB.load(self.path).get_column_data("id"), list(range(100)))
+    
+    def test_mmap_string_append(self):
+        """Test that appending to a mapped string column copies it first"""
+        loaded = ColumnDB.load(self.path, mmap=True)
+        loaded.append_array("name", ["", "caf\u00e9", None])
+        
+        self.assertEqual(loaded.get_column_data("name")[-4:], ["name99", "", "caf\u00e9", None])
+        self.assertRoundTrip(ColumnDB.load(self.path, mmap=True))
+    
+    def test_mmap_save_over_source(self):
+        """Test saving a mapped database back over its own file"""
+        loaded = ColumnDB.load(self.path, mmap=True)
+        loaded.save(self.path)
+        
+        self.assertRoundTrip(ColumnDB.load(self.path))
+    
+    def test_load_selected_columns(self):
+        """Test projection pushdown loads only the requested columns"""
+        for mmap in (False, True):
+            loaded = ColumnDB.load(self.path, mmap=mmap, columns=["score", "id"])
+            self.assertEqual(loaded.get_num_columns(), 2)
+            self.assertEqual(loaded._db.get_column_names(), ["score", "id"])
+            self.assertEqual(loaded.get_column_data("id"), list(range(100)))
+            with self.assertRaises(ValueError):
+                loaded.get_column_data("name")
+    
+    def test_load_missing_column(self):
+        """Test that requesting an unknown column loads nothing"""
+        with self.assertRaises(IOError):
+            ColumnDB.load(self.path, columns=["id", "missing"])
+    
+    def test_load_invalid_file(self):
+        """Test that a non-CDB file is rejected"""
+        bad_path = os.path.join(self.tmpdir.name, "bad.cdb")
+        with open(bad_path, "wb") as f:
+            f.write(b"not a cdb file at all")
+        
+        with self.assertRaises(IOError):
+            ColumnDB.load(bad_path)
+        with self.assertRaises(IOError):
+            ColumnDB.load(bad_path, mmap=True)
+
+
+class TestDictString(unittest.TestCase):
+    """Test dictionary-encoded string columns"""
+    
+    def setUp(self):
+        self.db = ColumnDB()
+        self.db.add_column("country", DataType.DICT_STRING)
+        for value in ["US", "DE", None, "US", "FR", "DE", ""]:
+            self.db.insert("country", value)
+    
+    def test_values_and_dictionary(self):
+        """Test that values decode and repeats share one dictionary entry"""
+        self.assertEqual(self.db.get_column_data("country"), ["US", "DE", None, "US", "FR", "DE", ""])
+        self.assertEqual(self.db.get_dictionary("country"), ["US", "DE", "FR", ""])
+        self.assertEqual(self.db.get_schema(), {"country": "dict_string"})
+    
+    def test_codes_buffer(self):
+        """Test that an equality filter can run on the exported codes"""
+        codes = self.db.get_column_buffer("country")
+        self.assertEqual(codes.format, "I")
+        nulls = self.db.get_null_bitmap("country")[0]
+        us = self.db.get_dictionary("country").index("US")
+        matches = [i for i, c in enumerate(codes.tolist()) if c == us and not (nulls >> i) & 1]
+        self.assertEqual(matches, [0, 3])
+    
+    def test_append_array(self):
+        """Test bulk appends through the string sequence path"""
+        self.db.append_array("country", ["FR", None, "JP"])
+        self.assertEqual(self.db.get_column_data("country")[-3:], ["FR", None, "JP"])
+        self.assertEqual(self.db.get_dictionary("country"), ["US", "DE", "FR", "", "JP"])
+    
+    def test_not_dictionary_column(self):
+        """Test that get_dictionary rejects plain string columns"""
+        self.db.add_column("name", DataType.STRING)
+        with self.assertRaises(TypeError):
+            self.db.get_dictionary("name")
+    
+    def test_save_load_roundtrip(self):
+        """Test that codes and dictionary survive save/load and mmap"""
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "dict.cdb")
+            self.db.save(path)
+            for mmap in (False, True):
+                loaded = ColumnDB.load(path, mmap=mmap)
+                self.assertEqual(loaded.get_column_data("country"), ["US", "DE", None, "US", "FR", "DE", ""])
+                self.assertEqual(loaded.get_dictionary("country"), ["US", "DE", "FR", ""])
+                
+                loaded.append_array("country", ["DE", "IT"])
+                self.assertEqual(loaded.get_column_data("country")[-2:], ["DE", "IT"])
+                self.assertEqual(len(loaded.get_dictionary("country")), 5)
+    
+    def test_many_distinct_values(self):
+        """Test dictionary and hash growth past their initial sizes"""
+        db = ColumnDB()
+        db.add_column("event", DataType.DICT_STRING)
+        db.append_array("event", [f"e{i % 500}" for i in range(2000)])
+        
+        self.assertEqual(len(db.get_dictionary("event")), 500)
+        self.assertEqual(db.get_column_data("event")[1234], "e234")
+
+
+class TestAggregates(unittest.TestCase):
+    """Test the C aggregate kernels"""
+    
+    def setUp(self):
+        self.db = ColumnDB()
+        self.db.add_column("qty", DataType.INT64)
+        self.db.add_column("price", DataType.FLOAT64)
+        self.db.add_column("flag", DataType.BOOL)
+        # 200 rows span several 64-row bitmap words, including a partial one
+        nulls = bytearray(25)
+        for i in range(0, 200, 3):
+            nulls[i // 8] |= 1 << (i % 8)
+        self.valid = [i for i in range(200) if i % 3 != 0]
+        self.db.append_array("qty", array.array("q", range(200)), bytes(nulls))
+        self.db.append_array("price", array.array("d", [i * 0.25 for i in range(200)]))
+        self.db.append_array("flag", array.array("B", [i % 2 for i in range(200)]))
+    
+    def test_null_aware_integer_aggregates(self):
+        """Test that NULL rows are skipped"""
+        self.assertEqual(self.db.sum("qty"), sum(self.valid))
+        self.assertEqual(self.db.min("qty"), 1)
+        self.assertEqual(self.db.max("qty"), 199)
+        self.assertEqual(self.db.count("qty"), len(self.valid))
+        self.assertAlmostEqual(self.db.mean("qty"), sum(self.valid) / len(self.valid))
+    
+    def test_float_and_bool_aggregates(self):
+        """Test float results and bool sums"""
+        self.assertAlmostEqual(self.db.sum("price"), sum(i * 0.25 for i in range(200)))
+        self.assertEqual(self.db.max("price"), 199 * 0.25)
+        self.assertEqual(self.db.sum("flag"), 100)
+        self.assertEqual(self.db.min("flag"), 0)
+    
+    def test_empty_and_all_null(self):
+        """Test that aggregates over no values are None, count is 0"""
+        db = ColumnDB()
+        db.add_column("x", DataType.INT32)
+        self.assertIsNone(db.sum("x"))
+        self.assertEqual(db.count("x"), 0)
+        db.insert("x", None)
+        self.assertIsNone(db.mean("x"))
+        self.assertEqual(db.count("x"), 0)
+    
+    def test_all_nan_min_max(self):
+        """Test that min/max skip NaN and are None when nothing else is left"""
+        nan, inf = float("nan"), float("inf")
+        for data_type in (DataType.FLOAT32, DataType.FLOAT64):
+            db = ColumnDB()
+            db.add_column("x", data_type)
+            db.insert_rows([(nan,), (None,)] * 100)
+            self.assertIsNone(db.min("x"))
+            self.assertIsNone(db.max("x"))
+            db.insert_rows([(inf,), (-inf,)])
+            self.assertEqual(db.min("x"), -inf)
+            self.assertEqual(db.max("x"), inf)
+    
+    def test_count_on_string_column(self):
+        """Test that count works on strings but sum does not"""
+        db = ColumnDB()
+        db.add_column("s", DataType.STRING)
+        for value in ["a", None, "b"]:
+            db.insert("s", value)
+        self.assertEqual(db.count("s"), 2)
+        with self.assertRaises(TypeError):
+            db.sum("s")
+    
+    def test_nonexistent_column(self):
+        """Test aggregating a missing column"""
+        with self.assertRaises(ValueError):
+            self.db.sum("missing")
+
+
+class TestFilter(unittest.TestCase):
+    """Test predicate filtering into new databases"""
+    
+    OPS = {
+        "==": lambda a, b: a == b, "!=": lambda a, b: a != b,
+        "<": lambda a, b: a < b, "<=": lambda a, b: a <= b,
+        ">": lambda a, b: a > b, ">=": lambda a, b: a >= b,
+    }
+    
+    def setUp(self):
+        rng = random.Random(7)
+        self.rows = [
+            (rng.randrange(-50, 50) if rng.random() > 0.1 else None,
+             rng.choice([0.5, 1.5, 2.5, float("nan"), None]),
+             rng.choice(["open", "closed", "held", None]),
+             rng.choice(["apple", "apricot", "banana", "", None]),
+             rng.choice([True, False, None]))
+            for _ in range(300)
+        ]
+        self.db = ColumnDB()
+        self.db.add_column("qty", DataType.INT64)
+        self.db.add_column("price", DataType.FLOAT64)
+        self.db.add_column("status", DataType.DICT_STRING)
+        self.db.add_column("name", DataType.STRING)
+        self.db.add_column("flag", DataType.BOOL)
+        self.db.insert_rows(self.rows)
+        self.names = ["qty", "price", "status", "name", "flag"]
+    
+    def expected_rows(self, column, op, value):
+        c = self.names.index(column)
+        return [i for i, row in enumerate(self.rows)
+                if row[c] is not None and self.OPS[op](row[c], value)]
+    
+    def test_comparisons_match_python(self):
+        """Test every operator on every column type against a plain scan"""
+        cases = [("qty", 0), ("qty", -50), ("price", 1.5), ("status", "held"),
+                 ("status", "missing"), ("name", "apricot"), ("name", ""), ("flag", True)]
+        ids = list(range(len(self.rows)))
+        self.db.add_column("row", DataType.INT32)
+        self.db.append_array("row", array.array("i", ids))
+        
+        for column, value in cases:
+            for op in self.OPS:
+                with self.subTest(column=column, op=op, value=value):
+                    result = self.db.filter((column, op, value), ["row"])
+                    self.assertEqual(result.get_column_data("row"),
+                                     self.expected_rows(column, op, value))
+    
+    def test_and_or_and_null_tests(self):
+        """Test combining terms, IS NULL and the copied values"""
+        result = self.db.filter([("qty", ">", 10), ("status", "==", "open")])
+        expected = [row for row in self.rows
+                    if row[0] is not None and row[0] > 10 and row[2] == "open"]
+        self.assertEqual(result.get_num_rows(), len(expected))
+        self.assertEqual(result.get_column_data("name"), [row[3] for row in expected])
+        self.assertEqual(result.get_column_data("flag"), [row[4] for row in expected])
+        self.assertEqual(result.get_column_data("status"), ["open"] * len(expected))
+        self.assertEqual(result.get_null_count("name"), sum(row[3] is None for row in expected))
+        
+        result = self.db.filter(("or", ("qty", "is null"), ("name", "is not null")), ["qty"])
+        expected = [row[0] for row in self.rows if row[0] is None or row[3] is not None]
+        self.assertEqual(result.get_column_data("qty"), expected)
+    
+    def test_filter_loaded_database(self):
+        """Test filtering mapped columns, including compressed ones"""
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, "filter.cdb")
+            self.db.save(path, compression="zlib")
+            for mmap in (False, True):
+                loaded = ColumnDB.load(path, mmap=mmap)
+                result = loaded.filter(("price", "<=", 1.5), ["price", "status"])
+                expected = [row for row in self.rows
+                            if row[1] is not None and row[1] <= 1.5]
+                self.assertEqual(result.get_column_data("status"), [row[2] for row in expected])
+                del loaded, result
+    
+    def test_invalid_filters(self):
+        """Test errors for malformed terms"""
+        with self.assertRaises(ValueError):
+            self.db.filter(("missing", "==", 1))
+        with self.assertRaises(ValueError):
+            self.db.filter(("qty", "~", 1))
+        with self.assertRaises(ValueError):
+            self.db.filter(("qty", "==", None))
+        with self.assertRaises(ValueError):
+            self.db.filter(("xor", ("qty", "==", 1), ("qty", "==", 2)))
+        with self.assertRaises(TypeError):
+            self.db.filter(("name", "==", 3))
+        with self.assertRaises(ValueError):
+            self.db.filter(("qty", ">", 0), ["missing"])
+
+
+class TestGroupBy(unittest.TestCase):
+    """Test hash group-by aggregation into new databases"""
+    
+    def expected(self, keys, values, op):
+        groups = {}
+        for k, v in zip(keys, values):
+            groups.setdefault(k, [])
+            if v is not None:
+                groups[k].append(v)
+        result = {}
+        for k, vs in groups.items():
+            if op == "count":
+                result[k] = len(vs)
+            elif not vs:
+                result[k] = None
+            else:
+                result[k] = {"sum": sum, "min": min, "max": max,
+                             "mean": lambda x: sum(x) / len(x)}[op](vs)
+        return result
+    
+    def test_keys_and_aggregates_match_python(self):
+        """Test every key type and aggregate against a plain dict, across threads"""
+        rng = random.Random(11)
+        n = 200000
+        keys = [rng.randrange(-500, 500) if rng.random() > 0.02 else None for _ in range(n)]
+        values = [rng.randrange(1000) if rng.random() > 0.1 else None for _ in range(n)]
+        cities = [rng.choice(["oslo", "lima", "pune", None]) for _ in range(n)]
+        
+        db = ColumnDB()
+        db.add_column("k32", DataType.INT32)
+        db.add_column("k64", DataType.INT64)
+        db.add_column("city", DataType.DICT_STRING)
+        db.add_column("v", DataType.INT64)
+        db.add_column("f", DataType.FLOAT64)
+        db.insert_rows(list(zip(keys, [None if k is None else k * 2 ** 40 for k in keys],
+                                cities, values,
+                                [None if v is None else v / 4 for v in values])))
+        ops = ("sum", "min", "max", "count", "mean")
+        expected = {key: {op: self.expected(key_values, values, op) for op in ops}
+                    for key, key_values in (("k32", keys), ("city", cities))}
+        
+        for threads in (1, 4):
+            db.set_num_threads(threads)
+            for key, key_values in (("k32", keys), ("city", cities)):
+                aggregates = [(op, "v") for op in ops]
+                result = db.group_by(key, aggregates + [("count", None), ("sum", "f", "total")])
+                got_keys = result.get_column_data(key)
+                self.assertEqual(got_keys, list(dict.fromkeys(key_values)))
+                for op in ops:
+                    with self.subTest(threads=threads, key=key, op=op):
+                        want = expected[key][op]
+                        got = dict(zip(got_keys, result.get_column_data(f"{op}_v")))
+                        if op == "mean":
+                            for k in want:
+                                self.assertAlmostEqual(got[k], want[k])
+                        else:
+                            self.assertEqual(got, want)
+                rows = dict(zip(got_keys, result.get_column_data("count")))
+                self.assertEqual(rows, dict(collections.Counter(key_values)))
+                totals = dict(zip(got_keys, result.get_column_data("total")))
+                self.assertEqual(totals, {k: (None if v is None else v / 4)
+                                          for k, v in expected[key]["sum"].items()})
+            
+            result = db.group_by("k64", [("max", "v")])
+            self.assertEqual(result.get_column_data("k64")[:3],
+                             [None if k is None else k * 2 ** 40 for k in list(dict.fromkeys(keys))[:3]])
+    
+    def test_result_database(self):
+        """Test the result's columns, types and NULL groups"""
+        db = ColumnDB()
+        db.add_column("team", DataType.DICT_STRING)
+        db.add_column("score", DataType.FLOAT32)
+        db.insert_rows([("red", 1.5), ("blue", None), ("red", 2.5), (None, 4.0)])
+        
+        result = db.group_by("team", [("sum", "score"), ("mean", "score", "avg")])
+        self.assertEqual(result.get_num_rows(), 3)
+        self.assertEqual(result.get_column_data("team"), ["red", "blue", None])
+        self.assertEqual(result.get_column_data("sum_score"), [4.0, None, 4.0])
+        self.assertEqual(result.get_column_data("avg"), [2.0, None, 4.0])
+        self.assertEqual(result.get_schema(), {"team": "dict_string", "sum_score": "float64",
+                                               "avg": "float64"})
+        self.assertEqual(db.group_by("team").get_column_data("count"), [2, 1, 1])
+        
+        empty = ColumnDB()
+        empty.add_column("k", DataType.INT64)
+        self.assertEqual(empty.group_by("k").get_num_rows(), 0)
+    
+    def test_overflow_and_nan(self):
+        """Test that means cannot overflow, sums wrap like db.sum, and all-NaN groups are NULL"""
+        db = ColumnDB()
+        db.add_column("k", DataType.INT32)
+        db.add_column("v", DataType.INT64)
+        db.add_column("f", DataType.FLOAT64)
+        nan = float("nan")
+        db.insert_rows([(1, 2 ** 62, nan)] * 3 + [(2, -2 ** 63, nan)] * 4 + [(3, 5, 1.5), (3, 7, nan)])
+        
+        for threads in (1, 4):
+            db.set_num_threads(threads)
+            result = db.group_by("k", [("mean", "v"), ("sum", "v"), ("min", "f"), ("max", "f")])
+            self.assertEqual(result.get_column_data("mean_v"), [4.611686018427388e18, -2 ** 63, 6.0])
+            self.assertEqual(result.get_column_data("sum_v"), [-2 ** 62, 0, 12])
+            self.assertEqual(result.get_column_data("min_f"), [None, None, 1.5])
+            self.assertEqual(result.get_column_data("max_f"), [None, None, 1.5])
+        
+        only_first = db.filter(("k", "==", 1))
+        self.assertEqual(only_first.sum("v"), -2 ** 62)
+        self.assertEqual(only_first.mean("v"), 4.611686018427388e18)
+    
+    def test_invalid_group_by(self):
+        """Test errors for bad keys and aggregates"""
+        db = ColumnDB()
+        db.add_column("name", DataType.STRING)
+        db.add_column("n", DataType.INT32)
+        db.insert_rows([("a", 1)])
+        with self.assertRaises(ValueError):
+            db.group_by("name")
+        with self.assertRaises(ValueError):
+            db.group_by("missing")
+        with self.assertRaises(ValueError):
+            db.group_by("n", [("median", "n")])
+        with self.assertRaises(ValueError):
+            db.group_by("n", [("sum", None)])
+        with self.assertRaises(ValueError):
+            db.group_by("n", [("sum", "name")])
+        with self.assertRaises(ValueError):
+            db.group_by("n", [("count", None), ("count", None)])
+
+
+class TestSortedColumns(unittest.TestCase):
+    """Test sorted column declarations, detection and range lookups"""
+    
+    def make_db(self, values, data_type=DataType.INT64):
+        db = ColumnDB()
+        db.add_column("ts", data_type)
+        db.insert_rows([(v,) for v in values])
+        return db
+    
+    def test_declare_and_appends(self):
+        """Test that declaring checks the rows and appends keep the flag honest"""
+        db = self.make_db([None, None, 1, 3, 3, 7])
+        self.assertFalse(db.is_sorted("ts"))
+        db.set_sorted("ts")
+        self.assertTrue(db.is_sorted("ts"))
+        
+        db.insert_rows([(7,), (9,)])
+        db.append_array("ts", array.array("q", [10, 12]))
+        db.insert("ts", 12)
+        self.assertTrue(db.is_sorted("ts"))
+        db.insert("ts", 11)
+        self.assertFalse(db.is_sorted("ts"))
+        
+        with self.assertRaises(ValueError):
+            db.set_sorted("ts")
+        late_null = self.make_db([1, 2])
+        late_null.set_sorted("ts")
+        late_null.insert("ts", None)
+        self.assertFalse(late_null.is_sorted("ts"))
+        with self.assertRaises(ValueError):
+            self.make_db([1.0, float("nan")], DataType.FLOAT64).set_sorted("ts")
+        with self.assertRaises(ValueError):
+            self.make_db(["a", "b"], DataType.STRING).set_sorted("ts")
+        db.set_sorted("ts", False)
+        self.assertFalse(db.is_sorted("ts"))
+    
+    def test_range_matches_scan(self):
+        """Test range() against a plain scan, with duplicates and open bounds"""
+        rng = random.Random(3)
+        values = [None] * 5 + sorted(rng.randrange(100) for _ in range(1000))
+        for data_type, cast in ((DataType.INT64, int), (DataType.INT32, int),
+                                (DataType.FLOAT64, float)):
+            db = self.make_db([None if v is None else cast(v) for v in values], data_type)
+            db.set_sorted("ts")
+            for low, high in ((10, 20), (-5, 3), (99, 200), (50, 50), (30, 20), (None, 40), (60, None),
+                              (None, None), (10.5, 11)):
+                with self.subTest(data_type=data_type, low=low, high=high):
+                    if data_type != DataType.FLOAT64 and isinstance(low, float):
+                        continue
+                    start, end = db.range("ts", low, high)
+                    expected = [i for i, v in enumerate(values) if v is not None and
+                                (low is None or v >= low) and (high is None or v <= high)]
+                    self.assertEqual(list(range(start, end)), expected)
+        
+        with self.assertRaises(ValueError):
+            self.make_db([2, 1]).range("ts", 0, 5)
+    
+    def test_filter_uses_sorted_order(self):
+        """Test filters on a sorted column against the same data unsorted"""
+        values = [None, None] + [i // 3 for i in range(300)]
+        sorted_db = self.make_db(values)
+        sorted_db.set_sorted("ts")
+        plain = self.make_db(values)
+        for op in ("==", "!=", "<", "<=", ">", ">="):
+            for value in (-1, 0, 50, 99, 150):
+                with self.subTest(op=op, value=value):
+                    self.assertEqual(sorted_db.filter(("ts", op, value)).get_column_data("ts"),
+                                     plain.filter(("ts", op, value)).get_column_data("ts"))
+        self.assertTrue(sorted_db.filter(("ts", ">", 10)).is_sorted("ts"))
+    
+    def test_saved_flag(self):
+        """Test that saves detect sorted columns and loads keep the flag"""
+        db = ColumnDB()
+        db.add_column("ts", DataType.INT64)
+        db.add_column("noise", DataType.FLOAT64)
+        db.insert_rows([(i * 10, float(i % 7)) for i in range(5000)])
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, "sorted.cdb")
+            for compression in (None, "zlib"):
+                db.save(path, compression=compression)
+                for mmap in (False, True):
+                    with self.subTest(compression=compression, mmap=mmap):
+                        loaded = ColumnDB.load(path, mmap=mmap)
+                        self.assertTrue(loaded.is_sorted("ts"))
+                        self.assertFalse(loaded.is_sorted("noise"))
+                        self.assertEqual(loaded.range("ts", 95, 1000), (10, 101))
+                        del loaded
+
+
+class TestIndexes(unittest.TestCase):
+    """Test hash and bitmap column indexes"""
+    
+    def make_db(self, keys, data_type):
+        db = ColumnDB()
+        db.add_column("row", DataType.INT64)
+        db.add_column("key", data_type)
+        db.insert_rows(list(enumerate(keys)))
+        return db
+    
+    def matches(self, db, op, value):
+        return db.filter(("key", op, value)).get_column_data("row")
+    
+    def test_filters_match_scan(self):
+        """Test == and != through each index kind against plain scans"""
+        rng = random.Random(5)
+        ints = [None if rng.random() < 0.05 else rng.randrange(6) for _ in range(150000)]
+        ints[100] = 9  # A value with a single row
+        cases = (
+            (DataType.INT64, ints, (0, 3, 9, 42)),
+            (DataType.INT32, [None if v is None else rng.randrange(5000) for v in ints[:20000]], (17, 4999, -1)),
+            (DataType.BOOL, [None if v is None else v % 2 == 0 for v in ints[:20000]], (True, False)),
+            (DataType.STRING, [None if v is None else f"s{v}" for v in ints[:20000]], ("s0", "s9", "", "x")),
+            (DataType.DICT_STRING, [None if v is None else f"d{v}" for v in ints], ("d1", "d9", "zz")),
+        )
+        for data_type, keys, probes in cases:
+            plain = self.make_db(keys, data_type)
+            expected = {(op, v): self.matches(plain, op, v) for op in ("==", "!=") for v in probes}
+            for kind in ("hash", "bitmap", "auto"):
+                db = self.make_db(keys, data_type)
+                db.create_index("key", kind)
+                self.assertEqual(db.get_index("key"), kind)
+                for (op, value), rows in expected.items():
+                    with self.subTest(data_type=data_type, kind=kind, op=op, value=value):
+                        self.assertEqual(self.matches(db, op, value), rows)
+    
+    def test_appends_refresh(self):
+        """Test that filters after appends see the new rows"""
+        db = self.make_db([1, 2, 1], DataType.INT64)
+        db.create_index("key", "hash")
+        db.insert_rows([(3, 1), (4, None), (5, 7)])
+        self.assertEqual(self.matches(db, "==", 1), [0, 2, 3])
+        self.assertEqual(self.matches(db, "!=", 1), [1, 5])
+        db.append_array("row", array.array("q", [6]))
+        db.append_array("key", array.array("q", [7]))
+        self.assertEqual(self.matches(db, "==", 7), [5, 6])
+        
+        db.drop_index("key")
+        self.assertIsNone(db.get_index("key"))
+        self.assertEqual(self.matches(db, "==", 7), [5, 6])
+    
+    def test_saved_indexes(self):
+        """Test that indexes are written to the file and read back"""
+        keys = [f"k{i % 50}" if i % 11 else None for i in range(70000)]
+        db = self.make_db(keys, DataType.STRING)
+        db.add_column("code", DataType.INT64)
+        db.append_array("code", array.array("q", [i % 300 for i in range(70000)]))
+        db.create_index("key", "auto")
+        db.create_index("code", "hash")
+        db.insert_rows([(70000, "k3", 3)])  # Saved stale: the save builds it afresh
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, "indexed.cdb")
+            for compression in (None, "zlib"):
+                db.save(path, compression=compression)
+                for mmap in (False, True):
+                    with self.subTest(compression=compression, mmap=mmap):
+                        loaded = ColumnDB.load(path, mmap=mmap)
+                        self.assertEqual(loaded.get_index("key"), "auto")
+                        self.assertEqual(loaded.get_index("code"), "hash")
+                        self.assertIsNone(loaded.get_index("row"))
+                        self.assertEqual(self.matches(loaded, "==", "k3"), self.matches(db, "==", "k3"))
+                        self.assertEqual(loaded.filter(("code", "==", 299)).get_column_data("row"),
+                                         list(range(299, 70000, 300)))
+                        del loaded
+    
+    def test_bitmap_past_last_row(self):
+        """Test that a saved bitmap with bits past the last row is rejected"""
+        db = self.make_db([1] * 70000, DataType.INT64)
+        db.create_index("key", "bitmap")
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, "indexed.cdb")
+            db.save(path)
+            with open(path, "r+b") as f:
+                tail = f.read().find(b"\xff" * 6 + b"\x00\x00")  # Partial last word of the bitmap
+                self.assertGreater(tail, 0)
+                f.seek(tail + 6)
+                f.write(b"\x01")  # Row 70000
+            for mmap in (False, True):
+                with self.subTest(mmap=mmap):
+                    with self.assertRaisesRegex(IOError, "Corrupt column index"):
+                        ColumnDB.load(path, mmap=mmap)
+    
+    def test_errors(self):
+        """Test invalid index requests"""
+        db = self.make_db([1.5, 2.5], DataType.FLOAT64)
+        with self.assertRaises(ValueError):
+            db.create_index("key")
+        with self.assertRaises(ValueError):
+            db.create_index("row", "btree")
+        with self.assertRaises(ValueError):
+            db.create_index("missing")
+        with self.assertRaises(ValueError):
+            db.drop_index("missing")
+
+
+class TestAppendSave(unittest.TestCase):
+    """Test incremental saves and compaction"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "append.cdb")
+    
+    def tearDown(self):
+        self.tmpdir.cleanup()
+    
+    def make_db(self):
+        db = ColumnDB()
+        db.add_column("id", DataType.INT64)
+        db.add_column("name", DataType.STRING)
+        db.add_column("tag", DataType.DICT_STRING)
+        db.add_column("score", DataType.FLOAT64)
+        return db
+    
+    def rows(self, start, count):
+        return [(i, None if i % 7 == 0 else f"n{i}", ("a", "b", "c")[i % 3] if start else ("a", "b")[i % 2],
+                 i * 0.5) for i in range(start, start + count)]
+    
+    def assert_same(self, loaded, db):
+        for name in ("id", "name", "tag", "score"):
+            self.assertEqual(loaded.get_column_data(name), db.get_column_data(name))
+    
+    def test_appends_round_trip(self):
+        """Test that each append writes only the new rows and loads see them all"""
+        db = self.make_db()
+        db.insert_rows(self.rows(0, 20000))
+        db.save(self.path)
+        base_size = os.path.getsize(self.path)
+        for start in (20000, 20100, 20200):
+            db.insert_rows(self.rows(start, 100))
+            db.save(self.path, append=True)
+        self.assertLess(os.path.getsize(self.path) - base_size, base_size // 10)
+        db.save(self.path, append=True)  # Nothing new
+        for mmap in (False, True):
+            with self.subTest(mmap=mmap):
+                loaded = ColumnDB.load(self.path, mmap=mmap)
+                self.assert_same(loaded, db)
+                self.assertEqual(loaded.filter(("tag", "==", "c")).get_column_data("id"),
+                                 db.filter(("tag", "==", "c")).get_column_data("id"))
+                del loaded
+        self.assertEqual(ColumnDB.scan_between(self.path, "id", 19998, 20101),
+                         list(range(19998, 20102)))
+    
+    def test_loaded_database_appends(self):
+        """Test appending from a database loaded from the file"""
+        db = self.make_db()
+        db.insert_rows(self.rows(0, 500))
+        db.save(self.path)
+        loaded = ColumnDB.load(self.path)
+        loaded.insert_rows(self.rows(500, 50))
+        loaded.save(self.path, append=True)
+        db.insert_rows(self.rows(500, 50))
+        self.assert_same(ColumnDB.load(self.path), db)
+    
+    def test_compact(self):
+        """Test that compaction merges segments and keeps the data"""
+        db = self.make_db()
+        db.insert_rows(self.rows(0, 1000))
+        db.save(self.path)
+        for start in range(1000, 1500, 50):
+            db.insert_rows(self.rows(start, 50))
+            db.save(self.path, append=True)
+        segmented = os.path.getsize(self.path)
+        ColumnDB.compact(self.path)
+        self.assertLess(os.path.getsize(self.path), segmented)
+        self.assert_same(ColumnDB.load(self.path, mmap=True), db)
+        ColumnDB.compact(self.path, compression="zlib")
+        self.assert_same(ColumnDB.load(self.path), db)
+    
+    def test_full_save_fallback_and_errors(self):
+        """Test missing files, schema mismatches and lost rows"""
+        db = self.make_db()
+        db.insert_rows(self.rows(0, 10))
+        db.save(self.path, append=True)  # Missing file: written in full
+        self.assert_same(ColumnDB.load(self.path), db)
+        other = ColumnDB()
+        other.add_column("id", DataType.INT64)
+        other.insert_rows([(1,)] * 20)
+        with self.assertRaises(IOError):
+            other.save(self.path, append=True)
+        fewer = self.make_db()
+        fewer.insert_rows(self.rows(0, 5))
+        with self.assertRaises(IOError):
+            fewer.save(self.path, append=True)
+        self.assert_same(ColumnDB.load(self.path), db)
+        with self.assertRaises(IOError):
+            ColumnDB.compact(os.path.join(self.tmpdir.name, "missing.cdb"))
+
+
+class TestChecksums(unittest.TestCase):
+    """Test column checksums and atomic saves"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "checked.cdb")
+        rng = random.Random(3)
+        self.db = ColumnDB()
+        self.db.add_column("id", DataType.INT64)
+        self.db.add_column("name", DataType.STRING)
+        self.db.add_column("tag", DataType.DICT_STRING)
+        self.db.insert_rows([(rng.getrandbits(62), f"needle-{i}", ("x", "y")[i % 2]) for i in range(5000)])
+    
+    def tearDown(self):
+        self.tmpdir.cleanup()
+    
+    def corrupt(self, offset):
+        with open(self.path, "r+b") as f:
+            f.seek(offset)
+            byte = f.read(1)
+            f.seek(offset)
+            f.write(bytes([byte[0] ^ 0xff]))
+    
+    def test_corrupt_column_detected_on_read(self):
+        """Test that a damaged column fails when read and the others still load"""
+        self.db.save(self.path)
+        with open(self.path, "rb") as f:
+            self.corrupt(f.read().find(b"needle-2500"))
+        with self.assertRaises(IOError):
+            ColumnDB.load(self.path)
+        self.assertEqual(ColumnDB.load(self.path, columns=["id", "tag"]).get_column_data("tag"),
+                         self.db.get_column_data("tag"))
+        mapped = ColumnDB.load(self.path, mmap=True)
+        self.assertEqual(mapped.get_column_data("id"), self.db.get_column_data("id"))
+        for _ in range(2):
+            with self.assertRaises(IOError):
+                mapped.get_column_data("name")
+    
+    def test_compressed_and_metadata_corruption(self):
+        """Test damaged compressed blocks and damaged column metadata"""
+        self.db.save(self.path, compression="zlib")
+        self.corrupt(os.path.getsize(self.path) // 2)
+        with self.assertRaises(IOError):
+            ColumnDB.load(self.path)
+        self.db.save(self.path)
+        self.corrupt(16)  # Header timestamp
+        with self.assertRaises(IOError):
+            ColumnDB.load(self.path, mmap=True)
+    
+    def test_atomic_replace(self):
+        """Test that saves replace the file whole and leave no temporary behind"""
+        self.db.save(self.path)
+        mapped = ColumnDB.load(self.path, mmap=True)
+        self.db.insert_rows([(1, "new", "z")])
+        self.db.save(self.path)
+        self.assertEqual(len(mapped.get_column_data("name")), 5000)
+        del mapped
+        self.assertEqual(ColumnDB.load(self.path).get_column_data("name")[-1], "new")
+        self.assertEqual(os.listdir(self.tmpdir.name), ["checked.cdb"])
+        
+        target = os.path.join(self.tmpdir.name, "taken")
+        os.mkdir(target)
+        with self.assertRaises(IOError):
+            self.db.save(target)
+        self.assertEqual(sorted(os.listdir(self.tmpdir.name)), ["checked.cdb", "taken"])
+
+
+class TestStreamingReader(unittest.TestCase):
+    """Test reading saved files in batches"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "stream.cdb")
+        self.names = ("id", "score", "name", "tag", "flag")
+    
+    def tearDown(self):
+        self.tmpdir.cleanup()
+    
+    def make_db(self, start, count):
+        db = ColumnDB()
+        db.add_column("id", DataType.INT64)
+        db.add_column("score", DataType.FLOAT32)
+        db.add_column("name", DataType.STRING)
+        db.add_column("tag", DataType.DICT_STRING)
+        db.add_column("flag", DataType.BOOL)
+        db.set_row_group_size(128)
+        db.insert_rows([(i, None if i % 5 == 0 else i * 0.25, None if i % 7 == 0 else f"n{i}",
+                         ("a", "b", "c")[i % 3], i % 4 == 0) for i in range(start, start + count)])
+        return db
+    
+    def read_all(self, batch_size, columns=None):
+        data = {name: [] for name in columns or self.names}
+        for batch in ColumnDB.iter_batches(self.path, columns, batch_size):
+            for name in data:
+                data[name] += batch.get_column_data(name)
+        return data
+    
+    def test_batches_match_load(self):
+        """Test that batches of any size add up to the loaded columns"""
+        db = self.make_db(0, 3000)
+        for compression in (None, "zlib"):
+            db.save(self.path, compression=compression)
+            for batch_size in (1, 77, 128, 5000):
+                with self.subTest(compression=compression, batch_size=batch_size):
+                    data = self.read_all(batch_size)
+                    for name in self.names:
+                        self.assertEqual(data[name], db.get_column_data(name))
+    
+    def test_batch_sizes_and_segments(self):
+        """Test that batches stop at segment boundaries and see appended rows"""
+        db = self.make_db(0, 3000)
+        db.save(self.path)
+        grown = self.make_db(0, 3500)
+        grown.save(self.path, append=True)
+        sizes = [batch.get_num_rows()
+                 for batch in ColumnDB.iter_batches(self.path, ["tag"], batch_size=1000)]
+        self.assertEqual(sizes, [1000, 1000, 1000, 500])
+        data = self.read_all(999, ["name", "tag"])
+        self.assertEqual(data["name"], grown.get_column_data("name"))
+        self.assertEqual(data["tag"], grown.get_column_data("tag"))
+    
+    def test_batches_can_be_kept(self):
+        """Test that earlier batches stay valid while later ones are read"""
+        db = self.make_db(0, 2000)
+        db.save(self.path)
+        batches = list(ColumnDB.iter_batches(self.path, ["id", "tag"], batch_size=300))
+        self.assertEqual(len(batches), 7)
+        self.assertEqual(batches[0].get_column_data("id"), list(range(300)))
+        self.assertEqual(batches[-1].get_column_data("tag"), db.get_column_data("tag")[1800:])
+        self.assertEqual(batches[0].get_num_columns(), 2)
+    
+    def test_empty_strings(self):
+        """Test batches of strings that have no bytes at all"""
+        db = ColumnDB()
+        db.add_column("s", DataType.STRING)
+        db.insert_rows([("",)] * 100 + [(None,)])
+        for compression in (None, "zlib"):
+            db.save(self.path, compression=compression)
+            data = [value for batch in ColumnDB.iter_batches(self.path, batch_size=30)
+                    for value in batch.get_column_data("s")]
+            self.assertEqual(data, [""] * 100 + [None])
+    
+    def test_errors(self):
+        """Test missing files and columns and bad batch sizes"""
+        self.make_db(0, 10).save(self.path)
+        with self.assertRaises(IOError):
+            list(ColumnDB.iter_batches(os.path.join(self.tmpdir.name, "missing.cdb")))
+        with self.assertRaises(IOError):
+            list(ColumnDB.iter_batches(self.path, ["nope"]))
+        with self.assertRaises(ValueError):
+            list(ColumnDB.iter_batches(self.path, batch_size=0))
+
+
+class TestBatchWriter(unittest.TestCase):
+    """Test writing files from batches of rows"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "writer.cdb")
+    
+    def tearDown(self):
+        self.tmpdir.cleanup()
+    
+    def make_db(self, start, count):
+        db = ColumnDB()
+        db.add_column("id", DataType.INT64)
+        db.add_column("name", DataType.STRING)
+        db.add_column("tag", DataType.DICT_STRING)
+        db.insert_rows([(i, None if i % 7 == 0 else f"n{i}", f"t{i % 5}")
+                        for i in range(start, start + count)])
+        return db
+    
+    def test_batches_round_trip(self):
+        """Test that flushed and buffered batches all reach the file"""
+        with BatchWriter(self.path, self.make_db(0, 0), flush_rows=1000) as writer:
+            for k in range(25):
+                writer.write(self.make_db(k * 300, 300))
+                if k == 10:
+                    # Written rows are committed and readable right away
+                    self.assertEqual(writer.rows_written, 2400)
+                    self.assertEqual(ColumnDB.load(self.path).get_num_rows(), 2400)
+        loaded = ColumnDB.load(self.path)
+        expected = self.make_db(0, 7500)
+        for name in ("id", "name", "tag"):
+            self.assertEqual(loaded.get_column_data(name), expected.get_column_data(name))
+        ColumnDB.compact(self.path)
+        self.assertEqual(ColumnDB.load(self.path).get_column_data("tag"), expected.get_column_data("tag"))
+    
+    def test_empty_and_aborted(self):
+        """Test closing without rows and aborting with buffered rows"""
+        schema = self.make_db(0, 0)
+        BatchWriter(self.path, schema).close()
+        self.assertEqual(ColumnDB.load(self.path).get_num_rows(), 0)
+        with self.assertRaises(KeyError):
+            with BatchWriter(self.path, schema, flush_rows=100) as writer:
+                writer.write(self.make_db(0, 250))
+                writer.write(self.make_db(250, 50))
+                raise KeyError("stop")
+        self.assertEqual(ColumnDB.load(self.path).get_column_data("id"), list(range(250)))
+    
+    def test_errors(self):
+        """Test mismatched batches, closed writers and bad settings"""
+        writer = BatchWriter(self.path, self.make_db(0, 0))
+        other = ColumnDB()
+        other.add_column("id", DataType.INT32)
+        with self.assertRaises(IOError):
+            writer.write(other)
+        writer.write(self.make_db(0, 10))
+        writer.close()
+        self.assertEqual(ColumnDB.load(self.path).get_num_rows(), 10)
+        with self.assertRaises(ValueError):
+            writer.write(self.make_db(0, 1))
+        with self.assertRaises(ValueError):
+            BatchWriter(self.path, other, flush_rows=0)
+        with self.assertRaises(ValueError):
+            BatchWriter(self.path, other, compression="nope")
+
+
+class TestArrowInterop(unittest.TestCase):
+    """Test export and import through the Arrow C data interface"""
+    
+    def make_db(self):
+        db = ColumnDB()
+        db.add_column("i32", DataType.INT32)
+        db.add_column("i64", DataType.INT64)
+        db.add_column("f32", DataType.FLOAT32)
+        db.add_column("f64", DataType.FLOAT64)
+        db.add_column("name", DataType.STRING)
+        db.add_column("flag", DataType.BOOL)
+        db.add_column("tag", DataType.DICT_STRING)
+        db.insert_rows([(None, None, None, None, None, None, None) if i % 7 == 0 else
+                        (i, i * 1000, i / 2, i / 4, f"n{i}" * (i % 3), i % 2 == 0, f"t{i % 4}")
+                        for i in range(500)])
+        return db
+    
+    def test_stream_round_trip(self):
+        """Test that every column type and its NULLs survive an export and import"""
+        db = self.make_db()
+        copy = ColumnDB.from_arrow(db)
+        self.assertEqual(copy.to_dict(), db.to_dict())
+        self.assertEqual(copy.get_null_count("name"), db.get_null_count("name"))
+        self.assertEqual(sorted(copy.get_dictionary("tag")), ["t0", "t1", "t2", "t3"])
+    
+    def test_array_capsules(self):
+        """Test the struct array export and importing it from __arrow_c_array__"""
+        db = self.make_db()
+        
+        class ArrayOnly:
+            def __arrow_c_array__(self, requested_schema=None):
+                return db.__arrow_c_array__(requested_schema)
+        
+        schema, array = db.__arrow_c_array__()
+        self.assertEqual(type(schema).__name__, "PyCapsule")
+        self.assertEqual(type(array).__name__, "PyCapsule")
+        del schema, array
+        self.assertEqual(ColumnDB.from_arrow(ArrayOnly()).to_dict(), db.to_dict())
+        with self.assertRaises(TypeError):
+            ColumnDB.from_arrow([1, 2, 3])
+    
+    def test_exports_block_updates(self):
+        """Test that shared column memory can't move while an export is alive"""
+        db = self.make_db()
+        stream = db.__arrow_c_stream__()
+        with self.assertRaises(BufferError):
+            db.insert("i32", 1)
+        del stream
+        db.insert_rows([(1, 2, 3.0, 4.0, "x", True, "t1")])
+        self.assertEqual(db.get_num_rows(), 501)
+    
+    def test_stream_after_new_column(self):
+        """Test that a stream refuses to export columns added after it was created"""
+        db = self.make_db()
+        stream = db.__arrow_c_stream__()
+        
+        class StreamOnly:
+            def __arrow_c_stream__(self, requested_schema=None):
+                return stream
+        
+        db.add_column("extra", DataType.INT32)
+        with self.assertRaisesRegex(ValueError, "columns changed"):
+            ColumnDB.from_arrow(StreamOnly())
+    
+    def test_mapped_database(self):
+        """Test exporting a mapped database whose columns load on first access"""
+        db = self.make_db()
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "arrow.cdb")
+            db.save(path)
+            mapped = ColumnDB.load(path, mmap=True)
+            self.assertEqual(ColumnDB.from_arrow(mapped).to_dict(), db.to_dict())
+            del mapped
+    
+    def test_invalid_exports(self):
+        """Test ragged databases and capsules that were already consumed"""
+        db = self.make_db()
+        
+        class Reused:
+            capsules = db.__arrow_c_array__()
+            
+            def __arrow_c_array__(self, requested_schema=None):
+                return self.capsules
+        
+        reused = Reused()
+        ColumnDB.from_arrow(reused)
+        with self.assertRaises(ValueError):
+            ColumnDB.from_arrow(reused)
+        del Reused.capsules
+        db.add_column("extra", DataType.INT32)
+        with self.assertRaises(ValueError):
+            db.__arrow_c_stream__()
+        db.insert("extra", 1)
+
+
+class TestStats(unittest.TestCase):
+    """Test the C core's statistics counters"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "stats.cdb")
+        ColumnDB.enable_stats()
+        ColumnDB.stats(reset=True)
+    
+    def tearDown(self):
+        ColumnDB.enable_stats(False)
+        ColumnDB.stats(reset=True)
+        self.tmpdir.cleanup()
+    
+    def make_db(self):
+        db = ColumnDB()
+        db.add_column("id", DataType.INT64)
+        db.add_column("name", DataType.STRING)
+        db.insert_rows([(i, f"n{i}") for i in range(5000)])
+        return db
+    
+    def test_save_and_load(self):
+        """Test that saves and loads count their phases and file bytes"""
+        db = self.make_db()
+        db.save(self.path)
+        saved = ColumnDB.stats(reset=True)
+        self.assertEqual(saved["saves"], 1)
+        self.assertGreater(saved["bytes_written"], 0)
+        self.assertLessEqual(saved["bytes_written"], os.path.getsize(self.path))
+        self.assertGreaterEqual(saved["save_ns"], saved["write_ns"])
+        self.assertGreater(saved["save_ns"], 0)
+        
+        db2 = ColumnDB()
+        db2.load(self.path)
+        loaded = ColumnDB.stats()
+        self.assertEqual(loaded["loads"], 1)
+        self.assertEqual(loaded["saves"], 0)
+        self.assertGreaterEqual(loaded["bytes_read"], saved["bytes_written"])
+    
+    def test_growth_and_scans(self):
+        """Test that growing columns and scanning rows are counted"""
+        db = self.make_db()
+        grown = ColumnDB.stats(reset=True)
+        self.assertGreater(grown["allocations"], 0)
+        self.assertGreater(grown["reallocs"], 0)
+        self.assertGreater(grown["realloc_bytes"], 0)
+        
+        db.filter(("id", ">", 100))
+        db.sum("id")
+        self.assertEqual(ColumnDB.stats()["rows_scanned"], 10000)
+    
+    def test_disabled(self):
+        """Test that nothing is counted while statistics are off"""
+        ColumnDB.enable_stats(False)
+        self.make_db().save(self.path)
+        self.assertTrue(all(value == 0 for value in ColumnDB.stats().values()))
+    
+    def test_reset(self):
+        """Test that reset zeroes every counter"""
+        self.make_db().save(self.path)
+        self.assertGreater(ColumnDB.stats(reset=True)["bytes_written"], 0)
+        self.assertTrue(all(value == 0 for value in ColumnDB.stats().values()))
+
+
+class TestNullCount(unittest.TestCase):
+    """Test null count tracking"""
+    
+    def test_tracked_on_insert_and_append(self):
+        """Test that every way of adding a NULL is counted"""
+        db = ColumnDB()
+        db.add_column("x", DataType.INT32)
+        db.add_column("s", DataType.STRING)
+        db.insert("x", 1)
+        db.insert("x", None)
+        db.append_array("x", array.array("i", [1, 2, 3]), bytes([0b101]))
+        db.append_array("s", ["a", None, "b", None])
+        
+        self.assertEqual(db.get_null_count("x"), 3)
+        self.assertEqual(db.get_null_count("s"), 2)
+        self.assertEqual(db.get_column_data("x"), [1, None, None, 2, None])
+    
+    def test_export_across_bitmap_words(self):
+        """Test that the word-at-a-time export matches per-row null bits"""
+        db = ColumnDB()
+        db.add_column("x", DataType.INT64)
+        nulls = bytearray(17)
+        for i in (0, 63, 64, 65, 129):
+            nulls[i // 8] |= 1 << (i % 8)
+        db.append_array("x", array.array("q", range(130)), bytes(nulls))
+        
+        data = db.get_column_data("x")
+        self.assertEqual([i for i, v in enumerate(data) if v is None], [0, 63, 64, 65, 129])
+        self.assertEqual(data[128], 128)
+    
+    def test_persisted_in_file(self):
+        """Test that the count survives save/load and mmap"""
+        db = ColumnDB()
+        db.add_column("x", DataType.FLOAT64)
+        for value in [1.0, None, None, 4.0]:
+            db.insert("x", value)
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "nulls.cdb")
+            db.save(path)
+            for mmap in (False, True):
+                self.assertEqual(ColumnDB.load(path, mmap=mmap).get_null_count("x"), 2)
+
+
+class TestZoneMaps(unittest.TestCase):
+    """Test row groups and zone-map range scans"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "zones.cdb")
+    
+    def tearDown(self):
+        self.tmpdir.cleanup()
+    
+    def test_scan_skips_groups(self):
+        """Test that a selective range only reads overlapping row groups"""
+        db = ColumnDB()
+        db.add_column("ts", DataType.INT64)
+        db.set_row_group_size(128)
+        db.append_array("ts", array.array("q", range(1000)))
+        db.save(self.path)
+        
+        rows, groups_read, groups_total = ColumnDB.scan_between(
+            self.path, "ts", 300, 310, with_stats=True)
+        self.assertEqual(rows, list(range(300, 311)))
+        self.assertEqual((groups_read, groups_total), (1, 8))
+        
+        # Fully covered groups are answered from the zone maps alone
+        rows, groups_read, _ = ColumnDB.scan_between(
+            self.path, "ts", 0, 255, with_stats=True)
+        self.assertEqual(rows, list(range(256)))
+        self.assertEqual(groups_read, 0)
+        self.assertEqual(ColumnDB.scan_between(self.path, "ts", 5000, 6000), [])
+    
+    def test_nulls_and_floats(self):
+        """Test that NULL and NaN rows never match and float bounds work"""
+        db = ColumnDB()
+        db.add_column("x", DataType.FLOAT64)
+        db.set_row_group_size(64)
+        values = [None if i % 7 == 0 else float(i) for i in range(200)]
+        values[50] = float("nan")
+        for value in values:
+            db.insert("x", value)
+        db.save(self.path)
+        
+        expected = [i for i, v in enumerate(values) if v is not None and 10.5 <= v <= 99.0]
+        self.assertEqual(ColumnDB.scan_between(self.path, "x", 10.5, 99), expected)
+    
+    def test_nan_in_covered_group(self):
+        """Test that NaN rows of a group inside the range are not returned"""
+        db = ColumnDB()
+        db.add_column("x", DataType.FLOAT32)
+        db.set_row_group_size(64)
+        db.insert_rows([(float("nan") if i == 1 else 1.0 + (i % 2) / 2,) for i in range(64)])
+        db.save(self.path)
+        
+        rows, groups_read, _ = ColumnDB.scan_between(self.path, "x", 0, 2, with_stats=True)
+        self.assertEqual(rows, [i for i in range(64) if i != 1])
+        self.assertEqual(groups_read, 1)
+    
+    def test_matches_full_scan(self):
+        """Test scan results against a Python filter on unsorted data"""
+        db = ColumnDB()
+        db.add_column("a", DataType.INT32)
+        db.add_column("name", DataType.STRING)
+        db.set_row_group_size(64)
+        values = [(i * 37) % 101 - 50 for i in range(500)]
+        db.append_array("a", array.array("i", values))
+        db.append_array("name", [str(v) for v in values])
+        db.save(self.path)
+        
+        expected = [i for i, v in enumerate(values) if -10 <= v <= 20]
+        self.assertEqual(ColumnDB.scan_between(self.path, "a", -10, 20), expected)
+        self.assertEqual(ColumnDB.load(self.path).get_column_data("a"), values)
+        with self.assertRaises(IOError):
+            ColumnDB.scan_between(self.path, "name", 0, 1)
+        with self.assertRaises(ValueError):
+            db.set_row_group_size(100)
+
+
+class TestColumnEncoding(unittest.TestCase):
+    """Test RLE, delta and frame-of-reference column encodings"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "encoded.cdb")
+    
+    def tearDown(self):
+        self.tmpdir.cleanup()
+    
+    def save_size(self, db, encoding):
+        db.set_column_encoding(encoding)
+        db.save(self.path)
+        return os.path.getsize(self.path)
+    
+    def test_encoded_files_are_smaller(self):
+        """Test that sorted, narrow and boolean columns shrink and round-trip"""
+        n = 10000
+        db = ColumnDB()
+        db.add_column("ts", DataType.INT64)
+        db.add_column("code", DataType.INT32)
+        db.add_column("flag", DataType.BOOL)
+        db.add_column("level", DataType.FLOAT64)
+        ts = array.array("q", range(1_700_000_000_000, 1_700_000_000_000 + 1000 * n, 1000))
+        codes = array.array("i", [100 + (i * 7) % 13 for i in range(n)])
+        db.append_array("ts", ts)
+        db.append_array("code", codes)
+        db.append_array("flag", bytes(i % 2 for i in range(n)))
+        db.append_array("level", array.array("d", [float(i // 500) for i in range(n)]))
+        
+        plain = self.save_size(db, False)
+        encoded = self.save_size(db, True)
+        self.assertLess(encoded * 4, plain)
+        
+        for mmap in (False, True):
+            loaded = ColumnDB.load(self.path, mmap=mmap)
+            self.assertEqual(loaded.get_column_data("ts"), list(ts))
+            self.assertEqual(loaded.get_column_data("code"), list(codes))
+            self.assertEqual(loaded.get_column_data("flag"), [bool(i % 2) for i in range(n)])
+            self.assertEqual(loaded.sum("level"), float(sum(i // 500 for i in range(n))))
+    
+    def test_nulls_and_extremes(self):
+        """Test NULL rows and full-range values across row groups"""
+        db = ColumnDB()
+        db.add_column("x", DataType.INT64)
+        db.set_row_group_size(64)
+        values = [None if i % 10 == 3 else i * 3 for i in range(300)]
+        values += [-2**63, 2**63 - 1, None, 0]
+        for value in values:
+            db.insert("x", value)
+        db.save(self.path)
+        
+        for mmap in (False, True):
+            loaded = ColumnDB.load(self.path, mmap=mmap)
+            self.assertEqual(loaded.get_column_data("x"), values)
+            self.assertEqual(loaded.get_null_count("x"), values.count(None))
+    
+    def test_scan_encoded_column(self):
+        """Test that zone-map scans decode only the groups they read"""
+        db = ColumnDB()
+        db.add_column("ts", DataType.INT64)
+        db.set_row_group_size(256)
+        db.append_array("ts", array.array("q", range(0, 20000, 2)))
+        db.save(self.path)
+        
+        rows, groups_read, groups_total = ColumnDB.scan_between(
+            self.path, "ts", 5001, 5020, with_stats=True)
+        self.assertEqual(rows, list(range(2501, 2511)))
+        self.assertEqual((groups_read, groups_total), (1, 40))
+
+
+class TestCompression(unittest.TestCase):
+    """Test block compression of saved columns"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "compressed.cdb")
+    
+    def tearDown(self):
+        self.tmpdir.cleanup()
+    
+    def make_db(self, n):
+        db = ColumnDB()
+        db.add_column("id", DataType.INT64)
+        db.add_column("name", DataType.STRING)
+        db.add_column("status", DataType.DICT_STRING)
+        db.add_column("score", DataType.FLOAT64)
+        db.append_array("id", array.array("q", [i * 7919 % 100003 for i in range(n)]))
+        db.append_array("name", [None if i % 11 == 0 else f"user-{i % 500}" for i in range(n)])
+        db.append_array("status", [("open", "closed")[i % 2] for i in range(n)])
+        db.append_array("score", array.array("d", [float(i % 40) for i in range(n)]))
+        return db
+    
+    def test_zlib_round_trip(self):
+        """Test that compressed files are smaller and load the same way plain ones do"""
+        n = 20000
+        db = self.make_db(n)
+        db.save(self.path)
+        plain = os.path.getsize(self.path)
+        db.save(self.path, compression="zlib", level=6)
+        self.assertLess(os.path.getsize(self.path) * 2, plain)
+        
+        for mmap in (False, True):
+            loaded = ColumnDB.load(self.path, mmap=mmap)
+            for name in ("id", "name", "status", "score"):
+                self.assertEqual(loaded.get_column_data(name), db.get_column_data(name))
+            self.assertEqual(loaded.get_null_count("name"), db.get_null_count("name"))
+        
+        loaded = ColumnDB.load(self.path, columns=["score"])
+        self.assertEqual(loaded.sum("score"), db.sum("score"))
+    
+    def test_scan_compressed_column(self):
+        """Test that zone-map scans work on compressed columns"""
+        db = ColumnDB()
+        db.add_column("x", DataType.INT32)
+        db.set_row_group_size(512)
+        values = [None if i % 9 == 0 else i % 1000 for i in range(10000)]
+        for value in values:
+            db.insert("x", value)
+        db.save(self.path, compression="zlib")
+        
+        rows = ColumnDB.scan_between(self.path, "x", 100, 120)
+        self.assertEqual(rows, [i for i, v in enumerate(values) if v is not None and 100 <= v <= 120])
+    
+    def test_invalid_options(self):
+        """Test unknown codecs, codecs missing from the build and bad levels"""
+        db = self.make_db(10)
+        self.assertTrue(ColumnDB.compression_available("zlib"))
+        with self.assertRaises(ValueError):
+            db.save(self.path, compression="gzip")
+        with self.assertRaises(ValueError):
+            db.save(self.path, compression="zlib", level=10)
+        for codec in ("zstd", "lz4"):
+            if not ColumnDB.compression_available(codec):
+                with self.assertRaises(ValueError):
+                    db.save(self.path, compression=codec)
+        
+        # A failed save leaves later saves uncompressed
+        db.save(self.path)
+        self.assertEqual(ColumnDB.load(self.path).get_column_data("id"), db.get_column_data("id"))
+
+
+class TestParallelIO(unittest.TestCase):
+    """Test multi-threaded saves and loads"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "parallel.cdb")
+    
+    def tearDown(self):
+        self.tmpdir.cleanup()
+    
+    def test_thread_count_does_not_change_file(self):
+        """Test that saves with several threads write the same columns as one thread"""
+        n = 5000
+        db = ColumnDB()
+        types = [DataType.INT64, DataType.STRING, DataType.FLOAT64, DataType.BOOL, DataType.DICT_STRING]
+        for c in range(20):
+            db.add_column(f"c{c}", types[c % len(types)])
+        for c in range(0, 20, len(types)):
+            db.append_array(f"c{c}", array.array("q", [i * (c + 1) for i in range(n)]))
+            db.append_array(f"c{c + 1}", [None if i % 13 == 0 else f"s{i % (c + 50)}" for i in range(n)])
+            db.append_array(f"c{c + 2}", array.array("d", [i / (c + 3) for i in range(n)]))
+            db.append_array(f"c{c + 3}", bytes(i % 3 == 0 for i in range(n)))
+            db.append_array(f"c{c + 4}", [("a", "b", "c")[i % 3] for i in range(n)])
+        
+        for compression in (None, "zlib"):
+            db.set_num_threads(1)
+            db.save(self.path, compression=compression)
+            with open(self.path, "rb") as f:
+                serial = f.read()
+            db.set_num_threads(4)
+            db.save(self.path, compression=compression)
+            with open(self.path, "rb") as f:
+                parallel = f.read()
+            # Bytes 16-24 hold the save timestamp
+            self.assertEqual(parallel[:16] + parallel[24:], serial[:16] + serial[24:])
+            
+            loaded = ColumnDB.load(self.path, threads=4)
+            for c in range(20):
+                self.assertEqual(loaded.get_column_data(f"c{c}"), db.get_column_data(f"c{c}"))
+            loaded = ColumnDB.load(self.path, columns=["c6", "c2"], threads=3)
+            self.assertEqual(loaded.get_column_data("c6"), db.get_column_data("c6"))
+    
+    def test_invalid_thread_count(self):
+        """Test that negative thread counts are rejected"""
+        db = ColumnDB()
+        with self.assertRaises(ValueError):
+            db.set_num_threads(-1)
+        db.add_column("x", DataType.INT32)
+        db.insert("x", 5)
+        db.save(self.path)
+        with self.assertRaises(ValueError):
+            ColumnDB.load(self.path, threads=-2)
+        self.assertEqual(ColumnDB.load(self.path, threads=0).get_column_data("x"), [5])
+
+
+class TestConcurrentAccess(unittest.TestCase):
+    """Test one database used from several Python threads"""
+    
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "shared.cdb")
+    
+    def tearDown(self):
+        self.tmpdir.cleanup()
+    
+    def run_threads(self, targets):
+        errors = []
+        def guarded(target):
+            try:
+                target()
+            except Exception as e:
+                errors.append(e)
+        threads = [threading.Thread(target=guarded, args=(t,)) for t in targets]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual(errors, [])
+    
+    def test_concurrent_saves_to_one_file(self):
+        """Test that saves racing to one file leave one complete database in it"""
+        dbs = []
+        for k in range(4):
+            db = ColumnDB()
+            db.add_column("x", DataType.INT64)
+            db.append_array("x", array.array("q", [k] * 20000))
+            dbs.append(db)
+        
+        def saver(db):
+            def run():
+                for _ in range(10):
+                    db.save(self.path)
+            return run
+        
+        self.run_threads([saver(db) for db in dbs])
+        loaded = ColumnDB.load(self.path)
+        values = set(loaded.get_column_data("x"))
+        self.assertEqual(loaded.get_num_rows(), 20000)
+        self.assertEqual(len(values), 1)
+        self.assertEqual(os.listdir(self.tmpdir.name), ["shared.cdb"])
+    
+    def test_readers_and_writer(self):
+        """Test that saves and aggregates run safely while another thread appends"""
+        db = ColumnDB()
+        db.add_column("x", DataType.INT64)
+        db.append_array("x", array.array("q", range(50000)))
+        base = sum(range(50000))
+        
+        def reader(k):
+            def run():
+                for _ in range(10):
+                    self.assertGreaterEqual(db.sum("x"), base)
+                    db.save(os.path.join(self.tmpdir.name, f"r{k}.cdb"), compression="zlib")
+            return run
+        
+        def writer():
+            for i in range(1000):
+                db.insert("x", 1)
+        
+        self.run_threads([reader(0), reader(1), writer])
+        self.assertEqual(db.get_num_rows(), 51000)
+        self.assertEqual(db.sum("x"), base + 1000)
+        for k in range(2):
+            self.assertGreaterEqual(ColumnDB.load(os.path.join(self.tmpdir.name, f"r{k}.cdb")).sum("x"), base)
+    
+    def test_lazy_columns_from_many_threads(self):
+        """Test that lazily materialized mapped columns are loaded once for all readers"""
+        db = ColumnDB()
+        db.add_column("ts", DataType.INT64)
+        db.add_column("name", DataType.STRING)
+        db.append_array("ts", array.array("q", range(0, 30000, 3)))
+        db.append_array("name", [f"n{i % 97}" for i in range(10000)])
+        db.save(self.path, compression="zlib")
+        
+        mapped = ColumnDB.load(self.path, mmap=True)
+        expected_names = db.get_column_data("name")
+        
+        def reader():
+            self.assertEqual(mapped.sum("ts"), db.sum("ts"))
+            self.assertEqual(mapped.get_column_data("name"), expected_names)
+        
+        self.run_threads([reader] * 4)
+    
+    def test_errors_are_per_thread(self):
+        """Test that concurrent failures each report their own error"""
+        db = ColumnDB()
+        db.add_column("x", DataType.INT32)
+        db.insert("x", 1)
+        db.save(self.path)
+        missing = os.path.join(self.tmpdir.name, "missing.cdb")
+        
+        def scan_missing_column():
+            for _ in range(200):
+                with self.assertRaisesRegex(IOError, "Failed to scan database: Column not found"):
+                    ColumnDB.scan_between(self.path, "y", 0, 1)
+        
+        def load_missing_file():
+            for _ in range(200):
+                with self.assertRaisesRegex(IOError, "Failed to load database: Failed to open file"):
+                    ColumnDB.load(missing)
+        
+        self.run_threads([scan_missing_column, load_missing_file] * 2)
+
+    def test_writer_not_starved_by_readers(self):
+        """Test that a writer gets the lock while other threads keep reading"""
+        db = ColumnDB()
+        db.add_column("x", DataType.INT64)
+        db.append_array("x", array.array("q", range(2000000)))
+        stop = threading.Event()
+        
+        def reader():
+            while not stop.is_set():
+                db.sum("x")
+        
+        readers = [threading.Thread(target=reader) for _ in range(2)]
+        for t in readers:
+            t.start()
+        try:
+            writer = threading.Thread(target=db.insert_rows, args=([(1,)] * 10,))
+            writer.start()
+            writer.join(10)
+            self.assertFalse(writer.is_alive(), "writer starved by readers")
+        finally:
+            stop.set()
+            for t in readers:
+                t.join()
+            writer.join()
+        self.assertEqual(db.get_num_rows(), 2000010)
+
+
 class TestDataTypes(unittest.TestCase):
     """Test all supported data types"""
     